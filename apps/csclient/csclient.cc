@@ -20,6 +20,7 @@
 
 #include "csclient.hh"
 
+using namespace std;
 
 #define INCLUDE_TEST_CODE 0
 
@@ -98,6 +99,8 @@ ControlSocketClient::configure(unsigned int host_ip, unsigned short port)
     return click_err; /* wrong version */
   }
 
+  _binary = false;
+  _samples.clear();
   _init = true;
   return no_err;
 }
@@ -173,6 +176,17 @@ ControlSocketClient::read(string el, string handler, string &response)
 
   if (el.size() > 0)
     handler = el + "." + handler;
+
+  if (_binary) {
+    unsigned tag;
+    vector<value_t> values;
+    err_t err = binary_call(OP_READ, 0, 0, vector<string>(1, handler), tag, values);
+    if (err == no_err && values.size() != 1)
+      err = click_err;
+    if (err == no_err && (err = values[0].err) == no_err)
+      response = values[0].str;
+    return err;
+  }
   string cmd = "READ " + handler + "\n";
 
   int res = ::write(_fd, cmd.c_str(), cmd.size());
@@ -251,6 +265,19 @@ ControlSocketClient::write(string el, string handler, const char *buf, int bufsz
 
   if (el.size() > 0)
     handler = el + "." + handler;
+
+  if (_binary) {
+    vector<string> args;
+    args.push_back(handler);
+    args.push_back(string(buf, bufsz));
+    unsigned tag;
+    vector<value_t> values;
+    err_t err = binary_call(OP_WRITE, 0, 0, args, tag, values);
+    if (err == no_err && values.size() != 1)
+      err = click_err;
+    return (err == no_err ? values[0].err : err);
+  }
+
   char cbuf[10];
   snprintf(cbuf, sizeof(cbuf), "%d", bufsz);
   string cmd = "WRITEDATA " + handler + " " + cbuf + "\n";
@@ -411,6 +438,13 @@ ControlSocketClient::check_handler(string el, string h, bool is_write, bool &exi
 {
   check_init();
 
+  if (_binary) {
+    /* the binary protocol has no check command */
+    if (el.size() == 0)
+      return click_err;
+    return check_handler_workaround(el, h, is_write, exists);
+  }
+
   if (el.size() > 0)
     h = el + "." + h;
   string cmd = (is_write ? "CHECKWRITE " : "CHECKREAD ") + h + "\n";
@@ -486,6 +520,261 @@ ControlSocketClient::check_handler_workaround(string el, string h, bool is_write
 }
 
 
+ControlSocketClient::err_t
+ControlSocketClient::use_binary()
+{
+  check_init();
+  if (_binary)
+    return no_err;
+
+  string cmd = "BINARY\n";
+  int res = ::write(_fd, cmd.c_str(), cmd.size());
+  if (res < 0 || (size_t) res != cmd.size())
+    return sys_err;
+
+  string line;
+  do {
+    err_t err = readline(line);
+    if (err != no_err)
+      return err;
+    if (line.size() < 4)
+      return click_err;
+  }
+  while (line[3] == '-');
+
+  int code = get_resp_code(line);
+  if (code != CODE_OK)
+    return handle_err_code(code);
+  _binary = true;
+  return no_err;
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::readn(char *buf, size_t n)
+{
+  size_t pos = 0;
+  while (pos < n) {
+    int res = ::read(_fd, buf + pos, n - pos);
+    if (res <= 0)
+      return sys_err;
+    pos += res;
+  }
+  return no_err;
+}
+
+
+static void
+append_u32(string &s, unsigned x)
+{
+  x = htonl(x);
+  s.append((const char *) &x, 4);
+}
+
+static unsigned
+extract_u32(const char *s)
+{
+  unsigned x;
+  memcpy(&x, s, 4);
+  return ntohl(x);
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::send_frame(int opcode, int flags, unsigned tag, unsigned arg,
+                                const vector<string> &args)
+{
+  string frame;
+  append_u32(frame, 0);
+  frame += (char) opcode;
+  frame += (char) flags;
+  unsigned short nargs = htons(args.size());
+  frame.append((const char *) &nargs, 2);
+  append_u32(frame, tag);
+  append_u32(frame, arg);
+  for (vector<string>::const_iterator i = args.begin(); i != args.end(); i++) {
+    append_u32(frame, i->size());
+    frame += *i;
+  }
+  unsigned len = htonl(frame.size());
+  memcpy(&frame[0], &len, 4);
+
+  size_t pos = 0;
+  while (pos < frame.size()) {
+    int res = ::write(_fd, frame.data() + pos, frame.size() - pos);
+    if (res < 0)
+      return sys_err;
+    pos += res;
+  }
+  return no_err;
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::read_frame(int &opcode, unsigned &tag, unsigned &arg,
+                                vector<value_t> &values)
+{
+  char hdr[16];
+  err_t err = readn(hdr, 16);
+  if (err != no_err)
+    return err;
+  unsigned len = extract_u32(hdr);
+  if (len < 16)
+    return click_err;
+  opcode = (unsigned char) hdr[4];
+  unsigned short nvalues;
+  memcpy(&nvalues, hdr + 6, 2);
+  nvalues = ntohs(nvalues);
+  tag = extract_u32(hdr + 8);
+  arg = extract_u32(hdr + 12);
+
+  string body(len - 16, '\0');
+  if (body.size() && (err = readn(&body[0], body.size())) != no_err)
+    return err;
+
+  values.resize(0);
+  size_t pos = 0;
+  for (int n = 0; n < nvalues; n++) {
+    if (body.size() - pos < 8)
+      return click_err;
+    const char *v = body.data() + pos;
+    unsigned short code;
+    memcpy(&code, v, 2);
+    code = ntohs(code);
+    unsigned vlen = extract_u32(v + 4);
+    if (body.size() - pos - 8 < vlen)
+      return click_err;
+
+    value_t value;
+    value.type = (value_type_t) (unsigned char) v[2];
+    if (code != CODE_OK && code != CODE_OK_WARN)
+      value.err = handle_err_code(code);
+    if (value.type == value_string)
+      value.str.assign(v + 8, vlen);
+    else if (vlen == 8) {
+      uint64_t x = ((uint64_t) extract_u32(v + 8) << 32) | extract_u32(v + 12);
+      value.i = (int64_t) x;
+      value.u = x;
+      memcpy(&value.d, &x, 8);
+    } else
+      return click_err;
+    values.push_back(value);
+    pos += 8 + vlen;
+  }
+  return no_err;
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::binary_call(int opcode, int flags, unsigned arg,
+                                 const vector<string> &args,
+                                 unsigned &tag, vector<value_t> &values)
+{
+  tag = ++_next_tag;
+  err_t err = send_frame(opcode, flags, tag, arg, args);
+  if (err != no_err)
+    return err;
+
+  /* save subscription samples that arrive before the response */
+  while (1) {
+    int r_opcode;
+    unsigned r_tag, r_arg;
+    err = read_frame(r_opcode, r_tag, r_arg, values);
+    if (err != no_err)
+      return err;
+    if (r_opcode == OP_STREAM) {
+      sample_t s;
+      s.tag = r_tag;
+      s.seq = r_arg;
+      s.values.swap(values);
+      _samples.push_back(s);
+    } else if (r_tag == tag)
+      return (r_opcode == opcode ? no_err : click_err);
+  }
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::read_batch(const vector<string> &handlers, vector<value_t> &values, bool typed)
+{
+  check_init();
+  if (!_binary)
+    return click_err;
+  unsigned tag;
+  err_t err = binary_call(OP_READ_BATCH, typed ? FLAG_TYPED : 0, 0, handlers, tag, values);
+  if (err == no_err && values.size() != handlers.size())
+    return click_err;
+  return err;
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::subscribe(const vector<string> &handlers, unsigned interval_ms,
+                               unsigned &tag, vector<value_t> &values, bool typed)
+{
+  check_init();
+  if (!_binary || interval_ms == 0)
+    return click_err;
+  err_t err = binary_call(OP_SUBSCRIBE, typed ? FLAG_TYPED : 0, interval_ms, handlers, tag, values);
+  if (err == no_err && values.size() != handlers.size())
+    return click_err;
+  return err;
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::unsubscribe(unsigned tag)
+{
+  check_init();
+  if (!_binary)
+    return click_err;
+  /* UNSUBSCRIBE names the subscription by its own tag */
+  err_t err = send_frame(OP_UNSUBSCRIBE, 0, tag, 0, vector<string>());
+  if (err != no_err)
+    return err;
+  while (1) {
+    int r_opcode;
+    unsigned r_tag, r_arg;
+    vector<value_t> values;
+    err = read_frame(r_opcode, r_tag, r_arg, values);
+    if (err != no_err)
+      return err;
+    if (r_opcode == OP_UNSUBSCRIBE && r_tag == tag)
+      return (values.size() == 1 ? values[0].err : click_err);
+    else if (r_opcode == OP_STREAM && r_tag != tag) {
+      sample_t s;
+      s.tag = r_tag;
+      s.seq = r_arg;
+      s.values.swap(values);
+      _samples.push_back(s);
+    }
+  }
+}
+
+
+ControlSocketClient::err_t
+ControlSocketClient::next_sample(unsigned &tag, unsigned &seq, vector<value_t> &values)
+{
+  check_init();
+  if (!_binary)
+    return click_err;
+  if (!_samples.empty()) {
+    sample_t &s = _samples.front();
+    tag = s.tag;
+    seq = s.seq;
+    values.swap(s.values);
+    _samples.pop_front();
+    return no_err;
+  }
+  while (1) {
+    int opcode;
+    err_t err = read_frame(opcode, tag, seq, values);
+    if (err != no_err || opcode == OP_STREAM)
+      return err;
+  }
+}
+
+
 string
 ControlSocketClient::trim(string s)
 {
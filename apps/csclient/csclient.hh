@@ -6,11 +6,14 @@
 
 #include <string>
 #include <vector>
+#include <deque>
 
 #include <assert.h>
+#include <stdint.h>
 
 #include <unistd.h>
 
+
 /*
  * NB: obscure implementation note: this class does not handle EINTR
  * errors from any of the read/write calls.  If this is relevant to
@@ -20,8 +23,8 @@
 class ControlSocketClient
 {
 public:
-  ControlSocketClient() : _init(false), _fd(0) { }
-  ControlSocketClient(ControlSocketClient &) : _init(false), _fd(0) { }
+  ControlSocketClient() : _init(false), _fd(0), _binary(false), _next_tag(0) { }
+  ControlSocketClient(ControlSocketClient &) : _init(false), _fd(0), _binary(false), _next_tag(0) { }
 
   enum err_t {
     no_err = 0,
@@ -57,7 +60,7 @@ public:
    * Return a string describing the ControlSocket's host and port.
    * Requires: object is configured
    */
-  const string name() { assert(_init); return _name; }
+  const std::string name() { assert(_init); return _name; }
 
 
   /*
@@ -74,47 +77,47 @@ public:
    * CONFIG is filled with the configuration; existing contents are replaced.
    * Returns: no_err, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_router_config(string &config)         { return read("", "config", config); }
-  err_t get_router_flat_config(string &config)    { return read("", "flatconfig", config); }
+  err_t get_router_config(std::string &config)         { return read("", "config", config); }
+  err_t get_router_flat_config(std::string &config)    { return read("", "flatconfig", config); }
 
   /*
    * Get a string containing the router's version
    * VERS is filled with the version; existing contents are replaced.
    * Returns: no_err, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_router_version(string &vers)  { err_t err = read("", "version", vers); vers = trim(vers); return err; }
+  err_t get_router_version(std::string &vers)  { err_t err = read("", "version", vers); vers = trim(vers); return err; }
 
   /*
    * Get the names of the elements in the the current router configuration.
    * ELS is filled with the names, existing contents are replaced.
    * Returns: no_err, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_config_el_names(vector<string> &els);
+  err_t get_config_el_names(std::vector<std::string> &els);
 
   /*
    * Get the names of the element types that the router knows about.
    * CLASSES is filled with the names, existing contents are replaced.
    * Returns: no_err, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_router_classes(vector<string> &classes)   { return get_string_vec("", "classes", classes); }
+  err_t get_router_classes(std::vector<std::string> &classes)   { return get_string_vec("", "classes", classes); }
 
   /*
    * Get the names of the packages that the router knows about.
    * PACKAGES is filled with the names, existing contents are replaced.
    * Returns: no_err, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_router_packages(vector<string> &pkgs)  { return get_string_vec("", "packages", pkgs); }
+  err_t get_router_packages(std::vector<std::string> &pkgs)  { return get_string_vec("", "packages", pkgs); }
 
   /*
    * Get the names of the current router configuration requirements.
    * REQS is filled with the names, existing contents are replaced.
    * Returns: no_err, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_config_reqs(vector<string> &reqs)         { return get_string_vec("", "requirements", reqs); }
+  err_t get_config_reqs(std::vector<std::string> &reqs)         { return get_string_vec("", "requirements", reqs); }
 
   struct handler_info_t {
-    string element_name;
-    string handler_name;
+    std::string element_name;
+    std::string handler_name;
     bool can_read;
     bool can_write;
     handler_info_t() : can_read(false), can_write(false) { }
@@ -126,7 +129,7 @@ public:
    * HANDLERS is filled with the handler info, existing contents are replaced.
    * Returns: no_err, no_element, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t get_el_handlers(string el, vector<handler_info_t> &handlers);
+  err_t get_el_handlers(std::string el, std::vector<handler_info_t> &handlers);
 
   /*
    * Check whether a read/write handler exists.
@@ -136,9 +139,9 @@ public:
    * EXISTS is filled with true if the handler exists, otherwise false.
    * Returns: no_err, sys_err, init_err, click_err
    */
-  err_t check_handler(string el, string h, bool is_write, bool &exists);
+  err_t check_handler(std::string el, std::string h, bool is_write, bool &exists);
 protected:
-  err_t check_handler_workaround(string el, string h, bool is_write, bool &exists);
+  err_t check_handler_workaround(std::string el, std::string h, bool is_write, bool &exists);
 
 public:
   /*
@@ -149,7 +152,7 @@ public:
    * If NAME is not empty, calls``NAME.HANDLER''; otherwise calls ``HANDLER''
    * Returns: no_err, no_element, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t read(string el, string handler, string &response);
+  err_t read(std::string el, std::string handler, std::string &response);
 
   /*
    * Return the results of reading a handler.
@@ -162,7 +165,7 @@ public:
    * If returns too_short, the operation succeeded, but returned more than BUFSZ characters; the first BUFSZ
    * characters of the result are placed into BUF, and BUFSZ is unchanged.
    */
-  err_t read(string el, string handler, char *buf, int &bufsz);
+  err_t read(std::string el, std::string handler, char *buf, int &bufsz);
 
   /*
    * Write data to an element's handler.
@@ -172,7 +175,7 @@ public:
    * If NAME is not empty, calls``NAME.HANDLER''; otherwise calls ``HANDLER''
    * Returns: no_err, no_element, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t write(string el, string handler, string data);
+  err_t write(std::string el, std::string handler, std::string data);
 
   /*
    * Write data to an element's handler.
@@ -183,17 +186,79 @@ public:
    * If NAME is not empty, calls``NAME.HANDLER''; otherwise calls ``HANDLER''
    * Returns: no_err, no_element, no_handler, handler_err, handler_no_perm, sys_err, init_err, click_err
    */
-  err_t write(string el, string handler, const char *buf, int bufsz);
+  err_t write(std::string el, std::string handler, const char *buf, int bufsz);
 
   /*
    * sugar, for reading and writing handlers.
    */
-  err_t read(handler_info_t h, string &response)      { return read(h.element_name, h.handler_name, response); }
+  err_t read(handler_info_t h, std::string &response)      { return read(h.element_name, h.handler_name, response); }
   err_t read(handler_info_t h, char *buf, int &bufsz) { return read(h.element_name, h.handler_name, buf, bufsz); }
-  err_t write(handler_info_t h, string data)          { return write(h.element_name, h.handler_name, data); }
+  err_t write(handler_info_t h, std::string data)          { return write(h.element_name, h.handler_name, data); }
   err_t write(handler_info_t h, const char *buf, int bufsz) { return write(h.element_name, h.handler_name, buf, bufsz); }
 
 
+  /*
+   * Switch the connection to ControlSocket's binary protocol (version
+   * 1.4 and later).  Afterwards read() and write() use binary frames,
+   * and the batch and subscription functions below become available.
+   * There is no way back to the text protocol.
+   * Returns: no_err, sys_err, init_err, click_err
+   */
+  err_t use_binary();
+
+  enum value_type_t {
+    value_string = 0,
+    value_int = 1,
+    value_uint = 2,
+    value_double = 3
+  };
+
+  struct value_t {
+    err_t err;          /* no_err, or why this handler failed */
+    value_type_t type;
+    std::string str;         /* value_string value, or error message */
+    int64_t i;          /* value_int value */
+    uint64_t u;         /* value_uint value */
+    double d;           /* value_double value */
+    value_t() : err(no_err), type(value_string), i(0), u(0), d(0) { }
+  };
+
+  /*
+   * Read several handlers in one round trip.  Requires use_binary().
+   * HANDLERS are full handler names, like ``c.count''.
+   * VALUES is filled with one value per handler, in order.
+   * If TYPED, numeric results are returned as numbers rather than strings.
+   * Returns: no_err, sys_err, init_err, click_err
+   * A failing handler doesn't fail the batch; check each value's err.
+   */
+  err_t read_batch(const std::vector<std::string> &handlers, std::vector<value_t> &values, bool typed = true);
+
+  /*
+   * Ask the router to send HANDLERS' values every INTERVAL_MS
+   * milliseconds.  Requires use_binary().
+   * TAG is filled with the subscription's tag.  VALUES is filled with
+   * the first sample.
+   * Returns: no_err, sys_err, init_err, click_err
+   */
+  err_t subscribe(const std::vector<std::string> &handlers, unsigned interval_ms, unsigned &tag,
+                  std::vector<value_t> &values, bool typed = true);
+
+  /*
+   * Cancel subscription TAG.  Samples already sent may still arrive.
+   * Returns: no_err, sys_err, init_err, click_err
+   */
+  err_t unsubscribe(unsigned tag);
+
+  /*
+   * Wait for the next subscription sample.
+   * TAG is filled with the subscription's tag, SEQ with the sample
+   * number (samples the router dropped for a slow client leave gaps),
+   * and VALUES with the values.
+   * Returns: no_err, sys_err, init_err, click_err
+   */
+  err_t next_sample(unsigned &tag, unsigned &seq, std::vector<value_t> &values);
+
+
   ~ControlSocketClient() { if (_init) ::close(_fd); }
 
 private:
@@ -203,8 +268,17 @@ private:
   unsigned short _port;
   int _fd;
   int _protocol_minor_version;
+  bool _binary;
+  unsigned _next_tag;
 
-  string _name;
+  struct sample_t {
+    unsigned tag;
+    unsigned seq;
+    std::vector<value_t> values;
+  };
+  std::deque<sample_t> _samples;
+
+  std::string _name;
 
   enum {
     CODE_OK = 200,
@@ -218,18 +292,32 @@ private:
     CODE_NO_ROUTER = 540,
 
     PROTOCOL_MAJOR_VERSION = 1,
-    PROTOCOL_MINOR_VERSION = 0
+    PROTOCOL_MINOR_VERSION = 0,
+
+    OP_READ = 1,
+    OP_WRITE = 2,
+    OP_READ_BATCH = 3,
+    OP_SUBSCRIBE = 4,
+    OP_UNSUBSCRIBE = 5,
+    OP_STREAM = 7,
+    FLAG_TYPED = 1
   };
 
   /* Try to read a '\n'-terminated line (including the '\n') from the
    * socket.  */
-  err_t readline(string &buf);
+  err_t readline(std::string &buf);
 
-  int get_resp_code(string line);
-  int get_data_len(string line);
+  int get_resp_code(std::string line);
+  int get_data_len(std::string line);
   err_t handle_err_code(int code);
 
-  err_t get_string_vec(string el, string h, vector<string> &v);
-  vector<string> split(string s, size_t offset, char terminator);
-  string trim(string s);
+  err_t readn(char *buf, size_t n);
+  err_t send_frame(int opcode, int flags, unsigned tag, unsigned arg, const std::vector<std::string> &args);
+  err_t read_frame(int &opcode, unsigned &tag, unsigned &arg, std::vector<value_t> &values);
+  err_t binary_call(int opcode, int flags, unsigned arg, const std::vector<std::string> &args,
+                    unsigned &tag, std::vector<value_t> &values);
+
+  err_t get_string_vec(std::string el, std::string h, std::vector<std::string> &v);
+  std::vector<std::string> split(std::string s, size_t offset, char terminator);
+  std::string trim(std::string s);
 };
@@ -19,14 +19,16 @@
 #include "aggcounter.hh"
 #include <click/handlercall.hh>
 #include <click/args.hh>
+#include <click/jsonstream.hh>
 #include <click/error.hh>
 #include <click/packet_anno.hh>
-#include <click/integers.hh>	// for first_bit_set
+#include <click/heap.hh>
 #include <click/router.hh>
 CLICK_DECLS
 
 AggregateCounter::AggregateCounter()
-    : _root(0), _free(0), _call_nnz_h(0), _call_count_h(0)
+    : _table(0), _table_bits(0), _sketch_rows(0), _top(0),
+      _call_nnz_h(0), _call_count_h(0)
 {
 }
 
@@ -34,22 +36,6 @@ AggregateCounter::~AggregateCounter()
 {
 }
 
-AggregateCounter::Node *
-AggregateCounter::new_node_block()
-{
-    assert(!_free);
-    int block_size = 1024;
-    Node *block = new Node[block_size];
-    if (!block)
-	return 0;
-    _blocks.push_back(block);
-    for (int i = 1; i < block_size - 1; i++)
-	block[i].child[0] = &block[i+1];
-    block[block_size - 1].child[0] = 0;
-    _free = &block[1];
-    return &block[0];
-}
-
 int
 AggregateCounter::configure(Vector<String> &conf, ErrorHandler *errh)
 {
@@ -62,6 +48,10 @@ AggregateCounter::configure(Vector<String> &conf, ErrorHandler *errh)
     String call_nnz, call_count;
     freeze_nnz = stop_nnz = _call_nnz = (uint32_t)(-1);
     freeze_count = stop_count = _call_count = (uint64_t)(-1);
+    bool sketch = false;
+    uint32_t sketch_width = 65536;
+    _sketch_depth = 4;
+    _top_capacity = 100;
 
     if (Args(conf, this, errh)
 	.read("BYTES", bytes)
@@ -74,13 +64,31 @@ AggregateCounter::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("COUNT_STOP", stop_count)
 	.read("AGGREGATE_CALL", AnyArg(), call_nnz)
 	.read("COUNT_CALL", AnyArg(), call_count)
-	.read("BANNER", _output_banner).complete() < 0)
+	.read("BANNER", _output_banner)
+	.read("SKETCH", sketch)
+	.read("SKETCH_WIDTH", sketch_width)
+	.read("SKETCH_DEPTH", BoundedIntArg(1, (int) SKETCH_MAX_DEPTH), _sketch_depth)
+	.read("TOP", _top_capacity).complete() < 0)
 	return -1;
 
     _bytes = bytes;
     _ip_bytes = ip_bytes;
     _use_packet_count = packet_count;
     _use_extra_length = extra_length;
+    _sketch = sketch;
+
+    if (_sketch) {
+	if (freeze_nnz != (uint32_t)(-1) || stop_nnz != (uint32_t)(-1) || call_nnz)
+	    return errh->error("'AGGREGATE' keywords are incompatible with 'SKETCH'");
+	if (sketch_width == 0 || sketch_width > (1U << 28))
+	    return errh->error("'SKETCH_WIDTH' out of range");
+	if (_top_capacity == 0 || _top_capacity > (1U << 24))
+	    return errh->error("'TOP' out of range");
+	for (_sketch_width_bits = 1; (1U << _sketch_width_bits) < sketch_width; ++_sketch_width_bits)
+	    /* nada */;
+	if (sketch_size() > SKETCH_MAX_SIZE)
+	    return errh->error("sketch too large: 'SKETCH_DEPTH' times 'SKETCH_WIDTH' must be at most %u", (unsigned) SKETCH_MAX_SIZE);
+    }
 
     if ((freeze_nnz != (uint32_t)(-1)) + (stop_nnz != (uint32_t)(-1)) + ((bool)call_nnz) > 1)
 	return errh->error("'AGGREGATE_FREEZE', 'AGGREGATE_STOP', and 'AGGREGATE_CALL' are mutually exclusive");
@@ -121,6 +129,17 @@ AggregateCounter::initialize(ErrorHandler *errh)
     if (_call_count_h && _call_count_h->initialize_write(this, errh) < 0)
 	return -1;
 
+    if (_sketch) {
+	_sketch_rows = new uint32_t[sketch_size()];
+	_top = new Slot[_top_capacity];
+	if (!_sketch_rows || !_top)
+	    return errh->error("out of memory!");
+	for (int i = 0; i < _sketch_depth; ++i) {
+	    _sketch_hash[i][0] = (((uint64_t) click_random() << 32) | click_random()) | 1;
+	    _sketch_hash[i][1] = ((uint64_t) click_random() << 32) | click_random();
+	}
+    }
+
     if (clear(errh) < 0)
 	return -1;
 
@@ -132,84 +151,147 @@ AggregateCounter::initialize(ErrorHandler *errh)
 void
 AggregateCounter::cleanup(CleanupStage)
 {
-    for (int i = 0; i < _blocks.size(); i++)
-	delete[] _blocks[i];
-    _blocks.clear();
+    delete[] _table;
+    delete[] _sketch_rows;
+    delete[] _top;
+    _table = _top = 0;
+    _sketch_rows = 0;
     delete _call_nnz_h;
     delete _call_count_h;
     _call_nnz_h = _call_count_h = 0;
 }
 
-AggregateCounter::Node *
-AggregateCounter::make_peer(uint32_t a, Node *n, bool frozen)
+
+// FLAT TABLE
+
+inline AggregateCounter::Slot *
+AggregateCounter::find_slot(uint32_t agg) const
 {
-    /*
-     * become a peer
-     * algo: create two nodes, the two peers.  leave orig node as
-     * the parent of the two new ones.
-     */
+    uint32_t mask = table_capacity() - 1;
+    uint32_t i = slot_index(agg);
+    while (_table[i].value && _table[i].aggregate != agg)
+	i = (i + 1) & mask;
+    return &_table[i];
+}
 
-    if (frozen)
-	return 0;
+bool
+AggregateCounter::grow_table()
+{
+    if (_table_bits >= 30)
+	return false;
+    Slot *old_table = _table;
+    uint32_t old_capacity = table_capacity();
+    if (!(_table = new Slot[old_capacity * 2])) {
+	_table = old_table;
+	return false;
+    }
+    memset(_table, 0, sizeof(Slot) * old_capacity * 2);
+    ++_table_bits;
+    for (uint32_t i = 0; i < old_capacity; ++i)
+	if (old_table[i].value)
+	    *find_slot(old_table[i].aggregate) = old_table[i];
+    delete[] old_table;
+    return true;
+}
 
-    Node *down[2];
-    if (!(down[0] = new_node()))
-	return 0;
-    if (!(down[1] = new_node())) {
-	free_node(down[0]);
+AggregateCounter::Slot *
+AggregateCounter::insert_slot(uint32_t agg)
+{
+    // keep the load factor at most 1/2 so probe sequences stay short
+    if (_num_nonzero >= (table_capacity() >> 1) && !grow_table()) {
+	click_chatter("AggregateCounter: out of memory!");
 	return 0;
     }
-
-    // swivel is first bit 'a' and 'old->input' differ
-    int swivel = ffs_msb(a ^ n->aggregate);
-    // bitvalue is the value of that bit of 'a'
-    int bitvalue = (a >> (32 - swivel)) & 1;
-    // mask masks off all bits before swivel
-    uint32_t mask = (swivel == 1 ? 0 : (0xFFFFFFFFU << (33 - swivel)));
-
-    down[bitvalue]->aggregate = a;
-    down[bitvalue]->count = 0;
-    down[bitvalue]->child[0] = down[bitvalue]->child[1] = 0;
-
-    *down[1 - bitvalue] = *n;	/* copy orig node down one level */
-
-    n->aggregate = (down[0]->aggregate & mask);
-    if (down[0]->aggregate == n->aggregate) {
-	n->count = down[0]->count;
-	down[0]->count = 0;
-    } else
-	n->count = 0;
-    n->child[0] = down[0];	/* point to children */
-    n->child[1] = down[1];
-
-    return (n->aggregate == a ? n : down[bitvalue]);
+    Slot *s = find_slot(agg);
+    s->aggregate = agg;
+    return s;
 }
 
-AggregateCounter::Node *
-AggregateCounter::find_node(uint32_t a, bool frozen)
+void
+AggregateCounter::erase_slot(Slot *s)
 {
-    // straight outta tcpdpriv
-    Node *n = _root;
-    while (n) {
-	if (n->aggregate == a)
-	    return (n->count || !frozen ? n : 0);
-	if (!n->child[0])
-	    n = make_peer(a, n, frozen);
-	else {
-	    // swivel is the first bit in which the two children differ
-	    int swivel = ffs_msb(n->child[0]->aggregate ^ n->child[1]->aggregate);
-	    if (ffs_msb(a ^ n->aggregate) < swivel) // input differs earlier
-		n = make_peer(a, n, frozen);
-	    else if (a & (1 << (32 - swivel)))
-		n = n->child[1];
-	    else
-		n = n->child[0];
+    // backward-shift deletion: no tombstones, so lookups stay short
+    uint32_t mask = table_capacity() - 1;
+    uint32_t hole = s - _table, j = hole;
+    while (1) {
+	j = (j + 1) & mask;
+	if (!_table[j].value)
+	    break;
+	uint32_t home = slot_index(_table[j].aggregate);
+	if (((j - home) & mask) >= ((j - hole) & mask)) {
+	    _table[hole] = _table[j];
+	    hole = j;
 	}
     }
+    _table[hole].value = 0;
+}
 
-    if (!frozen)
-	click_chatter("AggregateCounter: out of memory!");
-    return 0;
+
+// SKETCH
+
+struct AggregateCounter::TopCompare {
+    bool operator()(const Slot &a, const Slot &b) const {
+	return a.value < b.value;
+    }
+};
+
+struct AggregateCounter::TopPlace {
+    AggregateCounter *ac;
+    TopPlace(AggregateCounter *ac_) : ac(ac_) { }
+    void operator()(Slot *begin, Slot *it) const {
+	ac->find_slot(it->aggregate)->value = it - begin + 1;
+    }
+};
+
+inline uint32_t
+AggregateCounter::sketch_update(uint32_t agg, uint32_t amount)
+{
+    uint32_t *counter[SKETCH_MAX_DEPTH];
+    uint32_t estimate = (uint32_t) -1;
+    for (int i = 0; i < _sketch_depth; ++i) {
+	uint32_t h = (_sketch_hash[i][0] * agg + _sketch_hash[i][1]) >> (64 - _sketch_width_bits);
+	counter[i] = &_sketch_rows[((size_t) i << _sketch_width_bits) + h];
+	if (*counter[i] < estimate)
+	    estimate = *counter[i];
+    }
+    estimate = (estimate + amount < estimate ? (uint32_t) -1 : estimate + amount);
+    // conservative update: raise each counter only as far as the estimate
+    for (int i = 0; i < _sketch_depth; ++i)
+	if (*counter[i] < estimate)
+	    *counter[i] = estimate;
+    return estimate;
+}
+
+inline bool
+AggregateCounter::sketch_update(uint32_t agg, uint32_t amount, bool frozen)
+{
+    Slot *s = find_slot(agg);
+    if (!s->value && frozen)
+	return false;
+
+    uint32_t estimate = sketch_update(agg, amount);
+    Slot *top_end = _top + _num_nonzero;
+    if (s->value) {
+	Slot *t = &_top[s->value - 1];
+	t->value = estimate;
+	change_heap(_top, top_end, t, TopCompare(), TopPlace(this));
+    } else if (_num_nonzero < _top_capacity) {
+	s->aggregate = agg;
+	top_end->aggregate = agg;
+	top_end->value = estimate;
+	++_num_nonzero;
+	push_heap(_top, top_end + 1, TopCompare(), TopPlace(this));
+    } else if (estimate > _top[0].value) {
+	// evict the smallest heavy hitter
+	erase_slot(find_slot(_top[0].aggregate));
+	s = find_slot(agg);
+	s->aggregate = agg;
+	s->value = 1;		// change_heap places only elements that move
+	_top[0].aggregate = agg;
+	_top[0].value = estimate;
+	change_heap(_top, top_end, _top, TopCompare(), TopPlace(this));
+    }
+    return true;
 }
 
 inline bool
@@ -220,9 +302,6 @@ AggregateCounter::update(Packet *p, bool frozen)
 
     // AGGREGATE_ANNO is already in host byte order!
     uint32_t agg = AGGREGATE_ANNO(p);
-    Node *n = find_node(agg, frozen);
-    if (!n)
-	return false;
 
     uint32_t amount;
     if (!_bytes)
@@ -233,18 +312,30 @@ AggregateCounter::update(Packet *p, bool frozen)
 	    amount -= p->network_header_offset();
     }
 
-    // update _num_nonzero; possibly call handler
-    if (amount && !n->count) {
-	if (_num_nonzero >= _call_nnz) {
-	    _call_nnz = (uint32_t)(-1);
-	    _call_nnz_h->call_write();
-	    // handler may have changed our state; reupdate
-	    return update(p, frozen || _frozen);
+    if (_sketch) {
+	if (!sketch_update(agg, amount, frozen))
+	    return false;
+    } else {
+	Slot *s = find_slot(agg);
+	if (!s->value) {
+	    if (frozen)
+		return false;
+	    // update _num_nonzero; possibly call handler
+	    if (amount) {
+		if (_num_nonzero >= _call_nnz) {
+		    _call_nnz = (uint32_t)(-1);
+		    _call_nnz_h->call_write();
+		    // handler may have changed our state; reupdate
+		    return update(p, frozen || _frozen);
+		}
+		if (!(s = insert_slot(agg)))
+		    return false;
+		_num_nonzero++;
+	    }
 	}
-	_num_nonzero++;
+	s->value = (s->value + amount < s->value ? (uint32_t) -1 : s->value + amount);
     }
 
-    n->count += amount;
     _count += amount;
     if (_count >= _call_count) {
 	_call_count = (uint64_t)(-1);
@@ -272,63 +363,50 @@ AggregateCounter::pull(int port)
 
 // CLEAR, REAGGREGATE
 
-void
-AggregateCounter::clear_node(Node *n)
-{
-    if (n->child[0]) {
-	clear_node(n->child[0]);
-	clear_node(n->child[1]);
-    }
-    free_node(n);
-}
-
 int
 AggregateCounter::clear(ErrorHandler *errh)
 {
-    if (_root)
-	clear_node(_root);
-
-    if (!(_root = new_node())) {
-	if (errh)
-	    errh->error("out of memory!");
-	return -1;
+    if (!_table) {
+	if (_sketch)
+	    for (_table_bits = 1; table_capacity() < 2 * _top_capacity; ++_table_bits)
+		/* nada */;
+	else
+	    _table_bits = 10;
+	if (!(_table = new Slot[table_capacity()])) {
+	    if (errh)
+		errh->error("out of memory!");
+	    return -1;
+	}
     }
-    _root->aggregate = 0;
-    _root->count = 0;
-    _root->child[0] = _root->child[1] = 0;
+    memset(_table, 0, sizeof(Slot) * table_capacity());
+    if (_sketch)
+	memset(_sketch_rows, 0, sizeof(uint32_t) * sketch_size());
     _num_nonzero = 0;
     _count = 0;
     return 0;
 }
 
-
-void
-AggregateCounter::reaggregate_node(Node *n)
-{
-    Node *l = n->child[0], *r = n->child[1];
-    uint32_t count = n->count;
-    free_node(n);
-
-    if ((n = find_node(count, false))) {
-	if (!n->count)
-	    _num_nonzero++;
-	n->count++;
-	_count++;
-    }
-
-    if (l) {
-	reaggregate_node(l);
-	reaggregate_node(r);
-    }
-}
-
 void
 AggregateCounter::reaggregate_counts()
 {
-    Node *old_root = _root;
-    _root = 0;
+    assert(!_sketch);
+    Slot *old_table = _table;
+    uint32_t old_capacity = table_capacity();
+    _table = 0;
     clear();
-    reaggregate_node(old_root);
+
+    for (uint32_t i = 0; i < old_capacity; ++i)
+	if (uint32_t count = old_table[i].value) {
+	    Slot *s = find_slot(count);
+	    if (!s->value) {
+		if (!(s = insert_slot(count)))
+		    continue;
+		_num_nonzero++;
+	    }
+	    s->value++;
+	    _count++;
+	}
+    delete[] old_table;
 }
 
 
@@ -351,24 +429,27 @@ write_batch(FILE *f, AggregateCounter::WriteFormat format,
 	    fprintf(f, "%u %u\n", buffer[i], buffer[i+1]);
 }
 
-void
-AggregateCounter::write_nodes(Node *n, FILE *f, WriteFormat format,
-			      uint32_t *buffer, int &pos, int len,
-			      ErrorHandler *errh) const
+static int
+slot_compare(const void *a, const void *b, void *)
 {
-    if (n->count > 0) {
-	buffer[pos++] = n->aggregate;
-	buffer[pos++] = n->count;
-	if (pos == len) {
-	    write_batch(f, format, buffer, pos, _count, errh);
-	    pos = 0;
-	}
-    }
+    uint32_t aa = *reinterpret_cast<const uint32_t *>(a);
+    uint32_t ab = *reinterpret_cast<const uint32_t *>(b);
+    return (aa < ab ? -1 : (aa == ab ? 0 : 1));
+}
 
-    if (n->child[0])
-	write_nodes(n->child[0], f, format, buffer, pos, len, errh);
-    if (n->child[1])
-	write_nodes(n->child[1], f, format, buffer, pos, len, errh);
+void
+AggregateCounter::sorted_slots(Vector<Slot> &v) const
+{
+    // report (aggregate, count) pairs in increasing aggregate order
+    v.reserve(_num_nonzero);
+    if (_sketch)
+	for (uint32_t i = 0; i < _num_nonzero; ++i)
+	    v.push_back(_top[i]);
+    else
+	for (uint32_t i = 0; i < table_capacity(); ++i)
+	    if (_table[i].value)
+		v.push_back(_table[i]);
+    click_qsort(v.begin(), v.size(), sizeof(Slot), slot_compare);
 }
 
 int
@@ -399,11 +480,12 @@ AggregateCounter::write_file(String where, WriteFormat format,
     } else if (format == WR_TEXT_IP)
 	fprintf(f, "!ip\n");
 
-    uint32_t buf[1024];
-    int pos = 0;
-    write_nodes(_root, f, format, buf, pos, 1024, errh);
-    if (pos)
-	write_batch(f, format, buf, pos, _count, errh);
+    Vector<Slot> slots;
+    sorted_slots(slots);
+    for (int i = 0; i < slots.size(); i += 512) {
+	int n = (slots.size() - i < 512 ? slots.size() - i : 512);
+	write_batch(f, format, reinterpret_cast<uint32_t *>(&slots[i]), 2 * n, _count, errh);
+    }
 
     bool had_err = ferror(f);
     if (f != stdout)
@@ -427,7 +509,7 @@ AggregateCounter::write_file_handler(const String &data, Element *e, void *thunk
 
 enum {
     AC_FROZEN, AC_ACTIVE, AC_BANNER, AC_STOP, AC_REAGGREGATE, AC_CLEAR,
-    AC_AGGREGATE_CALL, AC_COUNT_CALL, AC_NAGG, AC_COUNT
+    AC_AGGREGATE_CALL, AC_COUNT_CALL, AC_NAGG, AC_COUNT, AC_TABLE_JSON
 };
 
 String
@@ -451,6 +533,23 @@ AggregateCounter::read_handler(Element *e, void *thunk)
 	return String(ac->_count);
       case AC_NAGG:
 	return String(ac->_num_nonzero);
+      case AC_TABLE_JSON: {
+	Vector<Slot> slots;
+	ac->sorted_slots(slots);
+	StringAccum sa;
+	JsonWriter w(sa);
+	w.begin_object()
+	    .key("count").value(ac->_count)
+	    .key("nagg").value(ac->_num_nonzero)
+	    .key("aggregates").begin_array();
+	for (Slot *s = slots.begin(); s != slots.end(); ++s)
+	    w.begin_object()
+		.key("aggregate").value(s->aggregate)
+		.key("count").value(s->value)
+		.end_object();
+	w.end_array().end_object();
+	return sa.take_string();
+      }
       default:
 	return "<error>";
     }
@@ -481,6 +580,8 @@ AggregateCounter::write_handler(const String &data, Element *e, void *thunk, Err
 	ac->router()->please_stop_driver();
 	return 0;
       case AC_REAGGREGATE:
+	if (ac->_sketch)
+	    return errh->error("not available in sketch mode");
 	ac->reaggregate_counts();
 	return 0;
       case AC_BANNER:
@@ -543,6 +644,7 @@ AggregateCounter::add_handlers()
     add_write_handler("count_call", write_handler, AC_COUNT_CALL);
     add_read_handler("count", read_handler, AC_COUNT);
     add_read_handler("nagg", read_handler, AC_NAGG);
+    add_read_handler("table_json", read_handler, AC_TABLE_JSON);
 }
 
 ELEMENT_REQUIRES(userlevel int64)
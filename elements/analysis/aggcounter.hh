@@ -97,8 +97,36 @@ them.
 String. This banner is written to the head of any output file. It should
 probably begin with a comment character, like '!' or '#'. Default is empty.
 
+=item SKETCH
+
+Boolean. If true, then count approximately in fixed memory, using a Count-Min
+sketch (with conservative update) to estimate every aggregate's count, and
+remember only the TOP aggregates with the largest estimated counts. Estimates
+never undercount. Dumps and C<nagg> report only the remembered aggregates.
+Default is false.
+
+=item SKETCH_WIDTH
+
+Unsigned. The number of counters in each sketch row, rounded up to a power of
+two. Larger widths give more accurate estimates. Default is 65536.
+
+=item SKETCH_DEPTH
+
+Unsigned. The number of sketch rows, between 1 and 8. Default is 4. The
+sketch may hold at most 2^28 counters, so SKETCH_DEPTH times the rounded-up
+SKETCH_WIDTH must not exceed 268435456.
+
+=item TOP
+
+Unsigned. In sketch mode, the number of heavy-hitter aggregates to remember.
+Default is 100.
+
 =back
 
+In sketch mode, the AGGREGATE keywords and the C<counts_pdf> handler are not
+available, and frozen AggregateCounters update only aggregates that are
+currently remembered.
+
 =h write_file write-only
 
 Argument is a filename, or 'C<->', meaning standard out. Write a packed binary
@@ -163,11 +191,20 @@ Returns or sets the COUNT_CALL setting.
 
 Returns the number of aggregates that have been seen so far.
 
+=h table_json read-only
+
+Returns all current data as a JSON object.  Its "count" and "nagg" keys
+hold the total count and the number of aggregates; its "aggregates" key
+holds an array of objects with keys "aggregate" and "count", sorted by
+aggregate ID, as in C<write_text_file>.
+
 =n
 
 The aggregate identifier is stored in host byte order. Thus, the aggregate ID
 corresponding to IP address 128.0.0.0 is 2147483648.
 
+Counts are stored as 32-bit integers and saturate at 4294967295.
+
 Only available in user-level processes.
 
 =e
@@ -207,6 +244,7 @@ class AggregateCounter : public Element { public:
     Packet *pull(int);
 
     bool empty() const			{ return _num_nonzero == 0; }
+    bool sketch() const			{ return _sketch; }
     int clear(ErrorHandler * = 0);
     enum WriteFormat { WR_TEXT = 0, WR_BINARY = 1, WR_TEXT_IP = 2, WR_TEXT_PDF = 3 };
     int write_file(String, WriteFormat, ErrorHandler *) const;
@@ -214,25 +252,36 @@ class AggregateCounter : public Element { public:
 
   private:
 
-    struct Node {
+    // Open-addressed, linearly probed table. A slot whose value is 0 is
+    // empty. In exact mode the value is the aggregate's count; in sketch
+    // mode it is the aggregate's position in _top plus 1.
+    struct Slot {
 	uint32_t aggregate;
-	uint32_t count;
-	Node *child[2];
+	uint32_t value;
     };
 
+    enum { SKETCH_MAX_DEPTH = 8, SKETCH_MAX_SIZE = 1 << 28 };
+
     bool _bytes : 1;
     bool _ip_bytes : 1;
     bool _use_packet_count : 1;
     bool _use_extra_length : 1;
+    bool _sketch : 1;
     bool _frozen;
     bool _active;
 
-    Node *_root;
-    Node *_free;
-    Vector<Node *> _blocks;
+    Slot *_table;
+    int _table_bits;
     uint32_t _num_nonzero;
     uint64_t _count;
 
+    uint32_t *_sketch_rows;
+    int _sketch_width_bits;
+    int _sketch_depth;
+    uint64_t _sketch_hash[SKETCH_MAX_DEPTH][2];
+    Slot *_top;			// min-heap by value (estimated count)
+    uint32_t _top_capacity;
+
     uint32_t _call_nnz;
     HandlerCall *_call_nnz_h;
     uint64_t _call_count;
@@ -240,39 +289,31 @@ class AggregateCounter : public Element { public:
 
     String _output_banner;
 
-    Node *new_node();
-    Node *new_node_block();
-    void free_node(Node *);
-
-    Node *make_peer(uint32_t, Node *, bool frozen);
-    Node *find_node(uint32_t, bool frozen = false);
-    void reaggregate_node(Node *);
-    void clear_node(Node *);
-
-    void write_nodes(Node *, FILE *, WriteFormat, uint32_t *, int &, int, ErrorHandler *) const;
+    inline uint32_t table_capacity() const {
+	return 1U << _table_bits;
+    }
+    inline uint32_t slot_index(uint32_t agg) const {
+	return (agg * 2654435761U) >> (32 - _table_bits);
+    }
+    inline Slot *find_slot(uint32_t agg) const;
+    Slot *insert_slot(uint32_t agg);
+    bool grow_table();
+    void erase_slot(Slot *);
+
+    size_t sketch_size() const {
+	return (size_t) _sketch_depth << _sketch_width_bits;
+    }
+    inline uint32_t sketch_update(uint32_t agg, uint32_t amount);
+    inline bool sketch_update(uint32_t agg, uint32_t amount, bool frozen);
+    struct TopPlace;
+    struct TopCompare;
+
+    void sorted_slots(Vector<Slot> &) const;
     static int write_file_handler(const String &, Element *, void *, ErrorHandler *);
     static String read_handler(Element *, void *) CLICK_COLD;
     static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
 
 };
 
-inline AggregateCounter::Node *
-AggregateCounter::new_node()
-{
-    if (_free) {
-	Node *n = _free;
-	_free = n->child[0];
-	return n;
-    } else
-	return new_node_block();
-}
-
-inline void
-AggregateCounter::free_node(Node *n)
-{
-    n->child[0] = _free;
-    _free = n;
-}
-
 CLICK_ENDDECLS
 #endif
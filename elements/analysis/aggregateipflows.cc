@@ -27,6 +27,8 @@
 #include <clicknet/icmp.h>
 #include <click/packet_anno.hh>
 #include <click/handlercall.hh>
+#include <click/master.hh>
+#include <click/router.hh>
 CLICK_DECLS
 
 #define SEC_OLDER(s1, s2)	((int)(s1 - s2) < 0)
@@ -50,12 +52,6 @@ operator==(const AggregateIPFlows::HostPair &a, const AggregateIPFlows::HostPair
     return a.a == b.a && a.b == b.b;
 }
 
-inline hashcode_t
-AggregateIPFlows::HostPair::hashcode() const
-{
-    return (a << 12) + b + ((a >> 20) & 0x1F);
-}
-
 static inline bool
 ports_reverse_order(uint32_t ports)
 {
@@ -69,11 +65,30 @@ flip_ports(uint32_t ports)
 }
 
 
+inline Packet *
+AggregateIPFlows::Shard::take_emitted()
+{
+    Packet *head = _emit_head;
+    _emit_head = _emit_tail = 0;
+    return head;
+}
+
+inline AggregateIPFlows::Shard &
+AggregateIPFlows::shard_for(const HostPair &hp) const
+{
+    // HostPair::hashcode() also selects the HashTable bucket, so mix it
+    // before choosing a shard to keep the two choices independent.
+    uint32_t h = hp.hashcode() * 2654435761U;
+    return _shards[(h >> 16) % _nshards];
+}
+
+
 // actual AggregateIPFlows operations
 
 AggregateIPFlows::AggregateIPFlows()
+    : _shards(0), _nshards(0)
 #if CLICK_USERLEVEL
-    : _traceinfo_file(0), _packet_source(0), _filepos_h(0)
+    , _traceinfo_file(0), _packet_source(0), _filepos_h(0)
 #endif
 {
 }
@@ -102,6 +117,7 @@ AggregateIPFlows::configure(Vector<String> &conf, ErrorHandler *errh)
     _fragment_timeout = 30;
     _gc_interval = 20 * 60;
     _fragments = 2;
+    _nshards = master()->nthreads();
     bool handle_icmp_errors = false;
     bool fragments_parsed;
     bool fragments = true;
@@ -118,8 +134,11 @@ AggregateIPFlows::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("SOURCE", ElementArg(), _packet_source)
 #endif
 	.read("FRAGMENTS", fragments).read_status(fragments_parsed)
+	.read("SHARDS", _nshards)
 	.complete() < 0)
 	return -1;
+    if (_nshards == 0)
+	return errh->error("SHARDS must be positive");
 
     _smallest_timeout = (_tcp_timeout < _tcp_done_timeout ? _tcp_timeout : _tcp_done_timeout);
     _smallest_timeout = (_smallest_timeout < _udp_timeout ? _smallest_timeout : _udp_timeout);
@@ -133,8 +152,8 @@ int
 AggregateIPFlows::initialize(ErrorHandler *errh)
 {
     _next = 1;
-    _active_sec = _gc_sec = 0;
     _timestamp_warning = false;
+    _shards = new Shard[_nshards];
 
 #if CLICK_USERLEVEL
     if (_traceinfo_filename == "-")
@@ -147,7 +166,8 @@ AggregateIPFlows::initialize(ErrorHandler *errh)
 	if (_packet_source) {
 	    if (String s = HandlerCall::call_read(_packet_source, "filename").trim_space())
 		fprintf(_traceinfo_file, " file='%s'", s.c_str());
-	    (void) HandlerCall::reset_read(_filepos_h, _packet_source, "packet_filepos");
+	    if (HandlerCall::reset_read(_filepos_h, _packet_source, "packet_filepos") >= 0)
+		router()->add_handler_user(this);
 	}
 	fprintf(_traceinfo_file, ">\n");
     }
@@ -164,8 +184,14 @@ AggregateIPFlows::initialize(ErrorHandler *errh)
 void
 AggregateIPFlows::cleanup(CleanupStage)
 {
-    clean_map(_tcp_map);
-    clean_map(_udp_map);
+    if (_shards) {
+	for (unsigned i = 0; i < _nshards; ++i) {
+	    clean_map(_shards[i]._tcp_map);
+	    clean_map(_shards[i]._udp_map);
+	}
+	delete[] _shards;
+	_shards = 0;
+    }
 #if CLICK_USERLEVEL
     if (_traceinfo_file && _traceinfo_file != stdout) {
 	fprintf(_traceinfo_file, "</trace>\n");
@@ -266,11 +292,11 @@ AggregateIPFlows::packet_emit_hook(const Packet *p, const click_ip *iph, FlowInf
 }
 
 void
-AggregateIPFlows::reap_map(Map &table, uint32_t timeout, uint32_t done_timeout)
+AggregateIPFlows::reap_map(Shard &s, Map &table, uint32_t timeout, uint32_t done_timeout)
 {
-    timeout = _active_sec - timeout;
-    done_timeout = _active_sec - done_timeout;
-    int frag_timeout = _active_sec - _fragment_timeout;
+    timeout = s._active_sec - timeout;
+    done_timeout = s._active_sec - done_timeout;
+    int frag_timeout = s._active_sec - _fragment_timeout;
 
     // free completed flows and emit fragments
     for (Map::iterator iter = table.begin(); iter.live(); iter++) {
@@ -280,7 +306,7 @@ AggregateIPFlows::reap_map(Map &table, uint32_t timeout, uint32_t done_timeout)
 	while ((head = hpinfo->_fragment_head)
 	       && (head->timestamp_anno().sec() < frag_timeout
 		   || !IP_ISFRAG(good_ip_header(head))))
-	    emit_fragment_head(hpinfo);
+	    emit_fragment_head(s, hpinfo);
 
 	// can't delete any flows if there are fragments
 	if (hpinfo->_fragment_head)
@@ -304,13 +330,14 @@ AggregateIPFlows::reap_map(Map &table, uint32_t timeout, uint32_t done_timeout)
 }
 
 void
-AggregateIPFlows::reap()
+AggregateIPFlows::reap(Shard &s)
 {
-    if (_gc_sec) {
-	reap_map(_tcp_map, _tcp_timeout, _tcp_done_timeout);
-	reap_map(_udp_map, _udp_timeout, _udp_timeout);
+    // called with s._lock held
+    if (s._gc_sec) {
+	reap_map(s, s._tcp_map, _tcp_timeout, _tcp_done_timeout);
+	reap_map(s, s._udp_map, _udp_timeout, _udp_timeout);
     }
-    _gc_sec = _active_sec + _gc_interval;
+    s._gc_sec = s._active_sec + _gc_interval;
 }
 
 const click_ip *
@@ -333,9 +360,9 @@ AggregateIPFlows::icmp_encapsulated_header(const Packet *p)
 }
 
 int
-AggregateIPFlows::relevant_timeout(const FlowInfo *f, const Map &m) const
+AggregateIPFlows::relevant_timeout(const FlowInfo *f, bool udp) const
 {
-    if (&m == &_udp_map)
+    if (udp)
 	return _udp_timeout;
     else if (f->_flow_over == 3)
 	return _tcp_done_timeout;
@@ -346,7 +373,7 @@ AggregateIPFlows::relevant_timeout(const FlowInfo *f, const Map &m) const
 // XXX timing when fragments are merged back in?
 
 AggregateIPFlows::FlowInfo *
-AggregateIPFlows::find_flow_info(Map &m, HostPairInfo *hpinfo, uint32_t ports, bool flipped, const Packet *p)
+AggregateIPFlows::find_flow_info(bool udp, HostPairInfo *hpinfo, uint32_t ports, bool flipped, const Packet *p)
 {
     FlowInfo **pprev = &hpinfo->_flows;
     for (FlowInfo *finfo = *pprev; finfo; pprev = &finfo->_next, finfo = finfo->_next)
@@ -357,7 +384,7 @@ AggregateIPFlows::find_flow_info(Map &m, HostPairInfo *hpinfo, uint32_t ports, b
 	    // 4.Feb.2004 - Also start a new flow if the old flow closed off,
 	    // and we have a SYN.
 	    if ((age > (int) _smallest_timeout
-		 && age > relevant_timeout(finfo, m))
+		 && age > relevant_timeout(finfo, udp))
 		|| (finfo->_flow_over == 3
 		    && p->ip_header()->ip_p == IP_PROTO_TCP
 		    && (p->tcp_header()->th_flags & TH_SYN))) {
@@ -368,8 +395,7 @@ AggregateIPFlows::find_flow_info(Map &m, HostPairInfo *hpinfo, uint32_t ports, b
 		delete_flowinfo(hp, finfo, false);
 
 		// make a new aggregate
-		finfo->_aggregate = _next;
-		_next++;
+		finfo->_aggregate = _next.fetch_and_add(1);
 		finfo->_reverse = flipped;
 		finfo->_flow_over = 0;
 #if CLICK_USERLEVEL
@@ -388,23 +414,23 @@ AggregateIPFlows::find_flow_info(Map &m, HostPairInfo *hpinfo, uint32_t ports, b
 
     // make and install new FlowInfo pair
     FlowInfo *finfo;
+    uint32_t agg = _next.fetch_and_add(1);
 #if CLICK_USERLEVEL
     if (stats()) {
-	finfo = new StatFlowInfo(ports, hpinfo->_flows, _next);
+	finfo = new StatFlowInfo(ports, hpinfo->_flows, agg);
 	stat_new_flow_hook(p, finfo);
     } else
 #endif
-	finfo = new FlowInfo(ports, hpinfo->_flows, _next);
+	finfo = new FlowInfo(ports, hpinfo->_flows, agg);
 
     finfo->_reverse = flipped;
     hpinfo->_flows = finfo;
-    _next++;
     notify(finfo->aggregate(), AggregateListener::NEW_AGG, p);
     return finfo;
 }
 
 void
-AggregateIPFlows::emit_fragment_head(HostPairInfo *hpinfo)
+AggregateIPFlows::emit_fragment_head(Shard &s, HostPairInfo *hpinfo)
 {
     Packet *head = hpinfo->_fragment_head;
     hpinfo->_fragment_head = head->next();
@@ -444,11 +470,18 @@ AggregateIPFlows::emit_fragment_head(HostPairInfo *hpinfo)
 
     assert(finfo);
     packet_emit_hook(head, iph, finfo);
-    output(0).push(head);
+
+    // defer the push until s._lock is released
+    head->set_next(0);
+    if (s._emit_head)
+	s._emit_tail->set_next(head);
+    else
+	s._emit_head = head;
+    s._emit_tail = head;
 }
 
 int
-AggregateIPFlows::handle_fragment(Packet *p, HostPairInfo *hpinfo)
+AggregateIPFlows::handle_fragment(Shard &s, Packet *p, HostPairInfo *hpinfo)
 {
     if (hpinfo->_fragment_head)
 	hpinfo->_fragment_tail->set_next(p);
@@ -456,21 +489,21 @@ AggregateIPFlows::handle_fragment(Packet *p, HostPairInfo *hpinfo)
 	hpinfo->_fragment_head = p;
     hpinfo->_fragment_tail = p;
     p->set_next(0);
-    _active_sec = p->timestamp_anno().sec();
+    s._active_sec = p->timestamp_anno().sec();
 
     // get rid of old fragments
-    int frag_timeout = _active_sec - _fragment_timeout;
+    int frag_timeout = s._active_sec - _fragment_timeout;
     Packet *head;
     while ((head = hpinfo->_fragment_head)
 	   && (head->timestamp_anno().sec() < frag_timeout
 	       || !IP_ISFRAG(good_ip_header(head))))
-	emit_fragment_head(hpinfo);
+	emit_fragment_head(s, hpinfo);
 
     return ACT_NONE;
 }
 
 int
-AggregateIPFlows::handle_packet(Packet *p)
+AggregateIPFlows::handle_packet(Packet *p, Packet *&emitted)
 {
     const click_ip *iph = p->ip_header();
     int paint = 0;
@@ -497,20 +530,25 @@ AggregateIPFlows::handle_packet(Packet *p)
 	|| (iph->ip_src.s_addr == 0 && iph->ip_dst.s_addr == 0))
 	return ACT_DROP;
 
-    // find relevant HostPairInfo
-    Map &m = (iph->ip_p == IP_PROTO_TCP ? _tcp_map : _udp_map);
+    // find relevant shard and HostPairInfo
     HostPair hosts(iph->ip_src.s_addr, iph->ip_dst.s_addr);
     if (hosts.a != iph->ip_src.s_addr)
 	paint ^= 1;
-    HostPairInfo *hpinfo = &m[hosts];
+    bool udp = (iph->ip_p == IP_PROTO_UDP);
+    Shard &s = shard_for(hosts);
+    s._lock.acquire();
+    HostPairInfo *hpinfo = &(udp ? s._udp_map : s._tcp_map)[hosts];
+    int action;
 
     // find relevant FlowInfo, if any
     FlowInfo *finfo;
     if (IP_FIRSTFRAG(iph)) {
 	const uint8_t *udp_ptr = reinterpret_cast<const uint8_t *>(iph) + (iph->ip_hl << 2);
-	if (udp_ptr + 4 > p->end_data())
+	if (udp_ptr + 4 > p->end_data()) {
 	    // packet not big enough
-	    return ACT_DROP;
+	    action = ACT_DROP;
+	    goto done;
+	}
 
 	uint32_t ports = *reinterpret_cast<const uint32_t *>(udp_ptr);
 	// 1.Jan.08: handle connections where IP addresses are the same (John
@@ -520,10 +558,11 @@ AggregateIPFlows::handle_packet(Packet *p)
 	if (paint & 1)
 	    ports = flip_ports(ports);
 
-	finfo = find_flow_info(m, hpinfo, ports, paint & 1, p);
+	finfo = find_flow_info(udp, hpinfo, ports, paint & 1, p);
 	if (!finfo) {
 	    click_chatter("out of memory!");
-	    return ACT_DROP;
+	    action = ACT_DROP;
+	    goto done;
 	}
 	if (finfo->reverse())
 	    paint ^= 1;
@@ -539,26 +578,42 @@ AggregateIPFlows::handle_packet(Packet *p)
 
     // check for fragment
     if ((_fragments && IP_ISFRAG(iph)) || hpinfo->_fragment_head)
-	return handle_fragment(p, hpinfo);
+	action = handle_fragment(s, p, hpinfo);
     else if (!finfo)
-	return ACT_DROP;
+	action = ACT_DROP;
+    else {
+	// packet emit hook
+	s._active_sec = p->timestamp_anno().sec();
+	packet_emit_hook(p, iph, finfo);
+	action = ACT_EMIT;
+    }
 
-    // packet emit hook
-    _active_sec = p->timestamp_anno().sec();
-    packet_emit_hook(p, iph, finfo);
+  done:
+    // GC if necessary
+    if (s._active_sec >= s._gc_sec)
+	reap(s);
+    emitted = s.take_emitted();
+    s._lock.release();
+    return action;
+}
 
-    return ACT_EMIT;
+inline void
+AggregateIPFlows::push_emitted(Packet *head)
+{
+    while (Packet *p = head) {
+	head = p->next();
+	p->set_next(0);
+	output(0).push(p);
+    }
 }
 
 void
 AggregateIPFlows::push(int, Packet *p)
 {
-    int action = handle_packet(p);
-
-    // GC if necessary
-    if (_active_sec >= _gc_sec)
-	reap();
+    Packet *emitted = 0;
+    int action = handle_packet(p, emitted);
 
+    push_emitted(emitted);
     if (action == ACT_EMIT)
 	output(0).push(p);
     else if (action == ACT_DROP)
@@ -569,12 +624,11 @@ Packet *
 AggregateIPFlows::pull(int)
 {
     Packet *p = input(0).pull();
-    int action = (p ? handle_packet(p) : ACT_NONE);
-
-    // GC if necessary
-    if (_active_sec >= _gc_sec)
-	reap();
+    Packet *emitted = 0;
+    int action = (p ? handle_packet(p, emitted) : ACT_NONE);
 
+    // fragments are never held in pull context
+    assert(!emitted);
     if (action == ACT_EMIT)
 	return p;
     else if (action == ACT_DROP)
@@ -589,13 +643,19 @@ AggregateIPFlows::write_handler(const String &, Element *e, void *thunk, ErrorHa
 {
     AggregateIPFlows *af = static_cast<AggregateIPFlows *>(e);
     switch ((intptr_t)thunk) {
-      case H_CLEAR: {
-	  int active_sec = af->_active_sec, gc_sec = af->_gc_sec;
-	  af->_active_sec = af->_gc_sec = 0x7FFFFFFF;
-	  af->reap();
-	  af->_active_sec = active_sec, af->_gc_sec = gc_sec;
-	  return 0;
-      }
+      case H_CLEAR:
+	for (unsigned i = 0; i < af->_nshards; ++i) {
+	    Shard &s = af->_shards[i];
+	    s._lock.acquire();
+	    unsigned active_sec = s._active_sec, gc_sec = s._gc_sec;
+	    s._active_sec = s._gc_sec = 0x7FFFFFFF;
+	    af->reap(s);
+	    s._active_sec = active_sec, s._gc_sec = gc_sec;
+	    Packet *emitted = s.take_emitted();
+	    s._lock.release();
+	    af->push_emitted(emitted);
+	}
+	return 0;
       default:
 	return -1;
     }
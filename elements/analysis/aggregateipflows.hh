@@ -4,6 +4,7 @@
 #include <click/element.hh>
 #include <click/ipflowid.hh>
 #include <click/hashtable.hh>
+#include <click/sync.hh>
 #include "aggregatenotifier.hh"
 CLICK_DECLS
 class HandlerCall;
@@ -110,11 +111,27 @@ Boolean. If true, then try to assign aggregate annotations to all fragments.
 May only be set to true if AggregateIPFlows is running in a push context.
 Default is true in a push context and false in a pull context.
 
+=item SHARDS
+
+Integer. The number of independent flow tables. Each table has its own lock
+and garbage collection schedule, and every flow is assigned to a table by a
+hash of its (unordered) address pair, so both directions of a flow, and all
+of its fragments, always land in the same table. Threads processing different
+flows therefore rarely contend. Default is the number of Click threads.
+
 =back
 
 AggregateIPFlows is an AggregateNotifier, so AggregateListeners can request
 notifications when new aggregates are created and old ones are deleted.
 
+AggregateIPFlows may be used from several threads at once. Aggregate numbers
+remain unique across all threads. Notifications are delivered with the
+relevant table locked, so the NEW_AGG and DELETE_AGG events for any given
+aggregate are never concurrent and always arrive in order; however, events
+for different aggregates may be delivered concurrently on different threads.
+Fragments released from a table are pushed downstream after the table is
+unlocked.
+
 =h clear write-only
 
 Clears all flow information. Future packets will get new aggregate annotation
@@ -209,12 +226,23 @@ class AggregateIPFlows : public Element, public AggregateNotifier { public:
     };
 
     typedef HashTable<HostPair, HostPairInfo> Map;
-    Map _tcp_map;
-    Map _udp_map;
 
-    uint32_t _next;
-    unsigned _active_sec;
-    unsigned _gc_sec;
+    struct Shard {
+	Map _tcp_map;
+	Map _udp_map;
+	unsigned _active_sec;
+	unsigned _gc_sec;
+	Packet *_emit_head;
+	Packet *_emit_tail;
+	Spinlock _lock CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+	Shard() : _active_sec(0), _gc_sec(0), _emit_head(0), _emit_tail(0) { }
+	inline Packet *take_emitted();
+    };
+
+    Shard *_shards;
+    unsigned _nshards;
+
+    atomic_uint32_t _next;
 
     uint32_t _tcp_timeout;
     uint32_t _tcp_done_timeout;
@@ -238,28 +266,37 @@ class AggregateIPFlows : public Element, public AggregateNotifier { public:
 
     static const click_ip *icmp_encapsulated_header(const Packet *);
 
+    inline Shard &shard_for(const HostPair &hp) const;
+
     void clean_map(Map &);
-    void reap_map(Map &, uint32_t, uint32_t);
-    void reap();
+    void reap_map(Shard &, Map &, uint32_t, uint32_t);
+    void reap(Shard &);
 
-    inline int relevant_timeout(const FlowInfo *, const Map &) const;
+    inline int relevant_timeout(const FlowInfo *, bool udp) const;
 #if CLICK_USERLEVEL
     void stat_new_flow_hook(const Packet *, FlowInfo *);
 #endif
     inline void packet_emit_hook(const Packet *, const click_ip *, FlowInfo *);
     inline void delete_flowinfo(const HostPair &, FlowInfo *, bool really_delete = true);
-    void emit_fragment_head(HostPairInfo *hpinfo);
-    FlowInfo *find_flow_info(Map &, HostPairInfo *, uint32_t ports, bool flipped, const Packet *);
+    void emit_fragment_head(Shard &, HostPairInfo *hpinfo);
+    FlowInfo *find_flow_info(bool udp, HostPairInfo *, uint32_t ports, bool flipped, const Packet *);
 
     FlowInfo *uncommon_case(FlowInfo *finfo, const click_ip *iph);
 
     enum { ACT_EMIT, ACT_DROP, ACT_NONE };
-    int handle_fragment(Packet *, HostPairInfo *);
-    int handle_packet(Packet *);
+    int handle_fragment(Shard &, Packet *, HostPairInfo *);
+    int handle_packet(Packet *, Packet *&emitted);
+    inline void push_emitted(Packet *);
 
     static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
 
 };
 
+inline hashcode_t
+AggregateIPFlows::HostPair::hashcode() const
+{
+    return (a << 12) + b + ((a >> 20) & 0x1F);
+}
+
 CLICK_ENDDECLS
 #endif
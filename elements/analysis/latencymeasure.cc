@@ -0,0 +1,204 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * latencymeasure.{cc,hh} -- record latency distributions
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "latencymeasure.hh"
+#include "latencystamp.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+LatencyMeasure::LatencyMeasure()
+    : _shards(0), _nshards(0)
+{
+}
+
+LatencyMeasure::~LatencyMeasure()
+{
+}
+
+int
+LatencyMeasure::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _anno = PERFCTR_ANNO_OFFSET;
+    _offset = -1;
+    uint32_t offset;
+    bool offset_given;
+    int precision = 3;
+    if (Args(conf, this, errh)
+	.read("ANNO", AnnoArg(8), _anno)
+	.read("OFFSET", offset).read_status(offset_given)
+	.read("PRECISION", precision)
+	.complete() < 0)
+	return -1;
+    if (offset_given)
+	_offset = offset;
+    // bits needed to distinguish 10^PRECISION values within a factor of 2
+    static const int precision_bits[] = { 5, 8, 11, 15 };
+    if (precision < 1 || precision > 4)
+	return errh->error("PRECISION must be between 1 and 4");
+    _bits = precision_bits[precision - 1];
+    return 0;
+}
+
+int
+LatencyMeasure::initialize(ErrorHandler *errh)
+{
+    _cycles = LatencyStamp::use_cycles();
+    _ns_per_tick = _cycles ? 1e9 / click_cycles_per_second() : 1;
+    _nshards = master()->nthreads();
+    if (!(_shards = new Shard[_nshards]))
+	return errh->error("out of memory");
+    for (int i = 0; i < _nshards; ++i) {
+	if (_shards[i].hist.initialize(_bits) < 0)
+	    return errh->error("out of memory");
+	_shards[i].unstamped = 0;
+    }
+    return 0;
+}
+
+void
+LatencyMeasure::cleanup(CleanupStage)
+{
+    delete[] _shards;
+    _shards = 0;
+}
+
+Packet *
+LatencyMeasure::simple_action(Packet *p)
+{
+    uint64_t now = LatencyStamp::now(_cycles), stamp;
+    if (_offset < 0)
+	stamp = p->anno_u64(_anno);
+    else if (p->length() >= (uint32_t) _offset + 8) {
+	uint32_t x[2];
+	memcpy(x, p->data() + _offset, 8);
+	stamp = ((uint64_t) ntohl(x[0]) << 32) | ntohl(x[1]);
+    } else
+	stamp = now + 1;
+
+    unsigned c = click_current_cpu_id();
+    Shard &s = _shards[c < (unsigned) _nshards ? c : 0];
+    if (stamp == 0 || stamp > now)
+	++s.unstamped;
+    else if (_cycles)
+	s.hist.record((uint64_t) ((now - stamp) * _ns_per_tick));
+    else
+	s.hist.record(now - stamp);
+    return p;
+}
+
+void
+LatencyMeasure::merge(HdrHistogram &h) const
+{
+    h.initialize(_bits);
+    for (int i = 0; i < _nshards; ++i)
+	h.add(_shards[i].hist);
+}
+
+String
+LatencyMeasure::read_handler(Element *e, void *thunk)
+{
+    LatencyMeasure *lm = static_cast<LatencyMeasure *>(e);
+    int which = reinterpret_cast<intptr_t>(thunk);
+    if (which == h_unstamped) {
+	uint64_t n = 0;
+	for (int i = 0; i < lm->_nshards; ++i)
+	    n += lm->_shards[i].unstamped;
+	return String(n);
+    }
+
+    HdrHistogram h;
+    lm->merge(h);
+    switch (which) {
+    case h_count:
+	return String(h.count());
+    case h_min:
+	return String(h.min());
+    case h_max:
+	return String(h.max());
+    case h_mean:
+	return String(h.mean());
+    case h_histogram: {
+	StringAccum sa;
+	for (uint32_t i = 0; i < h.nbuckets(); ++i)
+	    if (uint64_t n = h.bucket_count(i))
+		sa << h.bucket_low(i) << ' ' << h.bucket_high(i) << ' ' << n << '\n';
+	return sa.take_string();
+    }
+    case h_p50:
+	return String(h.percentile(50));
+    case h_p90:
+	return String(h.percentile(90));
+    case h_p99:
+	return String(h.percentile(99));
+    case h_p999:
+	return String(h.percentile(99.9));
+    case h_p9999:
+	return String(h.percentile(99.99));
+    default:
+	return String();
+    }
+}
+
+int
+LatencyMeasure::percentile_handler(int, String &str, Element *e, const Handler *, ErrorHandler *errh)
+{
+    LatencyMeasure *lm = static_cast<LatencyMeasure *>(e);
+    double p;
+    if (!DoubleArg().parse(cp_uncomment(str), p) || p < 0 || p > 100)
+	return errh->error("expected percentile between 0 and 100");
+    HdrHistogram h;
+    lm->merge(h);
+    str = String(h.percentile(p));
+    return 0;
+}
+
+int
+LatencyMeasure::reset_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    LatencyMeasure *lm = static_cast<LatencyMeasure *>(e);
+    for (int i = 0; i < lm->_nshards; ++i) {
+	lm->_shards[i].hist.clear();
+	lm->_shards[i].unstamped = 0;
+    }
+    return 0;
+}
+
+void
+LatencyMeasure::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("unstamped", read_handler, h_unstamped);
+    add_read_handler("min", read_handler, h_min);
+    add_read_handler("max", read_handler, h_max);
+    add_read_handler("mean", read_handler, h_mean);
+    add_read_handler("histogram", read_handler, h_histogram);
+    add_read_handler("p50", read_handler, h_p50);
+    add_read_handler("p90", read_handler, h_p90);
+    add_read_handler("p99", read_handler, h_p99);
+    add_read_handler("p999", read_handler, h_p999);
+    add_read_handler("p9999", read_handler, h_p9999);
+    set_handler("percentile", Handler::f_read | Handler::f_read_param, percentile_handler);
+    add_write_handler("reset", reset_handler, 0, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel int64)
+EXPORT_ELEMENT(LatencyMeasure)
+ELEMENT_MT_SAFE(LatencyMeasure)
@@ -0,0 +1,141 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_LATENCYMEASURE_HH
+#define CLICK_LATENCYMEASURE_HH
+#include <click/element.hh>
+#include <click/hdrhistogram.hh>
+CLICK_DECLS
+
+/*
+=c
+
+LatencyMeasure([I<keywords> ANNO, OFFSET, PRECISION])
+
+=s timestamps
+
+measures latency distributions from LatencyStamp stamps
+
+=d
+
+For each passing packet, computes the time elapsed since an upstream
+LatencyStamp stamped it, and records it in a high-dynamic-range histogram.
+ANNO and OFFSET must match the LatencyStamp's.
+
+Each thread records into its own histogram, without locks or atomic
+operations; handlers merge the per-thread histograms when read.  Histograms
+count values with PRECISION significant decimal digits over the whole range of
+64-bit nanosecond latencies.  Packets whose stamp is zero or lies in the
+future, as happens when a packet was never stamped, are counted as
+unstamped.
+
+All latencies are reported in nanoseconds.
+
+Keyword arguments are:
+
+=over 8
+
+=item ANNO
+
+Annotation name or offset.  The 8-byte annotation holding the stamp when
+OFFSET is not given.  Default is the PERFCTR annotation, bytes 40-47.
+
+=item OFFSET
+
+Unsigned integer.  If given, read the stamp from the packet data at this
+offset.
+
+=item PRECISION
+
+Integer between 1 and 4.  Significant decimal digits kept by the histograms.
+Each thread's histogram needs roughly 56*10^PRECISION bytes of memory.
+Default is 3.
+
+=back
+
+=h count read-only
+
+Returns the number of latencies recorded.
+
+=h unstamped read-only
+
+Returns the number of packets without a valid stamp.
+
+=h min read-only
+
+Returns the smallest latency.
+
+=h max read-only
+
+Returns the largest latency.
+
+=h mean read-only
+
+Returns the mean latency.
+
+=h p50 read-only
+
+Returns the median latency.  Handlers C<p90>, C<p99>, C<p999>, and C<p9999>
+return the 90th, 99th, 99.9th, and 99.99th percentiles.
+
+=h percentile read-only with parameter
+
+Returns the latency at the percentile given as a parameter, as in
+"percentile 99.5".
+
+=h histogram read-only
+
+Returns the nonempty histogram buckets, one per line: the bucket's lowest and
+highest latency and its count.
+
+=h reset write-only
+
+Clears the histograms.  Concurrent recording may be lost.
+
+=e
+
+  ... -> LatencyStamp -> Queue -> ToDevice(eth0);
+  ... -> LatencyMeasure -> Discard;
+
+=a LatencyStamp, TimestampAccum */
+
+class LatencyMeasure : public Element { public:
+
+    LatencyMeasure() CLICK_COLD;
+    ~LatencyMeasure() CLICK_COLD;
+
+    const char *class_name() const	{ return "LatencyMeasure"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    Packet *simple_action(Packet *);
+
+  private:
+
+    struct Shard {
+	HdrHistogram hist;
+	uint64_t unstamped;
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+    Shard *_shards;
+    int _nshards;
+    bool _cycles;
+    double _ns_per_tick;
+    int _anno;
+    int _offset;			// -1: use annotation
+    int _bits;
+
+    void merge(HdrHistogram &h) const;
+
+    enum { h_count, h_unstamped, h_min, h_max, h_mean, h_histogram,
+	   h_percentile, h_p50, h_p90, h_p99, h_p999, h_p9999 };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int percentile_handler(int, String &, Element *, const Handler *, ErrorHandler *) CLICK_COLD;
+    static int reset_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,77 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * latencystamp.{cc,hh} -- store latency-measurement timestamps
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "latencystamp.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packet_anno.hh>
+CLICK_DECLS
+
+LatencyStamp::LatencyStamp()
+{
+}
+
+LatencyStamp::~LatencyStamp()
+{
+}
+
+int
+LatencyStamp::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _anno = PERFCTR_ANNO_OFFSET;
+    _offset = -1;
+    uint32_t offset;
+    bool offset_given;
+    if (Args(conf, this, errh)
+	.read("ANNO", AnnoArg(8), _anno)
+	.read("OFFSET", offset).read_status(offset_given)
+	.complete() < 0)
+	return -1;
+    if (offset_given)
+	_offset = offset;
+    return 0;
+}
+
+int
+LatencyStamp::initialize(ErrorHandler *)
+{
+    _cycles = use_cycles();
+    return 0;
+}
+
+Packet *
+LatencyStamp::simple_action(Packet *p)
+{
+    uint64_t t = now(_cycles);
+    if (_offset < 0)
+	p->set_anno_u64(_anno, t);
+    else if (p->length() >= (uint32_t) _offset + 8) {
+	if (WritablePacket *q = p->uniqueify()) {
+	    uint32_t x[2];
+	    x[0] = htonl((uint32_t) (t >> 32));
+	    x[1] = htonl((uint32_t) t);
+	    memcpy(q->data() + _offset, x, 8);
+	    return q;
+	}
+	return 0;
+    }
+    return p;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel int64)
+EXPORT_ELEMENT(LatencyStamp)
+ELEMENT_MT_SAFE(LatencyStamp)
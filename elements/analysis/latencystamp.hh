@@ -0,0 +1,90 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_LATENCYSTAMP_HH
+#define CLICK_LATENCYSTAMP_HH
+#include <click/element.hh>
+#include <click/timestamp.hh>
+CLICK_DECLS
+
+/*
+=c
+
+LatencyStamp([I<keywords> ANNO, OFFSET])
+
+=s timestamps
+
+stores a latency-measurement timestamp in packets
+
+=d
+
+Stores the current time in each passing packet, for later measurement by
+LatencyMeasure.  The time is read from the CPU cycle counter when it is
+available, and from Timestamp::now() otherwise or when Click runs in simulated
+time; LatencyMeasure uses the same clock.
+
+By default, the time is stored in an 8-byte annotation.  If OFFSET is given,
+it is instead written into the packet data at that byte offset, so that the
+stamp survives a trip out of Click and back, for instance through a device
+under test.  Packets too short to hold the stamp pass through unchanged.
+Writing the stamp does not update checksums.
+
+Keyword arguments are:
+
+=over 8
+
+=item ANNO
+
+Annotation name or offset.  The 8-byte annotation holding the stamp when
+OFFSET is not given.  Default is the PERFCTR annotation, bytes 40-47.
+
+=item OFFSET
+
+Unsigned integer.  If given, store the stamp in the packet data at this
+offset, in network byte order.
+
+=back
+
+=e
+
+  TrafficGenerator(LENGTH 64, RATE 1000000, CHECKSUM false)
+      -> LatencyStamp(OFFSET 42) -> ToDPDKDevice(0);
+  FromDPDKDevice(1) -> lm :: LatencyMeasure(OFFSET 42) -> Discard;
+
+=a LatencyMeasure, SetTimestamp, TimestampAccum */
+
+class LatencyStamp : public Element { public:
+
+    LatencyStamp() CLICK_COLD;
+    ~LatencyStamp() CLICK_COLD;
+
+    const char *class_name() const	{ return "LatencyStamp"; }
+    const char *port_count() const	{ return PORTS_1_1; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+
+    Packet *simple_action(Packet *);
+
+    /** @brief Return true iff latency stamps use the cycle counter. */
+    static bool use_cycles() {
+	return Timestamp::warp_class() == Timestamp::warp_none
+	    && click_cycles_per_second() != 0;
+    }
+
+    /** @brief Return the current latency clock.
+     * @param cycles result of use_cycles() */
+    static inline uint64_t now(bool cycles) {
+	if (cycles)
+	    return click_get_cycles();
+	return Timestamp::now().nsecval();
+    }
+
+  private:
+
+    bool _cycles;
+    int _anno;
+    int _offset;			// -1: use annotation
+
+};
+
+CLICK_ENDDECLS
+#endif
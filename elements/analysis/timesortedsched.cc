@@ -24,10 +24,11 @@
 #include <click/args.hh>
 #include <click/router.hh>
 #include <click/heap.hh>
+#include <click/master.hh>
 CLICK_DECLS
 
 TimeSortedSched::TimeSortedSched()
-    : _pkt(0), _npkt(0), _input(0), _nready(0),
+    : _input(0), _pkt(0), _ring_q(0), _ready(0), _nready(0), _tree(0),
       _notifier(Notifier::SEARCH_CONTINUE_WAKE), _buffer(1),
       _well_ordered(true)
 {
@@ -50,10 +51,11 @@ int
 TimeSortedSched::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     _notifier.initialize(Notifier::EMPTY_NOTIFIER, router());
-    _stop = false;
+    _stop = _prefetch = false;
     if (Args(conf, this, errh)
 	.read("STOP", _stop)
 	.read("BUFFER", _buffer)
+	.read("PREFETCH", _prefetch)
 	.complete() < 0)
 	return -1;
     if (_buffer <= 0)
@@ -64,72 +66,200 @@ TimeSortedSched::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 TimeSortedSched::initialize(ErrorHandler *errh)
 {
-    _pkt = new packet_s[ninputs() * _buffer];
+    for (_nleaves = 1; _nleaves < ninputs(); _nleaves *= 2)
+	/* nada */;
     _input = new input_s[ninputs()];
-    if (!_pkt || !_input)
+    _pkt = new Packet *[ninputs() * _buffer];
+    _ready = new int[ninputs()];
+    _tree = new int[2 * _nleaves];
+    if (_prefetch)
+	_ring_q = new Packet *[ninputs() * (_buffer + 1)];
+    if (!_input || !_pkt || !_ready || !_tree || (_prefetch && !_ring_q))
 	return errh->error("out of memory!");
+
     for (int i = 0; i < ninputs(); i++) {
-	_input[i].signal = Notifier::upstream_empty_signal(this, i, &_notifier);
-	_input[i].space = _buffer;
-	_input[i].ready = i;
+	input_s &is = _input[i];
+	is.signal = Notifier::upstream_empty_signal(this, i, &_notifier);
+	is.pkt = _pkt + i * _buffer;
+	is.port = i;
+	is.owner = this;
+	_ready[i] = i;
     }
     _nready = ninputs();
+    for (int k = 0; k < 2 * _nleaves; ++k)
+	_tree[k] = -1;
+
+    if (_prefetch) {
+	int nthreads = master()->nthreads();
+	for (int i = 0; i < ninputs(); i++) {
+	    input_s &is = _input[i];
+	    is.ring.set_capacity(_buffer);
+	    is.ring_q = _ring_q + i * (_buffer + 1);
+	    is.exhausted = false;
+	    if (!(is.task = new Task(prefetch_hook, &is)))
+		return errh->error("out of memory!");
+	    is.task->initialize(this, false);
+	    is.task->move_thread(i % nthreads);
+	    is.task->reschedule();
+	}
+    }
     return 0;
 }
 
 void
 TimeSortedSched::cleanup(CleanupStage)
 {
-    for (int i = 0; i < _npkt; ++i)
-	_pkt[i].p->kill();
-    delete[] _pkt;
+    if (_input)
+	for (int i = 0; i < ninputs(); ++i) {
+	    input_s &is = _input[i];
+	    delete is.task;
+	    for (int j = 0; j < is.npkt; ++j)
+		is.pkt[j]->kill();
+	    if (is.ring_q)
+		for (Storage::index_type h = is.ring.head(); h != is.ring.tail();
+		     h = is.ring.next_i(h))
+		    is.ring_q[h]->kill();
+	}
     delete[] _input;
+    delete[] _pkt;
+    delete[] _ring_q;
+    delete[] _ready;
+    delete[] _tree;
+}
+
+inline int
+TimeSortedSched::tree_winner(int a, int b) const
+{
+    if (a < 0 || (b >= 0 && _input[b].head < _input[a].head))
+	return b;
+    else
+	return a;
+}
+
+inline void
+TimeSortedSched::update_tree(int i)
+{
+    // replay the matches on the path from input i's leaf to the root
+    int k = _nleaves + i;
+    if (_input[i].npkt) {
+	_input[i].head = _input[i].pkt[0]->timestamp_anno();
+	_tree[k] = i;
+    } else
+	_tree[k] = -1;
+    for (k >>= 1; k; k >>= 1)
+	_tree[k] = tree_winner(_tree[2*k], _tree[2*k + 1]);
+}
+
+bool
+TimeSortedSched::prefetch_hook(Task *, void *user_data)
+{
+    input_s *is = static_cast<input_s *>(user_data);
+    return is->owner->prefetch(*is);
+}
+
+bool
+TimeSortedSched::prefetch(input_s &is)
+{
+    // producer side of is.ring; runs on is.task's thread
+    int n = 0;
+    Storage::index_type t = is.ring.tail(), nt;
+    while ((nt = is.ring.next_i(t)) != is.ring.head()) {
+	Packet *p = input(is.port).pull();
+	if (!p) {
+	    if (!is.signal) {
+		// publish "no more packets" after the last packet
+		click_write_fence();
+		is.exhausted = true;
+	    } else
+		is.task->fast_reschedule();
+	    return n > 0;
+	}
+	is.ring_q[t] = p;
+	is.ring.set_tail(nt);
+	t = nt;
+	++n;
+    }
+    // ring full: the consumer reschedules us once it makes room
+    return n > 0;
+}
+
+inline Packet *
+TimeSortedSched::next_packet(input_s &is, bool &live)
+{
+    if (!_prefetch) {
+	live = is.signal;
+	return live ? input(is.port).pull() : 0;
+    }
+
+    // consumer side of is.ring
+    Storage::index_type h = is.ring.head();
+    if (h == is.ring.tail()) {
+	bool exhausted = is.exhausted;
+	click_read_fence();
+	if (h == is.ring.tail()) {
+	    live = !exhausted;
+	    return 0;
+	}
+    }
+    Packet *p = is.ring_q[h];
+    is.ring.set_head(is.ring.next_i(h));
+    if (!is.task->scheduled() && !is.exhausted)
+	is.task->reschedule();
+    live = true;
+    return p;
 }
 
 Packet*
 TimeSortedSched::pull(int)
 {
     bool signals_on = false;
-    // first maybe fill in buffer
+    int nblocked = 0;
+    // first maybe fill in buffers
     for (int rpos = _nready - 1; rpos >= 0; --rpos) {
-	int i = _input[rpos].ready;
+	int i = _ready[rpos];
 	input_s &is = _input[i];
-	if (is.signal) {
-	    signals_on = true;
-	    while ((_pkt[_npkt].p = input(i).pull())) {
-		_pkt[_npkt].input = i;
-		++_npkt;
-		push_heap(_pkt, _pkt + _npkt, heap_less());
-		--is.space;
-		if (!is.space) {
-		    _input[rpos].ready = _input[_nready - 1].ready;
-		    --_nready;
-		    break;
-		}
-	    }
+	int old_npkt = is.npkt;
+	bool live = true;
+	while (is.npkt < _buffer) {
+	    Packet *p = next_packet(is, live);
+	    if (!p)
+		break;
+	    is.pkt[is.npkt] = p;
+	    ++is.npkt;
+	    push_heap(is.pkt, is.pkt + is.npkt, packet_less());
 	}
+	signals_on |= live;
+	if (is.npkt != old_npkt)
+	    update_tree(i);
+	if (is.npkt == _buffer) {
+	    _ready[rpos] = _ready[_nready - 1];
+	    --_nready;
+	} else if (_prefetch && !is.npkt && live)
+	    // cannot know what this input will produce next
+	    ++nblocked;
     }
 
     // then maybe emit a packet
-    _notifier.set_active(_npkt > 0 || signals_on);
-    if (_npkt > 0) {
-	Packet *p = _pkt[0].p;
+    int w = _tree[1];
+    _notifier.set_active(w >= 0 || signals_on);
+    if (w >= 0 && !nblocked) {
+	input_s &is = _input[w];
+	Packet *p = is.pkt[0];
 	if (p->timestamp_anno()) {
 	    if (_last_emission && p->timestamp_anno() < _last_emission)
 		_well_ordered = false;
 	    _last_emission = p->timestamp_anno();
 	}
-	input_s &is = _input[_pkt[0].input];
-	++is.space;
-	if (is.space == 1) {
-	    _input[_nready].ready = _pkt[0].input;
+	if (is.npkt == _buffer) {
+	    _ready[_nready] = w;
 	    ++_nready;
 	}
-	pop_heap(_pkt, _pkt + _npkt, heap_less());
-	--_npkt;
+	pop_heap(is.pkt, is.pkt + is.npkt, packet_less());
+	--is.npkt;
+	update_tree(w);
 	return p;
     } else {
-	if (_stop && !signals_on)
+	if (_stop && w < 0 && !signals_on)
 	    router()->please_stop_driver();
 	return 0;
     }
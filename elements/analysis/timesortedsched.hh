@@ -2,13 +2,15 @@
 #ifndef CLICK_TIMESORTEDSCHED_HH
 #define CLICK_TIMESORTEDSCHED_HH
 #include <click/element.hh>
+#include <click/task.hh>
+#include <click/standard/storage.hh>
 #include <click/notifier.hh>
 CLICK_DECLS
 
 /*
 =c
 
-TimeSortedSched(I<keywords> STOP, BUFFER)
+TimeSortedSched(I<keywords> STOP, BUFFER, PREFETCH)
 
 =s timestamps
 
@@ -31,6 +33,12 @@ TimeSortedSched emitted some packets out of order.  (But see BUFFER, below.)
 TimeSortedSched listens for notification from its inputs to avoid useless
 pulls, and provides notification for its output.
 
+TimeSortedSched keeps a small timestamp-ordered heap of buffered packets for
+each input, and a tournament tree over the inputs' earliest packets, so
+choosing the next packet costs O(log N) comparisons of cached timestamps for N
+inputs, rather than work proportional to the total number of buffered
+packets.
+
 Keyword arguments are:
 
 =over 8
@@ -47,6 +55,18 @@ Integer. Up to BUFFER packets per input are buffered within
 TimeSortedSched. Default BUFFER is 1. Higher BUFFER values let TimeSortedSched
 cope with minor reordering in its input streams.
 
+=item PREFETCH
+
+Boolean. If true, then each input is pulled by its own task, which reads ahead
+up to BUFFER packets into a private ring. The tasks are spread across all
+Click threads, so with the B<-j> option, upstream decoding (for example,
+FromDump or FromIPSummaryDump parsing) runs in parallel with merging. To keep
+the output sorted, TimeSortedSched emits nothing while any unfinished input
+has no packets ready. An input is finished once its upstream notifier reports
+empty and a pull returns no packet; a finished input is never consulted
+again. The upstream elements must not be pulled by anything else. Default is
+false.
+
 =back
 
 =n
@@ -66,6 +86,9 @@ stream, and stops the driver when all the files are exhausted.
   // ...
   tss -> ...;
 
+Run with C<click -j 4> and C<TimeSortedSched(STOP true, PREFETCH true, BUFFER
+64)> to decode the files on several threads.
+
 =h well_ordered r
 
 Returns a Boolean string. If "false", then TimeSortedSched's output was not
@@ -97,33 +120,50 @@ class TimeSortedSched : public Element { public:
 
   private:
 
-    struct packet_s {
-	Packet *p;
-	int input;		// for space, consider using annotation?
-    };
-    struct heap_less {
-	inline bool operator()(packet_s &a, packet_s &b) {
-	    return a.p->timestamp_anno() < b.p->timestamp_anno();
+    struct packet_less {
+	inline bool operator()(Packet *a, Packet *b) {
+	    return a->timestamp_anno() < b->timestamp_anno();
 	}
     };
     struct input_s {
 	NotifierSignal signal;
-	int space;
-	int ready;
+	Packet **pkt;		// heap of buffered packets, earliest first
+	int npkt;
+	int port;
+	Timestamp head;		// timestamp of pkt[0], cached for the tree
+	// PREFETCH: ring filled by task, single producer/single consumer
+	Storage ring;
+	Packet * volatile *ring_q;
+	volatile bool exhausted;
+	Task *task;
+	TimeSortedSched *owner;
+	input_s() : pkt(0), npkt(0), ring_q(0), task(0) { }
     };
 
-    packet_s *_pkt;
-    int _npkt;
-
     input_s *_input;
+    Packet **_pkt;
+    Packet **_ring_q;
+
+    int *_ready;		// inputs with buffer space
     int _nready;
 
+    int *_tree;			// tournament tree; _tree[1] is the winner
+    int _nleaves;
+
     Notifier _notifier;
     int _buffer;
     Timestamp _last_emission;
     bool _stop;
+    bool _prefetch;
     bool _well_ordered;
 
+    inline int tree_winner(int a, int b) const;
+    inline void update_tree(int i);
+    inline Packet *next_packet(input_s &is, bool &live);
+
+    static bool prefetch_hook(Task *, void *);
+    bool prefetch(input_s &is);
+
 };
 
 CLICK_ENDDECLS
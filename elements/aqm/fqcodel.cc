@@ -0,0 +1,467 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * fqcodel.{cc,hh} -- flow-queue fair queueing with CoDel
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "fqcodel.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/integers.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include <clicknet/udp.h>
+CLICK_DECLS
+
+FQCoDel::FQCoDel()
+    : _flows(0), _length(0), _nactive(0), _drops(0), _overlimit_drops(0)
+{
+}
+
+FQCoDel::~FQCoDel()
+{
+}
+
+void *
+FQCoDel::cast(const char *n)
+{
+    if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+	return static_cast<Notifier *>(&_empty_note);
+    else
+	return Element::cast(n);
+}
+
+int
+FQCoDel::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _nflows = 1024;
+    _limit = 10240;
+    _quantum = 1514;
+    _target = Timestamp::make_msec(0, 5);
+    _interval = Timestamp::make_msec(0, 100);
+    if (Args(conf, this, errh)
+	.read("FLOWS", _nflows)
+	.read("LIMIT", _limit)
+	.read("QUANTUM", _quantum)
+	.read("TARGET", _target)
+	.read("INTERVAL", _interval)
+	.complete() < 0)
+	return -1;
+
+    if (_nflows < 1 || _nflows > (1U << 20))
+	return errh->error("FLOWS must be between 1 and %u", 1U << 20);
+    if (_limit < 1)
+	return errh->error("LIMIT must be positive");
+    if (_quantum < 1)
+	return errh->error("QUANTUM must be positive");
+    if (_interval <= Timestamp() || _interval.sec() > 60)
+	return errh->error("INTERVAL must be between 0 and 60 seconds");
+    _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+    return 0;
+}
+
+int
+FQCoDel::initialize(ErrorHandler *errh)
+{
+    if (!(_flows = new Flow[_nflows]))
+	return errh->error("out of memory");
+    for (uint32_t i = 0; i < _nflows; ++i) {
+	Flow &f = _flows[i];
+	f.head = f.tail = 0;
+	f.length = f.backlog = 0;
+	f.deficit = 0;
+	f.next = -1;
+	f.list = list_none;
+	f.dropping = false;
+	f.count = f.lastcount = 0;
+    }
+    _new_flows.head = _new_flows.tail = -1;
+    _old_flows.head = _old_flows.tail = -1;
+    _perturbation = click_random();
+    _max_packet = 0;
+    return 0;
+}
+
+void
+FQCoDel::cleanup(CleanupStage)
+{
+    if (_flows)
+	for (uint32_t i = 0; i < _nflows; ++i)
+	    while (Packet *p = _flows[i].head) {
+		_flows[i].head = p->next();
+		p->kill();
+	    }
+    delete[] _flows;
+    _flows = 0;
+}
+
+static inline uint32_t
+fqcodel_mix(uint32_t h, uint32_t x)
+{
+    h ^= x * 0xCC9E2D51U;
+    h = (h << 13) | (h >> 19);
+    return h * 5 + 0xE6546B64U;
+}
+
+uint32_t
+FQCoDel::classify(Packet *p) const
+{
+    if (!p->has_network_header() || p->network_length() < 1)
+	return 0;
+    const unsigned char *nh = p->network_header();
+    uint32_t h = _perturbation;
+    if ((nh[0] >> 4) == 4 && p->network_length() >= (int) sizeof(click_ip)) {
+	const click_ip *iph = p->ip_header();
+	h = fqcodel_mix(h, iph->ip_src.s_addr);
+	h = fqcodel_mix(h, iph->ip_dst.s_addr);
+	h = fqcodel_mix(h, iph->ip_p);
+	if ((iph->ip_p == IP_PROTO_TCP || iph->ip_p == IP_PROTO_UDP
+	     || iph->ip_p == IP_PROTO_SCTP)
+	    && IP_FIRSTFRAG(iph) && p->has_transport_header()
+	    && p->transport_length() >= 4) {
+	    const click_udp *udph = p->udp_header();
+	    h = fqcodel_mix(h, udph->uh_sport | (udph->uh_dport << 16));
+	}
+    } else if ((nh[0] >> 4) == 6 && p->network_length() >= (int) sizeof(click_ip6)) {
+	const click_ip6 *ip6h = p->ip6_header();
+	for (int i = 0; i < 4; ++i) {
+	    h = fqcodel_mix(h, ip6h->ip6_src.s6_addr32[i]);
+	    h = fqcodel_mix(h, ip6h->ip6_dst.s6_addr32[i]);
+	}
+	h = fqcodel_mix(h, ip6h->ip6_flow & htonl(0x000FFFFF));
+	h = fqcodel_mix(h, ip6h->ip6_nxt);
+    } else
+	return 0;
+    h ^= h >> 16;
+    h *= 0x85EBCA6BU;
+    h ^= h >> 13;
+    // scale into [0, _nflows) without a division
+    return ((uint64_t) h * _nflows) >> 32;
+}
+
+inline void
+FQCoDel::list_append(FlowList &l, int fi)
+{
+    _flows[fi].next = -1;
+    if (l.tail >= 0)
+	_flows[l.tail].next = fi;
+    else
+	l.head = fi;
+    l.tail = fi;
+}
+
+inline int
+FQCoDel::list_pop(FlowList &l)
+{
+    int fi = l.head;
+    if ((l.head = _flows[fi].next) < 0)
+	l.tail = -1;
+    _flows[fi].next = -1;
+    return fi;
+}
+
+inline Packet *
+FQCoDel::flow_pop(Flow &f)
+{
+    Packet *p = f.head;
+    if (p) {
+	if (!(f.head = p->next()))
+	    f.tail = 0;
+	p->set_next(0);
+	--f.length;
+	f.backlog -= p->length();
+	--_length;
+    }
+    return p;
+}
+
+/** Drop packets from the head of the flow with the largest byte backlog,
+    and return them as a list. Like Linux's fq_codel, drop up to half of
+    that flow's backlog (at most 64 packets) at once, so the search over
+    all flows runs once per batch rather than once per packet. */
+Packet *
+FQCoDel::drop_from_fattest()
+{
+    uint32_t fat = 0, backlog = 0;
+    for (uint32_t i = 0; i < _nflows; ++i)
+	if (_flows[i].backlog > backlog) {
+	    fat = i;
+	    backlog = _flows[i].backlog;
+	}
+
+    Flow &f = _flows[fat];
+    uint32_t threshold = backlog >> 1;
+    Packet *dropped = 0, *tail = 0;
+    for (int n = 0; n < 64 && f.head && f.backlog > threshold; ++n) {
+	Packet *p = flow_pop(f);
+	if (tail)
+	    tail->set_next(p);
+	else
+	    dropped = p;
+	tail = p;
+	++_overlimit_drops;
+    }
+    return dropped;
+}
+
+void
+FQCoDel::push(int, Packet *p)
+{
+    uint32_t fi = classify(p);
+    SET_FIRST_TIMESTAMP_ANNO(p, Timestamp::now());
+    p->set_next(0);
+
+    _lock.acquire();
+    Flow &f = _flows[fi];
+    if (f.tail)
+	f.tail->set_next(p);
+    else
+	f.head = p;
+    f.tail = p;
+    ++f.length;
+    f.backlog += p->length();
+    ++_length;
+    if (p->length() > _max_packet)
+	_max_packet = p->length();
+
+    if (f.list == list_none) {
+	list_append(_new_flows, fi);
+	f.list = list_new;
+	f.deficit = _quantum;
+	++_nactive;
+    }
+
+    Packet *dropped = 0;
+    if (_length > _limit)
+	dropped = drop_from_fattest();
+    _lock.release();
+
+    _empty_note.wake();
+    while (dropped) {
+	Packet *next = dropped->next();
+	dropped->set_next(0);
+	checked_output_push(1, dropped);
+	dropped = next;
+    }
+}
+
+bool
+FQCoDel::should_drop(Flow &f, Packet *p, const Timestamp &now)
+{
+    if (!p) {
+	f.first_above_time = Timestamp();
+	return false;
+    }
+
+    Timestamp sojourn = now - FIRST_TIMESTAMP_ANNO(p);
+    SET_FIRST_TIMESTAMP_ANNO(p, sojourn);
+    // a flow holding at most one maximum-size packet is never too long
+    if (sojourn < _target || f.backlog <= _max_packet) {
+	f.first_above_time = Timestamp();
+	return false;
+    }
+    if (!f.first_above_time) {
+	f.first_above_time = now + _interval;
+	return false;
+    }
+    return now >= f.first_above_time;
+}
+
+Timestamp
+FQCoDel::control_law(const Timestamp &t, uint32_t count) const
+{
+    // interval / sqrt(count), with 10 bits of fraction in the square root
+    if (count > (1U << 20))
+	count = 1U << 20;
+    uint64_t interval_usec = _interval.usecval();
+    uint32_t root = int_sqrt((uint64_t) count << 20);
+    uint64_t delta = int_divide(interval_usec << 10, root);
+    return t + Timestamp::make_usec((Timestamp::value_type) delta);
+}
+
+/** Take the next packet from flow @a f, applying CoDel. Packets CoDel drops
+    are prepended to the @a dropped list. */
+Packet *
+FQCoDel::codel_dequeue(Flow &f, const Timestamp &now, Packet *&dropped)
+{
+    Packet *p = flow_pop(f);
+    bool ok_to_drop = should_drop(f, p, now);
+
+    if (f.dropping) {
+	if (!ok_to_drop)
+	    f.dropping = false;
+	else
+	    while (now >= f.drop_next && f.dropping) {
+		p->set_next(dropped);
+		dropped = p;
+		++_drops;
+		++f.count;
+		p = flow_pop(f);
+		if (!should_drop(f, p, now))
+		    f.dropping = false;
+		else
+		    f.drop_next = control_law(f.drop_next, f.count);
+	    }
+    } else if (ok_to_drop) {
+	p->set_next(dropped);
+	dropped = p;
+	++_drops;
+	p = flow_pop(f);
+	should_drop(f, p, now);
+	f.dropping = true;
+	// if we were dropping recently, resume near the old drop rate
+	uint32_t delta = f.count - f.lastcount;
+	if (delta > 1 && now - f.drop_next < _interval * 16)
+	    f.count = delta;
+	else
+	    f.count = 1;
+	f.lastcount = f.count;
+	f.drop_next = control_law(now, f.count);
+    }
+    return p;
+}
+
+Packet *
+FQCoDel::pull(int)
+{
+    Packet *p = 0, *dropped = 0;
+    Timestamp now = Timestamp::now();
+
+    _lock.acquire();
+    while (1) {
+	FlowList *l;
+	if (_new_flows.head >= 0)
+	    l = &_new_flows;
+	else if (_old_flows.head >= 0)
+	    l = &_old_flows;
+	else
+	    break;
+
+	int fi = l->head;
+	Flow &f = _flows[fi];
+	if (f.deficit <= 0) {
+	    f.deficit += _quantum;
+	    list_pop(*l);
+	    list_append(_old_flows, fi);
+	    f.list = list_old;
+	    continue;
+	}
+
+	if ((p = codel_dequeue(f, now, dropped))) {
+	    f.deficit -= p->length();
+	    break;
+	}
+
+	// An emptied new flow goes to the old list so that a flow cannot
+	// regain new-flow priority by emptying and refilling its queue.
+	list_pop(*l);
+	if (l == &_new_flows && _old_flows.head >= 0) {
+	    list_append(_old_flows, fi);
+	    f.list = list_old;
+	} else {
+	    f.list = list_none;
+	    --_nactive;
+	}
+    }
+    if (!_length && !p)
+	_empty_note.sleep();
+    _lock.release();
+
+    while (dropped) {
+	Packet *next = dropped->next();
+	dropped->set_next(0);
+	checked_output_push(1, dropped);
+	dropped = next;
+    }
+    return p;
+}
+
+String
+FQCoDel::read_handler(Element *e, void *thunk)
+{
+    FQCoDel *fq = static_cast<FQCoDel *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_target:
+	return fq->_target.unparse_interval();
+    case h_interval:
+	return fq->_interval.unparse_interval();
+    case h_quantum:
+	return String(fq->_quantum);
+    case h_limit:
+	return String(fq->_limit);
+    case h_active_flows:
+	return String(fq->_nactive);
+    case h_stats: {
+	StringAccum sa;
+	sa << fq->_length << " packets queued\n"
+	   << fq->_nactive << " active flows\n"
+	   << fq->_drops << " CoDel drops\n"
+	   << fq->_overlimit_drops << " overlimit drops\n";
+	return sa.take_string();
+    }
+    default:
+	return String();
+    }
+}
+
+int
+FQCoDel::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    FQCoDel *fq = static_cast<FQCoDel *>(e);
+    uintptr_t which = (uintptr_t) thunk;
+    if (which == h_target || which == h_interval) {
+	Timestamp t;
+	if (!cp_time(str, &t) || t <= Timestamp()
+	    || (which == h_interval && t.sec() > 60))
+	    return errh->error("bad time");
+	fq->_lock.acquire();
+	(which == h_target ? fq->_target : fq->_interval) = t;
+	fq->_lock.release();
+    } else {
+	uint32_t x;
+	if (!IntArg().parse(str, x) || x == 0 || x > 0x7FFFFFFF)
+	    return errh->error("expected positive integer");
+	fq->_lock.acquire();
+	if (which == h_quantum)
+	    fq->_quantum = x;
+	else
+	    fq->_limit = x;
+	fq->_lock.release();
+    }
+    return 0;
+}
+
+void
+FQCoDel::add_handlers()
+{
+    add_data_handlers("length", Handler::OP_READ, &_length);
+    add_data_handlers("drops", Handler::OP_READ, &_drops);
+    add_data_handlers("overlimit_drops", Handler::OP_READ, &_overlimit_drops);
+    add_read_handler("active_flows", read_handler, h_active_flows);
+    add_read_handler("stats", read_handler, h_stats);
+    add_read_handler("target", read_handler, h_target);
+    add_write_handler("target", write_handler, h_target);
+    add_read_handler("interval", read_handler, h_interval);
+    add_write_handler("interval", write_handler, h_interval);
+    add_read_handler("quantum", read_handler, h_quantum);
+    add_write_handler("quantum", write_handler, h_quantum);
+    add_read_handler("limit", read_handler, h_limit);
+    add_write_handler("limit", write_handler, h_limit);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(int64)
+EXPORT_ELEMENT(FQCoDel)
+ELEMENT_MT_SAFE(FQCoDel)
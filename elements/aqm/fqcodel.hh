@@ -0,0 +1,212 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_FQCODEL_HH
+#define CLICK_FQCODEL_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/timestamp.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+
+/*
+=c
+
+FQCoDel(I<KEYWORDS> FLOWS, LIMIT, QUANTUM, TARGET, INTERVAL)
+
+=s aqm
+
+flow-queue fair queueing with CoDel
+
+=d
+
+FQCoDel is a queue that combines per-flow fair queueing with P<CoDel> active
+queue management, following RFC 8290.  It replaces a graph made of a hash
+switch, many Queues, SetTimestamp elements, and CoDel and round-robin
+elements with a single push-to-pull element.
+
+Each incoming packet is hashed into one of FLOWS sub-queues.  IPv4 packets
+are hashed on their addresses, protocol, and, for TCP, UDP, and SCTP first
+fragments, their ports; IPv6 packets on their addresses, next header, and
+flow label.  Other packets share sub-queue 0.  The hash is perturbed by a
+random value chosen at initialization.
+
+Sub-queues are served by deficit round robin with a QUANTUM byte quantum.
+A sub-queue that becomes active joins a list of new flows, which is served
+before the list of old flows; this favors sparse flows, such as DNS or
+interactive traffic, over bulk flows.  A sub-queue that exhausts its
+deficit moves to the end of the old list.
+
+Every sub-queue runs its own CoDel instance.  FQCoDel records each packet's
+arrival time itself, so no SetTimestamp is needed.  When a packet is pulled,
+its sojourn time is compared against TARGET; if the sojourn time of a flow
+has stayed above TARGET for at least INTERVAL, CoDel drops packets from that
+flow at increasing frequency until its delay is under control.
+
+If more than LIMIT packets are queued, FQCoDel drops packets from the head
+of the sub-queue with the largest byte backlog, until half of that
+sub-queue's bytes are gone or 64 packets have been dropped.
+
+Dropped packets are emitted on output 1 if it exists, and are freed
+otherwise.
+
+FQCoDel's empty notifier sleeps when no packets are queued.
+
+Keyword arguments are:
+
+=over 8
+
+=item FLOWS
+
+Unsigned integer.  Number of sub-queues.  Default is 1024.
+
+=item LIMIT
+
+Unsigned integer.  Maximum number of packets queued over all sub-queues.
+Default is 10240.
+
+=item QUANTUM
+
+Unsigned integer.  Deficit round robin quantum, in bytes.  Default is 1514.
+
+=item TARGET
+
+Time.  Acceptable standing sojourn time.  Default is 5 milliseconds.
+
+=item INTERVAL
+
+Time.  Sliding window over which sojourn times are tracked; should be
+about a worst-case round-trip time.  Default is 100 milliseconds.
+
+=back
+
+=h length read-only
+
+Returns the number of packets queued.
+
+=h drops read-only
+
+Returns the number of packets dropped by CoDel.
+
+=h overlimit_drops read-only
+
+Returns the number of packets dropped because more than LIMIT packets were
+queued.
+
+=h active_flows read-only
+
+Returns the number of sub-queues on the new or old flow lists.
+
+=h stats read-only
+
+Returns human-readable statistics.
+
+=h target read/write
+
+Returns or sets TARGET.
+
+=h interval read/write
+
+Returns or sets INTERVAL.
+
+=h quantum read/write
+
+Returns or sets QUANTUM.
+
+=h limit read/write
+
+Returns or sets LIMIT.
+
+=n
+
+FQCoDel uses the "first timestamp" annotation to record each packet's
+arrival time.  On output, this annotation holds the packet's sojourn time.
+
+=e
+
+  FromDevice(eth0) -> Strip(14) -> CheckIPHeader
+      -> FQCoDel -> BandwidthRatedUnqueue(10Mbps) -> ...
+
+=a CoDel, Queue, DRRSched
+
+T. Hoeiland-Joergensen, P. McKenney, D. Taht, J. Gettys, and E. Dumazet.
+I<The Flow Queue CoDel Packet Scheduler and Active Queue Management
+Algorithm>.  RFC 8290, 2018. */
+
+class FQCoDel : public Element { public:
+
+    FQCoDel() CLICK_COLD;
+    ~FQCoDel() CLICK_COLD;
+
+    const char *class_name() const		{ return "FQCoDel"; }
+    const char *port_count() const		{ return PORTS_1_1X2; }
+    const char *processing() const		{ return "h/lh"; }
+    void *cast(const char *);
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int port, Packet *);
+    Packet *pull(int port);
+
+  private:
+
+    enum { list_none = 0, list_new = 1, list_old = 2 };
+
+    struct Flow {
+	Packet *head;
+	Packet *tail;
+	uint32_t length;		// packets
+	uint32_t backlog;		// bytes
+	int deficit;
+	int next;			// next flow on the same list, or -1
+	uint8_t list;
+	bool dropping;
+	uint32_t count;			// CoDel drops in this dropping state
+	uint32_t lastcount;
+	Timestamp first_above_time;
+	Timestamp drop_next;
+    };
+
+    struct FlowList {
+	int head;
+	int tail;
+    };
+
+    Flow *_flows;
+    FlowList _new_flows;
+    FlowList _old_flows;
+
+    uint32_t _nflows;
+    uint32_t _limit;
+    int _quantum;
+    Timestamp _target;
+    Timestamp _interval;
+    uint32_t _perturbation;
+    uint32_t _max_packet;
+
+    uint32_t _length;
+    uint32_t _nactive;
+    uint32_t _drops;
+    uint32_t _overlimit_drops;
+
+    Spinlock _lock;
+    ActiveNotifier _empty_note;
+
+    uint32_t classify(Packet *) const;
+    inline void list_append(FlowList &, int fi);
+    inline int list_pop(FlowList &);
+    inline Packet *flow_pop(Flow &);
+    bool should_drop(Flow &, Packet *, const Timestamp &now);
+    Packet *codel_dequeue(Flow &, const Timestamp &now, Packet *&dropped);
+    Timestamp control_law(const Timestamp &t, uint32_t count) const;
+    Packet *drop_from_fattest();
+
+    enum { h_target, h_interval, h_quantum, h_limit, h_active_flows, h_stats };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
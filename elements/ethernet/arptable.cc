@@ -25,19 +25,24 @@
 #include <click/args.hh>
 #include <click/bitvector.hh>
 #include <click/straccum.hh>
+#include <click/jsonstream.hh>
 #include <click/router.hh>
 #include <click/error.hh>
 #include <click/glue.hh>
 CLICK_DECLS
 
 ARPTable::ARPTable()
-    : _entry_capacity(0), _packet_capacity(2048), _entry_packet_capacity(0), _capacity_slim_factor(2), _expire_timer(this)
+    : _entry_capacity(0), _packet_capacity(2048), _entry_packet_capacity(0), _capacity_slim_factor(2), _expire_timer(this),
+      _cache(0), _ncache(0)
 {
     _entry_count = _packet_count = _drops = 0;
+    // slots start at generation 0, so they are all invalid
+    _generation = 1;
 }
 
 ARPTable::~ARPTable()
 {
+    delete[] _cache;
 }
 
 int
@@ -55,6 +60,10 @@ ARPTable::configure(Vector<String> &conf, ErrorHandler *errh)
     if (_capacity_slim_factor == 0)
 	return errh->error("CAPACITY_SLIM_FACTOR cannot be zero");
     set_timeout(timeout);
+    if (!_cache) {
+	_ncache = click_max_cpu_ids();
+	_cache = new ThreadCache[_ncache]();
+    }
     if (_timeout_j) {
 	_expire_timer.initialize(this);
 	_expire_timer.schedule_after_sec(_timeout_j / CLICK_HZ);
@@ -83,6 +92,7 @@ ARPTable::clear()
     }
     _entry_count = _packet_count = 0;
     _age.__clear();
+    ++_generation;
 }
 
 void
@@ -105,6 +115,7 @@ ARPTable::take_state(Element *e, ErrorHandler *errh)
 
     arpt->_entry_count = 0;
     arpt->_packet_count = 0;
+    ++arpt->_generation;
 }
 
 void
@@ -128,6 +139,7 @@ ARPTable::slim(click_jiffies_t now)
 
 	_alloc.deallocate(ae);
 	--_entry_count;
+	++_generation;
     }
 
     // Delete packets to make space.
@@ -202,6 +214,7 @@ ARPTable::insert(IPAddress ip, const EtherAddress &eth, Packet **head)
     ae->_live_at_j = now;
     ae->_num_polls_since_reply = 0;
     ae->_polled_at_j = ae->_live_at_j - CLICK_HZ;
+    ++_generation;
 
     if (ae->_age_link.next()) {
 	_age.erase(ae);
@@ -283,6 +296,38 @@ ARPTable::append_query(IPAddress ip, Packet *p)
     return r;
 }
 
+int
+ARPTable::lookup_slow(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j,
+		      CacheSlot *slot)
+{
+    // Read the generation before the table: if a writer intervenes, the
+    // slot filled below is already stale and will be ignored.
+    uint32_t generation = _generation.value();
+    _lock.acquire_read();
+    int r = -1;
+    if (Table::iterator it = _table.find(ip)) {
+	click_jiffies_t now = click_jiffies();
+	if (it->known(now, _timeout_j)) {
+	    *eth = it->_eth;
+	    if (poll_timeout_j
+		&& !click_jiffies_less(now, it->_live_at_j + poll_timeout_j)
+		&& it->allow_poll(now)) {
+		it->mark_poll(now);
+		r = 1;
+	    } else
+		r = 0;
+	    if (slot) {
+		slot->_ip = ip;
+		slot->_eth = it->_eth;
+		slot->_live_at_j = it->_live_at_j;
+		slot->_generation = generation;
+	    }
+	}
+    }
+    _lock.release_read();
+    return r;
+}
+
 IPAddress
 ARPTable::reverse_lookup(const EtherAddress &eth)
 {
@@ -313,6 +358,19 @@ ARPTable::read_handler(Element *e, void *user_data)
 	       << Timestamp::make_jiffies(now - ae->_live_at_j) << '\n';
 	}
 	break;
+    case h_table_json: {
+	JsonWriter w(sa);
+	w.begin_array();
+	for (ARPEntry *ae = arpt->_age.front(); ae; ae = ae->_age_link.next())
+	    w.begin_object()
+		.key("ip").quoted(ae->_ip)
+		.key("ok").value(ae->known(now, arpt->_timeout_j))
+		.key("eth").quoted(ae->_eth)
+		.key("age").number(Timestamp::make_jiffies(now - ae->_live_at_j))
+		.end_object();
+	w.end_array();
+	break;
+    }
     }
     return sa.take_string();
 }
@@ -354,6 +412,7 @@ void
 ARPTable::add_handlers()
 {
     add_read_handler("table", read_handler, h_table);
+    add_read_handler("table_json", read_handler, h_table_json);
     add_data_handlers("drops", Handler::OP_READ, &_drops);
     add_data_handlers("count", Handler::OP_READ, &_entry_count);
     add_data_handlers("length", Handler::OP_READ, &_packet_count);
@@ -57,6 +57,14 @@ service attack.
 Time value.  The amount of time after which an ARP entry will expire.  Default
 is 5 minutes.  Zero means ARP entries never expire.
 
+Lookups from the forwarding path do not take ARPTable's lock when they hit.
+Each thread keeps a small direct-mapped cache of resolved entries, stamped
+with a table generation number that every modification advances; a lookup
+is answered from the calling thread's cache when the stamp is current and
+the entry needs neither expiry nor a refresh poll.  Resolved lookups
+therefore perform no shared writes, however many threads forward through
+the table.
+
 =h table r
 
 Return a table of the ARP entries.  The returned string has four
@@ -64,6 +72,13 @@ space-separated columns: an IP address, whether the entry is valid (1 means
 valid, 0 means not), the corresponding Ethernet address, and finally, the
 amount of time since the entry was last updated.
 
+=h table_json r
+
+Return the ARP entries as a JSON array with one object per entry.  Each
+object has keys "ip", "ok" (true if the entry is valid), "eth", and "age"
+(seconds since the entry was last updated), with the same meanings as in
+the C<table> handler.
+
 =h drops r
 
 Return the number of packets dropped because of timeouts or capacity limits.
@@ -161,7 +176,7 @@ class ARPTable : public Element { public:
     void run_timer(Timer *);
 
     enum {
-	h_table, h_insert, h_delete, h_clear
+	h_table, h_table_json, h_insert, h_delete, h_clear
     };
     static String read_handler(Element *e, void *user_data) CLICK_COLD;
     static int write_handler(const String &str, Element *e, void *user_data, ErrorHandler *errh) CLICK_COLD;
@@ -208,6 +223,18 @@ class ARPTable : public Element { public:
 
   private:
 
+    enum { CACHE_SIZE = 128 };	// per-thread read cache slots; power of 2
+
+    struct CacheSlot {
+	IPAddress _ip;
+	EtherAddress _eth;
+	uint32_t _generation;
+	click_jiffies_t _live_at_j;
+    };
+    struct ThreadCache {
+	CacheSlot slot[CACHE_SIZE];
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
     ReadWriteLock _lock;
 
     typedef HashContainer<ARPEntry> Table;
@@ -225,6 +252,17 @@ class ARPTable : public Element { public:
     SizedHashAllocator<sizeof(ARPEntry)> _alloc;
     Timer _expire_timer;
 
+    // Advanced, under the write lock, by every change that can invalidate
+    // a cached mapping.  Read-mostly, so kept off the counters' line.
+    atomic_uint32_t _generation CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    ThreadCache *_cache;
+    unsigned _ncache;
+
+    static inline unsigned cache_index(IPAddress ip) {
+	return ntohl(ip.addr()) & (CACHE_SIZE - 1);
+    }
+    int lookup_slow(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j,
+		    CacheSlot *slot);
     ARPEntry *ensure(IPAddress ip, click_jiffies_t now);
     void slim(click_jiffies_t now);
 
@@ -233,23 +271,21 @@ class ARPTable : public Element { public:
 inline int
 ARPTable::lookup(IPAddress ip, EtherAddress *eth, uint32_t poll_timeout_j)
 {
-    _lock.acquire_read();
-    int r = -1;
-    if (Table::iterator it = _table.find(ip)) {
+    unsigned c = click_current_cpu_id();
+    if (c >= _ncache)
+	return lookup_slow(ip, eth, poll_timeout_j, 0);
+    CacheSlot *slot = &_cache[c].slot[cache_index(ip)];
+    if (slot->_generation == _generation.value() && slot->_ip == ip) {
 	click_jiffies_t now = click_jiffies();
-	if (it->known(now, _timeout_j)) {
-	    *eth = it->_eth;
-	    if (poll_timeout_j
-		&& !click_jiffies_less(now, it->_live_at_j + poll_timeout_j)
-		&& it->allow_poll(now)) {
-		it->mark_poll(now);
-		r = 1;
-	    } else
-		r = 0;
+	if ((!_timeout_j
+	     || click_jiffies_less(now, slot->_live_at_j + _timeout_j))
+	    && (!poll_timeout_j
+		|| click_jiffies_less(now, slot->_live_at_j + poll_timeout_j))) {
+	    *eth = slot->_eth;
+	    return 0;
 	}
     }
-    _lock.release_read();
-    return r;
+    return lookup_slow(ip, eth, poll_timeout_j, slot);
 }
 
 inline EtherAddress
@@ -222,6 +222,9 @@ destined for port 8000 or 8080; the second output is for TCP packets
 destined for any other user port (that is, port > 1023); and the third
 output is for all other TCP packets. Non-TCP packets are dropped.
 
+=h drops read-only
+Returns the number of packets that matched no pattern and were dropped.
+
 =h program read-only
 Returns a human-readable definition of the program the IPClassifier element
 is using to classify packets. At each step in the program, four bytes
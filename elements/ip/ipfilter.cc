@@ -1310,10 +1310,21 @@ IPFilter::program_string(Element *e, void *)
     return ipf->_zprog.unparse();
 }
 
+String
+IPFilter::read_drops(Element *e, void *)
+{
+    IPFilter *ipf = static_cast<IPFilter *>(e);
+    click_uint_large_t n = 0;
+    for (unsigned i = 0; i < ipf->_drops.size(); ++i)
+	n += ipf->_drops[i];
+    return String(n);
+}
+
 void
 IPFilter::add_handlers()
 {
     add_read_handler("program", program_string);
+    add_read_handler("drops", read_drops);
 }
 
 
@@ -1389,7 +1400,13 @@ IPFilter::length_checked_match(const IPFilterProgram &zprog, const Packet *p,
 void
 IPFilter::push(int, Packet *p)
 {
-    checked_output_push(match(_zprog, p), p);
+    int port = match(_zprog, p);
+    if ((unsigned) port < (unsigned) noutputs())
+	output(port).push(p);
+    else {
+	++*_drops;
+	p->kill();
+    }
 }
 
 CLICK_ENDDECLS
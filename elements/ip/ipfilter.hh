@@ -2,6 +2,7 @@
 #define CLICK_IPFILTER_HH
 #include "elements/standard/classification.hh"
 #include <click/element.hh>
+#include <click/perthread.hh>
 CLICK_DECLS
 
 /*
@@ -96,6 +97,10 @@ with IPFilter.
            // Default-2:
            deny all);
 
+=h drops read-only
+Returns the number of packets that were denied or matched no pattern.  Each
+thread counts its own drops; this handler adds them together.
+
 =h program read-only
 Returns a human-readable definition of the program the IPFilter element
 is using to classify packets. At each step in the program, four bytes
@@ -253,6 +258,7 @@ class IPFilter : public Element { public:
   protected:
 
     IPFilterProgram _zprog;
+    PerThread<click_uint_large_t> _drops;
 
   private:
 
@@ -297,6 +303,7 @@ class IPFilter : public Element { public:
 				    const Packet *p, int packet_length);
 
     static String program_string(Element *e, void *user_data);
+    static String read_drops(Element *e, void *user_data);
 
 };
 
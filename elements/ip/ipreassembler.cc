@@ -36,10 +36,9 @@ CLICK_DECLS
 #define IP_BYTE_OFF(iph)	((ntohs((iph)->ip_off) & IP_OFFMASK) << 3)
 
 IPReassembler::IPReassembler()
-    : _stat_frags_seen(0), _stat_good_assem(0), _stat_failed_assem(0), _stat_bad_pkts(0)
+    : _lru_head(0), _lru_tail(0),
+      _stat_frags_seen(0), _stat_good_assem(0), _stat_failed_assem(0), _stat_bad_pkts(0)
 {
-    for (int i = 0; i < NMAP; i++)
-	_map[i] = 0;
     static_assert(IPREASSEMBLER_ANNO_OFFSET + IPREASSEMBLER_ANNO_SIZE <= Packet::anno_size, "anno too big");
     static_assert(sizeof(ChunkLink) == IPREASSEMBLER_ANNO_SIZE, "sizeof(ChunkLink) is expected to equal IPREASSEMBLER_ANNO_SIZE.");
 }
@@ -67,28 +66,53 @@ int
 IPReassembler::initialize(ErrorHandler *)
 {
     _mem_used = 0;
-    _reap_time = 0;
     return 0;
 }
 
 void
 IPReassembler::cleanup(CleanupStage)
 {
-    for (int i = 0; i < NMAP; i++)
-	while (_map[i]) {
-	    WritablePacket *next = (WritablePacket *)(_map[i]->next());
-	    _map[i]->kill();
-	    _map[i] = next;
-	}
+    while (WritablePacket *q = _lru_head) {
+	_lru_head = (WritablePacket *) q->next();
+	q->kill();
+    }
+    _lru_tail = 0;
+    _map.clear();
+}
+
+inline void
+IPReassembler::lru_append(WritablePacket *q)
+{
+    q->set_next(0);
+    q->set_prev(_lru_tail);
+    if (_lru_tail)
+	_lru_tail->set_next(q);
+    else
+	_lru_head = q;
+    _lru_tail = q;
+}
+
+inline void
+IPReassembler::lru_remove(WritablePacket *q)
+{
+    if (q->prev())
+	q->prev()->set_next(q->next());
+    else
+	_lru_head = (WritablePacket *) q->next();
+    if (q->next())
+	q->next()->set_prev(q->prev());
+    else
+	_lru_tail = (WritablePacket *) q->prev();
+    q->set_next(0);
+    q->set_prev(0);
 }
 
 void
-IPReassembler::check_error(ErrorHandler *errh, int bucket, const Packet *p, const char *format, ...)
+IPReassembler::check_error(ErrorHandler *errh, const Packet *p, const char *format, ...)
 {
     va_list val;
     va_start(val, format);
     StringAccum sa;
-    sa << "buck " << bucket << ": ";
     if (p->has_network_header()) {
 	const click_ip *iph = p->ip_header();
 	sa << iph->ip_src << " > " << iph->ip_dst << " [" << ntohs(iph->ip_id) << ':' << PACKET_DLEN(p) << ((iph->ip_off & htons(IP_MF)) ? "+]: " : "]: ");
@@ -104,96 +128,85 @@ IPReassembler::check(ErrorHandler *errh)
     if (!errh)
 	errh = ErrorHandler::default_handler();
     uint32_t mem_used = 0;
-    for (int b = 0; b < NMAP; b++)
-	for (WritablePacket *q = _map[b]; q; q = (WritablePacket *)(q->next()))
-	    if (q->has_network_header()) {
-		const click_ip *qip = q->ip_header();
-		if (bucketno(qip) != b)
-		    check_error(errh, b, q, "in wrong bucket");
-		mem_used += IPH_MEM_USED + q->transport_length();
-		ChunkLink *chunk = &PACKET_CHUNK(q);
-		int off = 0;
+    int nqueues = 0;
+    for (WritablePacket *q = _lru_head; q; q = (WritablePacket *)(q->next()), ++nqueues)
+	if (q->has_network_header()) {
+	    Map::const_iterator it = _map.find(FragKey(q->ip_header()));
+	    if (!it.live() || it.value() != q)
+		check_error(errh, q, "not in table");
+	    mem_used += queue_mem(q);
+	    ChunkLink *chunk = &PACKET_CHUNK(q);
+	    int off = 0;
 #if VERBOSE_DEBUG
-		check_error(errh, b, q, "");
-		StringAccum sa;
-		while (chunk && (!off || off < q->transport_length())) {
-		    sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
-		    off = chunk->lastoff;
-		    chunk = next_chunk(q, chunk);
-		}
-		errh->message("  %s", sa.c_str());
-		chunk = &PACKET_CHUNK(q);
-		off = 0;
+	    check_error(errh, q, "");
+	    StringAccum sa;
+	    while (chunk && (!off || off < q->transport_length())) {
+		sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
+		off = chunk->lastoff;
+		chunk = next_chunk(q, chunk);
+	    }
+	    errh->message("  %s", sa.c_str());
+	    chunk = &PACKET_CHUNK(q);
+	    off = 0;
 #endif
-		while (chunk) {
-		    if (chunk->off >= chunk->lastoff
-			|| chunk->lastoff > q->transport_length()
-			|| (off != 0 && chunk->off < off + 8)) {
-			check_error(errh, b, q, "bad chunk (%d, %d) at %d", chunk->off, chunk->lastoff, off);
-			break;
-		    }
-		    off = chunk->lastoff;
-		    chunk = next_chunk(q, chunk);
+	    while (chunk) {
+		if (chunk->off >= chunk->lastoff
+		    || chunk->lastoff > q->transport_length()
+		    || (off != 0 && chunk->off < off + 8)) {
+		    check_error(errh, q, "bad chunk (%d, %d) at %d", chunk->off, chunk->lastoff, off);
+		    break;
 		}
-	    } else
-		errh->error("buck %d: missing IP header", b);
+		off = chunk->lastoff;
+		chunk = next_chunk(q, chunk);
+	    }
+	} else
+	    errh->error("missing IP header");
+    if (nqueues != (int) _map.size())
+	errh->error("bad queue count: have %d, table has %d", nqueues, (int) _map.size());
     if (mem_used != _mem_used)
 	errh->error("bad mem_used: have %u, claim %u", mem_used, _mem_used);
     return 0;
 }
 
+enum { H_DUMP, H_STATS };
+
 String
-IPReassembler::debug_dump(Element *e, void *)
+IPReassembler::read_handler(Element *e, void *thunk)
 {
     IPReassembler *r = (IPReassembler *) e;
-    r->check();
+    if ((intptr_t) thunk == H_DUMP)
+	r->check();
     StringAccum sa;
     sa <<
 	"frags seen total:    " << r->_stat_frags_seen << "\n"
 	"good reassemblies:   " << r->_stat_good_assem << "\n"
 	"failed reassemblies: " << r->_stat_failed_assem << "\n"
-	"bad fragments seen:  " << r->_stat_bad_pkts << "\n"
-	"cached chunk data:\n";
-    for (int b = 0; b < NMAP; b++)
-	for (WritablePacket *q = r->_map[b]; q; q = (WritablePacket *)(q->next()))
-	    if (const click_ip *qip = q->ip_header()) {
-		sa << ' ' << IPFlowID(qip) << ' ' << ntohs(qip->ip_id);
-		ChunkLink *chunk = &PACKET_CHUNK(q);
-		while (chunk &&
-		       (chunk->lastoff > chunk->off) &&
-		       (chunk->lastoff <= q->transport_length())) {
-		    sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
-		    chunk = next_chunk(q, chunk);
-		}
-		sa << '\n';
+	"bad fragments seen:  " << r->_stat_bad_pkts << "\n";
+    if ((intptr_t) thunk == H_STATS) {
+	sa << "partial packets:     " << r->_map.size() << "\n"
+	   << "memory used:         " << r->_mem_used << "\n";
+	return sa.take_string();
+    }
+    sa << "cached chunk data:\n";
+    for (WritablePacket *q = r->_lru_head; q; q = (WritablePacket *)(q->next()))
+	if (const click_ip *qip = q->ip_header()) {
+	    sa << ' ' << IPFlowID(qip) << ' ' << ntohs(qip->ip_id);
+	    ChunkLink *chunk = &PACKET_CHUNK(q);
+	    while (chunk &&
+		   (chunk->lastoff > chunk->off) &&
+		   (chunk->lastoff <= q->transport_length())) {
+		sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
+		chunk = next_chunk(q, chunk);
 	    }
-    return sa.take_string();
-}
-
-WritablePacket *
-IPReassembler::find_queue(Packet *p, WritablePacket ***store_pprev)
-{
-    const click_ip *iph = p->ip_header();
-    int bucket = bucketno(iph);
-    WritablePacket **pprev = &_map[bucket];
-    WritablePacket *q;
-    for (q = *pprev; q; pprev = (WritablePacket **)&q->next(), q = *pprev) {
-	const click_ip *qiph = q->ip_header();
-	if (same_segment(iph, qiph)) {
-	    *store_pprev = pprev;
-	    return q;
+	    sa << '\n';
 	}
-    }
-    *store_pprev = &_map[bucket];
-    return 0;
+    return sa.take_string();
 }
 
 Packet *
-IPReassembler::emit_whole_packet(WritablePacket *q, WritablePacket **q_pprev,
-				 Packet *p_in)
+IPReassembler::emit_whole_packet(WritablePacket *q, Packet *p_in)
 {
     ++_stat_good_assem;
-    *q_pprev = (WritablePacket *)q->next();
 
     click_ip *q_iph = q->ip_header();
     q_iph->ip_len = htons(q->network_length());
@@ -204,14 +217,14 @@ IPReassembler::emit_whole_packet(WritablePacket *q, WritablePacket **q_pprev,
     memset(&PACKET_CHUNK(q), 0, sizeof(ChunkLink));
     q->set_timestamp_anno(p_in->timestamp_anno());
     q->set_next(0);
+    q->set_prev(0);
 
     p_in->kill();
-    _mem_used -= IPH_MEM_USED + q->transport_length();
     return q;
 }
 
 void
-IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
+IPReassembler::make_queue(Packet *p)
 {
     int p_off = IP_BYTE_OFF(p->ip_header());
     int p_lastoff = p_off + PACKET_DLEN(p);
@@ -234,11 +247,10 @@ IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
 	memcpy(q->ip_header(), p->ip_header(), 20);
 	// copy data
 	memcpy(q->transport_header() + p_off, p->transport_header(), PACKET_DLEN(p));
+	q->set_timestamp_anno(p->timestamp_anno());
 	p->kill();
     }
 
-    _mem_used += IPH_MEM_USED + p_lastoff;
-
     click_ip *q_iph = q->ip_header();
     q_iph->ip_off = (q_iph->ip_off & ~htons(IP_OFFMASK)); // leave MF, DF, RF
 
@@ -249,10 +261,9 @@ IPReassembler::make_queue(Packet *p, WritablePacket **q_pprev)
     PACKET_CHUNK(q).lastoff = p_lastoff;
 
     // link it up
-    q->set_next(*q_pprev);
-    *q_pprev = q;
-
-    check();
+    _map.set(FragKey(q_iph), q);
+    lru_append(q);
+    _mem_used += queue_mem(q);
 }
 
 IPReassembler::ChunkLink *
@@ -281,7 +292,7 @@ IPReassembler::simple_action(Packet *p)
 	p->timestamp_anno().assign_now();
 	now = p->timestamp_anno().sec();
     }
-    if (now >= _reap_time)
+    if (_lru_head && _lru_head->timestamp_anno().sec() < now - REAP_TIMEOUT)
 	reap(now);
 
     // calculate packet edges
@@ -303,27 +314,32 @@ IPReassembler::simple_action(Packet *p)
 
     // clean up memory if necessary
     if (_mem_used > _mem_high_thresh)
-	reap_overfull(now);
+	reap_overfull();
 
     // get its Packet queue
-    WritablePacket **q_pprev;
-    WritablePacket *q = find_queue(p, &q_pprev);
-    if (!q) {			// make a new queue
-	make_queue(p, q_pprev);
+    Map::iterator it = _map.find(FragKey(iph));
+    if (!it.live()) {		// make a new queue
+	make_queue(p);
 	return 0;
     }
-    WritablePacket *q_bucket_next = (WritablePacket *)(q->next());
+    WritablePacket *q = it.value();
+
+    // error if packet already completed; q keeps its place in the LRU list
+    if (p_lastoff > q->transport_length()
+	&& !(q->ip_header()->ip_off & htons(IP_MF))) {
+	p->kill();
+	return 0;
+    }
+
+    // detach q while we work on it; it may move
+    lru_remove(q);
+    _mem_used -= queue_mem(q);
 
     if (_mtu_anno >= 0 && q->anno_u16(_mtu_anno) < p->network_length())
 	q->set_anno_u16(_mtu_anno, p->network_length());
 
     // extend the packet if necessary
     if (p_lastoff > q->transport_length()) {
-	// error if packet already completed
-	if (!(q->ip_header()->ip_off & htons(IP_MF))) {
-	    p->kill();
-	    return 0;
-	}
 	// Figure out how much space to request. Add 8 extra bytes to ensure
 	// room for a ChunkLink, and request extra space if this packet has MF
 	// set. XXX This algorithm could result in a number of intermediate
@@ -336,18 +352,16 @@ IPReassembler::simple_action(Packet *p)
 	// request space
 	if (!(q = q->put(want_space))) {
 	    click_chatter("out of memory");
-	    *q_pprev = q_bucket_next;
-	    _mem_used -= IPH_MEM_USED + old_transport_length;
+	    _map.erase(it);
 	    p->kill();
 	    return 0;
 	}
 	// get rid of extra space
 	q->take(q->transport_length() - p_lastoff);
-	// hook up packet, and add final chunk
-	*q_pprev = q;
+	// add final chunk
+	it.value() = q;
 	ChunkLink *last_chunk = (ChunkLink *)(q->transport_header() + old_transport_length);
 	last_chunk->off = last_chunk->lastoff = p_lastoff;
-	_mem_used += p_lastoff - old_transport_length;
     }
 
     // find chunks before and after p
@@ -376,9 +390,14 @@ IPReassembler::simple_action(Packet *p)
     if (p_off == 0) {
 	uint16_t old_ip_off = q->ip_header()->ip_off;
 	int header_delta = p->ip_header_offset() - q->ip_header_offset();
-	if (header_delta > 0)
-	    q = q->push(header_delta);
-	else if (header_delta < 0)
+	if (header_delta > 0) {
+	    if (!(q = q->push(header_delta))) {
+		_map.erase(it);
+		p->kill();
+		return 0;
+	    }
+	    it.value() = q;
+	} else if (header_delta < 0)
 	    q->pull(-header_delta);
 	q->set_ip_header((click_ip *)(q->data() + p->ip_header_offset()), p->ip_header_length());
         if (p->has_mac_header())
@@ -403,69 +422,55 @@ IPReassembler::simple_action(Packet *p)
     // Are we done with this packet?
     if ((q->ip_header()->ip_off & htons(IP_MF)) == 0
 	&& PACKET_CHUNK(q).off == 0
-	&& PACKET_CHUNK(q).lastoff == q->transport_length())
-	return emit_whole_packet(q, q_pprev, p);
+	&& PACKET_CHUNK(q).lastoff == q->transport_length()) {
+	_map.erase(it);
+	return emit_whole_packet(q, p);
+    }
 
-    // Otherwise, done for now
-    //check();
+    // Otherwise, done for now; q is now the most recently active queue
+    q->set_timestamp_anno(p->timestamp_anno());
     p->kill();
+    lru_append(q);
+    _mem_used += queue_mem(q);
     return 0;
 }
 
 void
-IPReassembler::reap_overfull(int now)
+IPReassembler::expire(WritablePacket *q)
 {
-    check();
-
-    // First throw away fragments at least 10 seconds old, then at least 5
-    // seconds old, then any fragments.
-    for (int delta = 10; delta >= 0; delta -= 5)
-	for (int bucket = 0; bucket < NMAP; bucket++) {
-	    WritablePacket **pprev = &_map[bucket];
-	    for (WritablePacket *q = *pprev; q; q = *pprev)
-		if (!delta || q->timestamp_anno().sec() < now - delta) {
-		    *pprev = (WritablePacket *)q->next();
-		    _mem_used -= IPH_MEM_USED + q->transport_length();
-		    q->set_next(0);
-		    checked_output_push(1, q);
-		    ++_stat_failed_assem;
-		    if (_mem_used <= _mem_low_thresh)
-			return;
-		} else
-		    pprev = (WritablePacket **)&q->next();
-	}
+    lru_remove(q);
+    _map.erase(FragKey(q->ip_header()));
+    _mem_used -= queue_mem(q);
+    checked_output_push(1, q);
+}
 
-    click_chatter("IPReassembler: cannot free enough memory!");
+void
+IPReassembler::reap_overfull()
+{
+    // Throw away the least recently active partial packets first.
+    while (_lru_head && _mem_used > _mem_low_thresh) {
+	expire(_lru_head);
+	++_stat_failed_assem;
+    }
+    if (_mem_used > _mem_low_thresh)
+	click_chatter("IPReassembler: cannot free enough memory!");
 }
 
 void
 IPReassembler::reap(int now)
 {
-    // look at all queues. If no activity for 30 seconds, kill that queue
-
+    // Kill queues with no activity for REAP_TIMEOUT seconds. The LRU list is
+    // ordered by activity, so only expired queues are visited.
     int kill_time = now - REAP_TIMEOUT;
-
-    for (int i = 0; i < NMAP; i++) {
-	WritablePacket **q_pprev = &_map[i];
-	for (WritablePacket *q = *q_pprev; q; ) {
-	    if (q->timestamp_anno().sec() < kill_time) {
-		*q_pprev = (WritablePacket *)q->next();
-		q->set_next(0);
-		_mem_used -= IPH_MEM_USED + q->transport_length();
-		checked_output_push(1, q);
-	    } else
-		q_pprev = (WritablePacket **)&q->next();
-	    q = *q_pprev;
-	}
-    }
-
-    _reap_time = now + REAP_INTERVAL;
+    while (_lru_head && _lru_head->timestamp_anno().sec() < kill_time)
+	expire(_lru_head);
 }
 
 void
 IPReassembler::add_handlers()
 {
-    add_read_handler("dump", debug_dump);
+    add_read_handler("dump", read_handler, H_DUMP);
+    add_read_handler("stats", read_handler, H_STATS);
 }
 
 CLICK_ENDDECLS
@@ -2,6 +2,7 @@
 #ifndef CLICK_IPREASSEMBLER_HH
 #define CLICK_IPREASSEMBLER_HH
 #include <click/element.hh>
+#include <click/hashtable.hh>
 #include <click/glue.hh>
 #include <clicknet/ip.h>
 #include <click/timer.hh>
@@ -26,9 +27,17 @@ seconds, the fragments are generally dropped. If IPReassembler has two
 outputs, however, a single packet containing all the received fragments at
 their proper offsets is pushed onto output 1.
 
-IPReassembler's memory usage is bounded. When memory consumption rises above
-HIMEM bytes, IPReassembler throws away old fragments until memory consumption
-drops below 3/4*HIMEM bytes. Default HIMEM is 256K.
+IPReassembler's memory usage is bounded. Every partially reassembled packet
+is charged for its whole packet buffer plus a fixed bookkeeping overhead. When
+memory consumption rises above HIMEM bytes, IPReassembler throws away the
+least recently active partial packets until memory consumption drops below
+3/4*HIMEM bytes. Default HIMEM is 256K.
+
+Partial packets are kept in a hash table keyed by source, destination,
+protocol, and IP ID, and on a list ordered by last activity. Finding a
+fragment's partial packet, expiring dormant packets, and evicting under memory
+pressure therefore take time independent of the number of partial packets,
+which keeps IPReassembler usable under fragment floods.
 
 Output packets have the same MAC header as the fragment that contains
 offset 0.  Other than that, input MAC headers are ignored.
@@ -53,6 +62,15 @@ is unchanged.
 
 =back
 
+=h stats read-only
+
+Returns reassembly statistics and current memory use.
+
+=h dump read-only
+
+Returns statistics and a list of the current partial packets, after
+consistency checking.
+
 =n
 
 You may want to attach an C<ICMPError(ADDR, timeexceeded, reassembly)> to the
@@ -60,7 +78,7 @@ second output.
 
 IPReassembler destroys its input packets' "next packet" annotations.
 
-=a IPFragmenter */
+=a IPFragmenter, IP6Reassembler */
 
 class IPReassembler : public Element { public:
 
@@ -86,16 +104,34 @@ class IPReassembler : public Element { public:
 	uint16_t lastoff;
     };
 
+    struct FragKey {
+	uint32_t src;
+	uint32_t dst;
+	uint16_t id;
+	uint8_t proto;
+	FragKey(const click_ip *iph)
+	    : src(iph->ip_src.s_addr), dst(iph->ip_dst.s_addr),
+	      id(iph->ip_id), proto(iph->ip_p) {
+	}
+	inline hashcode_t hashcode() const {
+	    return (src ^ (dst << 7) ^ (dst >> 25)) + ((uint32_t) id << 16) + proto;
+	}
+	inline bool operator==(const FragKey &x) const {
+	    return src == x.src && dst == x.dst && id == x.id && proto == x.proto;
+	}
+    };
+
   private:
 
     enum { REAP_TIMEOUT = 30, // seconds
-	   REAP_INTERVAL = 10, // seconds
-	   IPH_MEM_USED = 40 };
+	   QUEUE_MEM_USED = 64 };
 
-    enum { NMAP = 256 };
-    WritablePacket *_map[NMAP];
+    typedef HashTable<FragKey, WritablePacket *> Map;
+    Map _map;
 
-    int _reap_time;
+    // partial packets, least recently active first, linked by next/prev
+    WritablePacket *_lru_head;
+    WritablePacket *_lru_tail;
 
     uint32_t _stat_frags_seen;
     uint32_t _stat_good_assem;
@@ -107,34 +143,22 @@ class IPReassembler : public Element { public:
     uint32_t _mem_low_thresh;	// defaults to 3/4 * _mem_high_thresh
     int8_t _mtu_anno;
 
-    static inline int bucketno(const click_ip *);
-    static inline bool same_segment(const click_ip *, const click_ip *);
-    static String debug_dump(Element *e, void *);
+    static String read_handler(Element *e, void *) CLICK_COLD;
 
-    WritablePacket *find_queue(Packet *, WritablePacket ***);
-    void make_queue(Packet *, WritablePacket **);
+    static inline uint32_t queue_mem(const Packet *q) {
+	return QUEUE_MEM_USED + q->buffer_length();
+    }
+    inline void lru_append(WritablePacket *);
+    inline void lru_remove(WritablePacket *);
+    void make_queue(Packet *);
     static ChunkLink *next_chunk(WritablePacket *, ChunkLink *);
-    Packet *emit_whole_packet(WritablePacket *, WritablePacket **, Packet *);
-    void reap_overfull(int);
+    Packet *emit_whole_packet(WritablePacket *, Packet *);
+    void expire(WritablePacket *);
+    void reap_overfull();
     void reap(int);
-    static void check_error(ErrorHandler *, int, const Packet *, const char *, ...);
+    static void check_error(ErrorHandler *, const Packet *, const char *, ...);
 
 };
 
-
-inline int
-IPReassembler::bucketno(const click_ip *h)
-{
-    return (h->ip_id % NMAP);
-}
-
-inline bool
-IPReassembler::same_segment(const click_ip *h, const click_ip *h2)
-{
-    return h->ip_id == h2->ip_id && h->ip_p == h2->ip_p
-	&& h->ip_src.s_addr == h2->ip_src.s_addr
-	&& h->ip_dst.s_addr == h2->ip_dst.s_addr;
-}
-
 CLICK_ENDDECLS
 #endif
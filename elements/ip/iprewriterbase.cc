@@ -30,6 +30,7 @@
 #include <click/llrpc.h>
 #include <click/args.hh>
 #include <click/straccum.hh>
+#include <click/jsonstream.hh>
 #include <click/error.hh>
 #include <click/algorithm.hh>
 #include <click/heap.hh>
@@ -395,6 +396,22 @@ IPRewriterBase::read_handler(Element *e, void *user_data)
     return sa.take_string();
 }
 
+String
+IPRewriterBase::table_json_handler(Element *e, void *user_data)
+{
+    IPRewriterBase *rw = static_cast<IPRewriterBase *>(e);
+    Map *map = rw->get_map(reinterpret_cast<intptr_t>(user_data));
+    click_jiffies_t now = click_jiffies();
+    StringAccum sa;
+    JsonWriter w(sa);
+    w.begin_array();
+    if (map)
+	for (Map::iterator iter = map->begin(); iter.live(); ++iter)
+	    iter->flow()->unparse_json(w, iter->direction(), now);
+    w.end_array();
+    return sa.take_string();
+}
+
 int
 IPRewriterBase::write_handler(const String &str, Element *e, void *user_data, ErrorHandler *errh)
 {
@@ -167,6 +167,7 @@ class IPRewriterBase : public Element { public:
     static String read_handler(Element *e, void *user_data) CLICK_COLD;
     static int write_handler(const String &str, Element *e, void *user_data, ErrorHandler *errh) CLICK_COLD;
     static int pattern_write_handler(const String &str, Element *e, void *user_data, ErrorHandler *errh) CLICK_COLD;
+    static String table_json_handler(Element *e, void *user_data) CLICK_COLD;
 
     friend int IPRewriterInput::rewrite_flowid(const IPFlowID &flowid,
 			IPFlowID &rewritten_flowid, Packet *p, int mapid);
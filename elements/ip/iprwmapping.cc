@@ -27,6 +27,7 @@
 #include <clicknet/udp.h>
 #include <click/confparse.hh>
 #include <click/straccum.hh>
+#include <click/jsonstream.hh>
 #include <click/error.hh>
 #include <click/algorithm.hh>
 #include <click/heap.hh>
@@ -160,6 +161,32 @@ IPRewriterFlow::unparse(StringAccum &sa, bool direction,
     unparse_ports(sa, direction, now);
 }
 
+void
+IPRewriterFlow::unparse_json(JsonWriter &w, bool direction,
+			     click_jiffies_t now) const
+{
+    const IPFlowID &flowid = _e[direction].flowid();
+    const IPFlowID &rewritten = _e[direction].rewritten_flowid();
+    click_jiffies_t expiry_j = _expiry_j;
+    if (_guaranteed)
+	expiry_j = _owner->owner->best_effort_expiry(this);
+    w.begin_object()
+	.key("src").quoted(flowid.saddr())
+	.key("sport").value(ntohs(flowid.sport()))
+	.key("dst").quoted(flowid.daddr())
+	.key("dport").value(ntohs(flowid.dport()))
+	.key("rewritten_src").quoted(rewritten.saddr())
+	.key("rewritten_sport").value(ntohs(rewritten.sport()))
+	.key("rewritten_dst").quoted(rewritten.daddr())
+	.key("rewritten_dport").value(ntohs(rewritten.dport()))
+	.key("reply").value(direction)
+	.key("output").value(_e[direction].output())
+	.key("reply_output").value(_e[!direction].output())
+	.key("input").value(_owner->owner_input)
+	.key("expiry").value((click_jiffies_difference_t) (expiry_j + (CLICK_HZ / 2) - now) / (click_jiffies_difference_t) CLICK_HZ)
+	.end_object();
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(IPRewriterPattern)
 ELEMENT_PROVIDES(IPRewriterMapping)
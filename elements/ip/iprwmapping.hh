@@ -8,6 +8,7 @@
 #include <clicknet/ip.h>
 #include "iprwpattern.hh"
 CLICK_DECLS
+class JsonWriter;
 class IPRewriterBase;
 class IPRewriterFlow;
 class IPRewriterHeap;
@@ -139,6 +140,7 @@ class IPRewriterFlow { public:
 
     void unparse(StringAccum &sa, bool direction, click_jiffies_t now) const;
     void unparse_ports(StringAccum &sa, bool direction, click_jiffies_t now) const;
+    void unparse_json(JsonWriter &w, bool direction, click_jiffies_t now) const;
 
     struct heap_less {
 	inline bool operator()(IPRewriterFlow *a, IPRewriterFlow *b) {
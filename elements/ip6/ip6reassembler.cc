@@ -0,0 +1,517 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ip6reassembler.{cc,hh} -- defragments IPv6 packets
+ *
+ * Copyright (c) 2001 Massachusetts Institute of Technology
+ * Copyright (c) 2002 International Computer Science Institute
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * Further elaboration of this license, including a DISCLAIMER OF ANY
+ * WARRANTY, EXPRESS OR IMPLIED, is provided in the LICENSE file, which is
+ * also accessible at http://www.pdos.lcs.mit.edu/click/license.html
+ */
+
+#include <click/config.h>
+#include "ip6reassembler.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+#define PACKET_CHUNK(p)		(*((ChunkLink *)((p)->anno_u8() + IPREASSEMBLER_ANNO_OFFSET)))
+#define PACKET_DLEN(p)		((p)->transport_length())
+
+// extension headers that may precede the Fragment header
+enum { IP6_EXT_HOPOPTS = 0, IP6_EXT_ROUTING = 43, IP6_EXT_DSTOPTS = 60 };
+
+IP6Reassembler::IP6Reassembler()
+    : _lru_head(0), _lru_tail(0),
+      _stat_frags_seen(0), _stat_good_assem(0), _stat_failed_assem(0), _stat_bad_pkts(0)
+{
+    static_assert(sizeof(ChunkLink) == IPREASSEMBLER_ANNO_SIZE, "sizeof(ChunkLink) is expected to equal IPREASSEMBLER_ANNO_SIZE.");
+}
+
+IP6Reassembler::~IP6Reassembler()
+{
+}
+
+int
+IP6Reassembler::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _mem_high_thresh = 256 * 1024;
+    if (Args(conf, this, errh)
+	.read("HIMEM", _mem_high_thresh)
+	.complete() < 0)
+	return -1;
+    _mem_low_thresh = (_mem_high_thresh >> 2) * 3;
+    return 0;
+}
+
+int
+IP6Reassembler::initialize(ErrorHandler *)
+{
+    _mem_used = 0;
+    return 0;
+}
+
+void
+IP6Reassembler::cleanup(CleanupStage)
+{
+    while (WritablePacket *q = _lru_head) {
+	_lru_head = (WritablePacket *) q->next();
+	q->kill();
+    }
+    _lru_tail = 0;
+    _map.clear();
+}
+
+inline void
+IP6Reassembler::lru_append(WritablePacket *q)
+{
+    q->set_next(0);
+    q->set_prev(_lru_tail);
+    if (_lru_tail)
+	_lru_tail->set_next(q);
+    else
+	_lru_head = q;
+    _lru_tail = q;
+}
+
+inline void
+IP6Reassembler::lru_remove(WritablePacket *q)
+{
+    if (q->prev())
+	q->prev()->set_next(q->next());
+    else
+	_lru_head = (WritablePacket *) q->next();
+    if (q->next())
+	q->next()->set_prev(q->prev());
+    else
+	_lru_tail = (WritablePacket *) q->prev();
+    q->set_next(0);
+    q->set_prev(0);
+}
+
+/** Return the offset of @a p's Fragment header from its network header, 0
+    if it has none, or -1 if its extension headers are truncated. On return,
+    @a nxt_off is the offset of the Next Header field naming the Fragment
+    header. */
+int
+IP6Reassembler::find_fragment_header(const Packet *p, int &nxt_off)
+{
+    const uint8_t *nh = p->network_header();
+    int len = p->end_data() - nh;
+    if (len < (int) sizeof(click_ip6))
+	return -1;
+    nxt_off = 6;
+    int off = sizeof(click_ip6);
+    uint8_t nxt = nh[nxt_off];
+    while (nxt == IP6_EXT_HOPOPTS || nxt == IP6_EXT_ROUTING
+	   || nxt == IP6_EXT_DSTOPTS) {
+	if (off + 8 > len)
+	    return -1;
+	nxt_off = off;
+	nxt = nh[off];
+	off += (nh[off + 1] + 1) << 3;
+    }
+    if (nxt != IP6PROTO_FRAGMENT)
+	return 0;
+    if (off + (int) sizeof(click_ip6_fragment) > len)
+	return -1;
+    return off;
+}
+
+void
+IP6Reassembler::check_error(ErrorHandler *errh, const Packet *p, const char *format, ...)
+{
+    va_list val;
+    va_start(val, format);
+    StringAccum sa;
+    if (p->has_network_header() && p->has_transport_header()) {
+	const click_ip6 *ip6h = p->ip6_header();
+	const click_ip6_fragment *fh = fragment_header(p);
+	sa << IP6Address(ip6h->ip6_src) << " > " << IP6Address(ip6h->ip6_dst)
+	   << " [" << ntohl(fh->ip6_frag_id) << ':' << PACKET_DLEN(p)
+	   << ((fh->ip6_frag_offset & htons(IP6_MF)) ? "+]: " : "]: ");
+    }
+    sa << format;
+    errh->xmessage(ErrorHandler::e_error, sa.c_str(), val);
+    va_end(val);
+}
+
+int
+IP6Reassembler::check(ErrorHandler *errh)
+{
+    if (!errh)
+	errh = ErrorHandler::default_handler();
+    uint32_t mem_used = 0;
+    int nqueues = 0;
+    for (WritablePacket *q = _lru_head; q; q = (WritablePacket *)(q->next()), ++nqueues)
+	if (q->has_network_header() && q->has_transport_header()) {
+	    Map::const_iterator it = _map.find(FragKey(q->ip6_header(), fragment_header(q)));
+	    if (!it.live() || it.value() != q)
+		check_error(errh, q, "not in table");
+	    mem_used += queue_mem(q);
+	    ChunkLink *chunk = &PACKET_CHUNK(q);
+	    int off = 0;
+	    while (chunk) {
+		if (chunk->off >= chunk->lastoff
+		    || chunk->lastoff > q->transport_length()
+		    || (off != 0 && chunk->off < off + 8)) {
+		    check_error(errh, q, "bad chunk (%d, %d) at %d", chunk->off, chunk->lastoff, off);
+		    break;
+		}
+		off = chunk->lastoff;
+		chunk = next_chunk(q, chunk);
+	    }
+	} else
+	    errh->error("missing IPv6 header");
+    if (nqueues != (int) _map.size())
+	errh->error("bad queue count: have %d, table has %d", nqueues, (int) _map.size());
+    if (mem_used != _mem_used)
+	errh->error("bad mem_used: have %u, claim %u", mem_used, _mem_used);
+    return 0;
+}
+
+enum { H_DUMP, H_STATS };
+
+String
+IP6Reassembler::read_handler(Element *e, void *thunk)
+{
+    IP6Reassembler *r = (IP6Reassembler *) e;
+    if ((intptr_t) thunk == H_DUMP)
+	r->check();
+    StringAccum sa;
+    sa <<
+	"frags seen total:    " << r->_stat_frags_seen << "\n"
+	"good reassemblies:   " << r->_stat_good_assem << "\n"
+	"failed reassemblies: " << r->_stat_failed_assem << "\n"
+	"bad fragments seen:  " << r->_stat_bad_pkts << "\n";
+    if ((intptr_t) thunk == H_STATS) {
+	sa << "partial packets:     " << r->_map.size() << "\n"
+	   << "memory used:         " << r->_mem_used << "\n";
+	return sa.take_string();
+    }
+    sa << "cached chunk data:\n";
+    for (WritablePacket *q = r->_lru_head; q; q = (WritablePacket *)(q->next())) {
+	const click_ip6 *ip6h = q->ip6_header();
+	sa << ' ' << IP6Address(ip6h->ip6_src) << " > " << IP6Address(ip6h->ip6_dst)
+	   << ' ' << ntohl(fragment_header(q)->ip6_frag_id);
+	ChunkLink *chunk = &PACKET_CHUNK(q);
+	while (chunk &&
+	       (chunk->lastoff > chunk->off) &&
+	       (chunk->lastoff <= q->transport_length())) {
+	    sa << " (" << chunk->off << ',' << chunk->lastoff << ')';
+	    chunk = next_chunk(q, chunk);
+	}
+	sa << '\n';
+    }
+    return sa.take_string();
+}
+
+/** Remove the Fragment header from @a q, whose transport header points just
+    past it, and fix the Next Header and Payload Length fields. */
+static Packet *
+strip_fragment_header(WritablePacket *q, int fh_off, int nxt_off)
+{
+    uint8_t *nh = q->network_header();
+    nh[nxt_off] = reinterpret_cast<click_ip6_fragment *>(nh + fh_off)->ip6_frag_nxt;
+
+    int nh_off = q->network_header_offset();
+    int mac_off = q->has_mac_header() ? q->mac_header_offset() : -1;
+    memmove(q->data() + sizeof(click_ip6_fragment), q->data(), nh_off + fh_off);
+    q->pull(sizeof(click_ip6_fragment));
+    if (mac_off >= 0)
+	q->set_mac_header(q->data() + mac_off, nh_off - mac_off);
+    q->set_ip6_header((click_ip6 *)(q->data() + nh_off), fh_off);
+    q->ip6_header()->ip6_plen = htons(q->network_length() - sizeof(click_ip6));
+    return q;
+}
+
+Packet *
+IP6Reassembler::emit_whole_packet(WritablePacket *q, Packet *p_in)
+{
+    ++_stat_good_assem;
+
+    // zero out the annotations we used
+    memset(&PACKET_CHUNK(q), 0, sizeof(ChunkLink));
+    q->set_timestamp_anno(p_in->timestamp_anno());
+    q->set_next(0);
+    q->set_prev(0);
+    p_in->kill();
+
+    // the unfragmentable part may differ from the one seen at enqueue time
+    int nxt_off;
+    int fh_off = find_fragment_header(q, nxt_off);
+    assert(fh_off > 0);
+    return strip_fragment_header(q, fh_off, nxt_off);
+}
+
+void
+IP6Reassembler::make_queue(Packet *p)
+{
+    int p_off = ntohs(fragment_header(p)->ip6_frag_offset) & IP6_OFFMASK;
+    int p_lastoff = p_off + PACKET_DLEN(p);
+    WritablePacket *q;
+
+    if (p_off == 0) {
+	q = p->uniqueify();
+	if (!q) {
+	    click_chatter("out of memory");
+	    return;
+	}
+    } else {
+	// keep the unfragmentable part and Fragment header; the copy from
+	// the offset-0 fragment replaces them when it arrives
+	int hlen = p->network_header_length();
+	q = Packet::make(p->headroom() + p->network_header_offset(), 0, hlen + p_lastoff, 0);
+	if (!q) {
+	    p->kill();
+	    click_chatter("out of memory");
+	    return;
+	}
+	q->set_ip6_header((click_ip6 *)q->data(), hlen);
+	memcpy(q->data(), p->network_header(), hlen);
+	// copy data
+	memcpy(q->transport_header() + p_off, p->transport_header(), PACKET_DLEN(p));
+	q->set_timestamp_anno(p->timestamp_anno());
+	p->kill();
+    }
+
+    click_ip6_fragment *q_fh = fragment_header(q);
+    q_fh->ip6_frag_offset &= ~htons(IP6_OFFMASK); // leave MF
+
+    PACKET_CHUNK(q).off = p_off;
+    PACKET_CHUNK(q).lastoff = p_lastoff;
+
+    // link it up
+    _map.set(FragKey(q->ip6_header(), q_fh), q);
+    lru_append(q);
+    _mem_used += queue_mem(q);
+}
+
+IP6Reassembler::ChunkLink *
+IP6Reassembler::next_chunk(WritablePacket *q, ChunkLink *chunk)
+{
+    if (chunk->lastoff >= q->transport_length())
+	return 0;
+    else
+	return (ChunkLink *)(q->transport_header() + chunk->lastoff);
+}
+
+Packet *
+IP6Reassembler::simple_action(Packet *p)
+{
+    // check common case: not a fragment
+    assert(p->has_network_header());
+    int nxt_off;
+    int fh_off = find_fragment_header(p, nxt_off);
+    if (fh_off == 0)
+	return p;
+
+    ++_stat_frags_seen;
+    if (fh_off < 0) {
+	p->kill();
+	++_stat_bad_pkts;
+	return 0;
+    }
+
+    // calculate packet edges
+    const click_ip6 *ip6h = p->ip6_header();
+    const click_ip6_fragment *fh = (const click_ip6_fragment *)(p->network_header() + fh_off);
+    bool more = (fh->ip6_frag_offset & htons(IP6_MF)) != 0;
+    int p_off = ntohs(fh->ip6_frag_offset) & IP6_OFFMASK;
+    int p_len = ntohs(ip6h->ip6_plen) + (int) sizeof(click_ip6)
+	- fh_off - (int) sizeof(click_ip6_fragment);
+    int p_lastoff = p_off + p_len;
+
+    // check uncommon, but annoying, case: bad length, reassembled packet too
+    // long, or middle fragment length not a multiple of 8 bytes
+    if (p_len <= 0
+	|| p_lastoff + fh_off - (int) sizeof(click_ip6) > 0xFFFF
+	|| (more && (p_len & 7) != 0)
+	|| (int) p->network_length() < fh_off + (int) sizeof(click_ip6_fragment) + p_len) {
+	p->kill();
+	++_stat_bad_pkts;
+	return 0;
+    }
+    p->set_ip6_header(ip6h, fh_off + sizeof(click_ip6_fragment));
+    p->take(PACKET_DLEN(p) - p_len);
+
+    // atomic fragments (RFC 6946) are complete packets already
+    if (p_off == 0 && !more) {
+	if (WritablePacket *q = p->uniqueify())
+	    return strip_fragment_header(q, fh_off, nxt_off);
+	return 0;
+    }
+
+    // reap if necessary
+    int now = p->timestamp_anno().sec();
+    if (!now) {
+	p->timestamp_anno().assign_now();
+	now = p->timestamp_anno().sec();
+    }
+    if (_lru_head && _lru_head->timestamp_anno().sec() < now - REAP_TIMEOUT)
+	reap(now);
+
+    // clean up memory if necessary
+    if (_mem_used > _mem_high_thresh)
+	reap_overfull();
+
+    // get its Packet queue
+    Map::iterator it = _map.find(FragKey(ip6h, fh));
+    if (!it.live()) {		// make a new queue
+	make_queue(p);
+	return 0;
+    }
+    WritablePacket *q = it.value();
+
+    // error if packet already completed; q keeps its place in the LRU list
+    if (p_lastoff > q->transport_length()
+	&& !(fragment_header(q)->ip6_frag_offset & htons(IP6_MF))) {
+	p->kill();
+	return 0;
+    }
+
+    // detach q while we work on it; it may move
+    lru_remove(q);
+    _mem_used -= queue_mem(q);
+
+    // extend the packet if necessary
+    if (p_lastoff > q->transport_length()) {
+	// Add 8 extra bytes to ensure room for a ChunkLink, and request extra
+	// space if this packet has MF set.
+	int old_transport_length = q->transport_length();
+	assert((old_transport_length & 7) == 0);
+	int want_space = p_lastoff - old_transport_length + 8;
+	if (more)
+	    want_space += p_len;
+	// request space
+	if (!(q = q->put(want_space))) {
+	    click_chatter("out of memory");
+	    _map.erase(it);
+	    p->kill();
+	    return 0;
+	}
+	// get rid of extra space
+	q->take(q->transport_length() - p_lastoff);
+	// add final chunk
+	it.value() = q;
+	ChunkLink *last_chunk = (ChunkLink *)(q->transport_header() + old_transport_length);
+	last_chunk->off = last_chunk->lastoff = p_lastoff;
+    }
+
+    // find chunks before and after p
+    ChunkLink *chunk = &PACKET_CHUNK(q);
+    while (chunk->lastoff < p_off)
+	chunk = next_chunk(q, chunk);
+    ChunkLink *last = chunk;
+    while (last && last->lastoff < p_lastoff)
+	last = next_chunk(q, last);
+
+    // patch chunks
+    assert(chunk && last);
+    if (p_lastoff < last->off) {
+	ChunkLink *new_chunk = (ChunkLink *)(q->transport_header() + p_lastoff);
+	*new_chunk = *last;
+	chunk->lastoff = p_lastoff;
+    } else
+	chunk->lastoff = last->lastoff;
+    if (p_off < chunk->off)
+	chunk->off = p_off;
+
+    // copy p's data into q
+    memcpy(q->transport_header() + p_off, p->transport_header(), p_len);
+
+    // copy p's annotations and unfragmentable part if it is the first packet
+    if (p_off == 0) {
+	uint16_t old_frag_offset = fragment_header(q)->ip6_frag_offset;
+	int header_delta = p->transport_header_offset() - q->transport_header_offset();
+	if (header_delta > 0) {
+	    if (!(q = q->push(header_delta))) {
+		_map.erase(it);
+		p->kill();
+		return 0;
+	    }
+	    it.value() = q;
+	} else if (header_delta < 0)
+	    q->pull(-header_delta);
+	q->set_ip6_header((click_ip6 *)(q->data() + p->network_header_offset()), p->network_header_length());
+	if (p->has_mac_header())
+	    q->set_mac_header((q->data() + p->mac_header_offset()), p->mac_header_length());
+	memcpy(q->data(), p->data(), p->transport_header_offset());
+	fragment_header(q)->ip6_frag_offset = old_frag_offset;
+	ChunkLink old_chunk = PACKET_CHUNK(q);
+	q->copy_annotations(p);
+	PACKET_CHUNK(q) = old_chunk;
+    }
+
+    // clear MF if incoming packet has it cleared
+    if (!more)
+	fragment_header(q)->ip6_frag_offset &= ~htons(IP6_MF);
+
+    // Are we done with this packet?
+    if (!(fragment_header(q)->ip6_frag_offset & htons(IP6_MF))
+	&& PACKET_CHUNK(q).off == 0
+	&& PACKET_CHUNK(q).lastoff == q->transport_length()) {
+	_map.erase(it);
+	return emit_whole_packet(q, p);
+    }
+
+    // Otherwise, done for now; q is now the most recently active queue
+    q->set_timestamp_anno(p->timestamp_anno());
+    p->kill();
+    lru_append(q);
+    _mem_used += queue_mem(q);
+    return 0;
+}
+
+void
+IP6Reassembler::expire(WritablePacket *q)
+{
+    lru_remove(q);
+    _map.erase(FragKey(q->ip6_header(), fragment_header(q)));
+    _mem_used -= queue_mem(q);
+    q->ip6_header()->ip6_plen = htons(q->network_length() - sizeof(click_ip6));
+    checked_output_push(1, q);
+}
+
+void
+IP6Reassembler::reap_overfull()
+{
+    // Throw away the least recently active partial packets first.
+    while (_lru_head && _mem_used > _mem_low_thresh) {
+	expire(_lru_head);
+	++_stat_failed_assem;
+    }
+    if (_mem_used > _mem_low_thresh)
+	click_chatter("IP6Reassembler: cannot free enough memory!");
+}
+
+void
+IP6Reassembler::reap(int now)
+{
+    // Kill queues with no activity for REAP_TIMEOUT seconds.
+    int kill_time = now - REAP_TIMEOUT;
+    while (_lru_head && _lru_head->timestamp_anno().sec() < kill_time)
+	expire(_lru_head);
+}
+
+void
+IP6Reassembler::add_handlers()
+{
+    add_read_handler("dump", read_handler, H_DUMP);
+    add_read_handler("stats", read_handler, H_STATS);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IP6Reassembler)
@@ -0,0 +1,152 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_IP6REASSEMBLER_HH
+#define CLICK_IP6REASSEMBLER_HH
+#include <click/element.hh>
+#include <click/hashtable.hh>
+#include <click/ip6address.hh>
+#include <clicknet/ip6.h>
+CLICK_DECLS
+
+/*
+=c
+
+IP6Reassembler([I<KEYWORDS>])
+
+=s ip6
+
+Reassembles fragmented IPv6 packets
+
+=d
+
+Expects IPv6 packets with network header annotations as input to port 0. If
+an input packet carries a Fragment extension header, IP6Reassembler holds it
+until it has enough fragments to recreate the original packet. The
+reassembled packet, with the Fragment header removed and the preceding Next
+Header field and the Payload Length fixed, is emitted onto output 0.
+Unfragmented packets are emitted unchanged.
+
+The Fragment header may follow Hop-by-Hop Options, Routing, and Destination
+Options headers; these form the unfragmentable part, which is taken from the
+fragment with offset 0.
+
+If a set of fragments making a single packet is incomplete and dormant for 60
+seconds, the fragments are dropped. If IP6Reassembler has two outputs, a
+single packet containing all the received fragments at their proper offsets
+is pushed onto output 1 instead. This packet still carries its Fragment
+header, with offset 0.
+
+Like IPReassembler, IP6Reassembler keeps partial packets in a hash table and
+on a list ordered by last activity, and charges each partial packet for its
+whole buffer. When memory consumption rises above HIMEM bytes, the least
+recently active partial packets are thrown away until consumption drops
+below 3/4*HIMEM bytes.
+
+Keyword arguments are:
+
+=over 8
+
+=item HIMEM
+
+The upper bound for memory consumption, in bytes. Default is 256K.
+
+=back
+
+=h stats read-only
+
+Returns reassembly statistics and current memory use.
+
+=h dump read-only
+
+Returns statistics and a list of the current partial packets, after
+consistency checking.
+
+=n
+
+IP6Reassembler uses the IPREASSEMBLER annotation area and destroys its input
+packets' "next packet" annotations, like IPReassembler.
+
+=a IPReassembler, IP6Fragmenter, MarkIP6Header */
+
+class IP6Reassembler : public Element { public:
+
+    IP6Reassembler() CLICK_COLD;
+    ~IP6Reassembler() CLICK_COLD;
+
+    const char *class_name() const	{ return "IP6Reassembler"; }
+    const char *port_count() const	{ return PORTS_1_1X2; }
+    const char *processing() const	{ return PROCESSING_A_AH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+
+    int check(ErrorHandler * = 0);
+
+    Packet *simple_action(Packet *);
+
+    void add_handlers() CLICK_COLD;
+
+    struct ChunkLink {
+	uint16_t off;
+	uint16_t lastoff;
+    };
+
+    struct FragKey {
+	IP6Address src;
+	IP6Address dst;
+	uint32_t id;
+	FragKey(const click_ip6 *ip6h, const click_ip6_fragment *fh)
+	    : src(ip6h->ip6_src), dst(ip6h->ip6_dst), id(fh->ip6_frag_id) {
+	}
+	inline hashcode_t hashcode() const {
+	    return src.hashcode() ^ (dst.hashcode() << 7) ^ (dst.hashcode() >> 25) ^ id;
+	}
+	inline bool operator==(const FragKey &x) const {
+	    return id == x.id && src == x.src && dst == x.dst;
+	}
+    };
+
+  private:
+
+    enum { REAP_TIMEOUT = 60, // seconds
+	   QUEUE_MEM_USED = 64 };
+
+    typedef HashTable<FragKey, WritablePacket *> Map;
+    Map _map;
+
+    // partial packets, least recently active first, linked by next/prev
+    WritablePacket *_lru_head;
+    WritablePacket *_lru_tail;
+
+    uint32_t _stat_frags_seen;
+    uint32_t _stat_good_assem;
+    uint32_t _stat_failed_assem;
+    uint32_t _stat_bad_pkts;
+
+    uint32_t _mem_used;
+    uint32_t _mem_high_thresh;	// defaults to 256K
+    uint32_t _mem_low_thresh;	// defaults to 3/4 * _mem_high_thresh
+
+    static String read_handler(Element *e, void *) CLICK_COLD;
+
+    static inline uint32_t queue_mem(const Packet *q) {
+	return QUEUE_MEM_USED + q->buffer_length();
+    }
+    static inline click_ip6_fragment *fragment_header(const Packet *q) {
+	return (click_ip6_fragment *)(q->transport_header() - sizeof(click_ip6_fragment));
+    }
+    static int find_fragment_header(const Packet *, int &nxt_off);
+    inline void lru_append(WritablePacket *);
+    inline void lru_remove(WritablePacket *);
+    void make_queue(Packet *);
+    static ChunkLink *next_chunk(WritablePacket *, ChunkLink *);
+    Packet *emit_whole_packet(WritablePacket *, Packet *);
+    void expire(WritablePacket *);
+    void reap_overfull();
+    void reap(int);
+    static void check_error(ErrorHandler *, const Packet *, const char *, ...);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -31,10 +31,38 @@ AverageCounter::AverageCounter()
 void
 AverageCounter::reset()
 {
-  _count = 0;
-  _byte_count = 0;
+  Stats zero = { 0, 0, 0 };
+  _stats.set_all(zero);
   _first = 0;
-  _last = 0;
+}
+
+uint32_t
+AverageCounter::count() const
+{
+  uint32_t n = 0;
+  for (unsigned i = 0; i < _stats.size(); ++i)
+    n += _stats[i].count;
+  return n;
+}
+
+uint32_t
+AverageCounter::byte_count() const
+{
+  uint32_t n = 0;
+  for (unsigned i = 0; i < _stats.size(); ++i)
+    n += _stats[i].byte_count;
+  return n;
+}
+
+uint32_t
+AverageCounter::last() const
+{
+  // the latest per-thread arrival, measured relative to the first
+  uint32_t first = _first, last = first;
+  for (unsigned i = 0; i < _stats.size(); ++i)
+    if (_stats[i].last && (int32_t) (_stats[i].last - last) > 0)
+      last = _stats[i].last;
+  return last;
 }
 
 int
@@ -58,12 +86,14 @@ Packet *
 AverageCounter::simple_action(Packet *p)
 {
     uint32_t jpart = click_jiffies();
-    _first.compare_swap(0, jpart);
+    if (!_first)
+	_first.compare_swap(0, jpart);
+    Stats &s = *_stats;
     if (jpart - _first >= _ignore) {
-	_count++;
-	_byte_count += p->length();
+	s.count++;
+	s.byte_count += p->length();
     }
-    _last = jpart;
+    s.last = jpart;
     return p;
 }
 
@@ -106,10 +136,10 @@ averagecounter_reset_write_handler
 void
 AverageCounter::add_handlers()
 {
-  add_read_handler("count", averagecounter_read_count_handler, 0);
-  add_read_handler("byte_count", averagecounter_read_count_handler, 1);
-  add_read_handler("rate", averagecounter_read_rate_handler, 0);
-  add_read_handler("byte_rate", averagecounter_read_rate_handler, 1);
+  add_read_handler("count", averagecounter_read_count_handler, 0, Handler::f_counter);
+  add_read_handler("byte_count", averagecounter_read_count_handler, 1, Handler::f_counter);
+  add_read_handler("rate", averagecounter_read_rate_handler, 0, Handler::f_gauge);
+  add_read_handler("byte_rate", averagecounter_read_rate_handler, 1, Handler::f_gauge);
   add_write_handler("reset", averagecounter_reset_write_handler, 0, Handler::BUTTON);
 }
 
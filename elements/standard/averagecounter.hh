@@ -3,6 +3,7 @@
 #include <click/element.hh>
 #include <click/ewma.hh>
 #include <click/atomic.hh>
+#include <click/perthread.hh>
 #include <click/timer.hh>
 CLICK_DECLS
 
@@ -24,6 +25,9 @@ CLICK_DECLS
  * the first IGNORE number of seconds are ignored in
  * the count.
  *
+ * Several threads may use one AverageCounter.  Each thread counts into its
+ * own per-thread statistics, which handlers add together when read.
+ *
  * =h count read-only
  * Returns the number of packets that have passed through since the last reset.
  *
@@ -48,10 +52,10 @@ class AverageCounter : public Element { public:
     const char *port_count() const		{ return PORTS_1_1; }
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
 
-    uint32_t count() const			{ return _count; }
-    uint32_t byte_count() const			{ return _byte_count; }
+    uint32_t count() const;
+    uint32_t byte_count() const;
     uint32_t first() const			{ return _first; }
-    uint32_t last() const			{ return _last; }
+    uint32_t last() const;
     uint32_t ignore() const			{ return _ignore; }
     void reset();
 
@@ -62,10 +66,14 @@ class AverageCounter : public Element { public:
 
   private:
 
-    atomic_uint32_t _count;
-    atomic_uint32_t _byte_count;
+    struct Stats {
+	uint32_t count;
+	uint32_t byte_count;
+	uint32_t last;
+    };
+
+    PerThread<Stats> _stats;
     atomic_uint32_t _first;
-    atomic_uint32_t _last;
     uint32_t _ignore;
 
 };
@@ -23,7 +23,7 @@
 CLICK_DECLS
 
 BandwidthMeter::BandwidthMeter()
-  : _meters(0), _nmeters(0)
+  : _scaled_rate(0), _meters(0), _nmeters(0)
 {
 }
 
@@ -52,11 +52,11 @@ BandwidthMeter::configure(Vector<String> &conf, ErrorHandler *errh)
     else if (ba.status == NumArg::status_unitless)
       errh->warning("no units for bandwidth argument %d, assuming Bps", i+1);
 
-  unsigned max_value = 0xFFFFFFFF >> _rate.scale();
+  unsigned max_value = 0xFFFFFFFF >> rate_scale();
   for (int i = 0; i < conf.size(); i++) {
     if (vals[i] > max_value)
       return errh->error("rate %d too large (max %u)", i+1, max_value);
-    vals[i] = (vals[i]<<_rate.scale()) / _rate.epoch_frequency();
+    vals[i] = (vals[i]<<rate_scale()) / rate_freq();
   }
 
   if (vals.size() == 1) {
@@ -73,25 +73,24 @@ BandwidthMeter::configure(Vector<String> &conf, ErrorHandler *errh)
   return 0;
 }
 
+unsigned
+BandwidthMeter::aggregate_rate() const
+{
+  // Bring copies of each thread's rate up to date, so that idle threads'
+  // rates decay, without writing to other threads' rates.
+  unsigned sum = 0;
+  for (unsigned i = 0; i < _rates.size(); ++i) {
+    RateEWMA r = _rates[i].rate;
+    r.update(0);
+    sum += r.scaled_average();
+  }
+  return sum;
+}
+
 void
 BandwidthMeter::push(int, Packet *p)
 {
-  _rate.update(p->length());
-
-  unsigned r = _rate.scaled_average();
-  if (_nmeters < 2) {
-    int n = (r >= _meter1);
-    output(n).push(p);
-  } else {
-    unsigned *meters = _meters;
-    int nmeters = _nmeters;
-    for (int i = 0; i < nmeters; i++)
-      if (r < meters[i]) {
-	output(i).push(p);
-	return;
-      }
-    output(nmeters).push(p);
-  }
+  push_rated(update_rate(p->length()), p);
 }
 
 String
@@ -112,7 +111,6 @@ String
 BandwidthMeter::read_rate_handler(Element *f, void *)
 {
   BandwidthMeter *c = (BandwidthMeter *)f;
-  c->_rate.update(0);
   return cp_unparse_real2(c->scaled_rate()*c->rate_freq(), c->rate_scale());
 }
 
@@ -125,3 +123,4 @@ BandwidthMeter::add_handlers()
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(BandwidthMeter)
+ELEMENT_MT_SAFE(BandwidthMeter)
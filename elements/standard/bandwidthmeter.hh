@@ -2,6 +2,7 @@
 #define CLICK_BANDWIDTHMETER_HH
 #include <click/element.hh>
 #include <click/ewma.hh>
+#include <click/perthread.hh>
 CLICK_DECLS
 
 /*
@@ -25,6 +26,11 @@ CLICK_DECLS
  * sent to output 1; and so on. If it is >= RATEI<n>, packets are sent to
  * output I<n>.
  *
+ * Several threads may use one BandwidthMeter.  Each thread measures the
+ * packets it sees in a per-thread rate.  Once per rate epoch (jiffy), each
+ * thread sets the meter's rate to the sum of all the per-thread rates, and
+ * packets are classified by that sum.
+ *
  * =e
  *
  * This configuration fragment drops the input stream when it is generating
@@ -37,7 +43,13 @@ CLICK_DECLS
 
 class BandwidthMeter : public Element { protected:
 
-  RateEWMA _rate;
+  struct Rate {
+    RateEWMA rate;
+    unsigned epoch;
+  };
+
+  PerThread<Rate> _rates;
+  unsigned _scaled_rate;	// sum of per-thread rates
 
   unsigned _meter1;
   unsigned *_meters;
@@ -46,6 +58,10 @@ class BandwidthMeter : public Element { protected:
   static String meters_read_handler(Element *, void *) CLICK_COLD;
   static String read_rate_handler(Element *, void *);
 
+  unsigned aggregate_rate() const;
+  inline unsigned update_rate(unsigned delta);
+  inline void push_rated(unsigned rate, Packet *p);
+
  public:
 
   BandwidthMeter() CLICK_COLD;
@@ -55,9 +71,9 @@ class BandwidthMeter : public Element { protected:
   const char *port_count() const		{ return "1/2-"; }
   const char *processing() const		{ return PUSH; }
 
-  unsigned scaled_rate() const		{ return _rate.scaled_average(); }
-  unsigned rate_scale() const		{ return _rate.scale(); }
-  unsigned rate_freq() const		{ return _rate.epoch_frequency(); }
+  unsigned scaled_rate() const		{ return aggregate_rate(); }
+  unsigned rate_scale() const		{ return _rates[0].rate.scale(); }
+  unsigned rate_freq() const		{ return RateEWMA::epoch_frequency(); }
 
   int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
   void add_handlers() CLICK_COLD;
@@ -66,5 +82,40 @@ class BandwidthMeter : public Element { protected:
 
 };
 
+/** @brief Count @a delta in this thread's rate and return the meter's rate.
+ *
+ * The meter's rate changes only at epoch boundaries, as does a single
+ * RateEWMA's average, so recomputing the sum then loses no precision. */
+inline unsigned
+BandwidthMeter::update_rate(unsigned delta)
+{
+  Rate &r = *_rates;
+  unsigned now = RateEWMA::epoch();
+  r.rate.update(delta);
+  if (r.epoch != now) {
+    r.epoch = now;
+    _scaled_rate = aggregate_rate();
+  }
+  return _scaled_rate;
+}
+
+inline void
+BandwidthMeter::push_rated(unsigned r, Packet *p)
+{
+  if (_nmeters < 2) {
+    int n = (r >= _meter1);
+    output(n).push(p);
+  } else {
+    unsigned *meters = _meters;
+    int nmeters = _nmeters;
+    for (int i = 0; i < nmeters; i++)
+      if (r < meters[i]) {
+	output(i).push(p);
+	return;
+      }
+    output(nmeters).push(p);
+  }
+}
+
 CLICK_ENDDECLS
 #endif
@@ -29,6 +29,9 @@ BandwidthRatedUnqueue::BandwidthRatedUnqueue()
 bool
 BandwidthRatedUnqueue::run_task(Task *)
 {
+    if (_wheel)
+	return run_paced(true);
+
     bool worked = false;
     _runs++;
 
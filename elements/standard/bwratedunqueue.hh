@@ -16,6 +16,9 @@ CLICK_DECLS
  * defaults to 20 milliseconds worth of tokens, but can be customized by setting
  * one of BURST_DURATION or BURST_SIZE.
  *
+ * Like RatedUnqueue, BandwidthRatedUnqueue uses the configuration's
+ * PacingWheel, if any, to wait for tokens.
+ *
  * Keyword arguments are:
  *
  * =over 8
@@ -36,7 +39,8 @@ CLICK_DECLS
  *
  * =h rate read/write
  *
- * =a RatedUnqueue, Unqueue, BandwidthShaper, BandwidthRatedSplitter */
+ * =a RatedUnqueue, Unqueue, BandwidthShaper, BandwidthRatedSplitter,
+ * PacingWheel */
 
 class BandwidthRatedUnqueue : public RatedUnqueue { public:
 
@@ -243,16 +243,33 @@ Classifier::program_string(Element *element, void *)
     return c->_prog.unparse();
 }
 
+String
+Classifier::read_drops(Element *element, void *)
+{
+    Classifier *c = static_cast<Classifier *>(element);
+    click_uint_large_t n = 0;
+    for (unsigned i = 0; i < c->_drops.size(); ++i)
+	n += c->_drops[i];
+    return String(n);
+}
+
 void
 Classifier::add_handlers()
 {
     add_read_handler("program", Classifier::program_string, 0, Handler::CALM);
+    add_read_handler("drops", read_drops, 0);
 }
 
 void
 Classifier::push(int, Packet *p)
 {
-    checked_output_push(_prog.match(p), p);
+    int port = _prog.match(p);
+    if ((unsigned) port < (unsigned) noutputs())
+	output(port).push(p);
+    else {
+	++*_drops;
+	p->kill();
+    }
 }
 
 CLICK_ENDDECLS
@@ -1,6 +1,7 @@
 #ifndef CLICK_CLASSIFIER_HH
 #define CLICK_CLASSIFIER_HH
 #include <click/element.hh>
+#include <click/perthread.hh>
 #include "classification.hh"
 CLICK_DECLS
 
@@ -55,6 +56,10 @@ CLICK_DECLS
  * ARP requests are sent to output 0, ARP replies are sent to
  * output 1, IP packets to output 2, and all others to output 3.
  *
+ * =h drops read-only
+ * Returns the number of packets that matched no pattern and were dropped.
+ * Each thread counts its own drops; this handler adds them together.
+ *
  * =h program read-only
  * Returns a human-readable definition of the program the Classifier element
  * is using to classify packets. At each step in the program, four bytes
@@ -95,8 +100,10 @@ class Classifier : public Element { public:
   protected:
 
     Classification::Wordwise::Program _prog;
+    PerThread<click_uint_large_t> _drops;
 
     static String program_string(Element *, void *);
+    static String read_drops(Element *, void *);
 
 };
 
@@ -38,8 +38,44 @@ Counter::~Counter()
 void
 Counter::reset()
 {
-  _count = _byte_count = 0;
-  _count_triggered = _byte_triggered = false;
+  for (unsigned i = 0; i < _stats.size(); ++i)
+    _stats[i].count = _stats[i].byte_count = 0;
+  _count_triggered = _byte_triggered = 0;
+}
+
+Counter::counter_t
+Counter::count() const
+{
+  counter_t n = 0;
+  for (unsigned i = 0; i < _stats.size(); ++i)
+    n += _stats[i].count;
+  return n;
+}
+
+Counter::counter_t
+Counter::byte_count() const
+{
+  counter_t n = 0;
+  for (unsigned i = 0; i < _stats.size(); ++i)
+    n += _stats[i].byte_count;
+  return n;
+}
+
+void
+Counter::aggregate_rates(rate_t::signed_value_type &rate,
+			 byte_rate_t::signed_value_type &byte_rate)
+{
+  // Bring copies of each thread's rates up to date, so that idle threads'
+  // rates decay, without writing to other threads' statistics.
+  rate = byte_rate = 0;
+  for (unsigned i = 0; i < _stats.size(); ++i) {
+    rate_t r = _stats[i].rate;
+    byte_rate_t br = _stats[i].byte_rate;
+    r.update(0);
+    br.update(0);
+    rate += r.scaled_average();
+    byte_rate += br.scaled_average();
+  }
 }
 
 int
@@ -85,26 +121,33 @@ Counter::initialize(ErrorHandler *errh)
   return 0;
 }
 
+void
+Counter::check_triggers()
+{
+  if (!_count_triggered && count() >= _count_trigger
+      && _count_triggered.compare_swap(0, 1) == 0
+      && _count_trigger_h)
+    (void) _count_trigger_h->call_write();
+  if (!_byte_triggered && byte_count() >= _byte_trigger
+      && _byte_triggered.compare_swap(0, 1) == 0
+      && _byte_trigger_h)
+    (void) _byte_trigger_h->call_write();
+}
+
 Packet *
 Counter::simple_action(Packet *p)
 {
-    _count++;
-    _byte_count += p->length();
-    _rate.update(1);
-    _byte_rate.update(p->length());
-
-  if (_count == _count_trigger && !_count_triggered) {
-    _count_triggered = true;
-    if (_count_trigger_h)
-      (void) _count_trigger_h->call_write();
-  }
-  if (_byte_count >= _byte_trigger && !_byte_triggered) {
-    _byte_triggered = true;
-    if (_byte_trigger_h)
-      (void) _byte_trigger_h->call_write();
-  }
+    Stats &s = *_stats;
+    s.count++;
+    s.byte_count += p->length();
+    s.rate.update(1);
+    s.byte_rate.update(p->length());
+
+    if (unlikely((_count_trigger != (counter_t) -1 && !_count_triggered)
+		 || (_byte_trigger != (counter_t) -1 && !_byte_triggered)))
+	check_triggers();
 
-  return p;
+    return p;
 }
 
 
@@ -115,25 +158,29 @@ String
 Counter::read_handler(Element *e, void *thunk)
 {
     Counter *c = (Counter *)e;
+    rate_t::signed_value_type rate;
+    byte_rate_t::signed_value_type byte_rate;
+    unsigned scale = c->_stats[0].rate.scale(),
+	byte_scale = c->_stats[0].byte_rate.scale();
     switch ((intptr_t)thunk) {
       case H_COUNT:
-	return String(c->_count);
+	return String(c->count());
       case H_BYTE_COUNT:
-	return String(c->_byte_count);
+	return String(c->byte_count());
       case H_RATE:
-	c->_rate.update(0);	// drop rate after idle period
-	return c->_rate.unparse_rate();
+	c->aggregate_rates(rate, byte_rate);
+	return cp_unparse_real2(rate * rate_t::epoch_frequency(), scale);
       case H_BIT_RATE:
-	c->_byte_rate.update(0); // drop rate after idle period
+	c->aggregate_rates(rate, byte_rate);
 	// avoid integer overflow by adjusting scale factor instead of
 	// multiplying
-	if (c->_byte_rate.scale() >= 3)
-	    return cp_unparse_real2(c->_byte_rate.scaled_average() * c->_byte_rate.epoch_frequency(), c->_byte_rate.scale() - 3);
+	if (byte_scale >= 3)
+	    return cp_unparse_real2(byte_rate * byte_rate_t::epoch_frequency(), byte_scale - 3);
 	else
-	    return cp_unparse_real2(c->_byte_rate.scaled_average() * c->_byte_rate.epoch_frequency() * 8, c->_byte_rate.scale());
+	    return cp_unparse_real2(byte_rate * byte_rate_t::epoch_frequency() * 8, byte_scale);
       case H_BYTE_RATE:
-	c->_byte_rate.update(0); // drop rate after idle period
-	return c->_byte_rate.unparse_rate();
+	c->aggregate_rates(rate, byte_rate);
+	return cp_unparse_real2(byte_rate * byte_rate_t::epoch_frequency(), byte_scale);
       case H_COUNT_CALL:
 	if (c->_count_trigger_h)
 	    return String(c->_count_trigger);
@@ -155,14 +202,14 @@ Counter::write_handler(const String &in_str, Element *e, void *thunk, ErrorHandl
 	    return errh->error("'count_call' first word should be unsigned (count)");
 	if (HandlerCall::reset_write(c->_count_trigger_h, str, c, errh) < 0)
 	    return -1;
-	c->_count_triggered = false;
+	c->_count_triggered = 0;
 	return 0;
       case H_BYTE_COUNT_CALL:
 	  if (!IntArg().parse(cp_shift_spacevec(str), c->_byte_trigger))
 	    return errh->error("'byte_count_call' first word should be unsigned (count)");
 	if (HandlerCall::reset_write(c->_byte_trigger_h, str, c, errh) < 0)
 	    return -1;
-	c->_byte_triggered = false;
+	c->_byte_triggered = 0;
 	return 0;
       case H_RESET:
 	c->reset();
@@ -175,11 +222,11 @@ Counter::write_handler(const String &in_str, Element *e, void *thunk, ErrorHandl
 void
 Counter::add_handlers()
 {
-    add_read_handler("count", read_handler, H_COUNT);
-    add_read_handler("byte_count", read_handler, H_BYTE_COUNT);
-    add_read_handler("rate", read_handler, H_RATE);
-    add_read_handler("bit_rate", read_handler, H_BIT_RATE);
-    add_read_handler("byte_rate", read_handler, H_BYTE_RATE);
+    add_read_handler("count", read_handler, H_COUNT, Handler::f_counter);
+    add_read_handler("byte_count", read_handler, H_BYTE_COUNT, Handler::f_counter);
+    add_read_handler("rate", read_handler, H_RATE, Handler::f_gauge);
+    add_read_handler("bit_rate", read_handler, H_BIT_RATE, Handler::f_gauge);
+    add_read_handler("byte_rate", read_handler, H_BYTE_RATE, Handler::f_gauge);
     add_write_handler("reset", write_handler, H_RESET, Handler::f_button);
     add_write_handler("reset_counts", write_handler, H_RESET, Handler::f_button | Handler::f_uncommon);
     add_read_handler("count_call", read_handler, H_COUNT_CALL);
@@ -194,15 +241,17 @@ Counter::llrpc(unsigned command, void *data)
     uint32_t *val = reinterpret_cast<uint32_t *>(data);
     if (*val != 0)
       return -EINVAL;
-    _rate.update(0);		// drop rate after idle period
-    *val = _rate.rate();
+    rate_t::signed_value_type rate;
+    byte_rate_t::signed_value_type byte_rate;
+    aggregate_rates(rate, byte_rate);
+    *val = (rate * rate_t::epoch_frequency()) >> _stats[0].rate.scale();
     return 0;
 
   } else if (command == CLICK_LLRPC_GET_COUNT) {
     uint32_t *val = reinterpret_cast<uint32_t *>(data);
     if (*val != 0 && *val != 1)
       return -EINVAL;
-    *val = (*val == 0 ? _count : _byte_count);
+    *val = (*val == 0 ? count() : byte_count());
     return 0;
 
   } else if (command == CLICK_LLRPC_GET_COUNTS) {
@@ -213,9 +262,9 @@ Counter::llrpc(unsigned command, void *data)
       return -EINVAL;
     for (unsigned i = 0; i < cs.n; i++) {
       if (cs.keys[i] == 0)
-	cs.values[i] = _count;
+	cs.values[i] = count();
       else if (cs.keys[i] == 1)
-	cs.values[i] = _byte_count;
+	cs.values[i] = byte_count();
       else
 	return -EINVAL;
     }
@@ -227,3 +276,4 @@ Counter::llrpc(unsigned command, void *data)
 
 CLICK_ENDDECLS
 EXPORT_ELEMENT(Counter)
+ELEMENT_MT_SAFE(Counter)
@@ -3,6 +3,8 @@
 #define CLICK_COUNTER_HH
 #include <click/element.hh>
 #include <click/ewma.hh>
+#include <click/perthread.hh>
+#include <click/atomic.hh>
 #include <click/llrpc.h>
 CLICK_DECLS
 class HandlerCall;
@@ -39,6 +41,12 @@ emitting the packet.
 
 =back
 
+Counter may be used by several threads at once.  Each thread counts into its
+own per-thread statistics, which handlers add together when read, so counting
+needs no locks or atomic operations.  COUNT_CALL and BYTE_COUNT_CALL add up
+the per-thread counts for every packet until they fire, so they slow Counter
+down somewhat.
+
 =h count read-only
 
 Returns the number of packets that have passed through since the last reset.
@@ -111,8 +119,8 @@ class Counter : public Element { public:
     const char *class_name() const		{ return "Counter"; }
     const char *port_count() const		{ return PORTS_1_1; }
 
-    counter_t count() const                     { return _count; }
-    counter_t byte_count() const                { return _byte_count; }
+    counter_t count() const;
+    counter_t byte_count() const;
     void reset();
 
     int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
@@ -133,10 +141,14 @@ class Counter : public Element { public:
     typedef RateEWMAX<RateEWMAXParameters<4, 4> > byte_rate_t;
 #endif
 
-    counter_t _count;
-    counter_t _byte_count;
-    rate_t _rate;
-    byte_rate_t _byte_rate;
+    struct Stats {
+	counter_t count;
+	counter_t byte_count;
+	rate_t rate;
+	byte_rate_t byte_rate;
+    };
+
+    PerThread<Stats> _stats;
 
     counter_t _count_trigger;
     HandlerCall *_count_trigger_h;
@@ -144,8 +156,12 @@ class Counter : public Element { public:
     counter_t _byte_trigger;
     HandlerCall *_byte_trigger_h;
 
-    bool _count_triggered : 1;
-    bool _byte_triggered : 1;
+    atomic_uint32_t _count_triggered;
+    atomic_uint32_t _byte_triggered;
+
+    void check_triggers();
+    void aggregate_rates(rate_t::signed_value_type &rate,
+			 byte_rate_t::signed_value_type &byte_rate);
 
     static String read_handler(Element *, void *) CLICK_COLD;
     static int write_handler(const String&, Element*, void*, ErrorHandler*) CLICK_COLD;
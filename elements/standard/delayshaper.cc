@@ -26,7 +26,7 @@
 CLICK_DECLS
 
 DelayShaper::DelayShaper()
-    : _p(0), _timer(this), _notifier(Notifier::SEARCH_CONTINUE_WAKE)
+    : _p(0), _timer(this), _notifier(Notifier::SEARCH_CONTINUE_WAKE), _wheel(0)
 {
 }
 
@@ -53,6 +53,7 @@ DelayShaper::initialize(ErrorHandler *)
 {
     _timer.initialize(this);
     _upstream_signal = Notifier::upstream_empty_signal(this, 0, &_notifier);
+    _wheel = PacingWheel::find(this);
     return 0;
 }
 
@@ -91,7 +92,10 @@ DelayShaper::pull(int)
 	    _notifier.wake();
 	} else {
 	    // large delta, go to sleep and schedule Timer
-	    _timer.schedule_at(expiry);
+	    if (_wheel)
+		_wheel->schedule(this, _p->timestamp_anno());
+	    else
+		_timer.schedule_at(expiry);
 	    _notifier.sleep();
 	}
     } else if (!_upstream_signal) {
@@ -108,6 +112,12 @@ DelayShaper::run_timer(Timer *)
     _notifier.wake();
 }
 
+void
+DelayShaper::run_pacing(const Timestamp &)
+{
+    _notifier.wake();
+}
+
 String
 DelayShaper::read_param(Element *e, void *)
 {
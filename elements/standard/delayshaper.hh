@@ -4,6 +4,7 @@
 #include <click/element.hh>
 #include <click/timer.hh>
 #include <click/notifier.hh>
+#include <click/standard/pacingwheel.hh>
 CLICK_DECLS
 
 /*
@@ -29,13 +30,16 @@ until the enqueued packet is ready.
 
 SetTimestamp element can be used to stamp the packet.
 
+If the configuration contains a PacingWheel, DelayShaper waits for the
+enqueued packet's departure time on the wheel rather than on its own Timer.
+
 =h delay read/write
 
 Returns or sets the DELAY parameter.
 
-=a BandwidthShaper, DelayUnqueue, SetTimestamp */
+=a BandwidthShaper, DelayUnqueue, SetTimestamp, PacingWheel */
 
-class DelayShaper : public Element, public ActiveNotifier { public:
+class DelayShaper : public Element, public ActiveNotifier, public PacingWheel::Client { public:
 
     DelayShaper() CLICK_COLD;
 
@@ -51,6 +55,7 @@ class DelayShaper : public Element, public ActiveNotifier { public:
 
     Packet *pull(int);
     void run_timer(Timer *);
+    void run_pacing(const Timestamp &now);
 
   private:
 
@@ -59,6 +64,7 @@ class DelayShaper : public Element, public ActiveNotifier { public:
     Timer _timer;
     NotifierSignal _upstream_signal;
     ActiveNotifier _notifier;
+    PacingWheel *_wheel;
 
     static String read_param(Element *, void *) CLICK_COLD;
     static int write_param(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
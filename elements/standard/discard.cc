@@ -97,7 +97,7 @@ Discard::write_handler(const String &s, Element *e, void *user_data,
 void
 Discard::add_handlers()
 {
-    add_data_handlers("count", Handler::OP_READ, &_count);
+    add_data_handlers("count", Handler::OP_READ | Handler::f_counter, &_count);
     add_write_handler("reset_counts", write_handler, h_reset_counts, Handler::BUTTON);
     if (input_is_pull(0)) {
 	add_data_handlers("active", Handler::OP_READ | Handler::CHECKBOX, &_active);
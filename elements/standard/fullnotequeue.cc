@@ -76,6 +76,19 @@ FullNoteQueue::pull(int)
 	return pull_failure();
 }
 
+int
+FullNoteQueue::pull_batch(int, Packet **ps, int n)
+{
+    int k = deq_batch(ps, n);
+
+    if (k) {
+	_sleepiness = 0;
+	_full_note.wake();
+    } else
+	pull_failure();
+    return k;
+}
+
 #if CLICK_DEBUG_SCHEDULING
 String
 FullNoteQueue::read_handler(Element *e, void *)
@@ -80,6 +80,7 @@ class FullNoteQueue : public NotifierQueue { public:
 
     void push(int port, Packet *p);
     Packet *pull(int port);
+    int pull_batch(int port, Packet **ps, int n);
 
   protected:
 
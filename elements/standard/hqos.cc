@@ -0,0 +1,467 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * hqos.{cc,hh} -- hierarchical QoS scheduler
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "hqos.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/bigint.hh>
+#include <click/integers.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+CLICK_DECLS
+
+void
+HQoS::ActiveSet::resize(int n)
+{
+    int nwords = (n + 63) >> 6;
+    _n = n;
+    _count = 0;
+    _word.assign(nwords, 0);
+    _summary.assign((nwords + 63) >> 6, 0);
+}
+
+/** Return the first member at or after @a i, wrapping around to the
+    smallest member, or -1 if the set is empty. */
+int
+HQoS::ActiveSet::next(int i) const
+{
+    if (!_count)
+	return -1;
+    if (i >= _n)
+	i = 0;
+    int wi = i >> 6;
+    if (uint64_t w = _word[wi] & (~(uint64_t) 0 << (i & 63)))
+	return (wi << 6) + ffs_lsb(w) - 1;
+
+    // find the next nonzero word after wi via the summary
+    int nwords = _word.size(), nsum = _summary.size();
+    int wj = (wi + 1 == nwords ? 0 : wi + 1);
+    int si = wj >> 6;
+    uint64_t s = _summary[si] & (~(uint64_t) 0 << (wj & 63));
+    for (int k = 0; !s && k < nsum; ++k) {
+	si = (si + 1 == nsum ? 0 : si + 1);
+	s = _summary[si];
+    }
+    assert(s);
+    int w = (si << 6) + ffs_lsb(s) - 1;
+    return (w << 6) + ffs_lsb(_word[w]) - 1;
+}
+
+
+HQoS::HQoS()
+    : _queues(0), _pipes(0), _subports(0), _subport_cursor(0),
+      _out_head(0), _out_tail(0), _length(0), _drops(0), _timer(this)
+{
+}
+
+HQoS::~HQoS()
+{
+}
+
+void *
+HQoS::cast(const char *n)
+{
+    if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+	return static_cast<Notifier *>(&_empty_note);
+    else
+	return Element::cast(n);
+}
+
+void
+HQoS::assign_rate(TokenRate &rate, uint32_t r)
+{
+    // capacity is _burst_msec worth of tokens, as in RatedUnqueue
+    bigint::limb_type res[2];
+    bigint::multiply(res[1], res[0], r, _burst_msec);
+    bigint::divide(res, res, 2, 1000);
+    uint32_t tokens = res[1] ? UINT_MAX : res[0];
+    rate.assign(r, tokens ? tokens : 1);
+}
+
+int
+HQoS::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t rate, subport_rate, pipe_rate;
+    bool subport_rate_specified, pipe_rate_specified;
+    _nsubports = _npipes = _nqueues = 1;
+    _ntcs = 4;
+    _capacity = 64;
+    _burst_msec = 20;
+    _batch = 4;
+    _anno = AGGREGATE_ANNO_OFFSET;
+    if (Args(conf, this, errh)
+	.read_mp("RATE", BandwidthArg(), rate)
+	.read("SUBPORTS", _nsubports)
+	.read("PIPES", _npipes)
+	.read("TCS", _ntcs)
+	.read("QUEUES", _nqueues)
+	.read("SUBPORT_RATE", BandwidthArg(), subport_rate).read_status(subport_rate_specified)
+	.read("PIPE_RATE", BandwidthArg(), pipe_rate).read_status(pipe_rate_specified)
+	.read("CAPACITY", _capacity)
+	.read("BURST_DURATION", SecondsArg(3), _burst_msec)
+	.read("BATCH", _batch)
+	.read("ANNO", AnnoArg(4), _anno)
+	.complete() < 0)
+	return -1;
+
+    if (rate == 0)
+	return errh->error("RATE must be positive");
+    if (!subport_rate_specified)
+	subport_rate = rate;
+    if (!pipe_rate_specified)
+	pipe_rate = subport_rate;
+    if (subport_rate == 0 || pipe_rate == 0)
+	return errh->error("SUBPORT_RATE and PIPE_RATE must be positive");
+    if (_ntcs < 1 || _ntcs > MAX_TCS)
+	return errh->error("TCS must be between 1 and %d", MAX_TCS);
+    if (_nqueues < 1 || _ntcs * _nqueues > 64)
+	return errh->error("TCS * QUEUES must be between 1 and 64");
+    if (_nsubports < 1 || _npipes < 1
+	|| _nsubports > (1U << 24) / _npipes)
+	return errh->error("SUBPORTS * PIPES must be between 1 and %u", 1U << 24);
+    if (_batch < 1)
+	return errh->error("BATCH must be positive");
+    _pipe_queues = _ntcs * _nqueues;
+    if (_nsubports * _npipes > 0xFFFFFFFFU / _pipe_queues)
+	return errh->error("too many queues");
+    _total_queues = _nsubports * _npipes * _pipe_queues;
+
+    assign_rate(_rate, rate);
+    assign_rate(_subport_rate, subport_rate);
+    _pipe_rates.resize(1);
+    assign_rate(_pipe_rates[0], pipe_rate);
+    _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+    return 0;
+}
+
+int
+HQoS::initialize(ErrorHandler *errh)
+{
+    _queues = new Queue[_total_queues];
+    _pipes = new Pipe[_nsubports * _npipes];
+    _subports = new Subport[_nsubports];
+    if (!_queues || !_pipes || !_subports)
+	return errh->error("out of memory");
+    memset(_queues, 0, sizeof(Queue) * _total_queues);
+
+    TokenRate::time_point_type now = _rate.now();
+    _tokens.set_full();
+    _tokens.set_time_point(now);
+    for (uint32_t g = 0; g < _nsubports * _npipes; ++g) {
+	Pipe &pp = _pipes[g];
+	pp.active = 0;
+	pp.tokens.set_full();
+	pp.tokens.set_time_point(now);
+	pp.profile = 0;
+	memset(pp.rr, 0, sizeof(pp.rr));
+    }
+    for (uint32_t s = 0; s < _nsubports; ++s) {
+	Subport &sp = _subports[s];
+	sp.tokens.set_full();
+	sp.tokens.set_time_point(now);
+	sp.pipes.resize(_npipes);
+	sp.cursor = 0;
+    }
+    _active_subports.resize(_nsubports);
+    _timer.initialize(this);
+    return 0;
+}
+
+void
+HQoS::cleanup(CleanupStage)
+{
+    if (_queues)
+	for (uint32_t i = 0; i < _total_queues; ++i)
+	    while (Packet *p = _queues[i].head) {
+		_queues[i].head = p->next();
+		p->kill();
+	    }
+    while (Packet *p = _out_head) {
+	_out_head = p->next();
+	p->kill();
+    }
+    delete[] _queues;
+    delete[] _pipes;
+    delete[] _subports;
+    _queues = 0;
+    _pipes = 0;
+    _subports = 0;
+}
+
+void
+HQoS::push(int, Packet *p)
+{
+    uint32_t qi = p->anno_u32(_anno);
+    _lock.acquire();
+    Queue *q = qi < _total_queues ? &_queues[qi] : 0;
+    if (!q || q->length >= _capacity) {
+	++_drops;
+	_lock.release();
+	checked_output_push(1, p);
+	return;
+    }
+
+    p->set_next(0);
+    if (q->tail)
+	q->tail->set_next(p);
+    else
+	q->head = p;
+    q->tail = p;
+    ++_length;
+
+    // first packet: mark the queue, its pipe, and its subport active
+    if (++q->length == 1) {
+	uint32_t g = qi / _pipe_queues;
+	Pipe &pp = _pipes[g];
+	if (!pp.active) {
+	    uint32_t s = g / _npipes;
+	    Subport &sp = _subports[s];
+	    if (sp.pipes.empty())
+		_active_subports.insert(s);
+	    sp.pipes.insert(g - s * _npipes);
+	}
+	pp.active |= (uint64_t) 1 << (qi - g * _pipe_queues);
+    }
+    _lock.release();
+    _empty_note.wake();
+}
+
+/** Move up to _batch packets from pipe @a g to the output list. Returns the
+    number moved, or a negative grind_ code if a bucket above the pipe ran
+    dry before any packet moved. */
+int
+HQoS::dequeue_pipe(Pipe &pp, Subport &sp, uint32_t g)
+{
+    const TokenRate &pipe_rate = _pipe_rates[pp.profile];
+    uint64_t tc_mask = (_nqueues == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << _nqueues) - 1);
+    int n = 0;
+    while (n < (int) _batch && pp.active) {
+	// strict priority across traffic classes, round robin within one
+	int tc = (ffs_lsb(pp.active) - 1) / _nqueues;
+	int base = tc * _nqueues;
+	uint64_t tc_active = (pp.active >> base) & tc_mask;
+	uint64_t after = tc_active & (~(uint64_t) 0 << pp.rr[tc]);
+	int qi = base + ffs_lsb(after ? after : tc_active) - 1;
+	Queue &q = _queues[g * _pipe_queues + qi];
+	Packet *p = q.head;
+
+	// A packet larger than a bucket needs the whole bucket.
+	uint32_t len = p->length();
+	uint32_t port_need = len < _rate.capacity() ? len : _rate.capacity();
+	uint32_t subport_need = len < _subport_rate.capacity() ? len : _subport_rate.capacity();
+	uint32_t pipe_need = len < pipe_rate.capacity() ? len : pipe_rate.capacity();
+	if (!_tokens.contains(_rate, port_need))
+	    return n ? n : grind_port_blocked;
+	if (!sp.tokens.contains(_subport_rate, subport_need))
+	    return n ? n : grind_subport_blocked;
+	if (!pp.tokens.contains(pipe_rate, pipe_need))
+	    return n;
+	_tokens.remove(_rate, port_need);
+	sp.tokens.remove(_subport_rate, subport_need);
+	pp.tokens.remove(pipe_rate, pipe_need);
+
+	if (!(q.head = p->next()))
+	    q.tail = 0;
+	if (--q.length == 0)
+	    pp.active &= ~((uint64_t) 1 << qi);
+	pp.rr[tc] = (qi - base + 1 == (int) _nqueues ? 0 : qi - base + 1);
+	--_length;
+
+	p->set_next(0);
+	if (_out_tail)
+	    _out_tail->set_next(p);
+	else
+	    _out_head = p;
+	_out_tail = p;
+	++n;
+    }
+    return n;
+}
+
+int
+HQoS::grind_subport(Subport &sp, int s, TokenRate::time_point_type now)
+{
+    int first = -1;
+    while (1) {
+	int i = sp.pipes.next(sp.cursor);
+	if (i < 0 || i == first)
+	    return grind_ok;
+	if (first < 0)
+	    first = i;
+	sp.cursor = i + 1;
+
+	uint32_t g = s * _npipes + i;
+	Pipe &pp = _pipes[g];
+	pp.tokens.refill(_pipe_rates[pp.profile], now);
+	int n = dequeue_pipe(pp, sp, g);
+	if (!pp.active) {
+	    sp.pipes.erase(i);
+	    if (sp.pipes.empty())
+		_active_subports.erase(s);
+	}
+	if (n != 0)
+	    return n;
+    }
+}
+
+bool
+HQoS::grind()
+{
+    TokenRate::time_point_type now = _rate.now();
+    _tokens.refill(_rate, now);
+    int first = -1;
+    while (1) {
+	int s = _active_subports.next(_subport_cursor);
+	if (s < 0 || s == first)
+	    return false;
+	if (first < 0)
+	    first = s;
+	_subport_cursor = s + 1;
+
+	Subport &sp = _subports[s];
+	sp.tokens.refill(_subport_rate, now);
+	int n = grind_subport(sp, s, now);
+	if (n > 0)
+	    return true;
+	else if (n == grind_port_blocked)
+	    return false;
+    }
+}
+
+Packet *
+HQoS::pull(int)
+{
+    _lock.acquire();
+    if (!_out_head && _length)
+	grind();
+    Packet *p = _out_head;
+    if (p) {
+	if (!(_out_head = p->next()))
+	    _out_tail = 0;
+	p->set_next(0);
+    } else {
+	_empty_note.sleep();
+	// Nonempty but out of tokens: buckets fill once per jiffy.
+	if (_length && !_timer.scheduled())
+	    _timer.schedule_after(Timestamp::make_jiffies((click_jiffies_difference_t) 1));
+    }
+    _lock.release();
+    return p;
+}
+
+void
+HQoS::run_timer(Timer *)
+{
+    _empty_note.wake();
+}
+
+int
+HQoS::pipe_profile(uint32_t r)
+{
+    TokenRate rate;
+    assign_rate(rate, r);
+    for (int i = 0; i < _pipe_rates.size(); ++i)
+	if (_pipe_rates[i].rate() == rate.rate()
+	    && _pipe_rates[i].capacity() == rate.capacity())
+	    return i;
+    if (_pipe_rates.size() >= MAX_PROFILES)
+	return -1;
+    _pipe_rates.push_back(rate);
+    return _pipe_rates.size() - 1;
+}
+
+String
+HQoS::read_handler(Element *e, void *thunk)
+{
+    HQoS *hq = static_cast<HQoS *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_rate:
+	return BandwidthArg::unparse(hq->_rate.rate());
+    case h_subport_rate:
+	return BandwidthArg::unparse(hq->_subport_rate.rate());
+    case h_pipe_rate:
+	return BandwidthArg::unparse(hq->_pipe_rates[0].rate());
+    case h_capacity:
+	return String(hq->_capacity);
+    default:
+	return String();
+    }
+}
+
+int
+HQoS::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    HQoS *hq = static_cast<HQoS *>(e);
+    uintptr_t which = (uintptr_t) thunk;
+    uint32_t r;
+    if (which == h_capacity) {
+	if (!IntArg().parse(str, r))
+	    return errh->error("syntax error");
+	hq->_capacity = r;
+	return 0;
+    } else if (which == h_set_pipe_rate) {
+	uint32_t g;
+	if (Args(hq, errh).push_back_words(str)
+	    .read_mp("PIPE", g)
+	    .read_mp("RATE", BandwidthArg(), r)
+	    .complete() < 0)
+	    return -1;
+	if (g >= hq->_nsubports * hq->_npipes)
+	    return errh->error("no such pipe");
+	if (r == 0)
+	    return errh->error("rate must be positive");
+	hq->_lock.acquire();
+	int profile = hq->pipe_profile(r);
+	if (profile >= 0)
+	    hq->_pipes[g].profile = profile;
+	hq->_lock.release();
+	return profile >= 0 ? 0 : errh->error("too many distinct pipe rates");
+    }
+
+    if (!BandwidthArg().parse(str, r))
+	return errh->error("syntax error");
+    if (r == 0)
+	return errh->error("rate must be positive");
+    hq->_lock.acquire();
+    if (which == h_rate)
+	hq->assign_rate(hq->_rate, r);
+    else if (which == h_subport_rate)
+	hq->assign_rate(hq->_subport_rate, r);
+    else
+	hq->assign_rate(hq->_pipe_rates[0], r);
+    hq->_lock.release();
+    return 0;
+}
+
+void
+HQoS::add_handlers()
+{
+    add_data_handlers("length", Handler::OP_READ, &_length);
+    add_data_handlers("drops", Handler::OP_READ, &_drops);
+    add_read_handler("rate", read_handler, h_rate);
+    add_write_handler("rate", write_handler, h_rate);
+    add_read_handler("subport_rate", read_handler, h_subport_rate);
+    add_write_handler("subport_rate", write_handler, h_subport_rate);
+    add_read_handler("pipe_rate", read_handler, h_pipe_rate);
+    add_write_handler("pipe_rate", write_handler, h_pipe_rate);
+    add_write_handler("set_pipe_rate", write_handler, h_set_pipe_rate);
+    add_read_handler("capacity", read_handler, h_capacity);
+    add_write_handler("capacity", write_handler, h_capacity);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(HQoS)
+ELEMENT_MT_SAFE(HQoS)
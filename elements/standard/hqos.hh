@@ -0,0 +1,267 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_HQOS_HH
+#define CLICK_HQOS_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/tokenbucket.hh>
+#include <click/timer.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+
+/*
+=c
+
+HQoS(RATE, I<keywords> SUBPORTS, PIPES, TCS, QUEUES, SUBPORT_RATE, PIPE_RATE, CAPACITY, BURST_DURATION, BATCH, ANNO)
+
+=s scheduling
+
+hierarchical QoS scheduler with many queues
+
+=d
+
+HQoS stores incoming packets in a large set of FIFO queues and releases them
+on pull through a four-level scheduling hierarchy: port, subport, pipe, and
+traffic class.  It replaces hand-built graphs of queues, shapers, and
+schedulers for per-subscriber shaping, and scales to tens of thousands of
+queues on one thread.
+
+The hierarchy has one port shaped to RATE, SUBPORTS subports each shaped to
+SUBPORT_RATE, and PIPES pipes per subport each shaped to PIPE_RATE.  Every
+pipe has TCS traffic classes served in strict priority order, class 0 first,
+and every traffic class has QUEUES queues served round-robin.  Active
+subports and active pipes within a subport are also served round-robin.
+Shaping uses a token bucket per node, holding BURST_DURATION worth of bytes.
+A packet is released only when every bucket on its path contains its
+length.
+
+Each packet's queue is given by the 4-byte annotation ANNO, which defaults to
+the aggregate annotation.  Queues are numbered traffic class major within a
+pipe, so queue number Q belongs to global pipe Q / (TCS*QUEUES), that is,
+subport Q / (PIPES*TCS*QUEUES); its traffic class within the pipe is
+(Q / QUEUES) % TCS.  Packets whose queue number is out of range, or whose
+queue holds CAPACITY packets, are dropped, or emitted on output 1 if it
+exists.
+
+Active queues, pipes, and subports are tracked in bitmaps, so finding the
+next packet to send costs time proportional to the number of words scanned
+rather than the number of queues.  Once a pipe is chosen, up to BATCH packets
+are taken from it at once and released by later pulls.
+
+HQoS's empty notifier sleeps when no packets are queued and while every
+nonempty pipe is waiting for tokens.
+
+Keyword arguments are:
+
+=over 8
+
+=item RATE
+
+Bandwidth.  Port rate.  Required.
+
+=item SUBPORTS
+
+Unsigned integer.  Number of subports.  Default is 1.
+
+=item PIPES
+
+Unsigned integer.  Number of pipes per subport.  Default is 1.
+
+=item TCS
+
+Unsigned integer between 1 and 8.  Number of traffic classes per pipe.
+Default is 4.
+
+=item QUEUES
+
+Unsigned integer.  Number of queues per traffic class.  TCS*QUEUES must be
+at most 64.  Default is 1.
+
+=item SUBPORT_RATE
+
+Bandwidth.  Rate of each subport.  Default is RATE.
+
+=item PIPE_RATE
+
+Bandwidth.  Default rate of each pipe.  Default is SUBPORT_RATE.
+
+=item CAPACITY
+
+Unsigned integer.  Maximum length of each queue, in packets.  Default is 64.
+
+=item BURST_DURATION
+
+Time.  Token bucket capacity, as a duration at the bucket's rate.  Default
+is 20 milliseconds.
+
+=item BATCH
+
+Unsigned integer.  Maximum number of packets taken from a pipe each time it
+is chosen.  Default is 4.
+
+=item ANNO
+
+Annotation name or offset.  The 4-byte annotation holding the queue number.
+Default is the aggregate annotation.
+
+=back
+
+=h length read-only
+
+Returns the number of packets waiting in the queues.
+
+=h drops read-only
+
+Returns the number of packets dropped so far.
+
+=h rate read/write
+
+Returns or sets the port rate.
+
+=h subport_rate read/write
+
+Returns or sets the subport rate.
+
+=h pipe_rate read/write
+
+Returns or sets the default pipe rate.
+
+=h set_pipe_rate write-only
+
+Sets the rate of a single pipe.  The argument is "PIPE RATE", where PIPE is
+the global pipe number.  At most 256 distinct pipe rates may be in use.
+
+=h capacity read/write
+
+Returns or sets CAPACITY.
+
+=e
+
+  ... // set the aggregate annotation to the queue number
+      -> hq :: HQoS(1Gbps, SUBPORTS 4, PIPES 4096, TCS 4,
+                    SUBPORT_RATE 300Mbps, PIPE_RATE 10Mbps)
+      -> ToDevice(eth0);
+
+=a BandwidthShaper, BandwidthRatedUnqueue, PrioSched, DRRSched, Queue */
+
+class HQoS : public Element { public:
+
+    HQoS() CLICK_COLD;
+    ~HQoS() CLICK_COLD;
+
+    const char *class_name() const		{ return "HQoS"; }
+    const char *port_count() const		{ return PORTS_1_1X2; }
+    const char *processing() const		{ return "h/lh"; }
+    void *cast(const char *);
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int port, Packet *);
+    Packet *pull(int port);
+    void run_timer(Timer *);
+
+    /** @brief A set of small integers kept as a two-level bitmap. */
+    class ActiveSet { public:
+	ActiveSet()
+	    : _n(0) {
+	}
+	void resize(int n);
+	bool empty() const {
+	    return !_count;
+	}
+	void insert(int i) {
+	    uint64_t &w = _word[i >> 6];
+	    if (!w) {
+		_summary[i >> 12] |= (uint64_t) 1 << ((i >> 6) & 63);
+		++_count;
+	    }
+	    w |= (uint64_t) 1 << (i & 63);
+	}
+	void erase(int i) {
+	    uint64_t &w = _word[i >> 6];
+	    w &= ~((uint64_t) 1 << (i & 63));
+	    if (!w) {
+		_summary[i >> 12] &= ~((uint64_t) 1 << ((i >> 6) & 63));
+		--_count;
+	    }
+	}
+	int next(int i) const;
+      private:
+	int _n;
+	int _count;			// number of nonzero words
+	Vector<uint64_t> _word;		// bit i: member i
+	Vector<uint64_t> _summary;	// bit w: _word[w] != 0
+    };
+
+  private:
+
+    enum { MAX_TCS = 8, MAX_PROFILES = 256 };
+
+    struct Queue {
+	Packet *head;
+	Packet *tail;
+	uint32_t length;
+    };
+
+    struct Pipe {
+	uint64_t active;		// nonempty queues, traffic class major
+	TokenCounter tokens;
+	uint8_t profile;		// index into _pipe_rates
+	uint8_t rr[MAX_TCS];		// next queue within each traffic class
+    };
+
+    struct Subport {
+	TokenCounter tokens;
+	ActiveSet pipes;		// pipes with nonempty queues
+	int cursor;
+    };
+
+    Queue *_queues;
+    Pipe *_pipes;
+    Subport *_subports;
+
+    TokenRate _rate;
+    TokenCounter _tokens;
+    TokenRate _subport_rate;
+    Vector<TokenRate> _pipe_rates;	// profile 0 is PIPE_RATE
+    ActiveSet _active_subports;
+    int _subport_cursor;
+
+    Packet *_out_head;			// chosen, already charged
+    Packet *_out_tail;
+
+    uint32_t _nsubports;
+    uint32_t _npipes;			// per subport
+    uint32_t _ntcs;
+    uint32_t _nqueues;			// per traffic class
+    uint32_t _pipe_queues;		// _ntcs * _nqueues
+    uint32_t _total_queues;
+    uint32_t _capacity;
+    uint32_t _burst_msec;
+    uint32_t _batch;
+    int _anno;
+
+    uint32_t _length;
+    uint32_t _drops;
+
+    Spinlock _lock;
+    ActiveNotifier _empty_note;
+    Timer _timer;
+
+    enum { grind_ok = 0, grind_subport_blocked = -1, grind_port_blocked = -2 };
+    int dequeue_pipe(Pipe &pp, Subport &sp, uint32_t g);
+    int grind_subport(Subport &sp, int s, TokenRate::time_point_type now);
+    bool grind();
+    void assign_rate(TokenRate &rate, uint32_t r);
+    int pipe_profile(uint32_t r);
+
+    enum { h_rate, h_subport_rate, h_pipe_rate, h_set_pipe_rate, h_capacity };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
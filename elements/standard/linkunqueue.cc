@@ -30,7 +30,7 @@
 CLICK_DECLS
 
 LinkUnqueue::LinkUnqueue()
-    : _qhead(0), _qtail(0), _task(this), _timer(&_task)
+    : _qhead(0), _qtail(0), _task(this), _timer(&_task), _wheel(0)
 {
 }
 
@@ -62,6 +62,7 @@ LinkUnqueue::initialize(ErrorHandler *errh)
     ScheduleInfo::initialize_task(this, &_task, errh);
     _timer.initialize(this);
     _signal = Notifier::upstream_empty_signal(this, 0, &_task);
+    _wheel = PacingWheel::find(this);
     Storage::_capacity = 0x7FFFFFFF;
     //_state = S_ASLEEP;
     _back_to_back = false;
@@ -106,6 +107,18 @@ static void print_queue(Packet *head) {
 
 bool
 LinkUnqueue::run_task(Task *)
+{
+    return run(true);
+}
+
+void
+LinkUnqueue::run_pacing(const Timestamp &)
+{
+    run(false);
+}
+
+bool
+LinkUnqueue::run(bool in_task)
 {
     bool worked = false;
     Timestamp now = Timestamp::now();
@@ -163,7 +176,10 @@ LinkUnqueue::run_task(Task *)
 	if (expiry <= now) {
 	    // small delay, reschedule Task
 	    //_state = S_TASK;
-	    _task.fast_reschedule();
+	    in_task ? _task.fast_reschedule() : _task.reschedule();
+	} else if (_wheel) {
+	    // large delay, wait on the shared wheel
+	    _wheel->schedule(this, expiry + Timer::adjustment());
 	} else {
 	    // large delay, schedule Timer instead
 	    //_state = S_TIMER;
@@ -171,7 +187,7 @@ LinkUnqueue::run_task(Task *)
 	}
     } else if (_signal) {
 	//_state = S_TASK;
-	_task.fast_reschedule();
+	in_task ? _task.fast_reschedule() : _task.reschedule();
     } else {
 	//_state = S_ASLEEP;
     }
@@ -230,6 +246,8 @@ LinkUnqueue::write_handler(const String &s, Element *e, void *thunk, ErrorHandle
     u->_qhead = u->_qtail = 0;
     u->Storage::set_tail(0);
     u->_timer.unschedule();
+    if (u->_wheel)
+	u->_wheel->unschedule(u);
     u->_task.reschedule();
     return 0;
 }
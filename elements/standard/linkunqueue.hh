@@ -6,6 +6,7 @@
 #include <click/timer.hh>
 #include <click/notifier.hh>
 #include <click/standard/storage.hh>
+#include <click/standard/pacingwheel.hh>
 CLICK_DECLS
 
 /*
@@ -34,6 +35,10 @@ doesn't store any other packets, however; it doesn't pull from its input
 unless there is room on the link. To emulate a link fed by a packet queue, use
 a "Queue -> LinkUnqueue" combination.
 
+If the configuration contains a PacingWheel, LinkUnqueue waits for its next
+departure on the wheel rather than on its own Timer, and releases packets
+directly from the wheel's Task.
+
 LinkUnqueue uses its input packets' "extra length" annotations, destroys their
 "next packet" annotations, and updates their timestamp annotations.
 
@@ -54,9 +59,9 @@ The number of packets currently in, or partially in, the emulated link.
 When written, drops all packets in, or partially in, the emulated link.
 
 =a DelayUnqueue, Queue, Unqueue, RatedUnqueue, BandwidthRatedUnqueue,
-DelayShaper, SetTimestamp */
+DelayShaper, SetTimestamp, PacingWheel */
 
-class LinkUnqueue : public Element, public Storage { public:
+class LinkUnqueue : public Element, public Storage, public PacingWheel::Client { public:
 
     LinkUnqueue() CLICK_COLD;
 
@@ -71,6 +76,7 @@ class LinkUnqueue : public Element, public Storage { public:
     void add_handlers() CLICK_COLD;
 
     bool run_task(Task *);
+    void run_pacing(const Timestamp &now);
 
   private:
 
@@ -83,7 +89,9 @@ class LinkUnqueue : public Element, public Storage { public:
     Task _task;
     Timer _timer;
     NotifierSignal _signal;
+    PacingWheel *_wheel;
 
+    bool run(bool in_task);
     void delay_by_bandwidth(Packet *, const Timestamp &) const;
     static String read_param(Element *, void *) CLICK_COLD;
     static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
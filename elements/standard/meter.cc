@@ -27,24 +27,10 @@ Meter::Meter()
 void
 Meter::push(int, Packet *p)
 {
-  _rate.update(1);		// packets, not bytes
-
-  unsigned r = _rate.scaled_average();
-  if (_nmeters < 2) {
-    int n = (r >= _meter1);
-    output(n).push(p);
-  } else {
-    unsigned *meters = _meters;
-    int nmeters = _nmeters;
-    for (int i = 0; i < nmeters; i++)
-      if (r < meters[i]) {
-	output(i).push(p);
-	return;
-      }
-    output(nmeters).push(p);
-  }
+  push_rated(update_rate(1), p);	// packets, not bytes
 }
 
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(BandwidthMeter)
 EXPORT_ELEMENT(Meter)
+ELEMENT_MT_SAFE(Meter)
@@ -90,6 +90,26 @@ NotifierQueue::pull(int)
     return p;
 }
 
+int
+NotifierQueue::pull_batch(int, Packet **ps, int n)
+{
+    int k = deq_batch(ps, n);
+
+    if (k)
+	_sleepiness = 0;
+    else if (_sleepiness >= SLEEPINESS_TRIGGER) {
+	_empty_note.sleep();
+#if HAVE_MULTITHREAD
+	// See pull().
+	if (size())
+	    _empty_note.wake();
+#endif
+    } else
+	++_sleepiness;
+
+    return k;
+}
+
 #if CLICK_DEBUG_SCHEDULING
 String
 NotifierQueue::read_handler(Element *e, void *)
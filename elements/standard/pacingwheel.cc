@@ -0,0 +1,312 @@
+// -*- c-basic-offset: 4; related-file-name: "../../include/click/standard/pacingwheel.hh" -*-
+/*
+ * pacingwheel.{cc,hh} -- shared timing wheel for shaping elements
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/standard/pacingwheel.hh>
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include <click/integers.hh>
+CLICK_DECLS
+
+PacingWheel::PacingWheel()
+    : _wheels(0), _nwheels(0)
+{
+}
+
+PacingWheel::~PacingWheel()
+{
+}
+
+PacingWheel *
+PacingWheel::find(Element *e)
+{
+    return static_cast<PacingWheel *>(e->router()->attachment("PacingWheel"));
+}
+
+int
+PacingWheel::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    if (void *a = router()->attachment("PacingWheel"))
+	if (a != this)
+	    return errh->error("only one PacingWheel allowed per configuration");
+
+    Timestamp slot = Timestamp::make_usec(10);
+    uint32_t nslots = 4096;
+    if (Args(conf, this, errh)
+	.read("SLOT", slot)
+	.read("SLOTS", nslots)
+	.complete() < 0)
+	return -1;
+
+    if (slot.usecval() < 1 || slot.usecval() > 0x7FFFFFFF)
+	return errh->error("SLOT out of range");
+    if (nslots < 64 || nslots > (1U << 24))
+	return errh->error("SLOTS must be between 64 and %u", 1U << 24);
+    _slot_usec = slot.usecval();
+    _nslots = 64;
+    while (_nslots < nslots)
+	_nslots <<= 1;
+
+    router()->set_attachment("PacingWheel", this);
+    return 0;
+}
+
+int
+PacingWheel::initialize(ErrorHandler *errh)
+{
+    _nwheels = master()->nthreads();
+    if (_nwheels < 1)
+	_nwheels = 1;
+    if (!(_wheels = new Wheel[_nwheels]))
+	return errh->error("out of memory");
+    uint64_t cursor = slot_of(Timestamp::now());
+    for (int i = 0; i < _nwheels; ++i) {
+	Wheel &w = _wheels[i];
+	w.slot = new Client *[_nslots];
+	w.nonempty = new uint64_t[_nslots / 64];
+	w.task = new Task(task_hook, &w);
+	w.timer = new Timer(w.task);
+	if (!w.slot || !w.nonempty || !w.task || !w.timer)
+	    return errh->error("out of memory");
+	memset(w.slot, 0, sizeof(Client *) * _nslots);
+	memset(w.nonempty, 0, sizeof(uint64_t) * (_nslots / 64));
+	w.cursor = cursor;
+	w.wake = ~(uint64_t) 0;
+	w.count = w.fires = 0;
+	w.owner = this;
+	w.task->initialize(this, false);
+	w.task->move_thread(i);
+	w.timer->initialize(this);
+	w.timer->move_thread(i);
+    }
+    return 0;
+}
+
+void
+PacingWheel::cleanup(CleanupStage)
+{
+    if (_wheels)
+	for (int i = 0; i < _nwheels; ++i) {
+	    delete _wheels[i].timer;
+	    delete _wheels[i].task;
+	    delete[] _wheels[i].slot;
+	    delete[] _wheels[i].nonempty;
+	}
+    delete[] _wheels;
+    _wheels = 0;
+    if (router()->attachment("PacingWheel") == this)
+	router()->set_attachment("PacingWheel", 0);
+}
+
+inline uint64_t
+PacingWheel::slot_of(const Timestamp &t) const
+{
+    return int_divide((uint64_t) t.usecval(), _slot_usec);
+}
+
+inline Timestamp
+PacingWheel::time_of(uint64_t slot) const
+{
+    return Timestamp::make_usec((Timestamp::value_type) (slot * _slot_usec));
+}
+
+inline void
+PacingWheel::unlink(Wheel &w, Client *c)
+{
+    uint32_t b = c->_pw_slot & (_nslots - 1);
+    if (c->_pw_next)
+	c->_pw_next->_pw_prev = c->_pw_prev;
+    if (c->_pw_prev)
+	c->_pw_prev->_pw_next = c->_pw_next;
+    else if (!(w.slot[b] = c->_pw_next))
+	w.nonempty[b >> 6] &= ~((uint64_t) 1 << (b & 63));
+    c->_pw_next = c->_pw_prev = 0;
+    c->_pw_wheel = -1;
+    --w.count;
+}
+
+/** Find the first nonempty slot at or after @a w.cursor.  Clients in that
+    slot may belong to a later rotation, in which case the wheel simply wakes
+    up early. */
+bool
+PacingWheel::next_slot(const Wheel &w, uint64_t &slot) const
+{
+    if (!w.count)
+	return false;
+    uint32_t mask = _nslots - 1, nwords = _nslots / 64;
+    uint32_t b = w.cursor & mask, wi = b >> 6;
+    uint64_t word = w.nonempty[wi] & (~(uint64_t) 0 << (b & 63));
+    for (uint32_t k = 0; !word && k < nwords; ++k) {
+	wi = (wi + 1) & (nwords - 1);
+	word = w.nonempty[wi];
+    }
+    uint32_t nb = (wi << 6) + ffs_lsb(word) - 1;
+    slot = w.cursor + ((nb - b) & mask);
+    return true;
+}
+
+void
+PacingWheel::arm(Wheel &w, uint64_t slot)
+{
+    Timestamp expiry = time_of(slot) - Timer::adjustment();
+    if (expiry <= Timestamp::now())
+	w.task->reschedule();
+    else
+	w.timer->schedule_at(expiry);
+}
+
+void
+PacingWheel::schedule(Client *c, const Timestamp &when)
+{
+    int wi = click_current_cpu_id();
+    if (wi >= _nwheels)
+	wi = 0;
+    if (c->_pw_wheel != wi)
+	unschedule(c);
+
+    Wheel &w = _wheels[wi];
+    // round up to the next slot boundary, but never into the past
+    uint64_t s = slot_of(when);
+    if (time_of(s) < when)
+	++s;
+
+    w.lock.acquire();
+    if (c->_pw_wheel >= 0)
+	unlink(w, c);
+    if (s < w.cursor)
+	s = w.cursor;
+    uint32_t b = s & (_nslots - 1);
+    c->_pw_slot = s;
+    c->_pw_wheel = wi;
+    c->_pw_prev = 0;
+    if ((c->_pw_next = w.slot[b]))
+	c->_pw_next->_pw_prev = c;
+    else
+	w.nonempty[b >> 6] |= (uint64_t) 1 << (b & 63);
+    w.slot[b] = c;
+    ++w.count;
+    bool rearm = s < w.wake;
+    if (rearm)
+	w.wake = s;
+    w.lock.release();
+
+    if (rearm)
+	arm(w, s);
+}
+
+void
+PacingWheel::unschedule(Client *c)
+{
+    int wi = c->_pw_wheel;
+    if (wi == pw_firing)
+	c->_pw_wheel = -1;
+    if (wi < 0)
+	return;
+    Wheel &w = _wheels[wi];
+    w.lock.acquire();
+    if (c->_pw_wheel == wi)
+	unlink(w, c);
+    w.lock.release();
+}
+
+bool
+PacingWheel::run_wheel(Wheel &w)
+{
+    Timestamp now = Timestamp::now();
+    uint64_t cur = slot_of(now);
+    uint32_t mask = _nslots - 1;
+
+    // Collect due clients under the lock and fire them without it.  A
+    // client rescheduled or unscheduled before its turn is skipped.
+    w.lock.acquire();
+    w.due.clear();
+    if (w.count && cur >= w.cursor) {
+	uint64_t s = w.cursor;
+	if (cur - s >= _nslots)
+	    s = cur - mask;
+	for (; s <= cur; ++s) {
+	    Client *c = w.slot[s & mask];
+	    while (c) {
+		Client *next = c->_pw_next;
+		if (c->_pw_slot <= cur) {
+		    unlink(w, c);
+		    c->_pw_wheel = pw_firing;
+		    w.due.push_back(c);
+		}
+		c = next;
+	    }
+	}
+    }
+    if (cur >= w.cursor)
+	w.cursor = cur + 1;
+    w.wake = ~(uint64_t) 0;
+    w.lock.release();
+
+    bool worked = false;
+    for (Client **cp = w.due.begin(); cp != w.due.end(); ++cp)
+	if ((*cp)->_pw_wheel == pw_firing) {
+	    (*cp)->_pw_wheel = -1;
+	    ++w.fires;
+	    (*cp)->run_pacing(now);
+	    worked = true;
+	}
+
+    // Clients fired above may already have armed the wheel for a later slot.
+    uint64_t slot;
+    w.lock.acquire();
+    bool rearm = next_slot(w, slot) && slot < w.wake;
+    if (rearm)
+	w.wake = slot;
+    w.lock.release();
+    if (rearm) {
+	Timestamp expiry = time_of(slot) - Timer::adjustment();
+	if (expiry <= now)
+	    w.task->fast_reschedule();
+	else
+	    w.timer->schedule_at(expiry);
+    }
+    return worked;
+}
+
+bool
+PacingWheel::task_hook(Task *, void *thunk)
+{
+    Wheel *w = static_cast<Wheel *>(thunk);
+    return w->owner->run_wheel(*w);
+}
+
+String
+PacingWheel::read_handler(Element *e, void *thunk)
+{
+    PacingWheel *pw = static_cast<PacingWheel *>(e);
+    uint32_t n = 0;
+    for (int i = 0; i < pw->_nwheels; ++i)
+	n += (thunk ? pw->_wheels[i].fires : pw->_wheels[i].count);
+    return String(n);
+}
+
+void
+PacingWheel::add_handlers()
+{
+    add_read_handler("scheduled", read_handler, 0);
+    add_read_handler("fires", read_handler, 1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(PacingWheel)
+ELEMENT_HEADER(<click/standard/pacingwheel.hh>)
+ELEMENT_MT_SAFE(PacingWheel)
@@ -61,6 +61,26 @@ QuickNoteQueue::pull(int)
     return p;
 }
 
+int
+QuickNoteQueue::pull_batch(int, Packet **ps, int n)
+{
+    int k = deq_batch(ps, n);
+
+    if (k)
+	_full_note.wake();
+
+    if (!size()) {
+	_empty_note.sleep();
+#if HAVE_MULTITHREAD
+	// See pull().
+	if (size())
+	    _empty_note.wake();
+#endif
+    }
+
+    return k;
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(FullNoteQueue)
 EXPORT_ELEMENT(QuickNoteQueue)
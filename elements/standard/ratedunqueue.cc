@@ -27,7 +27,7 @@
 CLICK_DECLS
 
 RatedUnqueue::RatedUnqueue()
-    : _task(this), _timer(&_task), _runs(0), _pushes(0), _failed_pulls(0), _empty_runs(0), _active(true)
+    : _task(this), _timer(&_task), _wheel(0), _runs(0), _pushes(0), _failed_pulls(0), _empty_runs(0), _active(true)
 {
 }
 
@@ -80,12 +80,15 @@ RatedUnqueue::initialize(ErrorHandler *errh)
     ScheduleInfo::initialize_task(this, &_task, errh);
     _signal = Notifier::upstream_empty_signal(this, 0, &_task);
     _timer.initialize(this);
+    _wheel = PacingWheel::find(this);
     return 0;
 }
 
 bool
 RatedUnqueue::run_task(Task *)
 {
+    if (_wheel)
+	return run_paced(true);
     bool worked = false;
     _runs++;
     if (!_active)
@@ -113,6 +116,52 @@ RatedUnqueue::run_task(Task *)
     return worked;
 }
 
+/** Push every packet the bucket allows, then wait on the PacingWheel until
+    the bucket refills, or on the upstream signal if the input is empty. */
+bool
+RatedUnqueue::run_paced(bool in_task)
+{
+    bool bandwidth = is_bandwidth();
+    unsigned need = bandwidth ? tb_bandwidth_thresh : 1;
+    bool worked = false;
+    _runs++;
+    if (!_active)
+	return false;
+
+    _tb.refill();
+    while (_tb.contains(need)) {
+	Packet *p = input(0).pull();
+	if (!p) {
+	    _failed_pulls++;
+	    if (!worked)
+		_empty_runs++;
+	    if (!_signal)
+		return worked;	// the upstream signal will wake _task
+	    else if (in_task)
+		_task.fast_reschedule();
+	    else
+		_task.reschedule();
+	    return worked;
+	}
+	_tb.remove(bandwidth ? p->length() : 1);
+	_pushes++;
+	worked = true;
+	output(0).push(p);
+    }
+
+    Timestamp when = Timestamp::now() + Timestamp::make_jiffies(_tb.time_until_contains(need));
+    _wheel->schedule(this, when);
+    if (!worked)
+	_empty_runs++;
+    return worked;
+}
+
+void
+RatedUnqueue::run_pacing(const Timestamp &)
+{
+    run_paced(false);
+}
+
 String
 RatedUnqueue::read_handler(Element *e, void *thunk)
 {
@@ -6,6 +6,7 @@
 #include <click/task.hh>
 #include <click/timer.hh>
 #include <click/notifier.hh>
+#include <click/standard/pacingwheel.hh>
 CLICK_DECLS
 
 /*
@@ -20,6 +21,11 @@ CLICK_DECLS
  * this token bucket defaults to 20 milliseconds worth of tokens, but can be
  * customized by setting BURST_DURATION or BURST_SIZE.
  *
+ * If the configuration contains a PacingWheel, RatedUnqueue waits for tokens
+ * on the wheel rather than on its own Timer.  Each time the wheel fires it,
+ * RatedUnqueue pushes every packet the bucket allows directly from the wheel's
+ * Task; its own Task runs only to restart after the input has been empty.
+ *
  * Keyword arguments are:
  *
  * =over 8
@@ -40,9 +46,9 @@ CLICK_DECLS
  *
  * =h rate read/write
  *
- * =a BandwidthRatedUnqueue, Unqueue, Shaper, RatedSplitter */
+ * =a BandwidthRatedUnqueue, Unqueue, Shaper, RatedSplitter, PacingWheel */
 
-class RatedUnqueue : public Element { public:
+class RatedUnqueue : public Element, public PacingWheel::Client { public:
 
     RatedUnqueue() CLICK_COLD;
 
@@ -60,6 +66,7 @@ class RatedUnqueue : public Element { public:
     void add_handlers() CLICK_COLD;
 
     bool run_task(Task *);
+    void run_pacing(const Timestamp &now);
 
   protected:
 
@@ -67,6 +74,7 @@ class RatedUnqueue : public Element { public:
     Task _task;
     Timer _timer;
     NotifierSignal _signal;
+    PacingWheel *_wheel;
     uint32_t _runs;
     uint32_t _pushes;
     uint32_t _failed_pulls;
@@ -74,6 +82,7 @@ class RatedUnqueue : public Element { public:
 
     enum { h_calls, h_rate };
 
+    bool run_paced(bool in_task);
     static String read_handler(Element *e, void *thunk) CLICK_COLD;
 
     bool _active;
@@ -94,6 +94,27 @@ static const StaticNameDB::Entry signal_entries[] = {
 
 static NameDB *dbs[2];
 
+namespace {
+// Reports errors in the context "While executing 'ELEMENT':", but formats
+// the context only if there is an error, since packet scripts run for every
+// packet.
+class ScriptErrorHandler : public ContextErrorHandler { public:
+    ScriptErrorHandler(ErrorHandler *errh, Element *e)
+        : ContextErrorHandler(errh, ""), _e(e) {
+    }
+    String decorate(const String &str) {
+        if (_e) {
+            set_context(combine_anno(format("While executing %<%p{element}%>:", _e),
+                                     String::make_stable("{context:context}", 17)));
+            _e = 0;
+        }
+        return ContextErrorHandler::decorate(str);
+    }
+  private:
+    Element *_e;
+};
+}
+
 void
 Script::static_initialize()
 {
@@ -115,7 +136,7 @@ Script::static_cleanup()
 }
 
 Script::Script()
-    : _type(-1), _write_status(0), _timer(this), _cur_steps(0)
+    : _input_var(-1), _type(-1), _write_status(0), _timer(this), _cur_steps(0)
 {
 }
 
@@ -163,6 +184,616 @@ Script::find_variable(const String &name, bool add)
     return i;
 }
 
+int
+Script::literal_text(const String &str)
+{
+    _texts.push_back(Vector<Part>());
+    if (str) {
+        Part p;
+        p.type = part_text;
+        p.quote = p.index = p.vtype = 0;
+        p.text = str;
+        _texts.back().push_back(p);
+    }
+    return _texts.size() - 1;
+}
+
+/* Compile text as cp_expand() would expand it.  Each substitution becomes a
+   part; references to known variables become variable indexes, and handler
+   references become calls. */
+int
+Script::compile_text(const String &str, bool expand_quote, int depth)
+{
+    if (!str || find(str, '$') == str.end() || depth > 10)
+        return literal_text(str);
+
+    Vector<Part> parts;
+    Part p;
+    p.quote = p.index = p.vtype = 0;
+    const char *s = str.begin(), *end = str.end();
+    const char *uninterpolated = s;
+    int quote = 0;
+
+    for (; s < end; s++)
+        switch (*s) {
+
+        case '\\':
+            if (s + 1 < end && quote == '\"')
+                s++;
+            break;
+
+        case '\'':
+        case '\"':
+            if (quote == 0)
+                quote = *s;
+            else if (quote == *s)
+                quote = 0;
+            break;
+
+        case '/':
+            if (s + 1 < end && (s[1] == '/' || s[1] == '*') && quote == 0)
+                s = cp_skip_comment_space(s, end) - 1;
+            break;
+
+        case '$': {
+            if (s + 1 >= end || quote == '\'')
+                break;
+
+            const char *beforedollar = s, *cstart;
+            String vname;
+            int vtype, expand_vname = 0;
+
+            if (s[1] == '{') {
+                vtype = '{';
+                s += 2;
+                for (cstart = s; s < end && *s != '}'; s++)
+                    if (*s == '$')
+                        expand_vname = 1;
+                if (s == end)
+                    goto done;
+                vname = str.substring(cstart, s++);
+
+            } else if (s[1] == '(') {
+                int level = 1, nquote = 0;
+                vtype = '(';
+                s += 2;
+                for (cstart = s; s < end && level; s++)
+                    switch (*s) {
+                    case '(':
+                        if (nquote == 0)
+                            level++;
+                        break;
+                    case ')':
+                        if (nquote == 0)
+                            level--;
+                        break;
+                    case '\"':
+                    case '\'':
+                        if (nquote == 0)
+                            nquote = *s;
+                        else if (nquote == *s)
+                            nquote = 0;
+                        break;
+                    case '\\':
+                        if (s + 1 < end && nquote != '\'')
+                            s++;
+                        break;
+                    case '$':
+                        if (nquote != '\'')
+                            expand_vname = 1;
+                        break;
+                    }
+
+                if (s == cstart || s[-1] != ')')
+                    goto done;
+                vname = str.substring(cstart, s - 1);
+
+            } else if (isalnum((unsigned char) s[1]) || s[1] == '_') {
+                vtype = 'a';
+                s++;
+                for (cstart = s; s < end && (isalnum((unsigned char) *s) || *s == '_'); s++)
+                    /* nada */;
+                vname = str.substring(cstart, s);
+
+            } else if (s[1] == '?' || s[1] == '#' || s[1] == '$') {
+                vtype = 'a';
+                s++;
+                vname = str.substring(s, s + 1);
+                s++;
+
+            } else
+                break;
+
+            if (uninterpolated != beforedollar) {
+                p.type = part_text;
+                p.quote = p.index = 0;
+                p.text = str.substring(uninterpolated, beforedollar);
+                parts.push_back(p);
+            }
+
+            p.quote = (quote == '\"' ? '\"' : (expand_quote && quote == 0 ? 'q' : 0));
+            p.vtype = vtype;
+            p.text = String();
+            if (vtype == '(') {
+                p.type = part_call;
+                p.index = compile_call(vname, expand_vname, depth + 1);
+            } else if (expand_vname) {
+                p.type = part_lookup;
+                p.index = compile_text(vname, false, depth + 1);
+            } else if ((p.index = find_variable(vname, false)) < _vars.size())
+                p.type = part_var;
+            else {
+                // maybe a special variable, or one defined later
+                p.type = part_lookup;
+                p.index = -1;
+                p.text = vname;
+            }
+            parts.push_back(p);
+
+            uninterpolated = s;
+            s--;
+            break;
+        }
+        }
+
+  done:
+    if (uninterpolated != end) {
+        p.type = part_text;
+        p.quote = p.index = 0;
+        p.text = str.substring(uninterpolated, end);
+        parts.push_back(p);
+    }
+    _texts.push_back(parts);
+    return _texts.size() - 1;
+}
+
+static bool
+plain_char(const char *s, const char *end)
+{
+    return !isspace((unsigned char) *s) && *s != '$' && *s != '\'' && *s != '\"'
+        && *s != '\\' && !(*s == '/' && s + 1 < end && (s[1] == '/' || s[1] == '*'));
+}
+
+/* Compile a handler call, either a $(...) substitution or the argument of a
+   handler instruction.  If the handler name is plain text, the handler is
+   looked up once, at the first call; otherwise every call looks it up, as
+   HandlerCall would. */
+int
+Script::compile_call(const String &str, bool expand, int depth)
+{
+    Call c;
+    c.name = c.param = c.op = -1;
+    c.e = 0;
+    c.h = 0;
+
+    const char *s = cp_skip_comment_space(str.begin(), str.end());
+    const char *w = s, *end = str.end();
+    while (w < end && plain_char(w, end))
+        ++w;
+    if (w == s || (w < end && !isspace((unsigned char) *w)))
+        c.name = (expand ? compile_text(str, false, depth) : literal_text(str));
+    else {
+        c.hname = str.substring(s, w);
+        const char *param = cp_skip_comment_space(w, end);
+        c.prefix = str.substring(str.begin(), param);
+        if (param != end) {
+            String pstr = str.substring(param, end);
+            c.param = (expand ? compile_text(pstr, false, depth) : literal_text(pstr));
+            compile_operands(c, pstr, depth);
+        }
+    }
+
+    _calls.push_back(c);
+    return _calls.size() - 1;
+}
+
+/* If the call might be to one of Script's arithmetic or comparison
+   handlers, split its parameters into operands so that run_operation() can
+   compute integer results directly.  Gives up unless each operand is a
+   plain word or a single substitution. */
+void
+Script::compile_operands(Call &c, const String &str, int depth)
+{
+    static const char * const names[] = {
+        "add", "sub", "min", "max", "mul", "neg", "abs",
+        "eq", "ne", "gt", "ge", "lt", "le",
+#if !CLICK_LINUXMODULE
+        "mod", "rem"
+#endif
+    };
+    static const int ops[] = {
+        ar_add, ar_sub, ar_min, ar_max, ar_mul, ar_neg, ar_abs,
+        AR_EQ, AR_NE, AR_GT, AR_GE, AR_LT, AR_LE,
+#if !CLICK_LINUXMODULE
+        ar_mod, ar_rem
+#endif
+    };
+    int op = -1;
+    for (unsigned i = 0; i < sizeof(ops) / sizeof(ops[0]) && op < 0; ++i)
+        if (c.hname == names[i])
+            op = ops[i];
+    if (op < 0)
+        return;
+
+    Vector<int> operands;
+    const char *s = str.begin(), *end = str.end();
+    while ((s = cp_skip_space(s, end)) != end) {
+        const char *u = s;
+        if (*s == '$' && s + 1 < end && s[1] == '(') {
+            int level = 1, nquote = 0;
+            for (s += 2; s < end && level; s++)
+                if (*s == '(' && nquote == 0)
+                    level++;
+                else if (*s == ')' && nquote == 0)
+                    level--;
+                else if ((*s == '\"' || *s == '\'') && nquote == 0)
+                    nquote = *s;
+                else if (*s == nquote)
+                    nquote = 0;
+                else if (*s == '\\' && s + 1 < end && nquote != '\'')
+                    s++;
+            if (level)
+                return;
+        } else if (*s == '$' && s + 1 < end && s[1] == '{') {
+            s = find(s, end, '}');
+            if (s == end)
+                return;
+            ++s;
+        } else if (*s == '$') {
+            for (++s; s < end && (isalnum((unsigned char) *s) || *s == '_'); ++s)
+                /* nada */;
+            if (s == u + 1 && s < end && (*s == '?' || *s == '#' || *s == '$'))
+                ++s;
+        } else
+            while (s < end && plain_char(s, end))
+                ++s;
+        if (s == u || (s < end && !isspace((unsigned char) *s))
+            || operands.size() == max_operands)
+            return;
+        operands.push_back(compile_text(str.substring(u, s), false, depth));
+    }
+
+    c.op = op;
+    c.operands.swap(operands);
+}
+
+void
+Script::compile()
+{
+    for (int i = 0; i < _insns.size(); i++) {
+        int compiled = -1;
+        switch (_insns[i]) {
+
+#if CLICK_USERLEVEL
+        case insn_save:
+        case insn_append: {
+            String word = cp_shift_spacevec(_args3[i]);
+            String file = (_args3[i] ? _args3[i] : "-");
+            _args3[i] = (&">>"[_insns[i] == insn_save]) + file + " " + word;
+        }
+#endif
+        /* fallthru */
+        case INSN_PRINT:
+        case INSN_PRINTQ:
+        case INSN_PRINTN:
+        case INSN_PRINTNQ: {
+            // _args: 1 to write FILE, 2 to append to it; _args3: FILE;
+            // _args2: 1 to print a read handler
+            String text = _args3[i];
+            _args[i] = 0;
+            if (text.length() && text[0] == '>') {
+                bool append = (text.length() > 1 && text[1] == '>');
+                text = text.substring(1 + append);
+                _args[i] = 1 + append;
+                _args3[i] = cp_shift_spacevec(text);
+            }
+            _args2[i] = (text && (isalpha((unsigned char) text[0]) || text[0] == '@' || text[0] == '_'));
+            if (_args2[i])
+                compiled = compile_call(text, true, 0);
+            else
+                compiled = compile_text(text, true, 0);
+            break;
+        }
+
+        case INSN_READ:
+        case INSN_READQ:
+        case INSN_WRITE:
+        case INSN_WRITEQ:
+            compiled = compile_call(_args3[i], true, 0);
+            break;
+
+        case INSN_WAIT_TIME:
+        case INSN_SET:
+        case insn_setq:
+        case insn_init:
+        case insn_initq:
+        case insn_export:
+        case insn_exportq:
+        case INSN_RETURN:
+        case insn_returnq:
+        case INSN_GOTO:
+        case insn_error:
+        case insn_errorq:
+            compiled = compile_text(_args3[i], false, 0);
+            break;
+
+        }
+        _compiled.push_back(compiled);
+    }
+}
+
+bool
+Script::expand_part(const Part &p, String &result, Expander &expander)
+{
+    switch (p.type) {
+
+    case part_var:
+        result = _vars[p.index + 1];
+        return true;
+
+    case part_lookup: {
+        String name = (p.index >= 0 ? expand(p.index, expander) : p.text);
+        if (expander.expand(name, result, p.vtype, 0))
+            return true;
+        else if (p.vtype == '{')
+            result = "${" + name + "}";
+        else
+            result = "$" + name;
+        return false;
+    }
+
+    case part_call: {
+        number_type x;
+        int r = run_call(p.index, x, result, expander);
+        if (r == result_int)
+            result = String(x);
+        else if (r == result_bool)
+            result = BoolArg::unparse(x);
+        else if (r == result_failed) {
+            result = "$(" + result + ")";
+            return false;
+        }
+        return true;
+    }
+
+    default:
+        result = p.text;
+        return false;
+
+    }
+}
+
+String
+Script::expand(int text, Expander &expander)
+{
+    const Vector<Part> &parts = _texts[text];
+    String result;
+    if (parts.size() == 1 && !parts[0].quote) {
+        (void) expand_part(parts[0], result, expander);
+        return result;
+    }
+
+    StringAccum sa;
+    for (const Part *p = parts.begin(); p != parts.end(); ++p)
+        if (expand_part(*p, result, expander) && p->quote) {
+            // quote as cp_expand() does
+            result = cp_quote(result);
+            if (result[0] == '\"')
+                result = result.substring(result.begin() + 1, result.end() - 1);
+            if (p->quote == '\"')
+                sa << result;
+            else
+                sa << '\"' << result << '\"';
+        } else
+            sa << result;
+    return sa.take_string();
+}
+
+bool
+Script::resolve(Call &c, int flags)
+{
+    if (c.h)
+        return true;
+
+    Element *e;
+    String hname;
+    const Handler *h;
+    if (c.name >= 0 || !router()->handlers_ready()
+        || !cp_handler_name(c.hname, &e, &hname, this, ErrorHandler::silent_handler())
+        || !(h = Router::handler(e, hname))
+        || ((flags & Handler::f_read) && !h->readable())
+        || ((flags & Handler::f_write) && !h->writable()))
+        return false;
+
+    // run_operation() computes Script's own arithmetic handlers
+    int hflags = h->flags() & (Handler::f_read | Handler::f_read_param | Handler::f_write);
+    if (c.op >= 0
+        && (!e->cast("Script")
+            || hflags != (Handler::f_read | Handler::f_read_param)
+            || (uintptr_t) h->read_user_data() != (uintptr_t) c.op))
+        c.op = -1;
+    c.e = e;
+    c.h = h;
+    router()->add_handler_user(this);
+    return true;
+}
+
+String
+Script::expand_param(const Call &c, Expander &expander, String &raw)
+{
+    if (c.param < 0) {
+        raw = String();
+        return raw;
+    }
+    raw = expand(c.param, expander);
+    return raw.substring(cp_skip_comment_space(raw.begin(), raw.end()), raw.end());
+}
+
+int
+Script::run_operation(Call &c, number_type &x, String &params, Expander &expander)
+{
+    number_type v[max_operands];
+    String s[max_operands];
+    bool computed[max_operands];
+    bool numeric = true;
+    int n = c.operands.size();
+    for (int i = 0; i < n; ++i) {
+        const Vector<Part> &parts = _texts[c.operands[i]];
+        computed[i] = false;
+        if (parts.size() == 1 && parts[0].type == part_call) {
+            int r = run_call(parts[0].index, v[i], s[i], expander);
+            if (r == result_int) {
+                computed[i] = true;
+                continue;
+            } else if (r == result_bool)
+                s[i] = BoolArg::unparse(v[i]);
+            else if (r == result_failed)
+                s[i] = "$(" + s[i] + ")";
+        } else
+            s[i] = expand(c.operands[i], expander);
+        if (numeric && !IntArg().parse(s[i], v[i]))
+            numeric = false;
+    }
+
+    if (numeric)
+        switch (c.op) {
+        case ar_add:
+        case ar_sub:
+        case ar_min:
+        case ar_max:
+        case ar_mul:
+            x = (c.op == ar_add || c.op == ar_sub ? 0 : 1);
+            for (int i = 0; i < n; ++i)
+                if (i == 0)
+                    x = v[i];
+                else if (c.op == ar_add)
+                    x += v[i];
+                else if (c.op == ar_sub)
+                    x -= v[i];
+                else if (c.op == ar_min)
+                    x = (x < v[i] ? x : v[i]);
+                else if (c.op == ar_max)
+                    x = (x > v[i] ? x : v[i]);
+                else
+                    x *= v[i];
+            return result_int;
+        case ar_mod:
+        case ar_rem:
+            if (n != 2 || v[1] == 0)
+                break;
+            x = v[0] % v[1];
+            return result_int;
+        case ar_neg:
+        case ar_abs:
+            if (n != 1)
+                break;
+            x = (c.op == ar_neg || v[0] < 0 ? -v[0] : v[0]);
+            return result_int;
+        default: {
+            if (n != 2)
+                break;
+            int comparison = (v[0] < v[1] ? AR_LT : (v[0] == v[1] ? AR_EQ : AR_GT));
+            x = (c.op == comparison || (c.op >= AR_GE && c.op != comparison + 3));
+            return result_bool;
+        }
+        }
+
+    // let the handler report the error, or compute with doubles
+    StringAccum sa;
+    for (int i = 0; i < n; ++i) {
+        if (i)
+            sa << ' ';
+        if (computed[i])
+            sa << v[i];
+        else
+            sa << s[i];
+    }
+    params = sa.take_string();
+    return result_string;
+}
+
+/* Run the $(...) substitution compiled as @a call.  Returns result_int or
+   result_bool, with the value in @a x, for computed arithmetic; otherwise
+   returns result_string with the value in @a result, or result_failed with
+   the handler description in @a result if there is no such handler. */
+int
+Script::run_call(int call, number_type &x, String &result, Expander &expander)
+{
+    Call &c = _calls[call];
+    String desc;
+    if (resolve(c, Handler::f_read)) {
+        if (c.op >= 0) {
+            String params;
+            int r = run_operation(c, x, params, expander);
+            if (r == result_string)
+                result = c.h->call_read(c.e, params, expander.errh);
+            return r;
+        }
+        String raw, param = expand_param(c, expander, raw);
+        if (!param || c.h->read_param()) {
+            result = c.h->call_read(c.e, param, expander.errh);
+            return result_string;
+        }
+        desc = c.prefix + raw;
+    } else if (c.name >= 0)
+        desc = expand(c.name, expander);
+    else {
+        String raw;
+        (void) expand_param(c, expander, raw);
+        desc = c.prefix + raw;
+    }
+
+    // report errors as HandlerCall does
+    if (expander.expand(desc, result, '(', 0))
+        return result_string;
+    result = desc;
+    return result_failed;
+}
+
+/* Call the handler for a read, write, or print instruction.  Returns the
+   handler, or null if there is no such handler. */
+const Handler *
+Script::call_handler(int call, int flags, String &result, int &status,
+                     Element *&e, Expander &expander, ErrorHandler *errh)
+{
+    Call &c = _calls[call];
+    HandlerCall hc;
+    if (resolve(c, flags)) {
+        String raw, param = expand_param(c, expander, raw);
+        if (flags & HandlerCall::f_unquote_param)
+            param = cp_unquote(param);
+        if (!(flags & HandlerCall::f_read) || !param || c.h->read_param()) {
+            String desc = c.h->unparse_name(c.e);
+            if (param)
+                desc += " " + param;
+            ContextErrorHandler c_errh(errh, "While calling %<%s%>:", desc.c_str());
+            if (flags & HandlerCall::f_read)
+                result = c.h->call_read(c.e, param, &c_errh);
+            else
+                status = c.h->call_write(param, c.e, &c_errh);
+            e = c.e;
+            return c.h;
+        }
+        hc = HandlerCall(c.prefix + raw);
+    } else if (c.name >= 0)
+        hc = HandlerCall(expand(c.name, expander));
+    else {
+        String raw;
+        (void) expand_param(c, expander, raw);
+        hc = HandlerCall(c.prefix + raw);
+    }
+
+    if (hc.initialize(flags, this, errh) < 0)
+        return 0;
+    ContextErrorHandler c_errh(errh, "While calling %<%s%>:", hc.unparse().c_str());
+    if (flags & HandlerCall::f_read)
+        result = hc.call_read(&c_errh);
+    else
+        status = hc.call_write(&c_errh);
+    e = hc.element();
+    return hc.handler();
+}
+
 int
 Script::configure(Vector<String> &conf, ErrorHandler *errh)
 {
@@ -319,6 +950,10 @@ Script::configure(Vector<String> &conf, ErrorHandler *errh)
         add_insn(INSN_WAIT_STEP, 1, 0);
     add_insn(_type == type_driver ? insn_stop : insn_end, 0);
 
+    if (_type == type_push)
+        _input_var = find_variable(String::make_stable("input", 5), true);
+    compile();
+
     return errh->nerrors() ? -1 : 0;
 }
 
@@ -334,9 +969,9 @@ Script::initialize(ErrorHandler *errh)
     expander.errh = errh;
     for (int i = 0; i < _insns.size(); i++)
         if (_insns[i] == insn_init || _insns[i] == insn_export)
-            _vars[_args[i] + 1] = cp_expand(_args3[i], expander);
+            _vars[_args[i] + 1] = expand(_compiled[i], expander);
         else if (_insns[i] == insn_initq || _insns[i] == insn_exportq)
-            _vars[_args[i] + 1] = cp_unquote(cp_expand(_args3[i], expander));
+            _vars[_args[i] + 1] = cp_unquote(expand(_compiled[i], expander));
 
     int insn = _insns[_insn_pos];
     assert(insn == INSN_INITIAL || insn == INSN_WAIT_STEP || insn == INSN_WAIT_TIME);
@@ -345,7 +980,7 @@ Script::initialize(ErrorHandler *errh)
         /* passive, do nothing */;
     else if (insn == INSN_WAIT_TIME) {
         Timestamp ts;
-        if (cp_time(cp_expand(_args3[_insn_pos], expander), &ts))
+        if (cp_time(expand(_compiled[_insn_pos], expander), &ts))
             _timer.schedule_after(ts);
         else
             errh->error("syntax error at %<wait%>");
@@ -407,7 +1042,7 @@ Script::step(int nsteps, int step_type, int njumps, ErrorHandler *errh)
         case INSN_WAIT_TIME:
             if (_step_count == nsteps) {
                 Timestamp ts;
-                if (cp_time(cp_expand(_args3[ipos], expander), &ts)) {
+                if (cp_time(expand(_compiled[ipos], expander), &ts)) {
                     _timer.schedule_after(ts);
                     _insn_pos--;
                 } else
@@ -427,49 +1062,36 @@ Script::step(int nsteps, int step_type, int njumps, ErrorHandler *errh)
 
 #if CLICK_USERLEVEL
         case insn_save:
-        case insn_append: {
-            String word = cp_shift_spacevec(_args3[ipos]);
-            String file = (_args3[ipos] ? _args3[ipos] : "-");
-            _args3[ipos] = (&">>"[insn == insn_save]) + file + " " + word;
-        }
+        case insn_append:
 #endif
-        /* fallthru */
         case INSN_PRINT:
         case INSN_PRINTQ:
         case INSN_PRINTN:
         case INSN_PRINTNQ: {
-            String text = _args3[ipos];
-
 #if CLICK_USERLEVEL
             FILE *f = stdout;
-            if (text.length() && text[0] == '>') {
-                bool append = (text.length() > 1 && text[1] == '>');
-                text = text.substring(1 + append);
-                String filename = cp_shift_spacevec(text);
+            if (_args[ipos]) {
+                const String &filename = _args3[ipos];
                 if (filename && filename != "-"
-                    && !(f = fopen(filename.c_str(), append ? "ab" : "wb"))) {
+                    && !(f = fopen(filename.c_str(), _args[ipos] == 2 ? "ab" : "wb"))) {
                     errh->error("%s: %s", filename.c_str(), strerror(errno));
                     break;
                 }
             }
 #else
-            if (text.length() && text[0] == '>') {
+            if (_args[ipos])
                 errh->error("file redirection not supported here");
-                (void) cp_shift_spacevec(text);
-            }
 #endif
 
             int before = errh->nerrors();
             String result;
-            if (text && (isalpha((unsigned char) text[0]) || text[0] == '@' || text[0] == '_')) {
-                HandlerCall hc(cp_expand(text, expander));
+            if (_args2[ipos]) {
                 int flags = HandlerCall::f_read + ((insn == INSN_PRINTQ || insn == INSN_PRINTNQ) ? HandlerCall::UNQUOTE_PARAM : 0);
-                if (hc.initialize(flags, this, errh) >= 0) {
-                    ContextErrorHandler c_errh(errh, "While calling %<%s%>:", hc.unparse().c_str());
-                    result = hc.call_read(&c_errh);
-                }
+                int status;
+                Element *e;
+                (void) call_handler(_compiled[ipos], flags, result, status, e, expander, errh);
             } else
-                result = cp_unquote(cp_expand(text, expander, true));
+                result = cp_unquote(expand(_compiled[ipos], expander));
             if (errh->nerrors() == before
                 && (!result || result.back() != '\n')
                 && insn != INSN_PRINTN
@@ -490,25 +1112,23 @@ Script::step(int nsteps, int step_type, int njumps, ErrorHandler *errh)
 
         case INSN_READ:
         case INSN_READQ: {
-            HandlerCall hc(cp_expand(_args3[ipos], expander));
             int flags = HandlerCall::f_read + (insn == INSN_READQ ? HandlerCall::UNQUOTE_PARAM : 0);
-            if (hc.initialize(flags, this, errh) >= 0) {
-                ContextErrorHandler c_errh(errh, "While calling %<%s%>:", hc.unparse().c_str());
-                String result = hc.call_read(&c_errh);
+            String result;
+            int status;
+            Element *e;
+            if (const Handler *h = call_handler(_compiled[ipos], flags, result, status, e, expander, errh)) {
                 ErrorHandler *d_errh = ErrorHandler::default_handler();
-                d_errh->message("%s:\n%.*s\n", hc.handler()->unparse_name(hc.element()).c_str(), result.length(), result.data());
+                d_errh->message("%s:\n%.*s\n", h->unparse_name(e).c_str(), result.length(), result.data());
             }
             break;
         }
 
         case INSN_WRITE:
         case INSN_WRITEQ: {
-            HandlerCall hc(cp_expand(_args3[ipos], expander));
             int flags = HandlerCall::f_write + (insn == INSN_WRITEQ ? HandlerCall::UNQUOTE_PARAM : 0);
-            if (hc.initialize(flags, this, errh) >= 0) {
-                ContextErrorHandler c_errh(errh, "While calling %<%s%>:", hc.unparse().c_str());
-                _write_status = hc.call_write(&c_errh);
-            }
+            String result;
+            Element *e;
+            (void) call_handler(_compiled[ipos], flags, result, _write_status, e, expander, errh);
             break;
         }
 
@@ -517,7 +1137,7 @@ Script::step(int nsteps, int step_type, int njumps, ErrorHandler *errh)
         case INSN_SET:
         case insn_setq: {
             expander.errh = errh;
-            _vars[_args[ipos] + 1] = cp_expand(_args3[ipos], expander);
+            _vars[_args[ipos] + 1] = expand(_compiled[ipos], expander);
             if (insn == insn_setq || insn == insn_returnq)
                 _vars[_args[ipos] + 1] = cp_unquote(_vars[_args[ipos] + 1]);
             if ((insn == INSN_RETURN || insn == insn_returnq)
@@ -529,12 +1149,29 @@ Script::step(int nsteps, int step_type, int njumps, ErrorHandler *errh)
         }
 
         case INSN_GOTO: {
-            // reset intervening instructions
-            String cond_text = cp_expand(_args3[ipos], expander);
-            bool cond;
-            if (cond_text && !BoolArg().parse(cond_text, cond))
+            // conditions are usually comparisons, which need not be
+            // unparsed and parsed again
+            const Vector<Part> &cond_parts = _texts[_compiled[ipos]];
+            String cond_text;
+            number_type x;
+            bool cond = true;
+            int r = result_string;
+            if (cond_parts.size() == 1 && cond_parts[0].type == part_call) {
+                r = run_call(cond_parts[0].index, x, cond_text, expander);
+                if (r == result_int)
+                    cond_text = String(x);
+                else if (r == result_failed)
+                    cond_text = "$(" + cond_text + ")";
+            } else
+                cond_text = expand(_compiled[ipos], expander);
+            if (r == result_bool)
+                cond = x;
+            else if (cond_text && !BoolArg().parse(cond_text, cond)) {
                 errh->error("bad condition %<%s%>", cond_text.c_str());
-            else if (!cond_text || cond) {
+                break;
+            }
+            if (cond) {
+                // reset intervening instructions
                 if (_args[ipos] < 0)
                     goto insn_finish;
                 for (int i = _args[ipos]; i < ipos; i++)
@@ -547,7 +1184,7 @@ Script::step(int nsteps, int step_type, int njumps, ErrorHandler *errh)
 
         case insn_error:
         case insn_errorq: {
-            String msg = cp_expand(_args3[ipos], expander);
+            String msg = expand(_compiled[ipos], expander);
             if (insn == insn_errorq)
                 msg = cp_unquote(msg);
             if (msg)
@@ -620,7 +1257,7 @@ Script::run_timer(Timer *)
     // called when a timer expires
     assert(_insns[_insn_pos] == INSN_WAIT_TIME || _insns[_insn_pos] == INSN_INITIAL);
     ErrorHandler *errh = ErrorHandler::default_handler();
-    ContextErrorHandler cerrh(errh, "While executing %<%p{element}%>:", this);
+    ScriptErrorHandler cerrh(errh, this);
     step(1, STEP_TIMER, 0, &cerrh);
     complete_step(0);
 }
@@ -629,11 +1266,9 @@ void
 Script::push(int port, Packet *p)
 {
     ErrorHandler *errh = ErrorHandler::default_handler();
-    ContextErrorHandler cerrh(errh, "While executing %<%p{element}%>:", this);
+    ScriptErrorHandler cerrh(errh, this);
 
-    // This is slow, but it probably doesn't need to be fast.
-    int i = find_variable(String::make_stable("input", 5), true);
-    _vars[i + 1] = String(port);
+    _vars[_input_var + 1] = String(port);
 
     _insn_pos = 0;
     step(0, STEP_JUMP, 0, &cerrh);
@@ -653,11 +1288,9 @@ Script::pull(int)
         return 0;
 
     ErrorHandler *errh = ErrorHandler::default_handler();
-    ContextErrorHandler cerrh(errh, "While executing %<%p{element}%>:", this);
+    ScriptErrorHandler cerrh(errh, this);
 
-    // This is slow, but it probably doesn't need to be fast.
-    int i = find_variable(String::make_stable("input", 5), true);
-    _vars[i + 1] = String::make_stable("0", 1);
+    _vars[_input_var + 1] = String::make_stable("0", 1);
 
     _insn_pos = 0;
     step(0, STEP_JUMP, 0, &cerrh);
@@ -936,7 +1569,9 @@ Script::modrem_handler(int, String &str, Element *, const Handler *h, ErrorHandl
 #else
         return normal_error(error_two_numbers, errh);
 #endif
-    } else {
+    } else if (b == 0)
+        return errh->error("division by zero");
+    else {
 #if CLICK_LINUXMODULE
         if ((int32_t) a != a || (int32_t) b != b)
             errh->warning("int64 divide truncated");
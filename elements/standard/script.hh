@@ -291,6 +291,13 @@ the element name.  Thus, "$(s.add ...)" can be written "$(add ...)", as below.
           goto begin_loop $(lt $x 5),
           stop);
 
+Script compiles each instruction's text once, at configuration time.
+Variable references are resolved to variable slots, handler references are
+looked up the first time they run and remembered, and arithmetic and
+comparisons on Script's own handlers are computed directly when their operands
+are integers, without formatting intermediate results as text.  The results
+are the same as if the text were expanded anew each time.
+
 =h step write-only
 
 Advance the instruction pointer past the current blocking instruction (C<pause> or C<wait>).  A numeric argument will step past that many blocking instructions.
@@ -482,13 +489,56 @@ class Script : public Element { public:
     };
 
     enum {
-        max_jumps = 1000, STEP_NORMAL = 0, STEP_ROUTER, STEP_TIMER, STEP_JUMP
+        max_jumps = 1000, max_operands = 8,
+        STEP_NORMAL = 0, STEP_ROUTER, STEP_TIMER, STEP_JUMP
     };
 
     Vector<int> _insns;
     Vector<int> _args;
     Vector<int> _args2;
     Vector<String> _args3;
+    Vector<int> _compiled;	// index into _texts, or into _calls for
+				// read, write, and handler print instructions
+
+#if HAVE_INT64_TYPES
+    typedef int64_t number_type;
+#else
+    typedef int32_t number_type;
+#endif
+
+    // A compiled text is a list of parts, each literal text or one
+    // substitution.  Static handler references become calls.
+    enum {
+        part_text, part_var, part_lookup, part_call
+    };
+
+    struct Part {
+        int type;
+        int quote;              // 0, '\"', or 'q' to quote and add quotes
+        int index;              // part_var: variable; part_call: call;
+                                // part_lookup: compiled name, or -1
+        int vtype;              // part_lookup: '{' or 'a'
+        String text;            // part_text: text; part_lookup: name
+    };
+
+    struct Call {
+        String prefix;          // text before the parameters
+        String hname;           // handler name, if it has no substitutions
+        int name;               // otherwise, compiled handler description
+        int param;              // compiled parameters, or -1
+        int op;                 // numeric operation, or -1
+        Vector<int> operands;   // compiled operands, for op
+        Element *e;             // resolved handler
+        const Handler *h;
+    };
+
+    enum {
+        result_string = 0, result_int = 1, result_bool = 2, result_failed = -1
+    };
+
+    Vector<Vector<Part> > _texts;
+    Vector<Call> _calls;
+    int _input_var;
 
     Vector<String> _vars;
     String _run_handler_name;
@@ -525,6 +575,19 @@ class Script : public Element { public:
     };
 
     void add_insn(int, int, int = 0, const String & = String());
+    int compile_text(const String &str, bool expand_quote, int depth) CLICK_COLD;
+    int compile_call(const String &str, bool expand, int depth) CLICK_COLD;
+    void compile_operands(Call &c, const String &str, int depth) CLICK_COLD;
+    void compile() CLICK_COLD;
+    int literal_text(const String &str) CLICK_COLD;
+    String expand(int text, Expander &expander);
+    bool expand_part(const Part &p, String &result, Expander &expander);
+    bool resolve(Call &c, int flags);
+    String expand_param(const Call &c, Expander &expander, String &raw);
+    int run_operation(Call &c, number_type &x, String &params, Expander &expander);
+    int run_call(int call, number_type &x, String &result, Expander &expander);
+    const Handler *call_handler(int call, int flags, String &result, int &status,
+                                Element *&e, Expander &expander, ErrorHandler *errh);
     int step(int nsteps, int step_type, int njumps, ErrorHandler *errh);
     int complete_step(String *retval);
     int find_label(const String &) const;
@@ -165,6 +165,16 @@ SimpleQueue::pull(int)
     return deq();
 }
 
+/** @brief Pull up to @a n packets from output @a port into @a ps.
+
+    Returns the number of packets pulled.  Subclasses that override pull()
+    must override pull_batch() as well. */
+int
+SimpleQueue::pull_batch(int, Packet **ps, int n)
+{
+    return deq_batch(ps, n);
+}
+
 
 String
 SimpleQueue::read_handler(Element *e, void *thunk)
@@ -213,10 +223,10 @@ SimpleQueue::write_handler(const String &, Element *e, void *thunk, ErrorHandler
 void
 SimpleQueue::add_handlers()
 {
-    add_read_handler("length", read_handler, 0);
-    add_read_handler("highwater_length", read_handler, 1);
-    add_read_handler("capacity", read_handler, 2, Handler::h_calm);
-    add_read_handler("drops", read_handler, 3);
+    add_read_handler("length", read_handler, 0, Handler::f_gauge);
+    add_read_handler("highwater_length", read_handler, 1, Handler::f_gauge);
+    add_read_handler("capacity", read_handler, 2, Handler::h_calm | Handler::f_gauge);
+    add_read_handler("drops", read_handler, 3, Handler::f_counter);
     add_write_handler("capacity", reconfigure_keyword_handler, "0 CAPACITY");
     add_write_handler("reset_counts", write_handler, 0, Handler::h_button | Handler::h_nonexclusive);
     add_write_handler("reset", write_handler, 1, Handler::h_button);
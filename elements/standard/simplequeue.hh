@@ -35,6 +35,11 @@ The Queue and NotifierQueue elements act like SimpleQueue, but additionally
 notify interested parties when they change state (from nonempty to empty or
 vice versa, and/or from nonfull to full or vice versa).
 
+Elements directly downstream of a SimpleQueue, such as Unqueue and ToDevice,
+may dequeue several packets at once with pull_batch().  This takes one pass
+over the queue indexes and, for notifying queues, one notification per batch
+rather than per packet.
+
 =h length read-only
 
 Returns the current number of packets in the queue.
@@ -72,6 +77,7 @@ class SimpleQueue : public Element, public Storage { public:
     inline bool enq(Packet*);
     inline void lifo_enq(Packet*);
     inline Packet* deq();
+    inline int deq_batch(Packet **ps, int n);
 
     // to be used with care
     Packet* packet(int i) const			{ return _q[i]; }
@@ -96,6 +102,7 @@ class SimpleQueue : public Element, public Storage { public:
 
     void push(int port, Packet*);
     Packet* pull(int port);
+    virtual int pull_batch(int port, Packet **ps, int n);
 
   protected:
 
@@ -162,6 +169,27 @@ SimpleQueue::deq()
 	return 0;
 }
 
+/** @brief Dequeue up to @a n packets into @a ps, returning the number
+    dequeued.
+
+    The head index is updated once for the whole batch, and the dequeued
+    Packet objects are prefetched. */
+inline int
+SimpleQueue::deq_batch(Packet **ps, int n)
+{
+    Storage::index_type h = head(), t = tail();
+    int k = 0;
+    for (; h != t && k < n; h = next_i(h)) {
+	Packet *p = _q[h];
+	assert(p);
+	click_prefetch0(p);
+	ps[k++] = p;
+    }
+    if (k)
+	set_head(h);
+    return k;
+}
+
 template <typename Filter>
 Packet *
 SimpleQueue::yank1(Filter filter)
@@ -101,6 +101,16 @@ ThreadSafeQueue::pull(int)
     }
 }
 
+int
+ThreadSafeQueue::pull_batch(int port, Packet **ps, int n)
+{
+    // Concurrent pullers reserve slots one at a time.
+    int k = 0;
+    while (k < n && (ps[k] = pull(port)))
+	++k;
+    return k;
+}
+
 CLICK_ENDDECLS
 ELEMENT_REQUIRES(FullNoteQueue)
 EXPORT_ELEMENT(ThreadSafeQueue)
@@ -63,6 +63,7 @@ class ThreadSafeQueue : public FullNoteQueue { public:
 
     void push(int port, Packet *);
     Packet *pull(int port);
+    int pull_batch(int port, Packet **ps, int n);
 
   private:
 
@@ -20,13 +20,14 @@
 
 #include <click/config.h>
 #include "unqueue.hh"
+#include "simplequeue.hh"
 #include <click/args.hh>
 #include <click/error.hh>
 #include <click/standard/scheduleinfo.hh>
 CLICK_DECLS
 
 Unqueue::Unqueue()
-    : _task(this)
+    : _task(this), _queue(0)
 {
 }
 
@@ -48,6 +49,12 @@ Unqueue::initialize(ErrorHandler *errh)
     _count = 0;
     ScheduleInfo::initialize_task(this, &_task, _active, errh);
     _signal = Notifier::upstream_empty_signal(this, 0, &_task);
+#if CLICK_STATS < 1
+    // Batches bypass Port::pull(), so only take them when port statistics
+    // are off.
+    if (input(0).port() == 0)
+	_queue = static_cast<SimpleQueue *>(input(0).element()->cast("SimpleQueue"));
+#endif
     if (_burst < 0)
 	_burst = 0x7FFFFFFFU;
     else if (_burst == 0)
@@ -68,6 +75,9 @@ Unqueue::run_task(Task *)
 	    return false;
     }
 
+    if (_queue && limit > 1)
+	return run_batch(limit);
+
     while (worked < limit && _active) {
 	if (Packet *p = input(0).pull()) {
 	    ++worked;
@@ -84,6 +94,35 @@ Unqueue::run_task(Task *)
     return worked > 0;
 }
 
+bool
+Unqueue::run_batch(int limit)
+{
+    Packet *batch[batch_size];
+    int worked = 0;
+
+    while (worked < limit && _active) {
+	int want = limit - worked < batch_size ? limit - worked : batch_size;
+	int n = _queue->pull_batch(0, batch, want);
+	if (!n) {
+	    if (!_signal)
+		return worked > 0;
+	    break;
+	}
+	for (int i = 0; i < n; ++i) {
+	    if (i + 1 < n)
+		click_prefetch0(batch[i + 1]->data());
+	    output(0).push(batch[i]);
+	}
+	worked += n;
+	_count += n;
+	if (n < want)
+	    break;
+    }
+
+    _task.fast_reschedule();
+    return worked > 0;
+}
+
 #if 0 && defined(CLICK_LINUXMODULE)
 #if __i386__ && HAVE_INTEL_CPU
 /* Old prefetching code from run_task(). */
@@ -4,6 +4,7 @@
 #include <click/task.hh>
 #include <click/notifier.hh>
 CLICK_DECLS
+class SimpleQueue;
 
 /*
 =c
@@ -21,6 +22,10 @@ its single output. Pulls a maximum of BURST packets every time
 it is scheduled. Default BURST is 1. If BURST
 is less than 0, pull until nothing comes back.
 
+If the input is connected directly to a Queue or another SimpleQueue
+variant, Unqueue takes up to BURST packets from it in batches, prefetching
+each packet's data before pushing the one ahead of it.
+
 Keyword arguments are:
 
 =over 4
@@ -85,6 +90,10 @@ class Unqueue : public Element { public:
     uint32_t _count;
     Task _task;
     NotifierSignal _signal;
+    SimpleQueue *_queue;
+
+    enum { batch_size = 32 };
+    bool run_batch(int limit);
 
     enum {
 	h_active, h_reset, h_burst, h_limit
@@ -183,6 +183,8 @@ IPRewriter::add_handlers()
 {
     add_read_handler("tcp_table", tcp_mappings_handler);
     add_read_handler("udp_table", udp_mappings_handler);
+    add_read_handler("tcp_table_json", table_json_handler, IPRewriterInput::mapid_default);
+    add_read_handler("udp_table_json", table_json_handler, IPRewriterInput::mapid_iprewriter_udp);
     add_read_handler("tcp_mappings", tcp_mappings_handler, 0, Handler::h_deprecated);
     add_read_handler("udp_mappings", udp_mappings_handler, 0, Handler::h_deprecated);
     set_handler("tcp_lookup", Handler::OP_READ | Handler::READ_PARAM, tcp_lookup_handler, 0);
@@ -204,6 +204,15 @@ relevant output port is starred.
 Returns a human-readable description of the IPRewriter's current UDP mapping
 table.
 
+=h tcp_table_json read-only
+
+Returns the current TCP mapping table as JSON.  See TCPRewriter's
+C<table_json> handler for the format.
+
+=h udp_table_json read-only
+
+Returns the current UDP mapping table as JSON, in the same format.
+
 =h tcp_lookup read
 
 Takes a TCP flow as a space-separated
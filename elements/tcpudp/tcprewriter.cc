@@ -395,6 +395,7 @@ TCPRewriter::add_handlers()
 {
     add_read_handler("table", tcp_mappings_handler, 0);
     add_read_handler("mappings", tcp_mappings_handler, 0, Handler::h_deprecated);
+    add_read_handler("table_json", table_json_handler, IPRewriterInput::mapid_default);
     set_handler("lookup", Handler::OP_READ | Handler::READ_PARAM, tcp_lookup_handler, 0);
     add_rewriter_handlers(true);
 }
@@ -80,6 +80,16 @@ packets to the rewritten destination address. Default is true.
 Returns a human-readable description of the TCPRewriter's current mapping
 table.
 
+=h table_json read-only
+
+Returns the current mapping table as a JSON array with one object per
+mapping.  Each object has keys "src", "sport", "dst", and "dport" for the
+flow, "rewritten_src", "rewritten_sport", "rewritten_dst", and
+"rewritten_dport" for its rewritten form, "reply" (true for the reply
+direction of a mapping), "output" and "reply_output" for the two
+directions' output ports, "input", and "expiry" (seconds until the mapping
+expires).
+
 =h lookup read
 
 Takes a flow as a space-separated
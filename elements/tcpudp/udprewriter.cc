@@ -195,6 +195,7 @@ UDPRewriter::add_handlers()
 {
     add_read_handler("table", dump_mappings_handler);
     add_read_handler("mappings", dump_mappings_handler, 0, Handler::h_deprecated);
+    add_read_handler("table_json", table_json_handler, IPRewriterInput::mapid_default);
     add_rewriter_handlers(true);
 }
 
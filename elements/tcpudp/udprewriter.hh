@@ -157,6 +157,11 @@ packets to the rewritten destination address. Default is true.
 Returns a human-readable description of the UDPRewriter's current mapping
 table.
 
+=h table_json read-only
+
+Returns the current mapping table as JSON.  See TCPRewriter's C<table_json>
+handler for the format.
+
 =a TCPRewriter, IPAddrRewriter, IPAddrPairRewriter, IPRewriterPatterns,
 RoundRobinIPMapper, FTPPortMapper, ICMPRewriter, ICMPPingRewriter */
 
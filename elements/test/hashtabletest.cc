@@ -19,6 +19,8 @@
 #include <click/config.h>
 #include "hashtabletest.hh"
 #include <click/hashtable.hh>
+#include <click/flathashtable.hh>
+#include <click/ipflowid.hh>
 #include <click/error.hh>
 #if CLICK_USERLEVEL
 # include <sys/time.h>
@@ -54,15 +56,16 @@ HashTableTest::HashTableTest()
 #define CHECK(x) if (!(x)) return errh->error("%s:%d: test `%s' failed", __FILE__, __LINE__, #x);
 #define CHECK_DATA(x, y, l) CHECK(memcmp((x), (y), (l)) == 0)
 
+template <typename M>
 static int
-check1(MAP_S2I &h, ErrorHandler *errh)
+check1(M &h, ErrorHandler *errh)
 {
     CHECK(h.size() == 4);
     CHECK(!h.empty());
 
     char x[4] = "\0\0\0";
     int n = 0;
-    for (MAP_S2I::const_iterator i = h.begin(); i.live(); i++) {
+    for (typename M::const_iterator i = h.begin(); i.live(); i++) {
 	CHECK(IT_VALUE(i) >= 1 && IT_VALUE(i) <= 4);
 	CHECK(x[IT_VALUE(i) - 1] == 0);
 	x[IT_VALUE(i) - 1] = 1;
@@ -72,7 +75,7 @@ check1(MAP_S2I &h, ErrorHandler *errh)
 
     memset(x, 0, 4);
     n = 0;
-    for (MAP_S2I::iterator i = h.begin(); i.live(); i++) {
+    for (typename M::iterator i = h.begin(); i.live(); i++) {
 	int oldv = IT_VALUE(i);
 	CHECK(IT_VALUE(i) >= 1 && IT_VALUE(i) <= 4);
 	IT_VALUE(i) = 5;
@@ -427,6 +430,115 @@ static const char * const nonclasses[] = {
 };
 #endif
 
+static int
+check_flat(ErrorHandler *errh)
+{
+    typedef FlatHashTable<String, int> FMAP;
+    FMAP h;
+    CHECK(h.empty() && h.begin() == h.end() && !h.find("Foo"));
+    h.set("Foo", 1);
+    h.set("bar", 2);
+    h.set("facker", 3);
+    h["Anne Elizabeth Dudfield"] = 4;
+    CHECK(check1(h, errh) == 0);
+    {
+	FMAP hh(h);
+	CHECK(check1(hh, errh) == 0);
+	hh["crap"] = 5;
+	CHECK(hh.size() == 5 && h.size() == 4);
+    }
+    CHECK(!h.set("Foo", 1) && h.erase("Foo") == 1 && h.erase("Foo") == 0);
+    CHECK(h.size() == 3 && h.get("Foo") == 0 && !h.get_pointer("Foo"));
+    CHECK(h.get("bar") == 2 && *h.get_pointer("facker") == 3);
+    const FMAP &ch = h;
+    CHECK(ch["Missing"] == 0 && h.size() == 3 && h["Missing"] == 0 && h.size() == 4);
+
+    for (FMAP::iterator it = h.begin(); it; )
+	if (it.key() == "bar")
+	    it = h.erase(it);
+	else
+	    ++it;
+    CHECK(h.size() == 3 && !h.count("bar") && h.count("facker"));
+    h.clear();
+    CHECK(h.size() == 0 && h.begin() == h.end() && h.bucket_count() > 0);
+
+    // compare against HashTable across growth, tombstones, and rehashing
+    FlatHashTable<int, int> f(-1);
+    HashTable<int, int> r(-1);
+    uint32_t seed = 1;
+    for (int i = 0; i < 200000; ++i) {
+	seed = seed * 1103515245 + 12345;
+	int k = (seed >> 8) % (i < 100000 ? 5000 : 200000), op = seed % 3;
+	if (op == 0) {
+	    CHECK(f.set(k, i) == r.set(k, i));
+	} else if (op == 1) {
+	    CHECK(f.erase(k) == r.erase(k));
+	} else
+	    CHECK(f.get(k) == r.get(k));
+	if (i == 150000) {
+	    f.rehash(1 << 16);
+	    FlatHashTable<int, int> g(f);
+	    f.clear();
+	    f = g;
+	}
+    }
+    CHECK(f.size() == r.size());
+    size_t n = 0;
+    for (FlatHashTable<int, int>::const_iterator it = f.begin(); it; ++it, ++n)
+	CHECK(r.get(it.key()) == it.value());
+    CHECK(n == r.size());
+    for (HashTable<int, int>::const_iterator it = r.begin(); it; ++it)
+	CHECK(f.get(it.key()) == it.value());
+    return 0;
+}
+
+#if CLICK_USERLEVEL
+static inline IPFlowID
+flow_key(uint32_t i)
+{
+    return IPFlowID(IPAddress(htonl(0x0A000000 + (i >> 4))), htons(1024 + (i & 15)),
+		    IPAddress(htonl(0xC0A80001)), htons(80));
+}
+
+// Time a flow-table workload: insert flows, look them up, look up flows
+// that are absent, and replace old flows with new ones.
+template <typename M>
+static int
+benchmark_flows(const char *name, ErrorHandler *errh)
+{
+    enum { nflows = 100000, rounds = 10 };
+    M m(0);
+    struct rusage ru0, ru1;
+    Timestamp ts0, ts1;
+    if (getrusage(RUSAGE_SELF, &ru0) < 0)
+	return errh->error("rusage: %s", strerror(errno));
+    ts0.assign_now();
+
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < nflows; ++i)
+	m.set(flow_key(i * 2), i);
+    for (int r = 0; r < rounds; ++r) {
+	uint32_t base = r * nflows / 4 * 2;
+	for (uint32_t i = 0; i < nflows; ++i) {
+	    value += m.get(flow_key(base + i * 2));
+	    value += m.get(flow_key(base + i * 2 + 1));
+	}
+	for (uint32_t i = 0; i < nflows / 4; ++i) {
+	    m.erase(flow_key(base + i * 2));
+	    m.set(flow_key(base + (nflows + i) * 2), i);
+	}
+    }
+
+    if (getrusage(RUSAGE_SELF, &ru1) < 0)
+	return errh->error("rusage: %s", strerror(errno));
+    ts1.assign_now();
+    Timestamp ru_delta = Timestamp(ru1.ru_utime) - Timestamp(ru0.ru_utime);
+    ts1 -= ts0;
+    errh->message("Time: %s flows: %p{timestamp}u %p{timestamp} total %u/%u (%u)", name, &ru_delta, &ts1, m.size(), m.bucket_count(), value);
+    return 0;
+}
+#endif
+
 struct MyHashContainerEntry {
     int _key;
     struct MyHashContainerEntry *_hashnext;
@@ -548,6 +660,14 @@ HashTableTest::initialize(ErrorHandler *errh)
     errh->message("Time: %p{timestamp}u %p{timestamp} total %u/%u", &ru_delta, &ts1, map.size(), map.bucket_count());
 #endif
 
+    if (check_flat(errh) < 0)
+	return -1;
+#if CLICK_USERLEVEL
+    if (benchmark_flows<HashTable<IPFlowID, uint32_t> >("HashTable", errh) < 0
+	|| benchmark_flows<FlatHashTable<IPFlowID, uint32_t> >("FlatHashTable", errh) < 0)
+	return -1;
+#endif
+
     {
 	char blah[] = "Hello, this is a story I will tell.\0\0\0\0";
 	size_t l = strlen(blah);
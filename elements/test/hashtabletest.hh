@@ -11,12 +11,13 @@ HashTableTest()
 
 =s test
 
-runs regression tests for HashTable<K, V>
+runs regression tests for HashTable<K, V> and FlatHashTable<K, V>
 
 =d
 
-HashTableTest runs HashTable regression tests at initialization time. It
-does not route packets.
+HashTableTest runs HashTable and FlatHashTable regression tests at
+initialization time. At user level, it also times a flow-table workload on
+each. It does not route packets.
 
 */
 
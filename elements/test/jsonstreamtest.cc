@@ -0,0 +1,145 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * jsonstreamtest.{cc,hh} -- regression test element for JsonWriter and
+ * JsonParser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "jsonstreamtest.hh"
+#include <click/jsonstream.hh>
+#include <click/ipaddress.hh>
+#include <click/error.hh>
+CLICK_DECLS
+
+namespace {
+// Records parse events as text, one event per space-separated word.
+class EventParser : public JsonParser { public:
+    StringAccum sa;
+    String stop_at;
+    bool on_begin_object() { sa << "{ "; return true; }
+    bool on_key(const char *s, int len) {
+	sa << "K:";
+	sa.append(s, len);
+	sa << ' ';
+	return String(s, len) != stop_at;
+    }
+    bool on_end_object() { sa << "} "; return true; }
+    bool on_begin_array() { sa << "[ "; return true; }
+    bool on_end_array() { sa << "] "; return true; }
+    bool on_null() { sa << "null "; return true; }
+    bool on_bool(bool x) { sa << x << ' '; return true; }
+    bool on_string(const char *s, int len) {
+	sa << "S:";
+	sa.append(s, len);
+	sa << ' ';
+	return true;
+    }
+    bool on_integer(click_intmax_t x) { sa << "I:" << x << ' '; return true; }
+#if HAVE_FLOAT_TYPES
+    bool on_double(double x) { sa << "D:" << x << ' '; return true; }
+#endif
+    String events(const String &str) {
+	sa.clear();
+	if (!parse(str))
+	    sa << "error@" << error_offset();
+	return sa.take_string();
+    }
+};
+}
+
+JsonStreamTest::JsonStreamTest()
+{
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test %<%s%> failed", __FILE__, __LINE__, #x);
+
+int
+JsonStreamTest::initialize(ErrorHandler *errh)
+{
+    {
+	StringAccum sa;
+	JsonWriter w(sa);
+	w.begin_object().key("a").value(1).key("b").begin_array()
+	    .value(true).null().value("x\"y").end_array()
+	    .key("c").begin_object().end_object()
+	    .key("d").begin_array().end_array().end_object();
+	CHECK(sa.take_string() == "{\"a\":1,\"b\":[true,null,\"x\\\"y\"],\"c\":{},\"d\":[]}");
+    }
+
+    {
+	StringAccum sa;
+	JsonWriter w(sa);
+	w.begin_array().quoted(IPAddress(0x0100000A)).quoted("a/b")
+	    .value(-5).value(4000000000U).number(12).end_array();
+	CHECK(sa.take_string() == "[\"10.0.0.1\",\"a\\/b\",-5,4000000000,12]");
+    }
+
+    {
+	StringAccum sa;
+	String s("\001\n\342\200\250\303\251", 7);
+	JsonWriter::append_escaped(sa, s.data(), s.length());
+	CHECK(sa.take_string() == s.encode_json());
+    }
+
+#if HAVE_FLOAT_TYPES
+    {
+	StringAccum sa;
+	JsonWriter w(sa);
+	double zero = 0;
+	w.begin_array().value(0.5).value(1 / zero).end_array();
+	CHECK(sa.take_string() == "[0.5,null]");
+    }
+#endif
+
+    EventParser p;
+    CHECK(p.events("{\"a\": [1, -2, true, false, null, \"s\"], \"b\": {}}")
+	  == "{ K:a [ I:1 I:-2 true false null S:s ] K:b { } } ");
+    CHECK(p.events(" [] ") == "[ ] ");
+    CHECK(p.events("\"\\u00e9\\n\\ud83d\\udca9\"") == "S:\303\251\n\360\237\222\251 ");
+    CHECK(p.events("-9223372036854775808") == "I:-9223372036854775808 ");
+#if HAVE_FLOAT_TYPES
+    CHECK(p.events("[1.5, 2e2, 9223372036854775808]") == "[ D:1.5 D:200 D:9.22337203685e+18 ] ");
+#endif
+    CHECK(p.events("[1,]") == "[ I:1 error@3");
+    CHECK(p.events("{\"a\" 1}") == "{ K:a error@5");
+    CHECK(p.events("[1] 2") == "[ I:1 ] error@4");
+    CHECK(p.events("") == "error@0");
+    CHECK(p.events("[01]") == "[ I:0 error@2");
+    CHECK(p.events("\"a\001\"") == "error@0");
+
+    p.stop_at = "stop";
+    CHECK(p.events("{\"go\":1,\"stop\":2}") == "{ K:go I:1 K:stop error@8");
+    p.stop_at = String();
+
+    {
+	StringAccum deep;
+	for (int i = 0; i < JsonParser::max_depth + 1; ++i)
+	    deep << '[';
+	CHECK(p.events(deep.take_string()).find_left("error@1024") >= 0);
+    }
+
+    {
+	// round trip
+	StringAccum sa;
+	JsonWriter w(sa);
+	w.begin_object().key("k\\").value("\t\"").key("n").begin_array()
+	    .value(0).value(-1).end_array().end_object();
+	CHECK(p.events(sa.take_string()) == "{ K:k\\ S:\t\" K:n [ I:0 I:-1 ] } ");
+    }
+
+    errh->message("All tests pass!");
+    return 0;
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(JsonStreamTest)
@@ -0,0 +1,34 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_JSONSTREAMTEST_HH
+#define CLICK_JSONSTREAMTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+JsonStreamTest()
+
+=s test
+
+runs regression tests for JsonWriter and JsonParser
+
+=d
+
+JsonStreamTest runs JsonWriter and JsonParser regression tests at
+initialization time. It does not route packets.
+
+*/
+
+class JsonStreamTest : public Element { public:
+
+    JsonStreamTest() CLICK_COLD;
+
+    const char *class_name() const		{ return "JsonStreamTest"; }
+
+    int initialize(ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,190 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * stringtest.{cc,hh} -- regression test element for String and StringAccum
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "stringtest.hh"
+#include <click/string.hh>
+#include <click/straccum.hh>
+#include <click/args.hh>
+#include <click/confparse.hh>
+#include <click/ipaddress.hh>
+#include <click/error.hh>
+#if CLICK_USERLEVEL
+# include <sys/time.h>
+# include <sys/resource.h>
+# include <unistd.h>
+#endif
+CLICK_DECLS
+
+StringTest::StringTest()
+    : _benchmark(false)
+{
+}
+
+int
+StringTest::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    return Args(conf, this, errh)
+	.read("BENCHMARK", _benchmark)
+	.complete();
+}
+
+#define CHECK(x) if (!(x)) return errh->error("%s:%d: test %<%s%> failed", __FILE__, __LINE__, #x);
+
+int
+StringTest::initialize(ErrorHandler *errh)
+{
+    {
+	String a("abc", 3);
+	String b = a;
+	b += "def";
+	CHECK(a == "abc" && b == "abcdef");
+	String c = b.substring(2, 3);
+	CHECK(c == "cde");
+	c += "x";
+	CHECK(b == "abcdef" && c == "cdex");
+	CHECK(String(c.c_str()) == "cdex");
+    }
+
+    {
+	// freed memory is reused without disturbing live strings
+	Vector<String> v;
+	for (int round = 0; round < 4; ++round) {
+	    for (int i = 0; i < 300; ++i) {
+		StringAccum sa;
+		for (int j = 0; j < i; ++j)
+		    sa << (char) ('a' + (i + j) % 26);
+		v.push_back(sa.take_string());
+	    }
+	    for (int i = 0; i < v.size(); ++i) {
+		CHECK(v[i].length() == i);
+		for (int j = 0; j < i; ++j)
+		    CHECK(v[i][j] == 'a' + (i + j) % 26);
+	    }
+	    v.clear();
+	}
+    }
+
+    {
+	StringAccum sa(20);
+	sa << "x" << 12 << ' ' << IPAddress(0x0100000A);
+	CHECK(sa.take_string() == "x12 10.0.0.1");
+	sa << "y";
+	String s = sa.take_string();
+	sa << s << s;
+	CHECK(sa.take_string() == "yy");
+	StringAccum big;
+	for (int i = 0; i < 1000; ++i)
+	    big << i;
+	String b = big.take_string();
+	CHECK(b.length() == 2890 && b.substring(0, 12) == "012345678910");
+    }
+
+    {
+	String s = String::make_stable("stable");
+	String t = s;
+	t.append("!", 1);
+	CHECK(s == "stable" && t == "stable!");
+	String u(100);
+	CHECK(u == "100");
+	u.append_fill('z', 300);
+	CHECK(u.length() == 303 && u.back() == 'z');
+    }
+
+    if (_benchmark)
+	return benchmark(errh);
+    errh->message("All tests pass!");
+    return 0;
+}
+
+int
+StringTest::benchmark(ErrorHandler *errh)
+{
+#if CLICK_USERLEVEL
+    for (int which = 0; which < 5; ++which) {
+	struct rusage ru0, ru1;
+	Timestamp ts0, ts1;
+	if (getrusage(RUSAGE_SELF, &ru0) < 0)
+	    return errh->error("rusage: %s", strerror(errno));
+	ts0.assign_now();
+
+	const char *name;
+	int n = 1000000;
+	uint32_t x = 0;
+	switch (which) {
+	case 0:
+	    name = "short String";
+	    for (int i = 0; i < n; ++i) {
+		String s("short string", 6 + (i & 3));
+		x += s.length();
+	    }
+	    break;
+	case 1:
+	    name = "String append";
+	    for (int i = 0; i < n; ++i) {
+		String s("a", 1);
+		s += "bcdefgh";
+		s += String(i);
+		x += s.length();
+	    }
+	    break;
+	case 2:
+	    name = "StringAccum take_string";
+	    for (int i = 0; i < n; ++i) {
+		StringAccum sa;
+		sa << "count " << i << ' ' << IPAddress(htonl(i));
+		x += sa.take_string().length();
+	    }
+	    break;
+	case 3: {
+	    name = "IntArg/IPAddressArg";
+	    String words[2] = {"123456", "10.0.4.5"};
+	    for (int i = 0; i < n; ++i) {
+		int v;
+		IPAddress a;
+		if (IntArg().parse(words[0], v) && IPAddressArg().parse(words[1], a))
+		    x += v + a.addr();
+	    }
+	    break;
+	}
+	default: {
+	    name = "cp_argvec/cp_spacevec";
+	    n = 100000;
+	    String conf = "10.0.0.1 255.0.0.0, DEST 2.0.0.2, // comment\n"
+		"LIMIT 1000, BURST 32, \"quoted, string\"";
+	    for (int i = 0; i < n; ++i) {
+		Vector<String> args, words;
+		cp_argvec(conf, args);
+		cp_spacevec(args[0], words);
+		x += args.size() + words.size();
+	    }
+	    break;
+	}
+	}
+
+	if (getrusage(RUSAGE_SELF, &ru1) < 0)
+	    return errh->error("rusage: %s", strerror(errno));
+	ts1.assign_now();
+	Timestamp ru_delta = Timestamp(ru1.ru_utime) - Timestamp(ru0.ru_utime);
+	ts1 -= ts0;
+	errh->message("Time: %s: %p{timestamp}u %p{timestamp} (%d ops, %u)", name, &ru_delta, &ts1, n, x);
+    }
+#endif
+    errh->message("All tests pass!");
+    return 0;
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(StringTest)
@@ -0,0 +1,53 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_STRINGTEST_HH
+#define CLICK_STRINGTEST_HH
+#include <click/element.hh>
+CLICK_DECLS
+
+/*
+=c
+
+StringTest([I<keywords> BENCHMARK])
+
+=s test
+
+runs regression tests and benchmarks for String and StringAccum
+
+=d
+
+StringTest runs String and StringAccum regression tests at initialization
+time. It does not route packets.
+
+Keyword arguments are:
+
+=over 8
+
+=item BENCHMARK
+
+Boolean. If true, then after the tests, time common String, StringAccum,
+and configuration-parsing operations, and report the results.  Default is
+false.
+
+=back
+
+*/
+
+class StringTest : public Element { public:
+
+    StringTest() CLICK_COLD;
+
+    const char *class_name() const		{ return "StringTest"; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+
+  private:
+
+    bool _benchmark;
+
+    int benchmark(ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -33,7 +33,7 @@
 #include <fcntl.h>
 CLICK_DECLS
 
-const char ControlSocket::protocol_version[] = "1.3";
+const char ControlSocket::protocol_version[] = "1.4";
 
 class ControlSocketErrorHandler : public ErrorHandler { public:
 
@@ -309,6 +309,20 @@ ControlSocket::take_state(Element *e, ErrorHandler *errh)
 	    add_select((*it)->fd, SELECT_READ);
 	if (*it && !(*it)->out_closed)
 	    add_select((*it)->fd, SELECT_WRITE);
+	// subscriptions refer to the old router's elements and timers
+	if (*it)
+	    for (subscription **sp = (*it)->subscriptions.begin();
+		 sp != (*it)->subscriptions.end(); ++sp) {
+		subscription *sub = *sp;
+		sub->cs = this;
+		for (bound_handler *bh = sub->handlers.begin();
+		     bh != sub->handlers.end(); ++bh)
+		    bind_handler(*bh, bh->name);
+		delete sub->timer;
+		sub->timer = new Timer(subscription_hook, sub);
+		sub->timer->initialize(this);
+		sub->timer->schedule_after_msec(sub->interval);
+	    }
     }
 }
 
@@ -341,6 +355,17 @@ ControlSocket::cleanup(CleanupStage)
     }
 }
 
+ControlSocket::subscription::~subscription()
+{
+    delete timer;
+}
+
+ControlSocket::connection::~connection()
+{
+    for (subscription **it = subscriptions.begin(); it != subscriptions.end(); ++it)
+	delete *it;
+}
+
 int
 ControlSocket::connection::message(int code, const String &msg, bool continuation)
 {
@@ -447,8 +472,9 @@ ControlSocket::proxied_handler_name(const String &n) const
     return n;
 }
 
-const Handler*
-ControlSocket::parse_handler(connection &conn, const String &full_name, Element **es)
+const Handler *
+ControlSocket::find_handler(const String &full_name, Element **es,
+			    int &code, Vector<String> &messages)
 {
   // Parse full_name into element_name and handler_name.
   String canonical_name = canonical_handler_name(full_name);
@@ -463,10 +489,14 @@ ControlSocket::parse_handler(connection &conn, const String &full_name, Element
     _proxied_errh = 0;
 
     if (errh.nerrors() > 0) {
-      conn.transfer_messages(CSERR_NO_SUCH_HANDLER, String(), &errh);
+      code = errh.error_code();
+      if (code == CSERR_OK)
+	code = CSERR_NO_SUCH_HANDLER;
+      messages = errh.messages();
       return 0;
     } else if (!h) {
-      conn.message(CSERR_NO_SUCH_HANDLER, "No proxied handler named '" + full_name + "'");
+      code = CSERR_NO_SUCH_HANDLER;
+      messages.push_back("No proxied handler named '" + full_name + "'");
       return 0;
     } else {
       *es = _proxy;
@@ -488,7 +518,8 @@ ControlSocket::parse_handler(connection &conn, const String &full_name, Element
 	e = router()->element(num - 1);
     }
     if (!e) {
-      conn.message(CSERR_NO_SUCH_ELEMENT, "No element named '" + ename + "'");
+      code = CSERR_NO_SUCH_ELEMENT;
+      messages.push_back("No element named '" + ename + "'");
       return 0;
     }
     hname = canonical_name.substring(dot + 1, canonical_name.end());
@@ -503,11 +534,23 @@ ControlSocket::parse_handler(connection &conn, const String &full_name, Element
     *es = e;
     return h;
   } else {
-    conn.message(CSERR_NO_SUCH_HANDLER, "No handler named '" + full_name + "'");
+    code = CSERR_NO_SUCH_HANDLER;
+    messages.push_back("No handler named '" + full_name + "'");
     return 0;
   }
 }
 
+const Handler*
+ControlSocket::parse_handler(connection &conn, const String &full_name, Element **es)
+{
+  int code;
+  Vector<String> messages;
+  const Handler *h = find_handler(full_name, es, code, messages);
+  for (int i = 0; i < messages.size(); i++)
+    conn.message(code, messages[i], i < messages.size() - 1);
+  return h;
+}
+
 int
 ControlSocket::read_command(connection &conn, const String &handlername, String param)
 {
@@ -779,6 +822,13 @@ ControlSocket::parse_command(connection &conn, const String &line)
     conn.inpos = 0;
     return 0;
 
+  } else if (command == "BINARY") {
+    if (words.size() != 1)
+      return conn.message(CSERR_SYNTAX, "Bad command syntax");
+    conn.message(CSERR_OK, "Switching to binary protocol");
+    conn.binary = true;
+    return 0;
+
   } else if (command == "HELP") {
     conn.message(CSERR_OK, "Commands supported:", true);
     conn.message(CSERR_OK, "READ handler [arg...]   call read handler, return DATA", true);
@@ -790,6 +840,7 @@ ControlSocket::parse_command(connection &conn, const String &line)
     conn.message(CSERR_OK, "CHECKREAD handler       check if read handler is valid", true);
     conn.message(CSERR_OK, "CHECKWRITE handler      check if write handler is valid", true);
     conn.message(CSERR_OK, "LLRPC elt#number [len]  call LLRPC, pass len data bytes, return DATA", true);
+    conn.message(CSERR_OK, "BINARY                  switch to binary protocol", true);
     conn.message(CSERR_OK, "QUIT                    close connection");
     return 0;
 
@@ -797,6 +848,331 @@ ControlSocket::parse_command(connection &conn, const String &line)
     return conn.message(CSERR_UNIMPLEMENTED, "Command '" + command + "' unimplemented");
 }
 
+// binary protocol
+
+static inline void
+append_u16(StringAccum &sa, uint16_t x)
+{
+    x = htons(x);
+    sa.append(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+static inline void
+append_u32(StringAccum &sa, uint32_t x)
+{
+    x = htonl(x);
+    sa.append(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+static inline uint16_t
+extract_u16(const char *s)
+{
+    uint16_t x;
+    memcpy(&x, s, sizeof(x));
+    return ntohs(x);
+}
+
+static inline uint32_t
+extract_u32(const char *s)
+{
+    uint32_t x;
+    memcpy(&x, s, sizeof(x));
+    return ntohl(x);
+}
+
+static int
+begin_frame(StringAccum &sa, int opcode, uint32_t tag, uint32_t arg)
+{
+    int pos = sa.length();
+    append_u32(sa, 0);		// length and count filled in by end_frame
+    sa << (char) opcode << '\0';
+    append_u16(sa, 0);
+    append_u32(sa, tag);
+    append_u32(sa, arg);
+    return pos;
+}
+
+static void
+end_frame(StringAccum &sa, int pos, int nvalues)
+{
+    uint32_t len = htonl(sa.length() - pos);
+    memcpy(sa.data() + pos, &len, sizeof(len));
+    uint16_t n = htons(nvalues);
+    memcpy(sa.data() + pos + 6, &n, sizeof(n));
+}
+
+static void
+append_value(StringAccum &sa, int code, int type, const String &data)
+{
+    append_u16(sa, code);
+    sa << (char) type << '\0';
+    append_u32(sa, data.length());
+    sa << data;
+}
+
+static void
+append_value(StringAccum &sa, int code, int type, uint64_t x)
+{
+    append_u16(sa, code);
+    sa << (char) type << '\0';
+    append_u32(sa, 8);
+    append_u32(sa, x >> 32);
+    append_u32(sa, x);
+}
+
+static String
+join_messages(const Vector<String> &messages)
+{
+    StringAccum sa;
+    for (int i = 0; i < messages.size(); ++i)
+	sa << (i ? "\n" : "") << messages[i];
+    return sa.take_string();
+}
+
+void
+ControlSocket::bind_handler(bound_handler &bh, const String &name)
+{
+    Vector<String> messages;
+    bh.name = name;
+    bh.e = 0;
+    bh.h = find_handler(name, &bh.e, bh.code, messages);
+    bh.message = (bh.h ? String() : join_messages(messages));
+}
+
+void
+ControlSocket::binary_read(StringAccum &sa, const bound_handler &bh,
+			   const String &param, bool typed)
+{
+    if (!bh.h) {
+	append_value(sa, bh.code, bin_type_string, bh.message);
+	return;
+    } else if (!bh.h->read_visible()) {
+	append_value(sa, CSERR_PERMISSION, bin_type_string, "Handler '" + bh.name + "' write-only");
+	return;
+    }
+
+    // collect errors from proxy
+    ControlSocketErrorHandler errh;
+    _proxied_handler = bh.h->name();
+    _proxied_errh = &errh;
+    String data = bh.h->call_read(bh.e, param, &errh);
+    _proxied_errh = 0;
+
+    if (errh.nerrors() > 0) {
+	int code = errh.error_code();
+	if (code == CSERR_OK)
+	    code = CSERR_UNSPECIFIED;
+	append_value(sa, code, bin_type_string, join_messages(errh.messages()));
+	return;
+    }
+
+    // send numbers as numbers if asked
+    if (typed) {
+	String t = data.trim_space();
+	int64_t i;
+	uint64_t u;
+	double d;
+	if (IntArg(10).parse(t, i))
+	    append_value(sa, CSERR_OK, bin_type_int, (uint64_t) i);
+	else if (IntArg(10).parse(t, u))
+	    append_value(sa, CSERR_OK, bin_type_uint, u);
+	else if (DoubleArg().parse(t, d)) {
+	    uint64_t x;
+	    static_assert(sizeof(x) == sizeof(d), "double must be 64 bits");
+	    memcpy(&x, &d, sizeof(x));
+	    append_value(sa, CSERR_OK, bin_type_double, x);
+	} else
+	    append_value(sa, CSERR_OK, bin_type_string, data);
+    } else
+	append_value(sa, CSERR_OK, bin_type_string, data);
+}
+
+void
+ControlSocket::binary_write(StringAccum &sa, const String &hname, const String &data)
+{
+    Element *e;
+    int code;
+    Vector<String> messages;
+    const Handler *h = find_handler(hname, &e, code, messages);
+    if (!h) {
+	append_value(sa, code, bin_type_string, join_messages(messages));
+	return;
+    } else if (!h->writable()) {
+	append_value(sa, CSERR_PERMISSION, bin_type_string, "Handler '" + hname + "' read-only");
+	return;
+    } else if (_read_only) {
+	append_value(sa, CSERR_PERMISSION, bin_type_string, "Permission denied for '" + hname + "'");
+	return;
+    }
+#ifdef LARGEST_HANDLER_WRITE
+    if (data.length() > LARGEST_HANDLER_WRITE) {
+	append_value(sa, CSERR_DATA_TOO_BIG, bin_type_string, "Data too large for write handler '" + hname + "'");
+	return;
+    }
+#endif
+
+    ControlSocketErrorHandler errh;
+    int result = h->call_write(data, e, &errh);
+    code = errh.error_code();
+    if (code == CSERR_OK) {
+	if (errh.nerrors() > 0 || result < 0)
+	    code = CSERR_HANDLER_ERROR;
+	else if (errh.nwarnings() > 0)
+	    code = CSERR_OK_HANDLER_WARNING;
+    }
+    append_value(sa, code, bin_type_string, join_messages(errh.messages()));
+}
+
+void
+ControlSocket::binary_subscribe(connection &conn, StringAccum &sa,
+				uint32_t tag, uint32_t interval, uint8_t flags,
+				const Vector<String> &args)
+{
+    remove_subscription(conn, tag);
+
+    subscription *sub = new subscription;
+    sub->cs = this;
+    sub->conn = &conn;
+    sub->tag = tag;
+    sub->interval = interval;
+    sub->seq = 0;
+    sub->flags = flags;
+    sub->handlers.resize(args.size());
+    for (int i = 0; i < args.size(); ++i) {
+	bind_handler(sub->handlers[i], args[i]);
+	binary_read(sa, sub->handlers[i], String(), flags & bin_flag_typed);
+    }
+    router()->add_handler_user(this);
+    sub->timer = new Timer(subscription_hook, sub);
+    sub->timer->initialize(this);
+    sub->timer->schedule_after_msec(interval);
+    conn.subscriptions.push_back(sub);
+}
+
+bool
+ControlSocket::remove_subscription(connection &conn, uint32_t tag)
+{
+    for (subscription **it = conn.subscriptions.begin();
+	 it != conn.subscriptions.end(); ++it)
+	if ((*it)->tag == tag) {
+	    delete *it;
+	    conn.subscriptions.erase(it);
+	    return true;
+	}
+    return false;
+}
+
+void
+ControlSocket::subscription_hook(Timer *t, void *thunk)
+{
+    subscription *sub = static_cast<subscription *>(thunk);
+    connection *conn = sub->conn;
+    ++sub->seq;
+    // drop samples rather than buffer without bound for a slow client
+    if (!conn->out_closed
+	&& conn->out_text.length() - conn->outpos < bin_max_backlog) {
+	int pos = begin_frame(conn->out_text, bin_stream, sub->tag, sub->seq);
+	for (bound_handler *bh = sub->handlers.begin();
+	     bh != sub->handlers.end(); ++bh)
+	    sub->cs->binary_read(conn->out_text, *bh, String(),
+				 sub->flags & bin_flag_typed);
+	end_frame(conn->out_text, pos, sub->handlers.size());
+	conn->flush_write(sub->cs, false);
+    }
+    t->reschedule_after_msec(sub->interval);
+}
+
+int
+ControlSocket::parse_binary_frame(connection &conn, const char *frame, uint32_t len)
+{
+    int opcode = (unsigned char) frame[4];
+    uint8_t flags = frame[5];
+    int nargs = extract_u16(frame + 6);
+    uint32_t tag = extract_u32(frame + 8), arg = extract_u32(frame + 12);
+    StringAccum &sa = conn.out_text;
+    int pos = begin_frame(sa, opcode, tag, 0);
+    int nvalues = 1;
+
+    // split arguments
+    Vector<String> args;
+    const char *s = frame + bin_header_size, *end = frame + len;
+    while (args.size() < nargs && end - s >= 4
+	   && extract_u32(s) <= (uint32_t) (end - s - 4)) {
+	args.push_back(String(s + 4, extract_u32(s)));
+	s += 4 + args.back().length();
+    }
+
+    if (args.size() != nargs || s != end)
+	append_value(sa, CSERR_SYNTAX, bin_type_string, "Bad frame");
+    else if (opcode == bin_read && (nargs == 1 || nargs == 2)) {
+	bound_handler bh;
+	bind_handler(bh, args[0]);
+	binary_read(sa, bh, nargs == 2 ? args[1] : String(), flags & bin_flag_typed);
+    } else if (opcode == bin_write && (nargs == 1 || nargs == 2))
+	binary_write(sa, args[0], nargs == 2 ? args[1] : String());
+    else if (opcode == bin_read_batch) {
+	bound_handler bh;
+	for (String *it = args.begin(); it != args.end(); ++it) {
+	    bind_handler(bh, *it);
+	    binary_read(sa, bh, String(), flags & bin_flag_typed);
+	}
+	nvalues = nargs;
+    } else if (opcode == bin_subscribe && arg > 0) {
+	binary_subscribe(conn, sa, tag, arg, flags, args);
+	nvalues = nargs;
+    } else if (opcode == bin_unsubscribe && nargs == 0) {
+	if (remove_subscription(conn, tag))
+	    append_value(sa, CSERR_OK, bin_type_string, String());
+	else
+	    append_value(sa, CSERR_SYNTAX, bin_type_string, "No such subscription");
+    } else if (opcode == bin_quit && nargs == 0) {
+	append_value(sa, CSERR_OK, bin_type_string, "Goodbye!");
+	end_frame(sa, pos, nvalues);
+	return READ_CLOSED;
+    } else if (opcode >= bin_read && opcode <= bin_quit)
+	append_value(sa, CSERR_SYNTAX, bin_type_string, "Wrong number of arguments");
+    else
+	append_value(sa, CSERR_UNIMPLEMENTED, bin_type_string, "Opcode " + String(opcode) + " unimplemented");
+
+    end_frame(sa, pos, nvalues);
+    return 0;
+}
+
+void
+ControlSocket::parse_binary(connection &conn)
+{
+    // process every complete frame
+    while (1) {
+	int avail = conn.in_text.length() - conn.inpos;
+	if (avail < bin_header_size)
+	    break;
+	const char *frame = conn.in_text.begin() + conn.inpos;
+	uint32_t len = extract_u32(frame);
+	if (len < bin_header_size || len > bin_max_frame) {
+	    // can't find the next frame; give up on this connection
+	    int pos = begin_frame(conn.out_text, (unsigned char) frame[4], extract_u32(frame + 8), 0);
+	    append_value(conn.out_text, CSERR_DATA_TOO_BIG, bin_type_string, "Bad frame length");
+	    end_frame(conn.out_text, pos, 1);
+	    goto close;
+	} else if ((uint32_t) avail < len)
+	    break;
+	int r = parse_binary_frame(conn, frame, len);
+	conn.inpos += len;
+	if (r == READ_CLOSED)
+	    goto close;
+    }
+    // an incomplete frame can't be completed after end of file
+    if (conn.in_closed)
+	conn.inpos = conn.in_text.length();
+    connection::contract(conn.in_text, conn.inpos);
+    return;
+
+  close:
+    conn.in_closed = true;
+    conn.in_text.clear();
+    conn.inpos = 0;
+}
+
 void
 ControlSocket::initialize_connection(int fd)
 {
@@ -845,9 +1221,10 @@ ControlSocket::selected(int fd, int)
     connection *conn = _conns[fd];
 
     // read commands from socket (but only a bit on each select)
+    int want = (conn->binary ? 65536 : 2048);
     if (!conn->in_closed)
-	if (char *buf = conn->in_text.reserve(2048)) {
-	    ssize_t r = read(conn->fd, buf, 2048);
+	if (char *buf = conn->in_text.reserve(want)) {
+	    ssize_t r = read(conn->fd, buf, want);
 	    if (r != 0 && r != -1)
 		conn->in_text.adjust_length(r);
 	    else if (r == 0 || (r == -1 && errno != EAGAIN && errno != EINTR))
@@ -856,8 +1233,12 @@ ControlSocket::selected(int fd, int)
 
     // parse commands
     // 16.Jun.2004: process only one command each time through
+    // (binary connections process all complete frames at once)
     bool blocked = false;
-    if (conn->in_text.length()) {
+    if (conn->binary) {
+	parse_binary(*conn);
+	blocked = true;
+    } else if (conn->in_text.length()) {
 	const char *in_text = conn->in_text.begin() + conn->inpos;
 	const char *in_end = conn->in_text.end();
 	const char *line_end = in_text;
@@ -39,8 +39,8 @@ The server will accept lines terminated by CR, LF, or CRLF. Its response
 lines are always terminated by CRLF.
 
 When a connection is opened, the server responds by stating its protocol
-version number with a line like "Click::ControlSocket/1.3". The current
-version number is 1.3. Changes in minor version number will only add commands
+version number with a line like "Click::ControlSocket/1.4". The current
+version number is 1.4. Changes in minor version number will only add commands
 and functionality to this specification, not change existing functionality.
 
 ControlSocket supports hot-swapping, meaning you can change configurations
@@ -175,6 +175,12 @@ ControlSocket will not call an LLRPC unless it can determine (from the command
 number) how much data the LLRPC expects and returns. (Only "flat" LLRPCs may
 be called; they are declared using the _CLICK_IOC_[RWS]F macros.)
 
+=item BINARY
+
+Switch the connection to the binary protocol described below. The server
+responds with a 200 message; every later byte in either direction is a binary
+frame. Introduced in version 1.4 of the ControlSocket protocol.
+
 =item QUIT
 
 Close the connection.
@@ -205,6 +211,68 @@ Here are some of the particular error messages:
   530 Permission denied.
   540 No router installed.
 
+=head1 BINARY PROTOCOL
+
+The binary protocol is meant for monitoring programs that read many handlers
+often. Requests are pipelined: a client may send any number of request frames
+without waiting, and the server answers all complete frames it has received
+before writing. Each response carries the tag of its request.
+
+All integers are in network byte order. A request frame is a 16-byte header
+followed by I<nargs> strings, each a 4-byte length and that many bytes:
+
+  uint32 length     whole frame, including header
+  uint8  opcode
+  uint8  flags      1 = typed values
+  uint16 nargs
+  uint32 tag        copied into the response
+  uint32 arg        SUBSCRIBE interval in milliseconds, else 0
+
+A response frame has the same header, except that I<nargs> counts values and
+I<arg> is a sequence number for STREAM frames. Each value is:
+
+  uint16 code       response code, as in the text protocol
+  uint8  type       0 string, 1 int64, 2 uint64, 3 double
+  uint8  reserved
+  uint32 length
+  data
+
+Errors are string values holding the error message. With the typed flag, read
+results that are decimal integers or real numbers are sent as 8-byte numbers
+instead of strings. The opcodes are:
+
+=over 5
+
+=item 1 READ I<handler> [I<params>]
+
+Call a read handler. Responds with one value.
+
+=item 2 WRITE I<handler> [I<data>]
+
+Call a write handler. Responds with one value holding any messages.
+
+=item 3 READ_BATCH I<handler>...
+
+Call several read handlers without parameters. Responds with one value per
+handler, in order.
+
+=item 4 SUBSCRIBE I<handler>...
+
+Like READ_BATCH, then every I<arg> milliseconds send a STREAM frame (opcode 7)
+with the request's tag and the current values. Handler names are resolved
+once. If the client falls far behind, samples are dropped; the sequence
+number shows the gap.
+
+=item 5 UNSUBSCRIBE
+
+Cancel the subscription with the request's tag. Responds with one value.
+
+=item 6 QUIT
+
+Close the connection.
+
+=back
+
 ControlSocket is only available in user-level processes.
 
 =e
@@ -267,6 +335,31 @@ class ControlSocket : public Element { public:
     Element *_proxy;
     HandlerProxy *_full_proxy;
 
+    struct connection;
+
+    struct bound_handler {
+	String name;
+	Element *e;
+	const Handler *h;
+	int code;		// error code and message if !h
+	String message;
+    };
+
+    struct subscription {
+	ControlSocket *cs;
+	connection *conn;
+	uint32_t tag;
+	uint32_t interval;
+	uint32_t seq;
+	uint8_t flags;
+	Vector<bound_handler> handlers;
+	Timer *timer;
+	subscription()
+	    : timer(0) {
+	}
+	~subscription();
+    };
+
     struct connection {
 	int fd;
 	StringAccum in_text;
@@ -275,10 +368,13 @@ class ControlSocket : public Element { public:
 	int outpos;
 	bool in_closed;
 	bool out_closed;
+	bool binary;
+	Vector<subscription *> subscriptions;
 	connection(int fd_)
 	    : fd(fd_), inpos(0), outpos(0),
-	      in_closed(false), out_closed(false) {
+	      in_closed(false), out_closed(false), binary(false) {
 	}
+	~connection();
 	int message(int code, const String &msg, bool continuation = false);
 	int transfer_messages(int default_code, const String &msg, ControlSocketErrorHandler *);
 	static void contract(StringAccum &sa, int &pos);
@@ -296,6 +392,16 @@ class ControlSocket : public Element { public:
 
     enum { READ_CLOSED = 1, WRITE_CLOSED = 2, ANY_ERR = -1 };
 
+    enum {
+	bin_read = 1, bin_write = 2, bin_read_batch = 3, bin_subscribe = 4,
+	bin_unsubscribe = 5, bin_quit = 6, bin_stream = 7,
+	bin_flag_typed = 1,
+	bin_type_string = 0, bin_type_int = 1, bin_type_uint = 2,
+	bin_type_double = 3,
+	bin_header_size = 16, bin_max_frame = 1 << 24,
+	bin_max_backlog = 1 << 22
+    };
+
     static const char protocol_version[];
 
     int initialize_socket_error(ErrorHandler *, const char *);
@@ -304,6 +410,7 @@ class ControlSocket : public Element { public:
     void initialize_connection(int fd);
 
     String proxied_handler_name(const String &) const;
+    const Handler *find_handler(const String &, Element **, int &code, Vector<String> &messages);
     const Handler* parse_handler(connection &conn, const String &, Element **);
     int read_command(connection &conn, const String &, String);
     int write_command(connection &conn, const String &, String);
@@ -311,6 +418,15 @@ class ControlSocket : public Element { public:
     int llrpc_command(connection &conn, const String &, String);
     int parse_command(connection &conn, const String &);
 
+    void bind_handler(bound_handler &bh, const String &name);
+    void binary_read(StringAccum &sa, const bound_handler &bh, const String &param, bool typed);
+    void binary_write(StringAccum &sa, const String &hname, const String &data);
+    void binary_subscribe(connection &conn, StringAccum &sa, uint32_t tag, uint32_t interval, uint8_t flags, const Vector<String> &args);
+    bool remove_subscription(connection &conn, uint32_t tag);
+    int parse_binary_frame(connection &conn, const char *frame, uint32_t len);
+    void parse_binary(connection &conn);
+    static void subscription_hook(Timer *, void *);
+
     static ErrorHandler *proxy_error_function(const String &, void *);
 
 };
@@ -0,0 +1,340 @@
+// -*- c-basic-offset: 4; related-file-name: "dpdkipfilter.hh" -*-
+/*
+ * dpdkipfilter.{cc,hh} -- IPFilter with rules offloaded to a DPDK device
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "dpdkipfilter.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packet_anno.hh>
+#include <click/straccum.hh>
+#if RTE_VERSION >= RTE_VERSION_NUM(17,02,0,0)
+# include <rte_flow.h>
+# define HAVE_RTE_FLOW 1
+#endif
+CLICK_DECLS
+
+DPDKIPFilter::DPDKIPFilter()
+    : _dev(0), _anno(AGGREGATE_ANNO_OFFSET), _noffloaded(0), _offload(true)
+{
+}
+
+DPDKIPFilter::~DPDKIPFilter()
+{
+}
+
+int
+DPDKIPFilter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    if (Args(this, errh).bind(conf)
+	.read_mp("PORT", _dev)
+	.read("ANNO", AnnoArg(4), _anno)
+	.read("OFFLOAD", _offload)
+	.consume() < 0)
+	return -1;
+
+    // Strip "queue Q" prefixes before handing the rules to IPFilter
+    _rules.clear();
+    for (int i = 0; i < conf.size(); ++i) {
+	Rule r;
+	r.queue = -1;
+	r.flow = 0;
+	r.text = cp_unquote(conf[i]);
+	String rest = r.text;
+	if (cp_shift_spacevec(rest) == "queue") {
+	    if (!IntArg().parse(cp_shift_spacevec(rest), r.queue) || r.queue < 0)
+		return errh->error("pattern %d: bad queue number", i);
+	    conf[i] = rest;
+	} else
+	    rest = r.text;
+	String action = cp_shift_spacevec(rest);
+	r.pattern = rest;
+	if (action == "allow")
+	    r.output = 0;
+	else if (!IntArg().parse(action, r.output))
+	    r.output = -1;
+	_rules.push_back(r);
+    }
+
+    if (IPFilter::configure(conf, errh) < 0)
+	return -1;
+    return _dev->set_rx_mark_anno(_anno, errh);
+}
+
+#if HAVE_RTE_FLOW
+namespace {
+
+// The part of a pattern that rte_flow can express.
+struct FlowSpec {
+    int proto;
+    IPAddress src, src_mask, dst, dst_mask;
+    int sport, dport;
+
+    FlowSpec()
+	: proto(-1), sport(-1), dport(-1) {
+    }
+
+    bool parse(const String &text, const Element *context);
+};
+
+bool
+FlowSpec::parse(const String &text, const Element *context)
+{
+    Vector<String> words;
+    cp_spacevec(text, words);
+    for (int i = 0; i < words.size(); ++i) {
+	const String &w = words[i];
+	String next = (i + 1 < words.size() ? words[i + 1] : String());
+	if (w == "and" || w == "&&" || w == "-" || w == "all" || w == "true")
+	    continue;
+	else if (w == "ip")
+	    continue;
+	else if (w == "tcp" || w == "udp" || w == "icmp" || w == "proto") {
+	    int p;
+	    if (w == "proto") {
+		++i;
+		if (next == "tcp" || next == "udp" || next == "icmp")
+		    p = (next == "tcp" ? IP_PROTO_TCP : next == "udp" ? IP_PROTO_UDP : IP_PROTO_ICMP);
+		else if (!IntArg().parse(next, p) || p < 0 || p > 255)
+		    return false;
+	    } else {
+		p = (w == "tcp" ? IP_PROTO_TCP : w == "udp" ? IP_PROTO_UDP : IP_PROTO_ICMP);
+		// "tcp opt syn", "icmp type echo", "tcp port 80", ...
+		if (next && next != "and" && next != "&&" && next != "src" && next != "dst")
+		    return false;
+	    }
+	    if (proto >= 0 && proto != p)
+		return false;
+	    proto = p;
+	} else if (w == "src" || w == "dst") {
+	    bool is_src = (w == "src");
+	    IPAddress a, m;
+	    i += 2;
+	    if (next == "port") {
+		int &port = (is_src ? sport : dport);
+		if (i >= words.size() || port >= 0
+		    || !IntArg().parse(words[i], port) || port < 0 || port > 65535)
+		    return false;
+		continue;
+	    } else if (next == "host") {
+		if (i >= words.size()
+		    || !IPAddressArg().parse(words[i], a, ArgContext(context)))
+		    return false;
+		m = IPAddress(0xFFFFFFFFU);
+	    } else if (next == "net") {
+		if (i >= words.size()
+		    || !IPPrefixArg().parse(words[i], a, m, ArgContext(context)))
+		    return false;
+	    } else {
+		--i;
+		if (!IPPrefixArg(true).parse(next, a, m, ArgContext(context)))
+		    return false;
+	    }
+	    IPAddress &addr = (is_src ? src : dst);
+	    IPAddress &mask = (is_src ? src_mask : dst_mask);
+	    if (mask)
+		return false;
+	    addr = a & m;
+	    mask = m;
+	} else
+	    return false;
+    }
+    // a port alone means "tcp or udp", which one flow cannot express
+    if ((sport >= 0 || dport >= 0) && proto != IP_PROTO_TCP && proto != IP_PROTO_UDP)
+	return false;
+    return true;
+}
+
+}
+#endif
+
+int
+DPDKIPFilter::offload(int i, ErrorHandler *errh)
+{
+#if HAVE_RTE_FLOW
+    Rule &r = _rules[i];
+    FlowSpec fs;
+    if (!fs.parse(r.pattern, this))
+	return -1;
+
+    struct rte_flow_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.ingress = 1;
+    attr.priority = i;
+
+    struct rte_flow_item pattern[4];
+    struct rte_flow_item_ipv4 ip_spec, ip_mask;
+    struct rte_flow_item_tcp tcp_spec, tcp_mask;
+    struct rte_flow_item_udp udp_spec, udp_mask;
+    memset(pattern, 0, sizeof(pattern));
+    memset(&ip_spec, 0, sizeof(ip_spec));
+    memset(&ip_mask, 0, sizeof(ip_mask));
+    int n = 0;
+    pattern[n++].type = RTE_FLOW_ITEM_TYPE_ETH;
+    pattern[n].type = RTE_FLOW_ITEM_TYPE_IPV4;
+    ip_spec.hdr.src_addr = fs.src.addr();
+    ip_mask.hdr.src_addr = fs.src_mask.addr();
+    ip_spec.hdr.dst_addr = fs.dst.addr();
+    ip_mask.hdr.dst_addr = fs.dst_mask.addr();
+    if (fs.proto >= 0) {
+	ip_spec.hdr.next_proto_id = fs.proto;
+	ip_mask.hdr.next_proto_id = 0xFF;
+    }
+    pattern[n].spec = &ip_spec;
+    pattern[n++].mask = &ip_mask;
+    if (fs.proto == IP_PROTO_TCP) {
+	memset(&tcp_spec, 0, sizeof(tcp_spec));
+	memset(&tcp_mask, 0, sizeof(tcp_mask));
+	if (fs.sport >= 0) {
+	    tcp_spec.hdr.src_port = htons(fs.sport);
+	    tcp_mask.hdr.src_port = 0xFFFF;
+	}
+	if (fs.dport >= 0) {
+	    tcp_spec.hdr.dst_port = htons(fs.dport);
+	    tcp_mask.hdr.dst_port = 0xFFFF;
+	}
+	pattern[n].type = RTE_FLOW_ITEM_TYPE_TCP;
+	pattern[n].spec = &tcp_spec;
+	pattern[n++].mask = &tcp_mask;
+    } else if (fs.proto == IP_PROTO_UDP) {
+	memset(&udp_spec, 0, sizeof(udp_spec));
+	memset(&udp_mask, 0, sizeof(udp_mask));
+	if (fs.sport >= 0) {
+	    udp_spec.hdr.src_port = htons(fs.sport);
+	    udp_mask.hdr.src_port = 0xFFFF;
+	}
+	if (fs.dport >= 0) {
+	    udp_spec.hdr.dst_port = htons(fs.dport);
+	    udp_mask.hdr.dst_port = 0xFFFF;
+	}
+	pattern[n].type = RTE_FLOW_ITEM_TYPE_UDP;
+	pattern[n].spec = &udp_spec;
+	pattern[n++].mask = &udp_mask;
+    }
+    pattern[n].type = RTE_FLOW_ITEM_TYPE_END;
+
+    // Marks are rule numbers plus one, so that 0 means "not marked"
+    struct rte_flow_action actions[3];
+    struct rte_flow_action_mark mark;
+    struct rte_flow_action_queue queue;
+    memset(actions, 0, sizeof(actions));
+    n = 0;
+    if (r.output < 0)
+	actions[n++].type = RTE_FLOW_ACTION_TYPE_DROP;
+    else {
+	mark.id = i + 1;
+	actions[n].type = RTE_FLOW_ACTION_TYPE_MARK;
+	actions[n++].conf = &mark;
+	if (r.queue >= 0) {
+	    queue.index = r.queue;
+	    actions[n].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+	    actions[n++].conf = &queue;
+	}
+    }
+    actions[n].type = RTE_FLOW_ACTION_TYPE_END;
+
+    struct rte_flow_error error;
+    if (rte_flow_validate(_dev->port_id, &attr, pattern, actions, &error) != 0)
+	return -1;
+    if (!(r.flow = rte_flow_create(_dev->port_id, &attr, pattern, actions, &error))) {
+	errh->warning("pattern %d: %s, matching it in software", i,
+		      error.message ? error.message : "cannot create flow");
+	return -1;
+    }
+    return 0;
+#else
+    (void) i, (void) errh;
+    return -1;
+#endif
+}
+
+int
+DPDKIPFilter::initialize(ErrorHandler *errh)
+{
+    if (DPDKDevice::initialize(errh) < 0)
+	return -1;
+    if (_offload)
+	while (_noffloaded < _rules.size() && offload(_noffloaded, errh) == 0)
+	    ++_noffloaded;
+    return 0;
+}
+
+void
+DPDKIPFilter::cleanup(CleanupStage)
+{
+#if HAVE_RTE_FLOW
+    for (int i = 0; i < _noffloaded; ++i)
+	if (_rules[i].flow) {
+	    struct rte_flow_error error;
+	    rte_flow_destroy(_dev->port_id, _rules[i].flow, &error);
+	    _rules[i].flow = 0;
+	}
+#endif
+    _noffloaded = 0;
+}
+
+void
+DPDKIPFilter::push(int port, Packet *p)
+{
+    // FromDPDKDevice stores 0 for packets the device did not mark
+    uint32_t mark = _noffloaded ? p->anno_u32(_anno) : 0;
+    if (mark && mark <= (uint32_t) _noffloaded) {
+	int out = _rules[mark - 1].output;
+	if ((unsigned) out < (unsigned) noutputs()) {
+	    ++*_hw_matches;
+	    output(out).push(p);
+	    return;
+	}
+    }
+    IPFilter::push(port, p);
+}
+
+String
+DPDKIPFilter::read_handler(Element *e, void *thunk)
+{
+    DPDKIPFilter *f = static_cast<DPDKIPFilter *>(e);
+    switch (reinterpret_cast<intptr_t>(thunk)) {
+    case h_offloaded:
+	return String(f->_noffloaded);
+    case h_rules: {
+	StringAccum sa;
+	for (int i = 0; i < f->_rules.size(); ++i)
+	    sa << i << (i < f->_noffloaded ? " hw " : " sw ")
+	       << f->_rules[i].text << '\n';
+	return sa.take_string();
+    }
+    case h_hw_matches: {
+	click_uint_large_t n = 0;
+	for (unsigned i = 0; i < f->_hw_matches.size(); ++i)
+	    n += f->_hw_matches[i];
+	return String(n);
+    }
+    default:
+	return String();
+    }
+}
+
+void
+DPDKIPFilter::add_handlers()
+{
+    IPFilter::add_handlers();
+    add_read_handler("offloaded", read_handler, h_offloaded);
+    add_read_handler("rules", read_handler, h_rules);
+    add_read_handler("hw_matches", read_handler, h_hw_matches);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel dpdk IPFilter)
+EXPORT_ELEMENT(DPDKIPFilter)
+ELEMENT_MT_SAFE(DPDKIPFilter)
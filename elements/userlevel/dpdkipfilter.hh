@@ -0,0 +1,162 @@
+#ifndef CLICK_DPDKIPFILTER_HH
+#define CLICK_DPDKIPFILTER_HH
+#include "elements/ip/ipfilter.hh"
+#include <click/dpdkdevice.hh>
+#include <click/perthread.hh>
+CLICK_DECLS
+struct rte_flow;
+
+/*
+=title DPDKIPFilter
+
+=c
+
+DPDKIPFilter(PORT, ACTION_1 PATTERN_1, ..., ACTION_N PATTERN_N [, I<keywords> ANNO, OFFLOAD])
+
+=s ip
+
+IPFilter with rules offloaded to a DPDK device
+
+=d
+
+Filters IP packets like IPFilter, but also installs as many of its rules as
+possible in the network device with DPDK port identifier PORT, using DPDK's
+generic flow API (rte_flow).  The device then matches those rules in hardware
+and tags each matching packet with a flow mark, which FromDPDKDevice stores in
+the ANNO annotation.  DPDKIPFilter sends a marked packet straight to its
+rule's output, and classifies every other packet in software with the
+complete IPFilter program.
+
+Patterns use IPFilter's syntax; any pattern IPFilter accepts works, but only
+the following subset can be offloaded:
+
+=over 3
+
+=item *
+
+"ip", "tcp", "udp", "icmp", "ip proto P", "-", "all", and "true";
+
+=item *
+
+"src host A", "dst host A", "src A", "dst A", "src net A/L", and "dst net A/L";
+
+=item *
+
+"src port N" and "dst port N", after "tcp" or "udp";
+
+=item *
+
+any conjunction of these with "and" or "&&".
+
+=back
+
+Rules are offloaded in order, with decreasing priority, and offloading stops
+at the first rule that cannot be offloaded or that the device rejects.  Later
+rules are matched in software only, so the first rule matching a packet
+always determines its fate, exactly as with IPFilter.  Offloaded "deny" and
+"drop" rules drop packets in the device.
+
+An ACTION can be preceded by "queue Q", as in "queue 2 allow tcp dst port
+80".  If that rule is offloaded, the device steers its packets to RX queue Q,
+which a FromDPDKDevice must read.  Queue steering has no effect on rules
+matched in software.
+
+This element is only available at user level, when compiled with DPDK
+support.  Devices without rte_flow support, such as the net_null and net_ring
+software devices, reject every rule, so DPDKIPFilter then behaves exactly
+like IPFilter.
+
+Keyword arguments are:
+
+=over 8
+
+=item ANNO
+
+Annotation name or offset.  The 4-byte annotation holding the flow mark.
+Every FromDPDKDevice on PORT stores marks there.  Default is the AGGREGATE
+annotation, bytes 20-23.  Elements between FromDPDKDevice and DPDKIPFilter
+must not modify it.
+
+=item OFFLOAD
+
+Boolean.  If false, do not install any rule in the device.  Default is true.
+
+=back
+
+=h offloaded read-only
+
+Returns the number of rules installed in the device.
+
+=h rules read-only
+
+Returns one line per rule: its number, "hw" or "sw" depending on where it is
+matched, and its text.
+
+=h hw_matches read-only
+
+Returns the number of packets classified by the device.
+
+=h drops read-only
+
+Returns the number of packets dropped in software.  Packets dropped by the
+device are not counted.
+
+=h program read-only
+
+Returns the software classification program, as for IPFilter.
+
+=e
+
+  FromDPDKDevice(0, N_QUEUES 2)
+    -> Strip(14) -> CheckIPHeader
+    -> f :: DPDKIPFilter(0, queue 1 allow tcp dst port 22,
+                         deny udp,
+                         allow src net 10.0.0.0/8 && tcp,
+                         deny all)
+    -> ...
+
+=a IPFilter, FromDPDKDevice */
+
+class DPDKIPFilter : public IPFilter { public:
+
+    DPDKIPFilter() CLICK_COLD;
+    ~DPDKIPFilter() CLICK_COLD;
+
+    const char *class_name() const		{ return "DPDKIPFilter"; }
+    // Before FromDPDKDevice, which needs to know the mark annotation
+    int configure_phase() const		{ return CONFIGURE_PHASE_PRIVILEGED - 6; }
+    bool can_live_reconfigure() const		{ return false; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int port, Packet *);
+
+  private:
+
+    struct Rule {
+	String text;
+	String pattern;
+	int output;		// < 0: drop
+	int queue;		// < 0: no steering
+	rte_flow *flow;
+    };
+
+    DPDKDevice *_dev;
+    Vector<Rule> _rules;
+    int _anno;
+    int _noffloaded;
+    bool _offload;
+    PerThread<click_uint_large_t> _hw_matches;
+
+    int offload(int i, ErrorHandler *errh);
+
+    enum { h_offloaded, h_rules, h_hw_matches };
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -22,6 +22,7 @@
 
 #include <click/args.hh>
 #include <click/error.hh>
+#include <click/master.hh>
 #include <click/standard/scheduleinfo.hh>
 #include <click/straccum.hh>
 
@@ -31,13 +32,14 @@ CLICK_DECLS
 
 FromDPDKDevice::FromDPDKDevice() :
     _dev(0), _queue_id(0), _promisc(true),
-    _count(0), _active(true), _task(this)
+    _active(true), _queues(0), _nqueues(0), _mark_anno(-1), _task(this)
 {
     _burst_size = DPDKDevice::DEF_BURST_SIZE;
 }
 
 FromDPDKDevice::~FromDPDKDevice()
 {
+    delete[] _queues;
 }
 
 int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
@@ -49,6 +51,12 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     uint16_t mtu = 0;
     bool has_mac = false;
     bool has_mtu = false;
+    int n_queues = 0;
+    String threads;
+    uint64_t rss_hf = 0;
+    bool has_rss = false;
+    int mark_anno;
+    bool has_mark_anno = false;
 
     if (Args(conf, this, errh)
         .read_mp("PORT", dev)
@@ -60,9 +68,25 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
         .read("MTU", mtu).read_status(has_mtu)
         .read("ALLOW_NONEXISTENT", allow_nonexistent)
         .read("ACTIVE", _active)
+        .read("N_QUEUES", n_queues)
+        .read("THREADS", AnyArg(), threads)
+        .read("RSS", DPDKRSSArg(), rss_hf).read_status(has_rss)
+        .read("MARK_ANNO", AnnoArg(4), mark_anno).read_status(has_mark_anno)
         .complete() < 0)
         return -1;
 
+    _threads.clear();
+    Vector<String> words;
+    cp_spacevec(threads, words);
+    for (String *it = words.begin(); it != words.end(); ++it) {
+        int t;
+        if (!IntArg().parse(*it, t) || t < 0)
+            return errh->error("THREADS should be a list of thread numbers");
+        _threads.push_back(t);
+    }
+    if (n_queues <= 0)
+        n_queues = _threads.size() ? _threads.size() : 1;
+
     if (!DPDKDeviceArg::parse(dev, _dev)) {
         if (allow_nonexistent)
             return 0;
@@ -76,9 +100,35 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     if (has_mtu)
         _dev->set_init_mtu(mtu);
 
-    return _dev->add_rx_queue(_queue_id, _promisc, (n_desc > 0) ?
-                                n_desc : DPDKDevice::DEF_DEV_RXDESC,
-                                errh);
+    if (has_rss && _dev->set_rx_rss(rss_hf, errh) < 0)
+        return -1;
+
+    if (has_mark_anno && _dev->set_rx_mark_anno(mark_anno, errh) < 0)
+        return -1;
+
+    if (noutputs() > 1 && noutputs() != n_queues)
+        return errh->error("have %d outputs, need 1 or N_QUEUES (%d)",
+                           noutputs(), n_queues);
+
+    delete[] _queues;
+    _queues = new RXQueue[n_queues];
+    _nqueues = n_queues;
+    for (int i = 0; i < _nqueues; ++i) {
+        RXQueue &q = _queues[i];
+        q.fd = this;
+        // Given a first QUEUE, use consecutive queues; otherwise take the
+        // first free ones
+        q.queue_id = _queue_id ? _queue_id + i : 0;
+        q.port = noutputs() > 1 ? i : 0;
+        q.count = 0;
+        q.task = (i == 0 ? &_task : 0);
+        if (_dev->add_rx_queue(q.queue_id, _promisc, (n_desc > 0) ?
+                               n_desc : DPDKDevice::DEF_DEV_RXDESC,
+                               errh) < 0)
+            return -1;
+    }
+    _queue_id = _queues[0].queue_id;
+    return 0;
 }
 
 int FromDPDKDevice::initialize(ErrorHandler *errh)
@@ -86,20 +136,56 @@ int FromDPDKDevice::initialize(ErrorHandler *errh)
     if (!_dev)
         return 0;
 
-    ScheduleInfo::initialize_task(this, &_task, true, errh);
+    // Elements such as DPDKIPFilter ask for flow marks in configure(); every
+    // configure() has run by now.  Unmarked packets get a 0 mark.
+    _mark_anno = _dev->rx_mark_anno();
+
+    if (_nqueues == 1) {
+        ScheduleInfo::initialize_task(this, &_task, _active, errh);
+        return DPDKDevice::initialize(errh);
+    }
+
+    int nthreads = master()->nthreads();
+    int home = router()->home_thread_id(this);
+    if (home < 0)
+        home = 0;
+    if (_nqueues > nthreads && !_threads.size())
+        errh->warning("%d queues but only %d threads, some threads will poll several queues",
+                      _nqueues, nthreads);
+    for (int i = 0; i < _nqueues; ++i) {
+        RXQueue &q = _queues[i];
+        if (!q.task)
+            q.task = new Task(run_queue_task, &q);
+        q.task->initialize(this, _active);
+        int thread = _threads.size() ? _threads[i % _threads.size()]
+            : home + i;
+        q.task->move_thread(thread % nthreads);
+    }
 
     return DPDKDevice::initialize(errh);
 }
 
 void FromDPDKDevice::cleanup(CleanupStage)
 {
+    for (int i = 1; i < _nqueues; ++i) {
+        delete _queues[i].task;
+        _queues[i].task = 0;
+    }
+}
+
+unsigned long FromDPDKDevice::count() const
+{
+    unsigned long n = 0;
+    for (int i = 0; i < _nqueues; ++i)
+        n += _queues[i].count;
+    return n;
 }
 
-bool FromDPDKDevice::run_task(Task * t)
+inline bool FromDPDKDevice::run_queue(RXQueue &q)
 {
     struct rte_mbuf *pkts[_burst_size];
 
-    unsigned n = rte_eth_rx_burst(_dev->port_id, _queue_id, pkts, _burst_size);
+    unsigned n = rte_eth_rx_burst(_dev->port_id, q.queue_id, pkts, _burst_size);
     for (unsigned i = 0; i < n; ++i) {
         unsigned char* data = rte_pktmbuf_mtod(pkts[i], unsigned char *);
         rte_prefetch0(data);
@@ -111,25 +197,38 @@ bool FromDPDKDevice::run_task(Task * t)
                          rte_pktmbuf_tailroom(pkts[i]));
         p->set_packet_type_anno(Packet::HOST);
         p->set_mac_header(data);
+        if (_mark_anno >= 0)
+            p->set_anno_u32(_mark_anno, DPDKDevice::flow_mark(pkts[i]));
 
-        output(0).push(p);
+        output(q.port).push(p);
     }
-    _count += n;
+    q.count += n;
 
     /* We reschedule directly, as we cannot know if there is actually packet
      * available and DPDK has no select mechanism*/
-    t->fast_reschedule();
+    q.task->fast_reschedule();
 
     return n;
 }
 
+bool FromDPDKDevice::run_task(Task *)
+{
+    return run_queue(_queues[0]);
+}
+
+bool FromDPDKDevice::run_queue_task(Task *, void *thunk)
+{
+    RXQueue *q = static_cast<RXQueue *>(thunk);
+    return q->fd->run_queue(*q);
+}
+
 String FromDPDKDevice::read_handler(Element *e, void * thunk)
 {
     FromDPDKDevice *fd = static_cast<FromDPDKDevice *>(e);
 
     switch((uintptr_t) thunk) {
         case h_count:
-            return String(fd->_count);
+            return String(fd->count());
         case h_active:
               if (!fd->_dev)
                   return "false";
@@ -240,15 +339,17 @@ int FromDPDKDevice::write_handler(
                 return errh->error("Not a valid boolean");
             if (fd->_active != active) {
                 fd->_active = active;
-                if (fd->_active)
-                    fd->_task.reschedule();
-                else
-                    fd->_task.unschedule();
+                for (int i = 0; i < fd->_nqueues; ++i)
+                    if (fd->_active)
+                        fd->_queues[i].task->reschedule();
+                    else
+                        fd->_queues[i].task->unschedule();
             }
             return 0;
         }
         case h_reset_count:
-            fd->_count = 0;
+            for (int i = 0; i < fd->_nqueues; ++i)
+                fd->_queues[i].count = 0;
             return 0;
     }
     return -1;
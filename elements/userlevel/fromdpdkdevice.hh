@@ -13,7 +13,7 @@ CLICK_DECLS
 
 =c
 
-FromDPDKDevice(PORT [, QUEUE [, I<keywords> PROMISC, BURST, NDESC]])
+FromDPDKDevice(PORT [, QUEUE [, I<keywords> PROMISC, BURST, NDESC, N_QUEUES, THREADS, RSS, MARK_ANNO]])
 
 =s netdevices
 
@@ -34,6 +34,15 @@ FromDPDKDevice will open a different RX queue attached to the same port,
 and packets will be dispatched among the FromDPDKDevice elements that
 you can pin to different thread using StaticThreadSched.
 
+Alternatively, a single FromDPDKDevice can read N_QUEUES queues itself.  It
+then runs one task per queue, each on a different thread: by default, the
+element's home thread and the threads after it, or the threads listed in
+THREADS.  The device's RSS redirection table is spread evenly over all its
+RX queues.  If the element has N_QUEUES outputs, packets from queue I<i>
+leave on output I<i>, so that each thread can run its own copy of the
+downstream path; otherwise, all packets leave on output 0, and elements
+downstream run on all of the threads.
+
 Arguments:
 
 =over 9
@@ -48,6 +57,29 @@ format fffff:ff:ff.f
 Integer.  Index of the queue to use. If omitted or negative, auto-increment
 between FromDPDKDevice attached to the same port will be used.
 
+=item N_QUEUES
+
+Integer.  Number of RX queues, and tasks, to use.  With N_QUEUES, QUEUE is
+the first of N_QUEUES consecutive queues.  Defaults to the number of THREADS
+if given, or 1.
+
+=item THREADS
+
+Space-separated list of thread numbers.  Task I<i> runs on the I<i>th
+listed thread, modulo the list's length.
+
+=item RSS
+
+Space-separated list of header fields hashed to select a queue, among
+"ip", "ipv4", "ipv6", "udp", "tcp", "sctp", and "l2".  The default is
+"ip udp tcp".  Fields the device does not support are ignored.
+
+=item MARK_ANNO
+
+Annotation name or offset.  If given, store each packet's rte_flow MARK in
+this 4-byte annotation, or 0 if the device did not mark the packet.  A
+DPDKIPFilter on the same PORT sets this automatically.
+
 =item PROMISC
 
 Boolean.  FromDPDKDevice puts the device in promiscuous mode if PROMISC is
@@ -88,6 +120,13 @@ support.
 
   FromDPDKDevice(3, QUEUE 1) -> ...
 
+  // four queues on threads 0-3, with a per-thread path for each queue
+  fd :: FromDPDKDevice(0, N_QUEUES 4);
+  td :: ToDPDKDevice(1, N_QUEUES 4);
+  fd[0] -> c0 :: Counter -> td;
+  fd[1] -> c1 :: Counter -> td;
+  ...
+
 =h count read-only
 
 Returns the number of packets processed by this FromDPDKDevice
@@ -169,7 +208,7 @@ the BURST parameter, this value is not checked. Eg each device generally have
 a minimal and a maximal value for BURST. A value between 4 and 256 is safe.
 
 
-=a DPDKInfo, ToDPDKDevice */
+=a DPDKInfo, ToDPDKDevice, DPDKIPFilter */
 
 class FromDPDKDevice : public Element {
 public:
@@ -178,7 +217,7 @@ public:
     ~FromDPDKDevice() CLICK_COLD;
 
     const char *class_name() const { return "FromDPDKDevice"; }
-    const char *port_count() const { return PORTS_0_1; }
+    const char *port_count() const { return "0/1-"; }
     const char *processing() const { return PUSH; }
     int configure_phase() const {
         return CONFIGURE_PHASE_PRIVILEGED - 5;
@@ -211,14 +250,29 @@ private:
         h_device,
     };
 
+    struct RXQueue {
+        FromDPDKDevice *fd;
+        unsigned queue_id;
+        int port;
+        unsigned long count;
+        Task *task;
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
     DPDKDevice* _dev;
     unsigned _queue_id;
     bool _promisc;
     unsigned int _burst_size;
-    unsigned long _count;
     bool _active;
+    RXQueue *_queues;
+    int _nqueues;
+    Vector<int> _threads;
+    int _mark_anno;
 
     Task _task;
+
+    inline bool run_queue(RXQueue &q);
+    static bool run_queue_task(Task *, void *);
+    unsigned long count() const;
 };
 
 CLICK_ENDDECLS
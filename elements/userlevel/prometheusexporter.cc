@@ -0,0 +1,354 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * prometheusexporter.{cc,hh} -- element serves statistics in OpenMetrics
+ * format
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "prometheusexporter.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/handler.hh>
+#include <click/hashtable.hh>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+CLICK_DECLS
+
+#define PROMETHEUS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+enum { max_request = 8192 };
+
+PrometheusExporter::PrometheusExporter()
+    : _socket_fd(-1), _scanned(false)
+{
+}
+
+PrometheusExporter::~PrometheusExporter()
+{
+}
+
+int
+PrometheusExporter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _localhost = false;
+    _cache = Timestamp(1);
+    if (Args(conf, this, errh)
+	.read_mp("PORT", IPPortArg(IP_PROTO_TCP), _port)
+	.read("LOCALHOST", _localhost)
+	.read("CACHE", _cache)
+	.complete() < 0)
+	return -1;
+    return 0;
+}
+
+int
+PrometheusExporter::initialize(ErrorHandler *errh)
+{
+    _socket_fd = socket(PF_INET, SOCK_STREAM, 0);
+    if (_socket_fd < 0)
+	return errh->error("socket: %s", strerror(errno));
+    int sockopt = 1;
+    if (setsockopt(_socket_fd, SOL_SOCKET, SO_REUSEADDR, (void *)&sockopt, sizeof(sockopt)) < 0)
+	errh->warning("setsockopt: %s", strerror(errno));
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(_port);
+    sa.sin_addr.s_addr = htonl(_localhost ? INADDR_LOOPBACK : INADDR_ANY);
+    if (bind(_socket_fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+	return errh->error("bind: %s", strerror(errno));
+    if (listen(_socket_fd, 8) < 0)
+	return errh->error("listen: %s", strerror(errno));
+    socklen_t sa_len = sizeof(sa);
+    if (_port == 0 && getsockname(_socket_fd, (struct sockaddr *)&sa, &sa_len) == 0)
+	_port = ntohs(sa.sin_port);
+
+    fcntl(_socket_fd, F_SETFL, O_NONBLOCK);
+    fcntl(_socket_fd, F_SETFD, FD_CLOEXEC);
+    add_select(_socket_fd, SELECT_READ);
+    return 0;
+}
+
+void
+PrometheusExporter::cleanup(CleanupStage)
+{
+    for (connection **it = _conns.begin(); it != _conns.end(); ++it)
+	if (*it) {
+	    close((*it)->fd);
+	    delete *it;
+	}
+    _conns.clear();
+    if (_socket_fd >= 0)
+	close(_socket_fd);
+    _socket_fd = -1;
+}
+
+static String
+metric_name(const String &hname)
+{
+    StringAccum sa;
+    sa << "click_";
+    for (const char *s = hname.begin(); s != hname.end(); ++s)
+	if (isalnum((unsigned char) *s) || *s == '_')
+	    sa << *s;
+	else
+	    sa << '_';
+    return sa.take_string();
+}
+
+void
+PrometheusExporter::scan()
+{
+    // OpenMetrics wants each family's samples together, so group handlers
+    // by family once, when the first scrape arrives; by then every element
+    // has added its handlers
+    HashTable<String, int> family_map(-1);
+    Vector<int> hindexes;
+    for (int i = 0; i < router()->nelements(); ++i) {
+	Element *e = router()->element(i);
+	hindexes.clear();
+	Router::element_hindexes(e, hindexes);
+	for (int *hp = hindexes.begin(); hp != hindexes.end(); ++hp) {
+	    const Handler *h = Router::handler(router(), *hp);
+	    if (!h || !h->read_visible()
+		|| !(h->flags() & (Handler::f_counter | Handler::f_gauge)))
+		continue;
+	    bool counter = h->flags() & Handler::f_counter;
+	    String name = metric_name(h->name());
+	    int *fp = &family_map[name];
+	    if (*fp >= 0 && _families[*fp].counter != counter) {
+		// the same handler name means different things in different
+		// classes
+		name += (counter ? "_counter" : "_gauge");
+		fp = &family_map[name];
+	    }
+	    if (*fp < 0) {
+		*fp = _families.size();
+		_families.push_back(family());
+		_families.back().name = name;
+		_families.back().help = "Click " + h->name() + " handler";
+		_families.back().counter = counter;
+	    }
+	    metric m;
+	    m.e = e;
+	    m.h = h;
+	    m.family = *fp;
+	    _metrics.push_back(m);
+	}
+    }
+
+    // stable counting sort by family
+    Vector<int> start(_families.size() + 1, 0);
+    for (metric *it = _metrics.begin(); it != _metrics.end(); ++it)
+	++start[it->family + 1];
+    for (int f = 0; f < _families.size(); ++f)
+	start[f + 1] += start[f];
+    Vector<metric> sorted(_metrics.size(), metric());
+    for (metric *it = _metrics.begin(); it != _metrics.end(); ++it)
+	sorted[start[it->family]++] = *it;
+    _metrics.swap(sorted);
+    _scanned = true;
+}
+
+static void
+append_label(StringAccum &sa, const String &value)
+{
+    for (const char *s = value.begin(); s != value.end(); ++s)
+	if (*s == '\\' || *s == '\"')
+	    sa << '\\' << *s;
+	else if (*s == '\n')
+	    sa << "\\n";
+	else
+	    sa << *s;
+}
+
+String
+PrometheusExporter::render()
+{
+    if (!_scanned)
+	scan();
+    StringAccum sa;
+    int family = -1;
+    for (metric *it = _metrics.begin(); it != _metrics.end(); ++it) {
+	const struct family &f = _families[it->family];
+	if (it->family != family) {
+	    family = it->family;
+	    sa << "# TYPE " << f.name << (f.counter ? " counter\n" : " gauge\n")
+	       << "# HELP " << f.name << ' ' << f.help << '\n';
+	}
+	String value = it->h->call_read(it->e).trim_space();
+	int64_t i;
+	uint64_t u;
+	double d;
+	if (!IntArg(10).parse(value, i) && !IntArg(10).parse(value, u)
+	    && !DoubleArg().parse(value, d))
+	    continue;
+	sa << f.name << (f.counter ? "_total{element=\"" : "{element=\"");
+	append_label(sa, it->e->name());
+	sa << "\",class=\"";
+	append_label(sa, it->e->class_name());
+	sa << "\"} " << value << '\n';
+    }
+    sa << "# EOF\n";
+    return sa.take_string();
+}
+
+String
+PrometheusExporter::metrics()
+{
+    Timestamp now = Timestamp::now_steady();
+    if (!_rendered || now >= _rendered_at + _cache) {
+	_rendered = render();
+	_rendered_at = now;
+    }
+    return _rendered;
+}
+
+void
+PrometheusExporter::accept_connection()
+{
+    int fd = accept(_socket_fd, 0, 0);
+    if (fd < 0) {
+	if (errno != EAGAIN && errno != EINTR)
+	    click_chatter("%s: accept: %s", declaration().c_str(), strerror(errno));
+	return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if (fd >= _conns.size())
+	_conns.resize(fd + 1, 0);
+    _conns[fd] = new connection(fd);
+    add_select(fd, SELECT_READ);
+}
+
+void
+PrometheusExporter::respond(connection *conn)
+{
+    // parse the request line; headers are ignored
+    String request = conn->in.take_string();
+    int sp1 = request.find_left(' ');
+    int sp2 = (sp1 < 0 ? -1 : request.find_left(' ', sp1 + 1));
+    String method, target;
+    if (sp2 > sp1) {
+	method = request.substring(0, sp1);
+	target = request.substring(sp1 + 1, sp2 - sp1 - 1);
+	int q = target.find_left('?');
+	if (q >= 0)
+	    target = target.substring(0, q);
+    }
+
+    String status, body, extra;
+    const char *type = "text/plain; charset=utf-8";
+    if (!method || !target.starts_with("/")) {
+	status = "400 Bad Request";
+	body = "Bad request\n";
+    } else if (method != "GET" && method != "HEAD") {
+	status = "405 Method Not Allowed";
+	body = "Method not allowed\n";
+	extra = "Allow: GET, HEAD\r\n";
+    } else if (target != "/metrics") {
+	status = "404 Not Found";
+	body = "Not found; try /metrics\n";
+    } else {
+	status = "200 OK";
+	body = metrics();
+	type = PROMETHEUS_CONTENT_TYPE;
+    }
+
+    StringAccum sa;
+    sa << "HTTP/1.0 " << status << "\r\n"
+       << "Content-Type: " << type << "\r\n" << extra
+       << "Content-Length: " << body.length() << "\r\n"
+       << "Connection: close\r\n\r\n";
+    if (method != "HEAD")
+	sa << body;
+    conn->out = sa.take_string();
+    conn->outpos = 0;
+    remove_select(conn->fd, SELECT_READ);
+    add_select(conn->fd, SELECT_WRITE);
+}
+
+void
+PrometheusExporter::close_connection(connection *conn)
+{
+    remove_select(conn->fd, SELECT_READ | SELECT_WRITE);
+    close(conn->fd);
+    _conns[conn->fd] = 0;
+    delete conn;
+}
+
+void
+PrometheusExporter::selected(int fd, int mask)
+{
+    if (fd == _socket_fd) {
+	accept_connection();
+	return;
+    }
+    if (fd >= _conns.size() || !_conns[fd])
+	return;
+    connection *conn = _conns[fd];
+
+    if ((mask & SELECT_READ) && !conn->out) {
+	char *buf = conn->in.reserve(2048);
+	ssize_t r = (buf ? read(fd, buf, 2048) : -1);
+	if (r > 0) {
+	    conn->in.adjust_length(r);
+	    const char *end = conn->in.end();
+	    for (const char *s = conn->in.begin(); s + 1 < end; ++s)
+		if (s[0] == '\n' && (s[1] == '\n'
+				     || (s[1] == '\r' && s + 2 < end && s[2] == '\n'))) {
+		    respond(conn);
+		    break;
+		}
+	    if (!conn->out && conn->in.length() > max_request)
+		close_connection(conn);
+	} else if (r == 0 || (errno != EAGAIN && errno != EINTR))
+	    close_connection(conn);
+	return;
+    }
+
+    if ((mask & SELECT_WRITE) && conn->out) {
+	ssize_t w = write(fd, conn->out.data() + conn->outpos,
+			  conn->out.length() - conn->outpos);
+	if (w > 0)
+	    conn->outpos += w;
+	if (conn->outpos == conn->out.length()
+	    || (w < 0 && errno != EAGAIN && errno != EINTR))
+	    close_connection(conn);
+    }
+}
+
+String
+PrometheusExporter::read_handler(Element *e, void *user_data)
+{
+    PrometheusExporter *pe = static_cast<PrometheusExporter *>(e);
+    if (user_data)
+	return String(pe->_port);
+    else
+	return pe->metrics();
+}
+
+void
+PrometheusExporter::add_handlers()
+{
+    add_read_handler("metrics", read_handler, 0, Handler::f_raw);
+    add_read_handler("port", read_handler, 1, Handler::f_calm);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(PrometheusExporter)
@@ -0,0 +1,144 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_PROMETHEUSEXPORTER_HH
+#define CLICK_PROMETHEUSEXPORTER_HH
+#include <click/element.hh>
+#include <click/straccum.hh>
+#include <click/timestamp.hh>
+CLICK_DECLS
+class Handler;
+
+/*
+=c
+
+PrometheusExporter(PORT [, I<keywords> LOCALHOST, CACHE])
+
+=s control
+
+serves router statistics to Prometheus
+
+=d
+
+Serves the router's statistics over HTTP in the OpenMetrics text format, so
+that Prometheus and compatible monitoring systems can scrape them.  A
+C<GET /metrics> request on TCP port PORT returns every read handler marked as
+a counter or a gauge, such as Counter's C<count> and Queue's C<length>.
+
+Each handler becomes a sample of the metric family
+C<click_I<handler>>, labeled with the element's name and class; counter
+families get the C<_total> suffix.  For example, the C<count> handler of
+C<c :: Counter> is exported as
+
+  click_count_total{element="c",class="Counter"} 1234
+
+Handlers whose current value is not a number are left out of that scrape.
+
+The rendered page is cached for CACHE, so frequent scrapes from several
+servers call each handler at most once per CACHE.
+
+PrometheusExporter handles connections on its home thread, and calls the
+exported handlers there.  Use StaticThreadSched to keep it away from
+forwarding threads.
+
+Keyword arguments are:
+
+=over 8
+
+=item LOCALHOST
+
+Boolean.  If true, accept connections only from the local host.  Default is
+false.
+
+=item CACHE
+
+Timestamp.  How long to reuse a rendered page.  Default is 1 second.
+
+=back
+
+Elements mark their handlers for export with the Handler::f_counter and
+Handler::f_gauge flags.  The C<handlers> handler shows these flags as C<C>
+and C<G>.
+
+=e
+
+  c :: Counter;
+  q :: Queue;
+  PrometheusExporter(9100, LOCALHOST true);
+  StaticThreadSched(q 0, c 0);
+
+=h metrics read-only
+
+Returns the page a scrape would return.
+
+=h port read-only
+
+Returns the TCP port.
+
+=a
+
+ControlSocket, ShmStats, StaticThreadSched */
+
+class PrometheusExporter : public Element { public:
+
+    PrometheusExporter() CLICK_COLD;
+    ~PrometheusExporter() CLICK_COLD;
+
+    const char *class_name() const	{ return "PrometheusExporter"; }
+
+    int configure_phase() const		{ return CONFIGURE_PHASE_INFO; }
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void selected(int fd, int mask);
+
+    /** @brief Return the current metrics page, rendering it if the cached
+     * page has expired. */
+    String metrics();
+
+  private:
+
+    struct metric {
+	Element *e;
+	const Handler *h;
+	int family;
+    };
+
+    struct family {
+	String name;
+	String help;
+	bool counter;
+    };
+
+    struct connection {
+	int fd;
+	StringAccum in;
+	String out;
+	int outpos;
+	connection(int fd_)
+	    : fd(fd_), outpos(0) {
+	}
+    };
+
+    int _socket_fd;
+    uint16_t _port;
+    bool _localhost;
+    bool _scanned;
+    Timestamp _cache;
+    Timestamp _rendered_at;
+    String _rendered;
+    Vector<family> _families;
+    Vector<metric> _metrics;
+    Vector<connection *> _conns;
+
+    void scan();
+    String render();
+    void accept_connection();
+    void respond(connection *conn);
+    void close_connection(connection *conn);
+    static String read_handler(Element *e, void *user_data);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,409 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * shmstats.{cc,hh} -- element exports statistics through shared memory
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "shmstats.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/handler.hh>
+#include <click/straccum.hh>
+#include <click/machine.hh>
+#include "elements/standard/counter.hh"
+#include "elements/standard/simplequeue.hh"
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+CLICK_DECLS
+
+namespace {
+
+const char shmstats_magic[8] = { '\177', 'C', 'l', 'k', 'S', 't', 'a', 't' };
+
+struct ShmStatsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t nrecords;
+    volatile uint32_t live;
+    uint32_t interval_ms;
+    uint64_t generation;
+    volatile uint64_t update_time;
+    uint32_t pid;
+    char padding[12];
+};
+
+struct ShmStatsRecord {
+    volatile uint32_t seq;
+    volatile uint8_t type;
+    uint8_t reserved[3];
+    uint32_t name;
+    uint32_t class_name;
+    volatile uint64_t value;
+    volatile uint64_t time;
+};
+
+// Direct samplers for common statistics, which avoid formatting and parsing
+// handler text. user_data is the element cast to its class.
+
+int
+counter_count_hook(Element *, void *user_data, uint64_t &value)
+{
+    value = static_cast<Counter *>(user_data)->count();
+    return ShmStats::type_uint;
+}
+
+int
+counter_byte_count_hook(Element *, void *user_data, uint64_t &value)
+{
+    value = static_cast<Counter *>(user_data)->byte_count();
+    return ShmStats::type_uint;
+}
+
+int
+queue_length_hook(Element *, void *user_data, uint64_t &value)
+{
+    value = static_cast<SimpleQueue *>(user_data)->size();
+    return ShmStats::type_int;
+}
+
+int
+queue_highwater_length_hook(Element *, void *user_data, uint64_t &value)
+{
+    value = static_cast<SimpleQueue *>(user_data)->highwater_length();
+    return ShmStats::type_int;
+}
+
+int
+queue_capacity_hook(Element *, void *user_data, uint64_t &value)
+{
+    value = static_cast<SimpleQueue *>(user_data)->capacity();
+    return ShmStats::type_int;
+}
+
+int
+queue_drops_hook(Element *, void *user_data, uint64_t &value)
+{
+    value = static_cast<SimpleQueue *>(user_data)->drops();
+    return ShmStats::type_int;
+}
+
+ShmStats::StatHook
+direct_hook(Element *e, const String &hname, void *&user_data)
+{
+    if ((user_data = e->cast("Counter"))) {
+	if (hname == "count")
+	    return counter_count_hook;
+	else if (hname == "byte_count")
+	    return counter_byte_count_hook;
+    } else if ((user_data = e->cast("SimpleQueue"))) {
+	if (hname == "length")
+	    return queue_length_hook;
+	else if (hname == "highwater_length")
+	    return queue_highwater_length_hook;
+	else if (hname == "capacity")
+	    return queue_capacity_hook;
+	else if (hname == "drops")
+	    return queue_drops_hook;
+    }
+    return 0;
+}
+
+}
+
+ShmStats::ShmStats()
+    : _timer(this), _map(0), _map_size(0), _dirty(true),
+      _rebuild_failed(false)
+{
+    static_assert(sizeof(ShmStatsHeader) == 64, "ShmStatsHeader layout");
+    static_assert(sizeof(ShmStatsRecord) == 32, "ShmStatsRecord layout");
+}
+
+ShmStats::~ShmStats()
+{
+}
+
+int
+ShmStats::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String handlers;
+    _interval = Timestamp(1);
+    _unlink = true;
+    if (Args(conf, this, errh)
+	.read_mp("FILE", FilenameArg(), _filename)
+	.read("HANDLERS", AnyArg(), handlers)
+	.read("INTERVAL", _interval)
+	.read("UNLINK", _unlink)
+	.complete() < 0)
+	return -1;
+    if (_interval.msecval() <= 0)
+	return errh->error("INTERVAL too small");
+    cp_spacevec(handlers, _handlers);
+    for (String *it = _handlers.begin(); it != _handlers.end(); ++it)
+	*it = cp_unquote(*it);
+
+    if (!router()->attachment("ShmStats"))
+	router()->set_attachment("ShmStats", this);
+    return 0;
+}
+
+ShmStats *
+ShmStats::find(Router *router)
+{
+    return static_cast<ShmStats *>(router->attachment("ShmStats"));
+}
+
+void
+ShmStats::add_stat(Element *owner, const String &name, StatHook hook, void *user_data)
+{
+    statistic s;
+    s.owner = owner;
+    s.name = name;
+    s.hook = hook;
+    s.user_data = user_data;
+    _stats.push_back(s);
+    _dirty = true;
+}
+
+int
+ShmStats::handler_hook(Element *owner, void *user_data, uint64_t &value)
+{
+    const Handler *h = static_cast<const Handler *>(user_data);
+    String s = h->call_read(owner).trim_space();
+    int64_t i;
+    double d;
+    if (IntArg(10).parse(s, i)) {
+	value = i;
+	return type_int;
+    } else if (IntArg(10).parse(s, value))
+	return type_uint;
+    else if (DoubleArg().parse(s, d)) {
+	memcpy(&value, &d, sizeof(value));
+	return type_double;
+    } else
+	return type_unavailable;
+}
+
+void
+ShmStats::add_handler_stat(Element *e, const Handler *h)
+{
+    void *user_data;
+    if (StatHook hook = direct_hook(e, h->name(), user_data))
+	add_stat(e, h->name(), hook, user_data);
+    else
+	add_stat(e, h->name(), handler_hook, const_cast<Handler *>(h));
+}
+
+int
+ShmStats::resolve_handlers(ErrorHandler *errh)
+{
+    for (String *it = _handlers.begin(); it != _handlers.end(); ++it) {
+	int dot = it->find_left('.');
+	String ename, hname;
+	if (dot < 0)
+	    hname = *it;
+	else {
+	    ename = it->substring(0, dot);
+	    hname = it->substring(dot + 1);
+	}
+
+	int nfound = 0;
+	if (!ename) {
+	    const Handler *h = Router::handler(router()->root_element(), hname);
+	    if (h && h->read_visible()) {
+		add_handler_stat(router()->root_element(), h);
+		++nfound;
+	    }
+	} else if (ename.find_left('*') >= 0 || ename.find_left('?') >= 0
+		   || ename.find_left('[') >= 0) {
+	    for (int i = 0; i < router()->nelements(); ++i) {
+		Element *e = router()->element(i);
+		const Handler *h;
+		if (e->name().glob_match(ename)
+		    && (h = Router::handler(e, hname)) && h->read_visible()) {
+		    add_handler_stat(e, h);
+		    ++nfound;
+		}
+	    }
+	    continue;		// patterns may match nothing
+	} else if (Element *e = router()->find(ename, this, errh)) {
+	    const Handler *h = Router::handler(e, hname);
+	    if (h && h->read_visible()) {
+		add_handler_stat(e, h);
+		++nfound;
+	    }
+	} else
+	    return -1;
+
+	if (!nfound)
+	    return errh->error("no read handler %<%s%>", it->c_str());
+    }
+    return 0;
+}
+
+int
+ShmStats::rebuild(ErrorHandler *errh)
+{
+    // lay out the string area
+    uint32_t strings_offset = sizeof(ShmStatsHeader) + _stats.size() * sizeof(ShmStatsRecord);
+    StringAccum strings;
+    Vector<uint32_t> offsets;
+    for (statistic *it = _stats.begin(); it != _stats.end(); ++it) {
+	offsets.push_back(strings_offset + strings.length());
+	if (it->owner != router()->root_element())
+	    strings << it->owner->name() << '.';
+	strings << it->name << '\0';
+	offsets.push_back(strings_offset + strings.length());
+	strings << it->owner->class_name() << '\0';
+    }
+    size_t size = strings_offset + strings.length();
+
+    // write a new file, then rename it into place, so readers never see a
+    // partial table
+    String tmpname = _filename + ".new";
+    int fd = open(tmpname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+	return errh->error("%s: %s", tmpname.c_str(), strerror(errno));
+    struct stat st;
+    void *m = MAP_FAILED;
+    if (ftruncate(fd, size) == 0 && fstat(fd, &st) == 0)
+	m = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+	int e = errno;
+	close(fd);
+	unlink(tmpname.c_str());
+	return errh->error("%s: %s", tmpname.c_str(), strerror(e));
+    }
+    close(fd);
+
+    char *map = reinterpret_cast<char *>(m);
+    ShmStatsHeader *h = reinterpret_cast<ShmStatsHeader *>(map);
+    memcpy(h->magic, shmstats_magic, sizeof(shmstats_magic));
+    h->version = 1;
+    h->header_size = sizeof(ShmStatsHeader);
+    h->record_size = sizeof(ShmStatsRecord);
+    h->nrecords = _stats.size();
+    h->live = 1;
+    h->interval_ms = _interval.msecval();
+    h->generation = Timestamp::now().nsecval();
+    h->update_time = 0;
+    h->pid = getpid();
+    ShmStatsRecord *r = reinterpret_cast<ShmStatsRecord *>(map + sizeof(ShmStatsHeader));
+    for (int i = 0; i < _stats.size(); ++i) {
+	r[i].name = offsets[2 * i];
+	r[i].class_name = offsets[2 * i + 1];
+    }
+    memcpy(map + strings_offset, strings.data(), strings.length());
+
+    if (rename(tmpname.c_str(), _filename.c_str()) < 0) {
+	int e = errno;
+	munmap(m, size);
+	unlink(tmpname.c_str());
+	return errh->error("%s: %s", _filename.c_str(), strerror(e));
+    }
+
+    unmap();
+    _map = map;
+    _map_size = size;
+    _dev = st.st_dev;
+    _ino = st.st_ino;
+    _dirty = _rebuild_failed = false;
+    return 0;
+}
+
+void
+ShmStats::unmap()
+{
+    if (_map) {
+	reinterpret_cast<ShmStatsHeader *>(_map)->live = 0;
+	munmap(_map, _map_size);
+	_map = 0;
+    }
+}
+
+int
+ShmStats::initialize(ErrorHandler *errh)
+{
+    if (resolve_handlers(errh) < 0 || rebuild(errh) < 0)
+	return -1;
+    _timer.initialize(this);
+    _timer.schedule_now();
+    return 0;
+}
+
+void
+ShmStats::cleanup(CleanupStage)
+{
+    if (_map) {
+	// don't remove a file another router has since put in place
+	struct stat st;
+	bool ours = stat(_filename.c_str(), &st) == 0
+	    && st.st_dev == _dev && st.st_ino == _ino;
+	unmap();
+	if (_unlink && ours)
+	    unlink(_filename.c_str());
+    }
+}
+
+void
+ShmStats::run_timer(Timer *)
+{
+    if (_dirty) {
+	// retry every interval, but complain only once
+	SilentErrorHandler serrh;
+	if (rebuild(_rebuild_failed ? &serrh : ErrorHandler::default_handler()) < 0)
+	    _rebuild_failed = true;
+    }
+    if (_map) {
+	// If a rebuild failed, the old file has room only for the old
+	// statistics; update those.
+	ShmStatsHeader *h = reinterpret_cast<ShmStatsHeader *>(_map);
+	ShmStatsRecord *r = reinterpret_cast<ShmStatsRecord *>(_map + sizeof(ShmStatsHeader));
+	uint64_t now = Timestamp::now().nsecval();
+	int n = _stats.size() < (int) h->nrecords ? _stats.size() : (int) h->nrecords;
+	for (statistic *it = _stats.begin(); it != _stats.begin() + n; ++it, ++r) {
+	    uint64_t value = 0;
+	    int type = it->hook(it->owner, it->user_data, value);
+	    uint32_t seq = r->seq;
+	    r->seq = seq + 1;
+	    click_write_fence();
+	    r->type = type;
+	    r->value = value;
+	    r->time = now;
+	    click_write_fence();
+	    r->seq = seq + 2;
+	}
+	h->update_time = now;
+    }
+    _timer.reschedule_after(_interval);
+}
+
+static String
+read_nstats(Element *e, void *)
+{
+    return String(static_cast<ShmStats *>(e)->nstats());
+}
+
+void
+ShmStats::add_handlers()
+{
+    add_read_handler("nstats", read_nstats, 0);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+EXPORT_ELEMENT(ShmStats)
@@ -0,0 +1,177 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_SHMSTATS_HH
+#define CLICK_SHMSTATS_HH
+#include <click/element.hh>
+#include <click/timer.hh>
+#include <sys/types.h>
+CLICK_DECLS
+class Handler;
+
+/*
+=c
+
+ShmStats(FILE [, I<keywords> HANDLERS, INTERVAL, UNLINK])
+
+=s control
+
+exports statistics through shared memory
+
+=d
+
+Publishes numeric statistics in a memory-mapped file, normally under
+F</dev/shm>, so that monitoring programs can read every value without system
+calls and without involving the router.  Every INTERVAL, ShmStats samples its
+statistics and writes them into the file.
+
+The HANDLERS keyword is a space-separated list of read handlers to export,
+such as C<c.count>.  The element part may be a shell-style pattern, as in
+C<*.byte_count>, which exports the handler for every element that has it.
+Counter's C<count> and C<byte_count>, and the C<length>, C<highwater_length>,
+C<capacity>, and C<drops> of SimpleQueue and its relatives, are sampled
+directly.  Other handlers are called and their text parsed as a number on
+every sample, which costs more.  Other elements can register statistics of their own with the add_stat()
+function.
+
+Keyword arguments are:
+
+=over 8
+
+=item HANDLERS
+
+Handler names, as above.
+
+=item INTERVAL
+
+Timestamp.  How often to sample.  Default is 1 second.
+
+=item UNLINK
+
+Boolean.  If true, remove FILE when the router is cleaned up.  Default is
+true.
+
+=back
+
+The file holds a header, a table of fixed-size records, and a string area.
+All fields are in host byte order.  The header is:
+
+  char     magic[8]       "\177ClkStat"
+  uint32_t version        1
+  uint32_t header_size    64
+  uint32_t record_size    32
+  uint32_t nrecords
+  uint32_t live           1 while the router runs, 0 after
+  uint32_t interval_ms
+  uint64_t generation     changes when another router writes FILE
+  uint64_t update_time    nanoseconds since the epoch of the last sample
+  uint32_t pid
+  (padding to 64 bytes)
+
+and is followed by C<nrecords> records:
+
+  uint32_t seq            sequence lock
+  uint8_t  type           0 unavailable, 1 int64, 2 uint64, 3 double
+  uint8_t  reserved[3]
+  uint32_t name           file offset of NUL-terminated "element.handler"
+  uint32_t class_name     file offset of NUL-terminated element class
+  uint64_t value
+  uint64_t time           nanoseconds since the epoch of this sample
+
+Each record is protected by a sequence lock.  A reader reads C<seq>, then the
+value and time, then C<seq> again; if the two reads differ or are odd, the
+record was being written, and the reader should retry.
+
+ShmStats writes FILE by creating a new file and renaming it into place.  If
+the configuration changes, or another router starts exporting to the same
+FILE, readers that still map the old file see C<live> become 0 and should
+reopen FILE.
+
+Sampling runs on ShmStats's home thread.  Use StaticThreadSched to keep it
+away from forwarding threads.
+
+=e
+
+  c :: Counter;
+  ShmStats(/dev/shm/click-stats, HANDLERS *.count *.byte_count,
+           INTERVAL 100ms);
+
+=h nstats read-only
+
+Returns the number of exported statistics.
+
+=a
+
+ControlSocket, StaticThreadSched */
+
+class ShmStats : public Element { public:
+
+    ShmStats() CLICK_COLD;
+    ~ShmStats() CLICK_COLD;
+
+    const char *class_name() const	{ return "ShmStats"; }
+
+    int configure_phase() const		{ return CONFIGURE_PHASE_INFO; }
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void run_timer(Timer *);
+
+    enum { type_unavailable = 0, type_int = 1, type_uint = 2,
+	   type_double = 3 };
+
+    /** @brief Sample a statistic.
+     * @param owner element that registered the statistic
+     * @param user_data user data from add_stat()
+     * @param[out] value the statistic's bits
+     * @return the value's type, or type_unavailable */
+    typedef int (*StatHook)(Element *owner, void *user_data, uint64_t &value);
+
+    /** @brief Export a statistic.
+     * @param owner element that owns the statistic
+     * @param name statistic name, appended to the owner's name
+     * @param hook sampling function, called on ShmStats's thread
+     * @param user_data passed to @a hook
+     *
+     * May be called at any time; the file is rewritten at the next
+     * sample. */
+    void add_stat(Element *owner, const String &name, StatHook hook, void *user_data);
+
+    /** @brief Return the number of exported statistics. */
+    int nstats() const			{ return _stats.size(); }
+
+    /** @brief Return the router's first ShmStats, or null. */
+    static ShmStats *find(Router *router);
+
+  private:
+
+    struct statistic {
+	Element *owner;
+	String name;
+	StatHook hook;
+	void *user_data;
+    };
+
+    Vector<statistic> _stats;
+    String _filename;
+    Vector<String> _handlers;
+    Timestamp _interval;
+    Timer _timer;
+    char *_map;
+    size_t _map_size;
+    dev_t _dev;
+    ino_t _ino;
+    bool _unlink;
+    bool _dirty;
+    bool _rebuild_failed;
+
+    void add_handler_stat(Element *e, const Handler *h);
+    int resolve_handlers(ErrorHandler *errh);
+    int rebuild(ErrorHandler *errh);
+    void unmap();
+    static int handler_hook(Element *owner, void *user_data, uint64_t &value);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -61,7 +61,7 @@
 CLICK_DECLS
 
 ToDevice::ToDevice()
-    : _task(this), _timer(&_task), _q(0), _pulls(0)
+    : _task(this), _timer(&_task), _q(0), _queue(0), _batch_pos(0), _batch_n(0), _pulls(0)
 {
 #if TODEVICE_ALLOW_PCAP
     _pcap = 0;
@@ -255,12 +255,21 @@ ToDevice::initialize(ErrorHandler *errh)
 
     ScheduleInfo::join_scheduler(this, &_task, errh);
     _signal = Notifier::upstream_empty_signal(this, 0, &_task);
+#if CLICK_STATS < 1
+    if (_burst > 1 && input(0).port() == 0)
+	_queue = static_cast<SimpleQueue *>(input(0).element()->cast("SimpleQueue"));
+#endif
     return 0;
 }
 
 void
 ToDevice::cleanup(CleanupStage)
 {
+    while (_batch_pos < _batch_n)
+	_batch[_batch_pos++]->kill();
+    if (_q)
+	_q->kill();
+    _q = 0;
 #if TODEVICE_ALLOW_PCAP
     if (_pcap && _my_pcap)
 	pcap_close(_pcap);
@@ -348,9 +357,23 @@ ToDevice::run_task(Task *)
 
     do {
 	if (!p) {
-	    ++_pulls;
-	    if (!(p = input(0).pull()))
+	    if (_batch_pos == _batch_n && _queue) {
+		int want = _burst - count < batch_size ? _burst - count : batch_size;
+		++_pulls;
+		_batch_pos = 0;
+		_batch_n = _queue->pull_batch(0, _batch, want);
+	    }
+	    if (_batch_pos < _batch_n) {
+		p = _batch[_batch_pos++];
+		if (_batch_pos < _batch_n)
+		    click_prefetch0(_batch[_batch_pos]->data());
+	    } else if (_queue)
 		break;
+	    else {
+		++_pulls;
+		if (!(p = input(0).pull()))
+		    break;
+	    }
 	}
 	if ((r = send_packet(p)) >= 0) {
 	    _backoff = 0;
@@ -383,7 +406,7 @@ ToDevice::run_task(Task *)
 	checked_output_push(1, p);
     }
 
-    if (p || _signal)
+    if (p || _batch_pos < _batch_n || _signal)
 	_task.fast_reschedule();
     return count > 0;
 }
@@ -6,6 +6,7 @@
 #include <click/timer.hh>
 #include <click/notifier.hh>
 #include "elements/userlevel/fromdevice.hh"
+#include "elements/standard/simplequeue.hh"
 CLICK_DECLS
 
 /*
@@ -29,6 +30,8 @@ CLICK_DECLS
  * =item BURST
  *
  * Integer. Maximum number of packets to pull per scheduling. Defaults to 1.
+ * When BURST is greater than 1 and ToDevice pulls directly from a
+ * SimpleQueue or one of its subclasses, packets are dequeued in batches.
  *
  * =item METHOD
  *
@@ -127,6 +130,12 @@ class ToDevice : public Element { public:
     Packet *_q;
     int _burst;
 
+    enum { batch_size = 32 };
+    SimpleQueue *_queue;
+    Packet *_batch[batch_size];
+    int _batch_pos;
+    int _batch_n;
+
     bool _debug;
 #if TODEVICE_ALLOW_PCAP
     bool _my_pcap;
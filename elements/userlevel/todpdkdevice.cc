@@ -20,14 +20,15 @@
 #include <click/args.hh>
 #include <click/error.hh>
 #include <click/algorithm.hh>
+#include <click/master.hh>
 
 #include "todpdkdevice.hh"
 
 CLICK_DECLS
 
 ToDPDKDevice::ToDPDKDevice() :
-    _iqueues(), _dev(0), _queue_id(0), _blocking(false),
-    _iqueue_size(1024), _timeout(0), _count(0),
+    _iqueues(), _dev(0), _queue_id(0), _shared_queues(true), _blocking(false),
+    _iqueue_size(1024), _timeout(0),
     _dropped(0), _congestion_warning_printed(false)
 {
     _burst_size = DPDKDevice::DEF_BURST_SIZE;
@@ -42,6 +43,7 @@ int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     int n_desc = -1;
     String dev;
     bool allow_nonexistent = false;
+    int n_queues = 1;
 
     if (Args(conf, this, errh)
         .read_mp("PORT", dev)
@@ -52,9 +54,13 @@ int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
         .read("TIMEOUT", _timeout)
         .read("NDESC",n_desc)
         .read("ALLOW_NONEXISTENT", allow_nonexistent)
+        .read("N_QUEUES", n_queues)
         .complete() < 0)
         return -1;
 
+    if (n_queues < 1)
+        return errh->error("N_QUEUES must be at least 1");
+
     if (_iqueue_size < _burst_size) {
         _iqueue_size = _burst_size;
         click_chatter(
@@ -69,7 +75,17 @@ int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
             return errh->error("%s : Unknown or invalid PORT", dev.c_str());
     }
 
-    return _dev->add_tx_queue(_queue_id, (n_desc > 0) ? n_desc : DPDKDevice::DEF_DEV_TXDESC, errh);
+    _queue_ids.clear();
+    for (int i = 0; i < n_queues; ++i) {
+        // Given a first QUEUE, use consecutive queues; otherwise take the
+        // first free ones
+        unsigned queue_id = _queue_id ? _queue_id + i : 0;
+        if (_dev->add_tx_queue(queue_id, (n_desc > 0) ? n_desc : DPDKDevice::DEF_DEV_TXDESC, errh) < 0)
+            return -1;
+        _queue_ids.push_back(queue_id);
+    }
+    _queue_id = _queue_ids[0];
+    return 0;
 }
 
 int ToDPDKDevice::initialize(ErrorHandler *errh)
@@ -78,12 +94,17 @@ int ToDPDKDevice::initialize(ErrorHandler *errh)
         return 0;
 
     _iqueues.resize(click_max_cpu_ids());
+    _shared_queues = _iqueues.size() > _queue_ids.size();
 
+    // Each thread's flush timer must run on that thread
     for (int i = 0; i < _iqueues.size(); i++) {
         _iqueues[i].pkts = new struct rte_mbuf *[_iqueue_size];
+        _iqueues[i].queue_id = _queue_ids[i % _queue_ids.size()];
         if (_timeout >= 0) {
             _iqueues[i].timeout.assign(this);
             _iqueues[i].timeout.initialize(this);
+            if (i < master()->nthreads())
+                _iqueues[i].timeout.move_thread(i);
         }
     }
 
@@ -100,7 +121,8 @@ int ToDPDKDevice::reset_counts_handler(const String &, Element *e, void *,
                                        ErrorHandler *)
 {
     ToDPDKDevice *tdd = static_cast<ToDPDKDevice *>(e);
-    tdd->_count = 0;
+    for (int i = 0; i < tdd->_iqueues.size(); i++)
+        tdd->_iqueues[i].count = 0;
     tdd->_dropped = 0;
     return 0;
 }
@@ -122,8 +144,12 @@ String ToDPDKDevice::statistics_handler(Element *e, void * thunk)
             return String(stats.obytes);
         case h_oerrors:
             return String(stats.oerrors);
-        case h_count:
-             return String(td->_count);
+        case h_count: {
+            unsigned long count = 0;
+            for (int i = 0; i < td->_iqueues.size(); i++)
+                count += td->_iqueues[i].count;
+            return String(count);
+        }
         case h_dropped:
             return String(td->_dropped);
     }
@@ -173,9 +199,13 @@ inline struct rte_mbuf* get_mbuf(Packet* p, bool create=true) {
     return mbuf;
 }
 
-void ToDPDKDevice::run_timer(Timer *)
+void ToDPDKDevice::run_timer(Timer *t)
 {
-    flush_internal_queue(_iqueues[click_current_cpu_id()]);
+    for (int i = 0; i < _iqueues.size(); i++)
+        if (&_iqueues[i].timeout == t) {
+            flush_internal_queue(_iqueues[i]);
+            break;
+        }
 }
 
 /* Flush as much as possible packets from a given internal queue to the DPDK
@@ -192,14 +222,15 @@ void ToDPDKDevice::flush_internal_queue(InternalQueue &iqueue) {
      */
     unsigned sub_burst;
 
-    _lock.acquire();
+    if (_shared_queues)
+        _lock.acquire();
 
     do {
         sub_burst = iqueue.nr_pending > 32 ? 32 : iqueue.nr_pending;
         if (iqueue.index + sub_burst >= _iqueue_size)
             // The sub_burst wraps around the ring
             sub_burst = _iqueue_size - iqueue.index;
-        r = rte_eth_tx_burst(_dev->port_id, _queue_id, &iqueue.pkts[iqueue.index],
+        r = rte_eth_tx_burst(_dev->port_id, iqueue.queue_id, &iqueue.pkts[iqueue.index],
                              sub_burst);
 
         iqueue.nr_pending -= r;
@@ -211,9 +242,10 @@ void ToDPDKDevice::flush_internal_queue(InternalQueue &iqueue) {
         sent += r;
     } while (r == sub_burst && iqueue.nr_pending > 0);
 
-    _count += sent;
+    if (_shared_queues)
+        _lock.release();
 
-    _lock.release();
+    iqueue.count += sent;
 
     // If ring is empty, reset the index to avoid wrap ups
     if (iqueue.nr_pending == 0)
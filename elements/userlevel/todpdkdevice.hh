@@ -13,7 +13,7 @@ CLICK_DECLS
 
 =c
 
-ToDPDKDevice(PORT [, QUEUE [, I<keywords> IQUEUE, BLOCKING, etc.]])
+ToDPDKDevice(PORT [, QUEUE [, I<keywords> IQUEUE, BLOCKING, N_QUEUES, etc.]])
 
 =s netdevices
 
@@ -42,6 +42,14 @@ format fffff:ff:ff.f
 Integer.  Index of the queue to use. If omitted or negative, auto-increment
 between ToDPDKDevice attached to the same port will be used.
 
+=item N_QUEUES
+
+Integer.  Number of TX queues to use; with N_QUEUES, QUEUE is the first of
+N_QUEUES consecutive queues.  Each thread sends on queue I<t> modulo
+N_QUEUES, where I<t> is the thread number.  When there are at least as many
+queues as threads, threads never share a queue and send without locking.
+Defaults to 1.
+
 =item IQUEUE
 
 Integer.  Size of the internal queue, i.e. number of packets that we can buffer
@@ -154,7 +162,7 @@ private:
      * than _iqueue_size but index should be wrapped-around. */
     class InternalQueue {
     public:
-        InternalQueue() : pkts(0), index(0), nr_pending(0) { }
+        InternalQueue() : pkts(0), index(0), nr_pending(0), queue_id(0), count(0) { }
 
         // Array of DPDK Buffers
         struct rte_mbuf ** pkts;
@@ -163,6 +171,11 @@ private:
         // Number of valid packets awaiting to be sent after index
         unsigned int nr_pending;
 
+        // TX queue used by this thread
+        unsigned queue_id;
+        // Number of packets sent by this thread
+        unsigned long count;
+
         // Timer to limit time a batch will take to be completed
         Timer timeout;
     } __attribute__((aligned(64)));
@@ -180,12 +193,13 @@ private:
 
     DPDKDevice* _dev;
     unsigned _queue_id;
+    Vector<unsigned> _queue_ids;
+    bool _shared_queues;
     bool _blocking;
     Spinlock _lock;
     unsigned int _iqueue_size;
     unsigned int _burst_size;
     int _timeout;
-    unsigned long _count;
     unsigned long _dropped;
     bool _congestion_warning_printed;
 };
@@ -0,0 +1,442 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * trafficgenerator.{cc,hh} -- multi-threaded UDP traffic generator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "trafficgenerator.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/etheraddress.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include <click/straccum.hh>
+#include <click/userutils.hh>
+CLICK_DECLS
+
+TrafficGenerator::TrafficGenerator()
+    : _flows(0), _zeros(0), _workers(0)
+{
+}
+
+TrafficGenerator::~TrafficGenerator()
+{
+}
+
+int
+TrafficGenerator::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    _length = 60;
+    _rate = 0;
+    _limit = -1;
+    _nthreads = master()->nthreads();
+    _nflows = 1;
+    memset(&_ethh, 0, sizeof(_ethh));
+    _sipaddr.s_addr = htonl(0x0A000001);
+    _dipaddr.s_addr = htonl(0x0A000002);
+    _sport = _dport = 1234;
+    _cksum = true;
+    _burst = 32;
+    _random = false;
+    _tsc = true;
+    _active = true;
+    _stop = false;
+    String vary = "sport", trace;
+
+    if (Args(conf, this, errh)
+	.read("LENGTH", _length)
+	.read("RATE", _rate)
+	.read("LIMIT", _limit)
+	.read("THREADS", _nthreads)
+	.read("FLOWS", _nflows)
+	.read("VARY", AnyArg(), vary)
+	.read("SRCETH", EtherAddressArg(), _ethh.ether_shost)
+	.read("DSTETH", EtherAddressArg(), _ethh.ether_dhost)
+	.read("SRCIP", _sipaddr)
+	.read("DSTIP", _dipaddr)
+	.read("SPORT", IPPortArg(IP_PROTO_UDP), _sport)
+	.read("DPORT", IPPortArg(IP_PROTO_UDP), _dport)
+	.read("CHECKSUM", _cksum)
+	.read("BURST", _burst)
+	.read("TRACE", FilenameArg(), trace)
+	.read("RANDOM", _random)
+	.read("TSC", _tsc)
+	.read("ACTIVE", _active)
+	.read("STOP", _stop)
+	.complete() < 0)
+	return -1;
+
+    if (_length < header_length || _length > 0xFFFF)
+	return errh->error("LENGTH must be between %d and 65535", (int) header_length);
+    if (_nthreads < 1 || _nthreads > master()->nthreads())
+	return errh->error("THREADS must be between 1 and %d", master()->nthreads());
+    if (_nflows < 1)
+	return errh->error("FLOWS must be positive");
+    if (_burst < 1)
+	_burst = 1;
+
+    _vary = 0;
+    Vector<String> words;
+    cp_spacevec(vary, words);
+    for (String *w = words.begin(); w != words.end(); ++w)
+	if (*w == "src")
+	    _vary |= vary_src;
+	else if (*w == "dst")
+	    _vary |= vary_dst;
+	else if (*w == "sport")
+	    _vary |= vary_sport;
+	else if (*w == "dport")
+	    _vary |= vary_dport;
+	else
+	    return errh->error("bad VARY field %<%s%>", w->c_str());
+
+    _ethh.ether_type = htons(ETHERTYPE_IP);
+    _trace.clear();
+    _trace_gaps = false;
+    if (trace && read_trace(trace, errh) < 0)
+	return -1;
+    return 0;
+}
+
+int
+TrafficGenerator::read_trace(const String &filename, ErrorHandler *errh)
+{
+    String s = file_string(filename, errh);
+    if (!s && errh->nerrors())
+	return -1;
+
+    // Gaps are stored as Timestamps here and converted to clock ticks once
+    // the clock is known.
+    const char *end = s.end();
+    int lineno = 0, ngaps = 0;
+    for (const char *x = s.begin(); x < end; ) {
+	const char *eol = (const char *) memchr(x, '\n', end - x);
+	if (!eol)
+	    eol = end;
+	String line = s.substring(x, eol).trim_space();
+	x = eol + 1;
+	++lineno;
+	if (!line || line[0] == '#')
+	    continue;
+
+	Vector<String> words;
+	cp_spacevec(line, words);
+	TraceEntry e;
+	Timestamp gap;
+	if (words.size() > 2
+	    || !IntArg().parse(words[0], e.length)
+	    || e.length < header_length || e.length > 0xFFFF
+	    || (words.size() == 2 && !cp_time(words[1], &gap)))
+	    return errh->error("%s:%d: bad trace line", filename.c_str(), lineno);
+	e.gap = gap.nsecval();
+	ngaps += words.size() == 2;
+	_trace.push_back(e);
+    }
+
+    if (!_trace.size())
+	return errh->error("%s: empty trace", filename.c_str());
+    if (ngaps && ngaps != _trace.size())
+	return errh->error("%s: some trace lines lack gaps", filename.c_str());
+    _trace_gaps = ngaps > 0;
+    return 0;
+}
+
+inline uint64_t
+TrafficGenerator::now_ticks() const
+{
+    if (_use_tsc)
+	return click_get_cycles();
+    return Timestamp::now().nsecval();
+}
+
+void
+TrafficGenerator::build_flow(uint32_t k, FlowTemplate &f) const
+{
+    memcpy(f.header, &_ethh, sizeof(click_ether));
+    click_ip *ip = reinterpret_cast<click_ip *>(f.header + sizeof(click_ether));
+    click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+
+    memset(ip, 0, sizeof(click_ip));
+    ip->ip_v = 4;
+    ip->ip_hl = sizeof(click_ip) >> 2;
+    ip->ip_ttl = 250;
+    ip->ip_p = IP_PROTO_UDP;
+    ip->ip_src.s_addr = htonl(ntohl(_sipaddr.s_addr) + (_vary & vary_src ? k : 0));
+    ip->ip_dst.s_addr = htonl(ntohl(_dipaddr.s_addr) + (_vary & vary_dst ? k : 0));
+    udp->uh_sport = htons(_sport + (_vary & vary_sport ? k : 0));
+    udp->uh_dport = htons(_dport + (_vary & vary_dport ? k : 0));
+    udp->uh_ulen = 0;
+    udp->uh_sum = 0;
+}
+
+int
+TrafficGenerator::initialize(ErrorHandler *errh)
+{
+    _hz = 1000000000;
+    _use_tsc = false;
+    if (_tsc && Timestamp::warp_class() == Timestamp::warp_none) {
+	if (uint64_t hz = click_cycles_per_second()) {
+	    _hz = hz;
+	    _use_tsc = true;
+	}
+    }
+
+    for (TraceEntry *e = _trace.begin(); e != _trace.end(); ++e)
+	e->gap = (uint64_t) ((double) e->gap * _hz / 1000000000);
+    _gap = _rate ? (double) _hz * _nthreads / _rate : 0;
+
+    _max_length = _length;
+    for (TraceEntry *e = _trace.begin(); e != _trace.end(); ++e)
+	if (e->length > _max_length)
+	    _max_length = e->length;
+
+    _flows = new FlowTemplate[_nflows];
+    _zeros = new unsigned char[_max_length];
+    _workers = new Worker[_nthreads];
+    if (!_flows || !_zeros || !_workers)
+	return errh->error("out of memory");
+    memset(_zeros, 0, _max_length);
+    for (uint32_t k = 0; k < _nflows; ++k)
+	build_flow(k, _flows[k]);
+
+    _ndone = 0;
+    for (int i = 0; i < _nthreads; ++i) {
+	Worker &w = _workers[i];
+	w.owner = this;
+	w.task = new Task(task_hook, &w);
+	w.timer = new Timer(w.task);
+	if (!w.task || !w.timer)
+	    return errh->error("out of memory");
+	w.limit = (uint64_t) -1;
+	if (_limit >= 0)
+	    w.limit = _limit / _nthreads + (i < _limit % _nthreads);
+	w.seed = click_random() | 1;
+	restart(w);
+	w.task->initialize(this, false);
+	w.task->move_thread(i);
+	w.timer->initialize(this);
+	w.timer->move_thread(i);
+	if (_active)
+	    w.task->reschedule();
+    }
+    return 0;
+}
+
+void
+TrafficGenerator::cleanup(CleanupStage)
+{
+    if (_workers)
+	for (int i = 0; i < _nthreads; ++i) {
+	    delete _workers[i].timer;
+	    delete _workers[i].task;
+	}
+    delete[] _workers;
+    delete[] _flows;
+    delete[] _zeros;
+    _workers = 0;
+    _flows = 0;
+    _zeros = 0;
+}
+
+void
+TrafficGenerator::restart(Worker &w)
+{
+    int i = &w - _workers;
+    w.count = w.bytes = 0;
+    w.start = w.last = w.next = 0;
+    w.flow = i % _nflows;
+    w.trace_pos = _trace.size() ? (uint32_t) (((uint64_t) _trace.size() * i) / _nthreads) : 0;
+    w.done = w.limit == 0;
+}
+
+inline uint32_t
+TrafficGenerator::next_random(Worker &w)
+{
+    // xorshift32; click_random() is shared by all threads
+    uint32_t x = w.seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return w.seed = x;
+}
+
+inline Packet *
+TrafficGenerator::make_packet(Worker &w, uint32_t length)
+{
+    WritablePacket *q = Packet::make(Packet::default_headroom, _zeros, length, 0);
+    if (!q)
+	return 0;
+
+    const FlowTemplate &f = _flows[w.flow];
+    if (++w.flow == _nflows)
+	w.flow = 0;
+    memcpy(q->data(), f.header, header_length);
+
+    click_ip *ip = reinterpret_cast<click_ip *>(q->data() + sizeof(click_ether));
+    click_udp *udp = reinterpret_cast<click_udp *>(ip + 1);
+    uint32_t ulen = length - sizeof(click_ether) - sizeof(click_ip);
+    ip->ip_len = htons(length - sizeof(click_ether));
+    ip->ip_sum = click_in_cksum((const unsigned char *) ip, sizeof(click_ip));
+    udp->uh_ulen = htons(ulen);
+    if (_cksum) {
+	// The payload is all zeros, so it does not change the sum.
+	unsigned csum = click_in_cksum((const unsigned char *) udp, sizeof(click_udp));
+	udp->uh_sum = click_in_cksum_pseudohdr(csum, ip, ulen);
+    }
+    q->set_mac_header(q->data(), sizeof(click_ether));
+    q->set_ip_header(ip, sizeof(click_ip));
+    q->set_dst_ip_anno(ip->ip_dst);
+    return q;
+}
+
+bool
+TrafficGenerator::run(Worker &w)
+{
+    if (!_active || w.done)
+	return false;
+
+    uint64_t now = now_ticks();
+    if (!w.count)
+	w.start = w.next = now;
+
+    uint32_t n = 0;
+    while (n < _burst && w.next <= now) {
+	uint32_t length = _length;
+	uint64_t gap = 0;
+	if (_trace.size()) {
+	    const TraceEntry &e = _trace[_random ? next_random(w) % _trace.size() : w.trace_pos];
+	    if (!_random && ++w.trace_pos == (uint32_t) _trace.size())
+		w.trace_pos = 0;
+	    length = e.length;
+	    gap = e.gap;
+	}
+
+	Packet *p = make_packet(w, length);
+	if (!p)
+	    break;
+	output(0).push(p);
+	++n;
+	++w.count;
+	w.bytes += length;
+
+	if (_trace_gaps)
+	    w.next += gap;
+	else if (_gap)
+	    w.next = w.start + (uint64_t) (w.count * _gap);
+
+	if (w.count == w.limit) {
+	    w.done = true;
+	    w.last = now_ticks();
+	    if (_ndone.fetch_and_add(1) + 1 == (uint32_t) _nthreads && _stop)
+		router()->please_stop_driver();
+	    return true;
+	}
+    }
+    w.last = now;
+
+    // Sleep on the Timer if the next departure is far enough away.
+    uint64_t ahead = w.next > now ? w.next - now : 0;
+    if (ahead > _hz / 1000) {
+	Timestamp::value_type nsec = (Timestamp::value_type) ((double) ahead * 1000000000 / _hz);
+	w.timer->schedule_after(Timestamp::make_nsec(nsec) - Timer::adjustment());
+    } else
+	w.task->fast_reschedule();
+    return n > 0;
+}
+
+bool
+TrafficGenerator::task_hook(Task *, void *thunk)
+{
+    Worker *w = static_cast<Worker *>(thunk);
+    return w->owner->run(*w);
+}
+
+String
+TrafficGenerator::read_handler(Element *e, void *thunk)
+{
+    TrafficGenerator *tg = static_cast<TrafficGenerator *>(e);
+    uint64_t count = 0, bytes = 0, first = 0, last = 0;
+    for (int i = 0; i < tg->_nthreads; ++i) {
+	Worker &w = tg->_workers[i];
+	count += w.count;
+	bytes += w.bytes;
+	if (w.count && (!first || w.start < first))
+	    first = w.start;
+	if (w.last > last)
+	    last = w.last;
+    }
+
+    switch ((intptr_t) thunk) {
+    case h_count:
+	return String(count);
+    case h_bytes:
+	return String(bytes);
+    case h_rate:
+	if (last <= first)
+	    return String(0);
+	return String((uint64_t) ((double) count * tg->_hz / (last - first)));
+    case h_thread_stats: {
+	StringAccum sa;
+	for (int i = 0; i < tg->_nthreads; ++i) {
+	    Worker &w = tg->_workers[i];
+	    uint64_t pps = 0;
+	    if (w.last > w.start)
+		pps = (uint64_t) ((double) w.count * tg->_hz / (w.last - w.start));
+	    sa << i << ' ' << w.count << ' ' << w.bytes << ' ' << pps << '\n';
+	}
+	return sa.take_string();
+    }
+    case h_active:
+	return String(tg->_active);
+    default:
+	return String();
+    }
+}
+
+int
+TrafficGenerator::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    TrafficGenerator *tg = static_cast<TrafficGenerator *>(e);
+    switch ((intptr_t) thunk) {
+    case h_active:
+	if (!BoolArg().parse(str, tg->_active))
+	    return errh->error("syntax error");
+	break;
+    case h_reset:
+	tg->_ndone = 0;
+	for (int i = 0; i < tg->_nthreads; ++i)
+	    tg->restart(tg->_workers[i]);
+	break;
+    }
+    if (tg->_active)
+	for (int i = 0; i < tg->_nthreads; ++i)
+	    tg->_workers[i].task->reschedule();
+    return 0;
+}
+
+void
+TrafficGenerator::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("bytes", read_handler, h_bytes);
+    add_read_handler("rate", read_handler, h_rate);
+    add_read_handler("thread_stats", read_handler, h_thread_stats);
+    add_read_handler("active", read_handler, h_active, Handler::CHECKBOX);
+    add_write_handler("active", write_handler, h_active);
+    add_write_handler("reset", write_handler, h_reset, Handler::BUTTON);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel int64)
+EXPORT_ELEMENT(TrafficGenerator)
+ELEMENT_MT_SAFE(TrafficGenerator)
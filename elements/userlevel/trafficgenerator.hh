@@ -0,0 +1,260 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_TRAFFICGENERATOR_HH
+#define CLICK_TRAFFICGENERATOR_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/atomic.hh>
+#include <clicknet/ether.h>
+#include <clicknet/ip.h>
+#include <clicknet/udp.h>
+CLICK_DECLS
+
+/*
+=c
+
+TrafficGenerator([I<keywords> LENGTH, RATE, LIMIT, THREADS, FLOWS, VARY,
+SRCETH, DSTETH, SRCIP, DSTIP, SPORT, DPORT, ...])
+
+=s udp
+
+multi-threaded UDP traffic generator with precise pacing
+
+=d
+
+TrafficGenerator is a load-testing tool.  It pushes UDP/IP/Ethernet packets
+from THREADS threads at once, one Task per thread, and paces each thread
+against the CPU's cycle counter so that inter-departure times stay accurate at
+high rates.
+
+At initialization, TrafficGenerator builds one header template per flow.  Flow
+I<k> is the base header with each field named in VARY increased by I<k>.
+Packets are produced by copying a flow's template into a fresh packet; flows
+are used in round-robin order.  Payload bytes are zero.
+
+The aggregate RATE is divided evenly among the threads.  Each thread computes
+the departure time of its I<n>th packet directly from its start time, so
+rounding errors do not accumulate.  A thread that falls behind, for instance
+because it was descheduled, catches up by sending up to BURST packets per Task
+invocation.  Waits longer than about a millisecond use a Timer; shorter waits
+busy-poll.
+
+TrafficGenerator can instead replay packet sizes and inter-departure times from
+a TRACE file.  Each line of the file contains a packet length and, optionally,
+the gap before the next packet, as in "C<1500 12us>".  Blank lines and lines
+starting with "C<#>" are ignored.  Either every line has a gap or none does;
+without gaps, RATE sets the pacing.  Every thread replays the trace
+independently, starting at a different offset.  If RANDOM is true, each
+thread draws trace lines uniformly at random, reproducing the trace's size and
+gap distributions rather than its exact sequence.
+
+Keyword arguments are:
+
+=over 8
+
+=item LENGTH
+
+Unsigned integer.  Ethernet frame length, excluding the CRC; at least 42.
+Ignored for packets whose length comes from TRACE.  Default is 60.
+
+=item RATE
+
+Unsigned integer.  Aggregate packets per second.  Zero means as fast as
+possible.  Default is 0.
+
+=item LIMIT
+
+Integer.  Total number of packets to send, or -1 for no limit.  Default is -1.
+
+=item THREADS
+
+Unsigned integer.  Number of threads to send on; thread I<i> runs on Click
+thread I<i>.  Defaults to the number of Click threads.
+
+=item FLOWS
+
+Unsigned integer.  Number of flow templates.  Default is 1.
+
+=item VARY
+
+Space-separated list of fields that differ between flows, chosen from
+C<src>, C<dst>, C<sport>, and C<dport>.  Default is C<sport>.
+
+=item SRCETH, DSTETH
+
+Ethernet addresses.  Default is 00:00:00:00:00:00 for both.
+
+=item SRCIP, DSTIP
+
+IP addresses of flow 0.  Defaults are 10.0.0.1 and 10.0.0.2.
+
+=item SPORT, DPORT
+
+UDP ports of flow 0.  Defaults are 1234 and 1234.
+
+=item CHECKSUM
+
+Boolean.  If true, compute UDP checksums.  Default is true.
+
+=item BURST
+
+Unsigned integer.  Maximum number of packets a thread sends per Task
+invocation.  Default is 32.
+
+=item TRACE
+
+Filename.  Replay packet lengths and gaps from this file.
+
+=item RANDOM
+
+Boolean.  If true, sample TRACE lines at random instead of in order.
+Default is false.
+
+=item TSC
+
+Boolean.  If true, pace with the CPU cycle counter, calibrated at
+initialization.  If false, or if the cycle counter is unavailable or Click
+runs in simulated time, pace with Timestamp::now().  Default is true.
+
+=item ACTIVE
+
+Boolean.  If false, do not send until the "active" handler is set.  Default
+is true.
+
+=item STOP
+
+Boolean.  If true, stop the driver once every thread has reached its share of
+LIMIT.  Default is false.
+
+=back
+
+=h count read-only
+
+Returns the number of packets sent by all threads.
+
+=h bytes read-only
+
+Returns the number of bytes sent by all threads.
+
+=h rate read-only
+
+Returns the achieved aggregate rate in packets per second, measured from the
+first to the last packet sent.
+
+=h thread_stats read-only
+
+Returns one line per thread: the thread number, packets sent, bytes sent, and
+achieved packets per second.
+
+=h active read/write
+
+Returns or sets ACTIVE.
+
+=h reset write
+
+Resets counts and restarts every thread.
+
+=n
+
+Threads push packets concurrently, so the downstream path must be safe to use
+from several threads.  Multi-threaded generation requires a Click built with
+--enable-user-multithread and started with B<-j>.
+
+=e
+
+  gen :: TrafficGenerator(LENGTH 64, RATE 20000000, THREADS 4, FLOWS 1024,
+                          VARY src sport, SRCIP 10.0.0.1, DSTIP 10.1.0.1)
+      -> ToDPDKDevice(0);
+
+=a FastUDPFlows, FastUDPSource, RatedSource */
+
+class TrafficGenerator : public Element { public:
+
+    TrafficGenerator() CLICK_COLD;
+    ~TrafficGenerator() CLICK_COLD;
+
+    const char *class_name() const	{ return "TrafficGenerator"; }
+    const char *port_count() const	{ return PORTS_0_1; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+  private:
+
+    enum { vary_src = 1, vary_dst = 2, vary_sport = 4, vary_dport = 8 };
+    enum { header_length = sizeof(click_ether) + sizeof(click_ip) + sizeof(click_udp) };
+
+    struct FlowTemplate {
+	uint8_t header[header_length];
+    };
+
+    struct TraceEntry {
+	uint32_t length;
+	uint64_t gap;			// in clock ticks
+    };
+
+    struct Worker {
+	Task *task;
+	Timer *timer;
+	TrafficGenerator *owner;
+	uint64_t limit;			// this thread's share of LIMIT
+	uint64_t count;
+	uint64_t bytes;
+	uint64_t start;			// clock at first packet
+	uint64_t last;			// clock at last packet
+	uint64_t next;			// departure time of next packet
+	uint32_t flow;
+	uint32_t trace_pos;
+	uint32_t seed;
+	bool done;
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+    uint32_t _length;
+    uint32_t _rate;
+    int64_t _limit;
+    int _nthreads;
+    uint32_t _nflows;
+    int _vary;
+    click_ether _ethh;
+    struct in_addr _sipaddr;
+    struct in_addr _dipaddr;
+    uint16_t _sport;
+    uint16_t _dport;
+    bool _cksum;
+    uint32_t _burst;
+    bool _random;
+    bool _tsc;
+    bool _active;
+    bool _stop;
+    bool _trace_gaps;
+
+    FlowTemplate *_flows;
+    Vector<TraceEntry> _trace;
+    unsigned char *_zeros;
+    uint32_t _max_length;
+    Worker *_workers;
+    atomic_uint32_t _ndone;
+
+    bool _use_tsc;
+    uint64_t _hz;			// clock ticks per second
+    double _gap;			// clock ticks between one thread's packets
+
+    inline uint64_t now_ticks() const;
+    int read_trace(const String &filename, ErrorHandler *errh);
+    void build_flow(uint32_t k, FlowTemplate &f) const;
+    inline Packet *make_packet(Worker &w, uint32_t length);
+    inline uint32_t next_random(Worker &w);
+    void restart(Worker &w);
+    bool run(Worker &w);
+    static bool task_hook(Task *, void *);
+
+    enum { h_count, h_bytes, h_rate, h_thread_stats, h_active, h_reset };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
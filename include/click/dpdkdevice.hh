@@ -65,6 +65,11 @@ public:
     EtherAddress get_mac();
     void set_init_mac(EtherAddress mac);
     void set_init_mtu(uint16_t mtu);
+    int set_rx_rss(uint64_t rss_hf, ErrorHandler *errh) CLICK_COLD;
+    int set_rx_mark_anno(int anno, ErrorHandler *errh) CLICK_COLD;
+    int rx_mark_anno() const {
+        return info.mark_anno;
+    }
 
     unsigned int get_nb_txdesc();
     int nbRXQueues();
@@ -89,6 +94,8 @@ public:
             return p->buffer_destructor() == DPDKDevice::free_pkt || (p->data_packet() && is_dpdk_packet(p->data_packet()));
     }
 
+    inline static uint32_t flow_mark(const rte_mbuf *mbuf);
+
     inline static rte_mbuf* get_pkt(unsigned numa_node);
     inline static rte_mbuf* get_pkt();
     static void free_pkt(unsigned char *, size_t, void *pktmbuf);
@@ -117,7 +124,7 @@ private:
     struct DevInfo {
         inline DevInfo() :
             rx_queues(0,false), tx_queues(0,false), promisc(false), n_rx_descs(0),
-            n_tx_descs(0), init_mac(), init_mtu(0) {
+            n_tx_descs(0), init_mac(), init_mtu(0), rss_hf(0), mark_anno(-1) {
             rx_queues.reserve(128);
             tx_queues.reserve(128);
         }
@@ -130,6 +137,8 @@ private:
         unsigned n_tx_descs;
         EtherAddress init_mac;
         uint16_t init_mtu;
+        uint64_t rss_hf;
+        int mark_anno;
     };
 
     DevInfo info;
@@ -141,6 +150,7 @@ private:
     static bool no_more_buffer_msg_printed;
 
     int initialize_device(ErrorHandler *errh) CLICK_COLD;
+    void spread_reta() CLICK_COLD;
     int add_queue(Dir dir, unsigned &queue_id, bool promisc,
                    unsigned n_desc, ErrorHandler *errh) CLICK_COLD;
 
@@ -189,6 +199,27 @@ inline rte_mbuf* DPDKDevice::get_pkt() {
     return get_pkt(rte_socket_id());
 }
 
+/** @brief Return the rte_flow MARK of a received mbuf, or 0 if none. */
+inline uint32_t DPDKDevice::flow_mark(const rte_mbuf *mbuf) {
+#if defined(RTE_MBUF_F_RX_FDIR_ID)
+    if (mbuf->ol_flags & RTE_MBUF_F_RX_FDIR_ID)
+        return mbuf->hash.fdir.hi;
+#elif defined(PKT_RX_FDIR_ID)
+    if (mbuf->ol_flags & PKT_RX_FDIR_ID)
+        return mbuf->hash.fdir.hi;
+#else
+    (void) mbuf;
+#endif
+    return 0;
+}
+
+/** @class DPDKRSSArg
+  @brief Parser class for a space-separated list of RSS hash fields, such
+  as "ip udp tcp". */
+class DPDKRSSArg { public:
+    static bool parse(const String &str, uint64_t &result, const ArgContext &args = ArgContext());
+};
+
 /** @class DPDKPortArg
   @brief Parser class for DPDK Port, either an integer or a PCI address. */
 class DPDKDeviceArg { public:
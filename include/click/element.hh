@@ -6,6 +6,9 @@
 #include <click/string.hh>
 #include <click/packet.hh>
 #include <click/handler.hh>
+#if CLICK_STATS >= 2
+# include <click/perfevent.hh>
+#endif
 CLICK_DECLS
 class Router;
 class Master;
@@ -271,21 +274,53 @@ class Element { public:
 
 #if CLICK_STATS >= 2
     // STATISTICS
-    unsigned _xfer_calls;       // Push and pull calls into this element.
-    click_cycles_t _xfer_own_cycles;    // Cycles spent in self from push and pull.
-    click_cycles_t _child_cycles;       // Cycles spent in children.
+    // Each thread charges its own slot, so counts need no synchronization.
+    struct ThreadStats {
+        unsigned xfer_calls;            // Push and pull calls into this element.
+        unsigned task_calls;            // Calls to tasks owned by this element.
+        unsigned timer_calls;           // Calls to timers owned by this element.
+        ProfileSample xfer_own;         // Spent in self from push and pull.
+        ProfileSample task_own;         // Spent in self from tasks.
+        ProfileSample timer_own;        // Spent in self from timers.
+        ProfileSample child;            // Spent in children.
+        inline void clear() {
+            xfer_calls = task_calls = timer_calls = 0;
+            xfer_own.clear();
+            task_own.clear();
+            timer_own.clear();
+            child.clear();
+        }
+        inline void add(const ThreadStats &x) {
+            xfer_calls += x.xfer_calls;
+            task_calls += x.task_calls;
+            timer_calls += x.timer_calls;
+            xfer_own += x.xfer_own;
+            task_own += x.task_own;
+            timer_own += x.timer_own;
+            child += x.child;
+        }
+        bool any() const {
+            return xfer_own.cycles || task_own.cycles || timer_own.cycles;
+        }
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
 
-    unsigned _task_calls;       // Calls to tasks owned by this element.
-    click_cycles_t _task_own_cycles;    // Cycles spent in self from tasks.
+    ThreadStats *_stats;
+    unsigned _nstats;
 
-    unsigned _timer_calls;      // Calls to timers owned by this element.
-    click_cycles_t _timer_own_cycles;   // Cycles spent in self from timers.
+    static inline unsigned stats_thread() {
+        return click_current_cpu_id();
+    }
+    inline ThreadStats &thread_stats(unsigned t) {
+        return _stats[t < _nstats ? t : 0];
+    }
+    ThreadStats total_stats() const;
 
     inline void reset_cycles() {
-        _xfer_calls = _task_calls = _timer_calls = 0;
-        _xfer_own_cycles = _task_own_cycles = _timer_own_cycles = _child_cycles = 0;
+        for (unsigned t = 0; t < _nstats; ++t)
+            _stats[t].clear();
     }
     static String read_cycles_handler(Element *, void *);
+    static String read_profile_handler(Element *, void *);
     static int write_cycles_handler(const String &, Element *, void *, ErrorHandler *);
 #endif
 
@@ -614,18 +649,18 @@ Element::Port::push(Packet* p) const
 #endif
 #if CLICK_STATS >= 2
     ++_e->input(_port)._packets;
-    click_cycles_t start_cycles = click_get_cycles(),
-        start_child_cycles = _e->_child_cycles;
+    unsigned t = Element::stats_thread();
+    Element::ThreadStats &es = _e->thread_stats(t);
+    ProfileSample start = ProfileSample::now(), start_child = es.child;
 # if HAVE_BOUND_PORT_TRANSFER
     _bound.push(_e, _port, p);
 # else
     _e->push(_port, p);
 # endif
-    click_cycles_t all_delta = click_get_cycles() - start_cycles,
-        own_delta = all_delta - (_e->_child_cycles - start_child_cycles);
-    _e->_xfer_calls += 1;
-    _e->_xfer_own_cycles += own_delta;
-    _owner->_child_cycles += all_delta;
+    ProfileSample all_delta = ProfileSample::now() - start;
+    es.xfer_calls += 1;
+    es.xfer_own += all_delta - (es.child - start_child);
+    _owner->thread_stats(t).child += all_delta;
 #else
 # if HAVE_BOUND_PORT_TRANSFER
     _bound.push(_e, _port, p);
@@ -656,8 +691,9 @@ Element::Port::pull() const
 {
     assert(_e);
 #if CLICK_STATS >= 2
-    click_cycles_t start_cycles = click_get_cycles(),
-        old_child_cycles = _e->_child_cycles;
+    unsigned t = Element::stats_thread();
+    Element::ThreadStats &es = _e->thread_stats(t);
+    ProfileSample start = ProfileSample::now(), start_child = es.child;
 # if HAVE_BOUND_PORT_TRANSFER
     Packet *p = _bound.pull(_e, _port);
 # else
@@ -665,11 +701,10 @@ Element::Port::pull() const
 # endif
     if (p)
         _e->output(_port)._packets += 1;
-    click_cycles_t all_delta = click_get_cycles() - start_cycles,
-        own_delta = all_delta - (_e->_child_cycles - old_child_cycles);
-    _e->_xfer_calls += 1;
-    _e->_xfer_own_cycles += own_delta;
-    _owner->_child_cycles += all_delta;
+    ProfileSample all_delta = ProfileSample::now() - start;
+    es.xfer_calls += 1;
+    es.xfer_own += all_delta - (es.child - start_child);
+    _owner->thread_stats(t).child += all_delta;
 #else
 # if HAVE_BOUND_PORT_TRANSFER
     Packet *p = _bound.pull(_e, _port);
@@ -0,0 +1,781 @@
+#ifndef CLICK_FLATHASHTABLE_HH
+#define CLICK_FLATHASHTABLE_HH
+/*
+ * flathashtable.hh -- FlatHashTable template
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software")
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+#include <click/pair.hh>
+#include <click/hashcode.hh>
+#include <click/integers.hh>
+#include <click/glue.hh>
+#if defined(__SSE2__) && !CLICK_LINUXMODULE && !CLICK_BSDMODULE
+# define CLICK_FLATHASHTABLE_SSE2 1
+# include <emmintrin.h>
+#endif
+CLICK_DECLS
+
+/** @file <click/flathashtable.hh>
+ * @brief Click's open-addressed hash table container template.
+ */
+
+template <typename K, typename V> class FlatHashTable;
+template <typename K, typename V> class FlatHashTable_iterator;
+template <typename K, typename V> class FlatHashTable_const_iterator;
+
+/** @class FlatHashTable
+  @brief Open-addressed hash table template.
+
+  FlatHashTable<K, V> maps keys K to values V.  Its interface matches
+  HashTable<K, V>'s, so most code can switch between the two by changing a
+  type name.
+
+  Unlike HashTable, which allocates a node per element and chains nodes
+  within buckets, FlatHashTable stores elements directly in one array of
+  slots.  A parallel array holds one control byte per slot: either a marker
+  for an empty or erased slot, or seven bits of the element's hash code.
+  Slots are grouped sixteen at a time.  A lookup hashes the key to a group
+  and compares the key's seven hash bits against all sixteen control bytes
+  at once, using SSE2 when available, so it usually examines one cache line
+  of control bytes and at most one element.  Groups are probed
+  quadratically until one containing an empty slot is found.
+
+  The price is weaker stability.  Inserting an element may move every
+  element in the table, so insertion invalidates all iterators and element
+  pointers.  Code that keeps pointers to elements, or links elements into
+  other structures, should use HashTable or HashContainer.  (Erasing an
+  element does not move the others.)  A FlatHashTable also needs one large
+  contiguous allocation, which makes it a poor choice for very large tables
+  in the kernel.
+*/
+template <typename K, typename V>
+class FlatHashTable {
+
+  public:
+
+    /** @brief Key type. */
+    typedef K key_type;
+
+    /** @brief Const reference to key type. */
+    typedef const K &key_const_reference;
+
+    /** @brief Value type. */
+    typedef V mapped_type;
+
+    /** @brief Pair of key type and value type. */
+    typedef Pair<const K, V> value_type;
+
+    /** @brief Type of sizes. */
+    typedef size_t size_type;
+
+    /** @brief Type of bucket sizes. */
+    typedef size_t bucket_count_type;
+
+    enum {
+	group_size = 16,
+	initial_bucket_count = 16
+    };
+
+
+    /** @brief Construct an empty hash table with normal default value. */
+    FlatHashTable()
+	: _default_value() {
+	initialize();
+    }
+
+    /** @brief Construct an empty hash table with default value @a d. */
+    explicit FlatHashTable(const mapped_type &d)
+	: _default_value(d) {
+	initialize();
+    }
+
+    /** @brief Construct an empty hash table with at least @a n buckets.
+     * @param d default value
+     * @param n minimum number of buckets */
+    FlatHashTable(const mapped_type &d, bucket_count_type n)
+	: _default_value(d) {
+	initialize();
+	rehash(n);
+    }
+
+    /** @brief Construct a hash table as a copy of @a x. */
+    FlatHashTable(const FlatHashTable<K, V> &x)
+	: _default_value(x._default_value) {
+	initialize();
+	copy_elements(x);
+    }
+
+#if HAVE_CXX_RVALUE_REFERENCES
+    /** @overload */
+    FlatHashTable(FlatHashTable<K, V> &&x)
+	: _default_value() {
+	initialize();
+	x.swap(*this);
+    }
+#endif
+
+    /** @brief Destroy this hash table, freeing its memory. */
+    ~FlatHashTable();
+
+
+    /** @brief Return the number of elements in the hash table. */
+    inline size_type size() const {
+	return _size;
+    }
+
+    /** @brief Return true iff size() == 0. */
+    inline bool empty() const {
+	return _size == 0;
+    }
+
+    /** @brief Return the number of buckets (slots) in the hash table. */
+    inline bucket_count_type bucket_count() const {
+	return _capacity;
+    }
+
+    /** @brief Return the number of elements in slot @a n, which is 0 or 1.
+     * @param n slot number, >= 0 and < bucket_count() */
+    inline size_type bucket_size(bucket_count_type n) const {
+	return _ctrl[n] >= 0;
+    }
+
+    /** @brief Return the hash table's default value.
+     *
+     * The default value is returned by operator[]() when a key does not
+     * exist. */
+    inline const mapped_type &default_value() const {
+	return _default_value;
+    }
+
+
+    typedef FlatHashTable_const_iterator<K, V> const_iterator;
+    typedef FlatHashTable_iterator<K, V> iterator;
+
+    /** @brief Return an iterator for the first element in the table.
+     *
+     * @note FlatHashTable iterators return elements in undefined order. */
+    inline iterator begin() {
+	return iterator(this, first_full(0));
+    }
+    /** @overload */
+    inline const_iterator begin() const {
+	return const_iterator(this, first_full(0));
+    }
+
+    /** @brief Return an iterator for the end of the table.
+     * @invariant end().live() == false */
+    inline iterator end() {
+	return iterator(this, _capacity);
+    }
+    /** @overload */
+    inline const_iterator end() const {
+	return const_iterator(this, _capacity);
+    }
+
+
+    /** @brief Return 1 if an element with key @a key exists, 0 otherwise. */
+    inline size_type count(key_const_reference key) const {
+	return find_slot(key, mix(key)) != _capacity;
+    }
+
+    /** @brief Return an iterator for the element with key @a key, if any.
+     *
+     * Returns end() if no such element exists. */
+    inline const_iterator find(key_const_reference key) const {
+	return const_iterator(this, find_slot(key, mix(key)));
+    }
+    /** @overload */
+    inline iterator find(key_const_reference key) {
+	return iterator(this, find_slot(key, mix(key)));
+    }
+
+    /** @brief Return an iterator for the element with key @a key, if any.
+     *
+     * Provided for compatibility with HashTable; equivalent to find(). */
+    inline iterator find_prefer(key_const_reference key) {
+	return find(key);
+    }
+
+
+    /** @brief Return the value for @a key.
+     *
+     * If no element for @a key currently exists (find(@a key) == end()),
+     * returns default_value(). */
+    const mapped_type &get(key_const_reference key) const {
+	size_type i = find_slot(key, mix(key));
+	return i != _capacity ? _slots[i].second : _default_value;
+    }
+
+    /** @brief Return a pointer to the value for @a key.
+     *
+     * If no element for @a key currently exists (find(@a key) == end()),
+     * returns null. */
+    mapped_type *get_pointer(key_const_reference key) {
+	size_type i = find_slot(key, mix(key));
+	return i != _capacity ? &_slots[i].second : 0;
+    }
+    /** @overload */
+    const mapped_type *get_pointer(key_const_reference key) const {
+	size_type i = find_slot(key, mix(key));
+	return i != _capacity ? &_slots[i].second : 0;
+    }
+
+    /** @brief Return the value for @a key.
+     *
+     * If no element for @a key currently exists (find(@a key) == end()),
+     * returns default_value().
+     *
+     * @warning The overloaded operator[] on non-const hash tables may add an
+     * element to the table.  If you don't want to add an element, either
+     * access operator[] through a const hash table, or use get().  */
+    const mapped_type &operator[](key_const_reference key) const {
+	return get(key);
+    }
+
+    /** @brief Return a reference to the value for @a key.
+     *
+     * The caller can assign the reference to change the value.  If no element
+     * for @a key currently exists (find(@a key) == end()), adds a new element
+     * with default_value() and returns a reference to that value.
+     *
+     * @note Inserting an element into a FlatHashTable invalidates all
+     * existing iterators and element pointers. */
+    inline mapped_type &operator[](key_const_reference key) {
+	return find_insert(key).value();
+    }
+
+
+    /** @brief Ensure an element with key @a key and return its iterator.
+     *
+     * If an element with @a key already exists in the table, then find(@a
+     * key) and find_insert(@a key) are equivalent.  Otherwise, find_insert
+     * adds a new element with key @a key and value default_value() to the
+     * table and returns its iterator.  Returns end() if memory is
+     * exhausted.
+     *
+     * @note Inserting an element into a FlatHashTable invalidates all
+     * existing iterators and element pointers. */
+    inline iterator find_insert(key_const_reference key) {
+	return find_insert(key, _default_value);
+    }
+
+    /** @brief Ensure an element for key @a key and return its iterator.
+     *
+     * If an element with @a key already exists in the table, then find(@a
+     * key) and find_insert(@a key, @a value) are equivalent.  Otherwise,
+     * find_insert(@a key, @a value) adds a new element with key @a key and
+     * value @a value to the table and returns its iterator.  Returns end()
+     * if memory is exhausted.
+     *
+     * @note Inserting an element into a FlatHashTable invalidates all
+     * existing iterators and element pointers. */
+    iterator find_insert(key_const_reference key, const mapped_type &value);
+
+
+    /** @brief Set the mapping for @a key to @a value.
+     *
+     * If an element for @a key already exists in the table, then its value is
+     * assigned to @a value and the function returns false.  Otherwise, a new
+     * element mapping @a key to @a value is added and the function returns
+     * true.
+     *
+     * @note Inserting an element into a FlatHashTable invalidates all
+     * existing iterators and element pointers. */
+    bool set(key_const_reference key, const mapped_type &value);
+
+    /** @brief Remove the element indicated by @a it.
+     * @return A valid iterator pointing at the next element remaining, or
+     * end() if no such element exists. */
+    iterator erase(const iterator &it) {
+	erase_slot(it._pos);
+	return iterator(this, first_full(it._pos + 1));
+    }
+
+    /** @brief Remove any element with @a key.
+     *
+     * Returns the number of elements removed, which is always 0 or 1. */
+    size_type erase(key_const_reference key) {
+	size_type i = find_slot(key, mix(key));
+	if (i == _capacity)
+	    return 0;
+	erase_slot(i);
+	return 1;
+    }
+
+    /** @brief Remove all elements.
+     * @post size() == 0 */
+    void clear();
+
+
+    /** @brief Swap the contents of this hash table and @a x. */
+    void swap(FlatHashTable<K, V> &x);
+
+
+    /** @brief Rehash the table, ensuring it contains at least @a n buckets.
+     *
+     * The table is also made large enough to hold its current elements.
+     * All existing iterators and element pointers are invalidated. */
+    void rehash(bucket_count_type n);
+
+
+    /** @brief Assign this hash table's contents to a copy of @a x. */
+    FlatHashTable<K, V> &operator=(const FlatHashTable<K, V> &x);
+
+#if HAVE_CXX_RVALUE_REFERENCES
+    /** @overload */
+    FlatHashTable<K, V> &operator=(FlatHashTable<K, V> &&x) {
+	x.swap(*this);
+	return *this;
+    }
+#endif
+
+  private:
+
+    enum {
+	ctrl_empty = -128,
+	ctrl_deleted = -2
+    };
+
+    int8_t *_ctrl;
+    value_type *_slots;
+    size_type _capacity;
+    size_type _size;
+    size_type _growth_left;
+    V _default_value;
+
+    static inline uint32_t mix(key_const_reference key) {
+	return (uint32_t) hashcode(key) * 0x9E3779B9U;
+    }
+    static inline int8_t h2(uint32_t x) {
+	return x >> 25;
+    }
+    static inline size_type h1(uint32_t x) {
+	return x ^ (x >> 16);
+    }
+    static inline size_type max_load(size_type capacity) {
+	return capacity - capacity / 8;
+    }
+
+    static inline unsigned match(const int8_t *group, int8_t c);
+    static inline unsigned match_free(const int8_t *group);
+
+    inline void initialize();
+    inline size_type find_slot(key_const_reference key, uint32_t x) const;
+    inline size_type find_free(uint32_t x) const;
+    inline size_type first_full(size_type i) const;
+    inline void erase_slot(size_type i);
+    bool resize(size_type capacity);
+    void destroy_elements();
+    void copy_elements(const FlatHashTable<K, V> &x);
+
+    friend class FlatHashTable_iterator<K, V>;
+    friend class FlatHashTable_const_iterator<K, V>;
+
+};
+
+/** @class FlatHashTable_const_iterator
+ * @brief The const_iterator type for FlatHashTable. */
+template <typename K, typename V>
+class FlatHashTable_const_iterator { public:
+
+    typedef typename FlatHashTable<K, V>::size_type size_type;
+
+    /** @brief Construct an uninitialized iterator. */
+    FlatHashTable_const_iterator() {
+    }
+
+    /** @brief Return a pointer to the element, null if *this == end(). */
+    const Pair<const K, V> *get() const {
+	if (_pos != _t->_capacity)
+	    return &_t->_slots[_pos];
+	else
+	    return 0;
+    }
+
+    /** @brief Return a pointer to the element.
+     * @pre *this != end() */
+    const Pair<const K, V> *operator->() const {
+	return &_t->_slots[_pos];
+    }
+
+    /** @brief Return a reference to the element.
+     * @pre *this != end() */
+    const Pair<const K, V> &operator*() const {
+	return _t->_slots[_pos];
+    }
+
+    /** @brief Return a reference to the element's key.
+     * @pre *this != end()
+     * @return operator*().first */
+    const K &key() const {
+	return operator*().first;
+    }
+
+    /** @brief Return a reference to the element's value.
+     * @pre *this != end()
+     * @return operator*().second */
+    const V &value() const {
+	return operator*().second;
+    }
+
+    /** @brief Return true iff *this != end(). */
+    bool live() const {
+	return _pos != _t->_capacity;
+    }
+
+    typedef bool (FlatHashTable_const_iterator::*unspecified_bool_type)() const;
+    /** @brief Return true iff *this != end(). */
+    inline operator unspecified_bool_type() const {
+	return live() ? &FlatHashTable_const_iterator::live : 0;
+    }
+
+    /** @brief Advance this iterator to the next element. */
+    void operator++(int) {
+	_pos = _t->first_full(_pos + 1);
+    }
+
+    /** @brief Advance this iterator to the next element. */
+    void operator++() {
+	_pos = _t->first_full(_pos + 1);
+    }
+
+  private:
+
+    const FlatHashTable<K, V> *_t;
+    size_type _pos;
+
+    inline FlatHashTable_const_iterator(const FlatHashTable<K, V> *t, size_type pos)
+	: _t(t), _pos(pos) {
+    }
+
+    friend class FlatHashTable<K, V>;
+    friend class FlatHashTable_iterator<K, V>;
+
+};
+
+/** @class FlatHashTable_iterator
+ * @brief The iterator type for FlatHashTable. */
+template <typename K, typename V>
+class FlatHashTable_iterator : public FlatHashTable_const_iterator<K, V> { public:
+
+    typedef FlatHashTable_const_iterator<K, V> inherited;
+    typedef typename inherited::size_type size_type;
+
+    /** @brief Construct an uninitialized iterator. */
+    FlatHashTable_iterator() {
+    }
+
+    /** @brief Return a pointer to the element, null if *this == end(). */
+    Pair<const K, V> *get() const {
+	return const_cast<Pair<const K, V> *>(inherited::get());
+    }
+
+    /** @brief Return a pointer to the element.
+     * @pre *this != end() */
+    inline Pair<const K, V> *operator->() const {
+	return const_cast<Pair<const K, V> *>(inherited::operator->());
+    }
+
+    /** @brief Return a reference to the element.
+     * @pre *this != end() */
+    inline Pair<const K, V> &operator*() const {
+	return const_cast<Pair<const K, V> &>(inherited::operator*());
+    }
+
+    /** @brief Return a mutable reference to the element's value.
+     * @pre *this != end()
+     * @return operator*().second */
+    V &value() const {
+	return operator*().second;
+    }
+
+  private:
+
+    inline FlatHashTable_iterator(const FlatHashTable<K, V> *t, size_type pos)
+	: inherited(t, pos) {
+    }
+
+    friend class FlatHashTable<K, V>;
+
+};
+
+
+/* Return a bitmask of the slots in @a group whose control byte equals @a c.
+   Bit i corresponds to slot i. */
+template <typename K, typename V>
+inline unsigned FlatHashTable<K, V>::match(const int8_t *group, int8_t c)
+{
+#if CLICK_FLATHASHTABLE_SSE2
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(c), ctrl));
+#else
+    unsigned m = 0;
+    for (int i = 0; i < group_size; ++i)
+	m |= (unsigned) (group[i] == c) << i;
+    return m;
+#endif
+}
+
+/* Return a bitmask of the empty or erased slots in @a group.  Both control
+   values have the high bit set; full slots do not. */
+template <typename K, typename V>
+inline unsigned FlatHashTable<K, V>::match_free(const int8_t *group)
+{
+#if CLICK_FLATHASHTABLE_SSE2
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(group)));
+#else
+    unsigned m = 0;
+    for (int i = 0; i < group_size; ++i)
+	m |= (unsigned) (group[i] < 0) << i;
+    return m;
+#endif
+}
+
+template <typename K, typename V>
+inline void FlatHashTable<K, V>::initialize()
+{
+    _ctrl = 0;
+    _slots = 0;
+    _capacity = _size = _growth_left = 0;
+}
+
+template <typename K, typename V>
+inline typename FlatHashTable<K, V>::size_type
+FlatHashTable<K, V>::find_slot(key_const_reference key, uint32_t x) const
+{
+    if (!_capacity)
+	return 0;
+    size_type gmask = _capacity / group_size - 1;
+    size_type g = h1(x) & gmask;
+    int8_t c = h2(x);
+    // The table always has an empty slot, so this loop terminates.
+    for (size_type step = 1; ; ++step) {
+	const int8_t *group = _ctrl + g * group_size;
+	for (unsigned m = match(group, c); m; m &= m - 1) {
+	    size_type i = g * group_size + ffs_lsb(m) - 1;
+	    if (likely(_slots[i].first == key))
+		return i;
+	}
+	if (likely(match(group, ctrl_empty)))
+	    return _capacity;
+	g = (g + step) & gmask;
+    }
+}
+
+template <typename K, typename V>
+inline typename FlatHashTable<K, V>::size_type
+FlatHashTable<K, V>::find_free(uint32_t x) const
+{
+    size_type gmask = _capacity / group_size - 1;
+    size_type g = h1(x) & gmask;
+    for (size_type step = 1; ; ++step) {
+	if (unsigned m = match_free(_ctrl + g * group_size))
+	    return g * group_size + ffs_lsb(m) - 1;
+	g = (g + step) & gmask;
+    }
+}
+
+template <typename K, typename V>
+inline typename FlatHashTable<K, V>::size_type
+FlatHashTable<K, V>::first_full(size_type i) const
+{
+    while (i < _capacity && _ctrl[i] < 0)
+	++i;
+    return i < _capacity ? i : _capacity;
+}
+
+template <typename K, typename V>
+inline void FlatHashTable<K, V>::erase_slot(size_type i)
+{
+    _slots[i].~value_type();
+    --_size;
+    // A probe passes a group only if the group has no empty slot.  If this
+    // group still has one, no probe has passed it, and the slot can become
+    // empty; otherwise it must remain a tombstone.
+    if (match(_ctrl + (i & ~(size_type) (group_size - 1)), ctrl_empty)) {
+	_ctrl[i] = ctrl_empty;
+	++_growth_left;
+    } else
+	_ctrl[i] = ctrl_deleted;
+}
+
+template <typename K, typename V>
+FlatHashTable<K, V>::~FlatHashTable()
+{
+    destroy_elements();
+    if (_capacity)
+	CLICK_LFREE(_ctrl, _capacity * (1 + sizeof(value_type)));
+}
+
+template <typename K, typename V>
+void FlatHashTable<K, V>::destroy_elements()
+{
+    for (size_type i = 0; _size && i < _capacity; ++i)
+	if (_ctrl[i] >= 0) {
+	    _slots[i].~value_type();
+	    --_size;
+	}
+}
+
+template <typename K, typename V>
+bool FlatHashTable<K, V>::resize(size_type capacity)
+{
+    // _ctrl and _slots share one allocation: capacity control bytes followed
+    // by capacity slots.  capacity is a multiple of 16, which keeps the
+    // slots aligned.
+    int8_t *ctrl = (int8_t *) CLICK_LALLOC(capacity * (1 + sizeof(value_type)));
+    if (!ctrl)
+	return false;
+    memset(ctrl, ctrl_empty, capacity);
+
+    int8_t *old_ctrl = _ctrl;
+    value_type *old_slots = _slots;
+    size_type old_capacity = _capacity;
+    _ctrl = ctrl;
+    _slots = reinterpret_cast<value_type *>(ctrl + capacity);
+    _capacity = capacity;
+    _growth_left = max_load(capacity) - _size;
+
+    for (size_type i = 0; i < old_capacity; ++i)
+	if (old_ctrl[i] >= 0) {
+	    uint32_t x = mix(old_slots[i].first);
+	    size_type j = find_free(x);
+	    _ctrl[j] = h2(x);
+	    new((void *) &_slots[j]) value_type(old_slots[i]);
+	    old_slots[i].~value_type();
+	}
+    if (old_capacity)
+	CLICK_LFREE(old_ctrl, old_capacity * (1 + sizeof(value_type)));
+    return true;
+}
+
+template <typename K, typename V>
+typename FlatHashTable<K, V>::iterator
+FlatHashTable<K, V>::find_insert(key_const_reference key, const mapped_type &value)
+{
+    uint32_t x = mix(key);
+    size_type i = find_slot(key, x);
+    if (i != _capacity)
+	return iterator(this, i);
+
+    if (_capacity)
+	i = find_free(x);
+    if (!_capacity || (_growth_left == 0 && _ctrl[i] == ctrl_empty)) {
+	// Grow if live elements fill more than half of the usable slots.
+	// Otherwise at least half are tombstones, and rehashing at the same
+	// size frees enough of them to pay for itself.
+	size_type capacity = initial_bucket_count;
+	if (_capacity)
+	    capacity = _size > max_load(_capacity) / 2 ? _capacity * 2 : _capacity;
+	if (!resize(capacity))
+	    return end();
+	i = find_free(x);
+    }
+
+    _growth_left -= (_ctrl[i] == ctrl_empty);
+    _ctrl[i] = h2(x);
+    new((void *) &_slots[i]) value_type(key, value);
+    ++_size;
+    return iterator(this, i);
+}
+
+template <typename K, typename V>
+bool FlatHashTable<K, V>::set(key_const_reference key, const mapped_type &value)
+{
+    size_type old_size = _size;
+    iterator it = find_insert(key, value);
+    if (_size != old_size)
+	return true;
+    if (it.live())
+	it.value() = value;
+    return false;
+}
+
+template <typename K, typename V>
+void FlatHashTable<K, V>::clear()
+{
+    destroy_elements();
+    if (_capacity) {
+	memset(_ctrl, ctrl_empty, _capacity);
+	_growth_left = max_load(_capacity);
+    }
+}
+
+template <typename K, typename V>
+void FlatHashTable<K, V>::swap(FlatHashTable<K, V> &x)
+{
+    click_swap(_ctrl, x._ctrl);
+    click_swap(_slots, x._slots);
+    click_swap(_capacity, x._capacity);
+    click_swap(_size, x._size);
+    click_swap(_growth_left, x._growth_left);
+    click_swap(_default_value, x._default_value);
+}
+
+template <typename K, typename V>
+void FlatHashTable<K, V>::rehash(bucket_count_type n)
+{
+    size_type capacity = initial_bucket_count;
+    while (capacity < n || max_load(capacity) <= _size)
+	capacity *= 2;
+    resize(capacity);
+}
+
+template <typename K, typename V>
+void FlatHashTable<K, V>::copy_elements(const FlatHashTable<K, V> &x)
+{
+    // Copy slot by slot, so the copy keeps x's layout and needs no hashing.
+    if (x._capacity && resize(x._capacity)) {
+	memcpy(_ctrl, x._ctrl, _capacity);
+	for (size_type i = 0; i < _capacity; ++i)
+	    if (_ctrl[i] >= 0)
+		new((void *) &_slots[i]) value_type(x._slots[i]);
+	_size = x._size;
+	_growth_left = x._growth_left;
+    }
+}
+
+template <typename K, typename V>
+FlatHashTable<K, V> &FlatHashTable<K, V>::operator=(const FlatHashTable<K, V> &x)
+{
+    if (&x != this) {
+	FlatHashTable<K, V> tmp(x);
+	swap(tmp);
+    }
+    return *this;
+}
+
+template <typename K, typename V>
+inline bool operator==(const FlatHashTable_const_iterator<K, V> &a, const FlatHashTable_const_iterator<K, V> &b)
+{
+    return a.get() == b.get();
+}
+
+template <typename K, typename V>
+inline bool operator!=(const FlatHashTable_const_iterator<K, V> &a, const FlatHashTable_const_iterator<K, V> &b)
+{
+    return a.get() != b.get();
+}
+
+template <typename K, typename V>
+inline void click_swap(FlatHashTable<K, V> &a, FlatHashTable<K, V> &b)
+{
+    a.swap(b);
+}
+
+template <typename K, typename V>
+inline void assign_consume(FlatHashTable<K, V> &a, FlatHashTable<K, V> &b)
+{
+    a.swap(b);
+}
+
+CLICK_ENDDECLS
+#endif
@@ -697,6 +697,14 @@ click_get_cycles()
 #endif
 }
 
+#if CLICK_USERLEVEL
+/** @brief Return the rate of click_get_cycles() in cycles per second.
+ *
+ * The rate is calibrated on first use, which takes about 20 milliseconds.
+ * Returns 0 if click_get_cycles() is not implemented on this platform. */
+click_cycles_t click_cycles_per_second();
+#endif
+
 CLICK_ENDDECLS
 
 #endif
@@ -42,6 +42,12 @@ class Handler { public:
 	f_button = 0x2000,	///< @brief Write handler ignores data.
 	f_checkbox = 0x4000,	///< @brief Read/write handler is boolean and
 				///  should be rendered as a checkbox.
+	f_counter = 0x8000,	///< @brief Read handler returns a number
+				///  that only increases, such as a packet
+				///  count.  Monitoring exports it.
+	f_gauge = 0x10000,	///< @brief Read handler returns a number
+				///  that can go up and down, such as a
+				///  queue length.  Monitoring exports it.
 	f_driver0 = 1U << 26,
         f_driver1 = 1U << 27,   ///< @brief Uninterpreted handler flags
 				///  available for drivers.
@@ -48,6 +48,8 @@ template <typename T> class HashTable_const_iterator;
   (April 2008, sparsehash-1.1), HashTable appears to perform slightly better
   than g++'s hash_map, better than sparse_hash_map, and worse than
   dense_hash_map; it takes less memory than hash_map and dense_hash_map.
+  FlatHashTable provides an open-addressed alternative with the same
+  interface, for lookup-heavy tables whose elements need not stay put.
 
   HashTable is faster than Click's prior HashMap class and has fewer potential
   race conditions in multithreaded use.  HashMap remains for backward
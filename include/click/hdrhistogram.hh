@@ -0,0 +1,206 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_HDRHISTOGRAM_HH
+#define CLICK_HDRHISTOGRAM_HH
+#include <click/glue.hh>
+#include <click/integers.hh>
+CLICK_DECLS
+
+/** @file <click/hdrhistogram.hh>
+ * @brief A high-dynamic-range histogram of 64-bit values.
+ */
+
+/** @class HdrHistogram include/click/hdrhistogram.hh <click/hdrhistogram.hh>
+ * @brief A histogram with constant relative precision over the full range of
+ * 64-bit values.
+ *
+ * Values below 2<sup>B</sup> are counted exactly, where B is the number of
+ * significant bits given to initialize().  Larger values fall into buckets
+ * whose width is at most 2<sup>1-B</sup> times their lower bound, so every
+ * reported value is within that relative error of the true value.  Recording
+ * is a few shifts and an increment; memory is fixed at initialization.
+ *
+ * An HdrHistogram is not synchronized.  To record from several threads, give
+ * each thread its own histogram and merge them with add() when reporting. */
+class HdrHistogram { public:
+
+    /** @brief Construct an empty, uninitialized histogram. */
+    HdrHistogram()
+	: _counts(0), _bits(0), _nbuckets(0) {
+	clear_stats();
+    }
+
+    ~HdrHistogram() {
+	delete[] _counts;
+    }
+
+    /** @brief Allocate buckets for @a significant_bits bits of precision.
+     * @return 0 on success, -1 if @a significant_bits is out of range or
+     * memory is exhausted
+     *
+     * @a significant_bits must be between 2 and 16.  Any previous contents
+     * are discarded. */
+    int initialize(int significant_bits) {
+	if (significant_bits < 2 || significant_bits > 16)
+	    return -1;
+	delete[] _counts;
+	_bits = significant_bits;
+	_nbuckets = (1U << _bits) + (64 - _bits) * (1U << (_bits - 1));
+	if (!(_counts = new uint64_t[_nbuckets]))
+	    return -1;
+	clear();
+	return 0;
+    }
+
+    /** @brief Return the number of significant bits. */
+    int significant_bits() const {
+	return _bits;
+    }
+
+    /** @brief Remove all recorded values. */
+    void clear() {
+	if (_counts)
+	    memset(_counts, 0, sizeof(uint64_t) * _nbuckets);
+	clear_stats();
+    }
+
+    /** @brief Record @a n occurrences of @a value. */
+    inline void record(uint64_t value, uint64_t n = 1);
+
+    /** @brief Add the contents of @a x to this histogram.
+     * @pre @a x has the same number of significant bits. */
+    void add(const HdrHistogram &x) {
+	assert(x._bits == _bits);
+	for (uint32_t i = 0; i < _nbuckets; ++i)
+	    _counts[i] += x._counts[i];
+	if (x._count && (!_count || x._min < _min))
+	    _min = x._min;
+	if (x._max > _max)
+	    _max = x._max;
+	_count += x._count;
+	_sum += x._sum;
+    }
+
+    /** @brief Return the number of recorded values. */
+    uint64_t count() const {
+	return _count;
+    }
+
+    /** @brief Return the smallest recorded value, or 0 if none. */
+    uint64_t min() const {
+	return _min;
+    }
+
+    /** @brief Return the largest recorded value, or 0 if none. */
+    uint64_t max() const {
+	return _max;
+    }
+
+    /** @brief Return the mean of the recorded values, or 0 if none. */
+    double mean() const {
+	return _count ? _sum / _count : 0;
+    }
+
+    /** @brief Return the value at percentile @a p.
+     * @param p percentile, between 0 and 100
+     *
+     * Returns the upper bound of the bucket containing the value with rank
+     * ceil(@a p * count() / 100), clamped to [min(), max()].  Returns 0 if
+     * the histogram is empty. */
+    uint64_t percentile(double p) const;
+
+    /** @brief Return the number of buckets. */
+    uint32_t nbuckets() const {
+	return _nbuckets;
+    }
+
+    /** @brief Return the number of values recorded in bucket @a i. */
+    uint64_t bucket_count(uint32_t i) const {
+	return _counts[i];
+    }
+
+    /** @brief Return the smallest value that falls in bucket @a i. */
+    inline uint64_t bucket_low(uint32_t i) const;
+
+    /** @brief Return the largest value that falls in bucket @a i. */
+    inline uint64_t bucket_high(uint32_t i) const;
+
+  private:
+
+    uint64_t *_counts;
+    int _bits;
+    uint32_t _nbuckets;
+    uint64_t _count;
+    uint64_t _min;
+    uint64_t _max;
+    double _sum;
+
+    HdrHistogram(const HdrHistogram &);
+    HdrHistogram &operator=(const HdrHistogram &);
+
+    void clear_stats() {
+	_count = _min = _max = 0;
+	_sum = 0;
+    }
+
+    inline uint32_t bucket(uint64_t value) const {
+	if (value < ((uint64_t) 1 << _bits))
+	    return value;
+	int shift = 64 - ffs_msb(value) - _bits + 1;
+	uint32_t half = 1U << (_bits - 1);
+	return (1U << _bits) + (shift - 1) * half + (uint32_t) (value >> shift) - half;
+    }
+
+};
+
+inline uint64_t
+HdrHistogram::bucket_low(uint32_t i) const
+{
+    if (i < (1U << _bits))
+	return i;
+    uint32_t half = 1U << (_bits - 1);
+    int shift = (i - (1U << _bits)) / half + 1;
+    return ((uint64_t) ((i - (1U << _bits)) % half) + half) << shift;
+}
+
+inline uint64_t
+HdrHistogram::bucket_high(uint32_t i) const
+{
+    if (i < (1U << _bits))
+	return i;
+    int shift = (i - (1U << _bits)) / (1U << (_bits - 1)) + 1;
+    return bucket_low(i) + (((uint64_t) 1 << shift) - 1);
+}
+
+inline void
+HdrHistogram::record(uint64_t value, uint64_t n)
+{
+    _counts[bucket(value)] += n;
+    if (!_count || value < _min)
+	_min = value;
+    if (value > _max)
+	_max = value;
+    _count += n;
+    _sum += (double) value * n;
+}
+
+inline uint64_t
+HdrHistogram::percentile(double p) const
+{
+    if (!_count)
+	return 0;
+    uint64_t rank = (uint64_t) (p * _count / 100);
+    if ((double) rank * 100 < p * _count)
+	++rank;
+    if (rank < 1)
+	rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < _nbuckets; ++i)
+	if ((seen += _counts[i]) >= rank) {
+	    uint64_t v = bucket_high(i);
+	    return v < _min ? _min : (v > _max ? _max : v);
+	}
+    return _max;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,352 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/jsonstream.cc" -*-
+#ifndef CLICK_JSONSTREAM_HH
+#define CLICK_JSONSTREAM_HH
+#include <click/straccum.hh>
+#include <click/vector.hh>
+#include <click/type_traits.hh>
+CLICK_DECLS
+
+/** @file <click/jsonstream.hh>
+ * @brief Streaming JSON output and event-driven JSON parsing. */
+
+/** @class JsonWriter
+ * @brief Writes JSON text directly into a StringAccum.
+ *
+ * A JsonWriter builds no tree.  Each call appends its text to the
+ * StringAccum immediately, inserting the commas and colons that JSON
+ * requires, so producing a large handler result costs one buffer and no
+ * per-value allocations.  Example:
+ *
+ * @code
+ * StringAccum sa;
+ * JsonWriter w(sa);
+ * w.begin_object().key("count").value(2)
+ *  .key("addrs").begin_array().quoted(ip1).quoted(ip2).end_array()
+ *  .end_object();
+ * // sa == "{\"count\":2,\"addrs\":[\"10.0.0.1\",\"10.0.0.2\"]}"
+ * @endcode
+ *
+ * The writer does not check that calls nest properly or that object values
+ * follow keys; that is the caller's responsibility.  Strings are escaped as
+ * String::encode_json() escapes them. */
+class JsonWriter { public:
+
+    /** @brief Construct a writer that appends to @a sa. */
+    explicit inline JsonWriter(StringAccum &sa)
+	: _sa(sa), _comma(false) {
+    }
+
+    /** @brief Return the underlying StringAccum. */
+    inline StringAccum &sa() const {
+	return _sa;
+    }
+
+    inline JsonWriter &begin_object();
+    inline JsonWriter &end_object();
+    inline JsonWriter &begin_array();
+    inline JsonWriter &end_array();
+
+    /** @brief Append an object key.  The next call should append its
+     * value. */
+    inline JsonWriter &key(const char *s, int len);
+    inline JsonWriter &key(const String &s);
+    inline JsonWriter &key(const char *cstr);
+
+    inline JsonWriter &null();
+    inline JsonWriter &value(bool x);
+    inline JsonWriter &value(int x);
+    inline JsonWriter &value(unsigned x);
+    inline JsonWriter &value(long x);
+    inline JsonWriter &value(unsigned long x);
+#if HAVE_LONG_LONG
+    inline JsonWriter &value(long long x);
+    inline JsonWriter &value(unsigned long long x);
+#endif
+#if HAVE_INT64_TYPES && !HAVE_INT64_IS_LONG && !HAVE_INT64_IS_LONG_LONG
+    inline JsonWriter &value(int64_t x);
+    inline JsonWriter &value(uint64_t x);
+#endif
+#if HAVE_FLOAT_TYPES
+    JsonWriter &value(double x);
+#endif
+    inline JsonWriter &value(const char *s, int len);
+    inline JsonWriter &value(const String &s);
+    inline JsonWriter &value(const char *cstr);
+
+    /** @brief Append @a x's StringAccum representation as a JSON string.
+     *
+     * This formats @a x with <tt>sa << x</tt> directly into the buffer, so
+     * addresses, timestamps, and similar values need no temporary String.
+     * The text is escaped afterwards if necessary. */
+    template <typename T> JsonWriter &quoted(const T &x) {
+	separate();
+	_sa << '\"';
+	int pos = _sa.length();
+	_sa << x;
+	escape_from(pos);
+	_sa << '\"';
+	_comma = true;
+	return *this;
+    }
+
+    /** @brief Append @a x's StringAccum representation as a JSON number.
+     *
+     * The representation must be valid JSON number syntax, as it is for
+     * Timestamp values. */
+    template <typename T> JsonWriter &number(const T &x) {
+	separate();
+	_sa << x;
+	_comma = true;
+	return *this;
+    }
+
+    /** @brief Append @a s, which must be valid JSON text, as a value. */
+    inline JsonWriter &raw(const String &s);
+
+    /** @brief Append @a s to @a sa as the contents of a JSON string, without
+     * surrounding quotes. */
+    static void append_escaped(StringAccum &sa, const char *s, int len);
+
+  private:
+
+    StringAccum &_sa;
+    bool _comma;
+
+    inline void separate();
+    void escape_from(int pos);
+
+};
+
+/** @class JsonParser
+ * @brief Event-driven JSON parser.
+ *
+ * JsonParser reads JSON text and reports what it finds through virtual
+ * callbacks, rather than building a tree.  Subclasses override the
+ * callbacks they care about; the defaults accept everything.  A callback
+ * can stop the parse by returning false.
+ *
+ * String and key callbacks receive pointers into the input when the text
+ * contains no escapes, and otherwise into a buffer the parser reuses, so
+ * the data is valid only until the callback returns.  Numbers are passed as
+ * text, exactly as they appear in the input, together with a flag saying
+ * whether they are integers; on_number() converts them further if asked.
+ * Nesting is tracked with an explicit stack, so deeply nested input cannot
+ * overflow the C stack. */
+class JsonParser { public:
+
+    JsonParser();
+    virtual ~JsonParser();
+
+    /** @brief Parse @a str.
+     * @return true iff @a str contains exactly one valid JSON value and no
+     * callback returned false
+     *
+     * On failure, error_offset() reports where parsing stopped. */
+    bool parse(const String &str);
+    bool parse(const char *begin, const char *end);
+
+    /** @brief Return the offset of the parse error, or -1 if the last parse
+     * succeeded. */
+    inline int error_offset() const {
+	return _error_offset;
+    }
+
+    /** @brief Return the nesting depth of the value being reported. */
+    inline int depth() const {
+	return _stack.size();
+    }
+
+    enum { max_depth = 1024 };
+
+  protected:
+
+    virtual bool on_begin_object();
+    virtual bool on_key(const char *s, int len);
+    virtual bool on_end_object();
+    virtual bool on_begin_array();
+    virtual bool on_end_array();
+    virtual bool on_null();
+    virtual bool on_bool(bool x);
+    virtual bool on_string(const char *s, int len);
+
+    /** @brief Report a number.
+     * @param s the number's text
+     * @param len the text's length
+     * @param integer true iff the text has no fraction or exponent
+     *
+     * The default implementation calls on_integer() for integers that fit in
+     * click_intmax_t and, when floating point is available, on_double() for
+     * other numbers.  It fails on integers that do not fit if floating point
+     * is unavailable. */
+    virtual bool on_number(const char *s, int len, bool integer);
+    virtual bool on_integer(click_intmax_t x);
+#if HAVE_FLOAT_TYPES
+    virtual bool on_double(double x);
+#endif
+
+  private:
+
+    Vector<char> _stack;
+    StringAccum _buf;
+    int _error_offset;
+
+    const char *parse_string(const char *s, const char *end, bool is_key);
+    const char *parse_primitive(const char *s, const char *end);
+
+};
+
+
+inline void JsonWriter::separate() {
+    if (_comma)
+	_sa << ',';
+}
+
+/** @brief Begin an object. */
+inline JsonWriter &JsonWriter::begin_object() {
+    separate();
+    _sa << '{';
+    _comma = false;
+    return *this;
+}
+
+/** @brief End the current object. */
+inline JsonWriter &JsonWriter::end_object() {
+    _sa << '}';
+    _comma = true;
+    return *this;
+}
+
+/** @brief Begin an array. */
+inline JsonWriter &JsonWriter::begin_array() {
+    separate();
+    _sa << '[';
+    _comma = false;
+    return *this;
+}
+
+/** @brief End the current array. */
+inline JsonWriter &JsonWriter::end_array() {
+    _sa << ']';
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::key(const char *s, int len) {
+    separate();
+    _sa << '\"';
+    append_escaped(_sa, s, len);
+    _sa << '\"' << ':';
+    _comma = false;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::key(const String &s) {
+    return key(s.data(), s.length());
+}
+
+inline JsonWriter &JsonWriter::key(const char *cstr) {
+    return key(cstr, strlen(cstr));
+}
+
+/** @brief Append null. */
+inline JsonWriter &JsonWriter::null() {
+    separate();
+    _sa.append("null", 4);
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(bool x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(int x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(unsigned x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(long x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(unsigned long x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+#if HAVE_LONG_LONG
+inline JsonWriter &JsonWriter::value(long long x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(unsigned long long x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+#endif
+
+#if HAVE_INT64_TYPES && !HAVE_INT64_IS_LONG && !HAVE_INT64_IS_LONG_LONG
+inline JsonWriter &JsonWriter::value(int64_t x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(uint64_t x) {
+    separate();
+    _sa << x;
+    _comma = true;
+    return *this;
+}
+#endif
+
+/** @brief Append the string @a s of length @a len. */
+inline JsonWriter &JsonWriter::value(const char *s, int len) {
+    separate();
+    _sa << '\"';
+    append_escaped(_sa, s, len);
+    _sa << '\"';
+    _comma = true;
+    return *this;
+}
+
+inline JsonWriter &JsonWriter::value(const String &s) {
+    return value(s.data(), s.length());
+}
+
+inline JsonWriter &JsonWriter::value(const char *cstr) {
+    return value(cstr, strlen(cstr));
+}
+
+inline JsonWriter &JsonWriter::raw(const String &s) {
+    separate();
+    _sa << s;
+    _comma = true;
+    return *this;
+}
+
+CLICK_ENDDECLS
+#endif
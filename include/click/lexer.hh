@@ -90,6 +90,7 @@ class Lexer { public:
 	return _element_type_map[name];
     }
     int force_element_type(String name, bool report_error = true);
+    Element *create_element(int t) const;
 
     void element_type_names(Vector<String> &) const;
 
@@ -79,4 +79,17 @@ inline void click_write_fence() {
 #endif
 }
 
+/** @brief Prefetch the cache line containing @a p for reading.
+
+    This is a hint only; @a p need not point to valid memory. */
+inline void click_prefetch0(const void *p) {
+#if CLICK_LINUXMODULE
+    prefetch(p);
+#elif defined(__GNUC__)
+    __builtin_prefetch(p, 0, 3);
+#else
+    (void) p;
+#endif
+}
+
 #endif
@@ -0,0 +1,125 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/perfevent.cc" -*-
+#ifndef CLICK_PERFEVENT_HH
+#define CLICK_PERFEVENT_HH
+#include <click/glue.hh>
+CLICK_DECLS
+class String;
+class ErrorHandler;
+
+/** @file <click/perfevent.hh>
+ * @brief Hardware performance counters for element profiling.
+ *
+ * When Click is built with --enable-stats=2, every push, pull, task, and
+ * timer call is bracketed by ProfileSample::now(), and the difference is
+ * charged to the element.  A ProfileSample always holds the cycle counter.
+ * At user level on Linux, it can also hold up to PerfEvents::nevents
+ * additional counters, such as retired instructions or last-level cache
+ * misses, chosen with PerfEvents::configure().  These are read with
+ * perf_event_open(2) counters that each thread opens on first use; when the
+ * kernel allows it, they are read in user space with rdpmc. */
+
+class PerfEvents { public:
+
+    enum { nevents = 2 };
+
+    /** @brief Select the counters to collect.
+     * @param spec comma-separated event names, such as
+     * "instructions,llc-misses"
+     * @return 0 on success, -1 on error
+     *
+     * Must be called before any thread reads counters.  Known names are
+     * instructions, cache-references, cache-misses (or llc-misses),
+     * branch-instructions, branch-misses, bus-cycles, ref-cycles,
+     * stalled-cycles-frontend, stalled-cycles-backend, page-faults,
+     * and context-switches. */
+    static int configure(const String &spec, ErrorHandler *errh);
+
+    /** @brief Return the number of configured counters. */
+    static int nconfigured() {
+	return _nconfigured;
+    }
+
+    /** @brief Return the name of configured counter @a i. */
+    static const char *name(int i);
+
+    /** @brief Store the current thread's configured counters in @a v.
+     *
+     * Unconfigured and unavailable counters read as 0. */
+    static inline void read(uint64_t *v) {
+#if CLICK_USERLEVEL && defined(__linux__)
+	if (_nconfigured) {
+	    read_slow(v);
+	    return;
+	}
+#endif
+	for (int i = 0; i < nevents; ++i)
+	    v[i] = 0;
+    }
+
+  private:
+
+    static int _nconfigured;
+
+    static void read_slow(uint64_t *v);
+
+};
+
+/** @class ProfileSample
+ * @brief A snapshot of the cycle counter and configured performance
+ * counters. */
+class ProfileSample { public:
+
+    click_cycles_t cycles;
+    uint64_t events[PerfEvents::nevents];
+
+    /** @brief Return the current thread's counters. */
+    static inline ProfileSample now() {
+	ProfileSample s;
+	s.cycles = click_get_cycles();
+	PerfEvents::read(s.events);
+	return s;
+    }
+
+    /** @brief Return a sample with every counter zero. */
+    static inline ProfileSample zero() {
+	ProfileSample s;
+	s.clear();
+	return s;
+    }
+
+    void clear() {
+	cycles = 0;
+	for (int i = 0; i < PerfEvents::nevents; ++i)
+	    events[i] = 0;
+    }
+
+    ProfileSample &operator+=(const ProfileSample &x) {
+	cycles += x.cycles;
+	for (int i = 0; i < PerfEvents::nevents; ++i)
+	    events[i] += x.events[i];
+	return *this;
+    }
+
+    ProfileSample &operator-=(const ProfileSample &x) {
+	cycles -= x.cycles;
+	for (int i = 0; i < PerfEvents::nevents; ++i)
+	    events[i] -= x.events[i];
+	return *this;
+    }
+
+};
+
+inline ProfileSample
+operator+(ProfileSample a, const ProfileSample &b)
+{
+    return a += b;
+}
+
+inline ProfileSample
+operator-(ProfileSample a, const ProfileSample &b)
+{
+    return a -= b;
+}
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,96 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_PERTHREAD_HH
+#define CLICK_PERTHREAD_HH
+#include <click/glue.hh>
+CLICK_DECLS
+
+/** @file <click/perthread.hh>
+ * @brief Per-thread copies of a value.
+ */
+
+/** @class PerThread include/click/perthread.hh <click/perthread.hh>
+ * @brief One copy of a value per thread, each on its own cache line.
+ *
+ * PerThread holds an array of T indexed by click_current_cpu_id().  Each
+ * thread updates its own copy without locks or atomic operations, and no
+ * two copies share a cache line, so threads never contend.  Readers that
+ * need a total, such as handlers, iterate over all copies; since writers
+ * are not stopped, a total may miss updates that are in flight.
+ *
+ * @code
+ * struct Stats { uint64_t count; };
+ * PerThread<Stats> _stats;
+ * ...
+ * _stats->count++;                    // in the fast path
+ * ...
+ * uint64_t n = 0;                     // in a handler
+ * for (unsigned i = 0; i < _stats.size(); ++i)
+ *     n += _stats[i].count;
+ * @endcode
+ *
+ * T must be default-constructible.  Copies are value-initialized, so
+ * plain counters start at 0. */
+template <typename T>
+class PerThread { public:
+
+    /** @brief Construct a copy for every possible thread. */
+    PerThread()
+	: _n(click_max_cpu_ids()) {
+	if (_n == 0)
+	    _n = 1;
+	_slots = new Slot[_n]();
+    }
+
+    ~PerThread() {
+	delete[] _slots;
+    }
+
+    /** @brief Return the number of copies. */
+    unsigned size() const {
+	return _slots ? _n : 0;
+    }
+
+    /** @brief Return copy @a i. */
+    T &operator[](unsigned i) {
+	return _slots[i].v;
+    }
+    /** @overload */
+    const T &operator[](unsigned i) const {
+	return _slots[i].v;
+    }
+
+    /** @brief Return the current thread's copy. */
+    inline T &get() {
+	unsigned i = click_current_cpu_id();
+	return _slots[i < _n ? i : 0].v;
+    }
+
+    T &operator*() {
+	return get();
+    }
+    T *operator->() {
+	return &get();
+    }
+
+    /** @brief Assign @a x to every copy. */
+    void set_all(const T &x) {
+	for (unsigned i = 0; i < size(); ++i)
+	    _slots[i].v = x;
+    }
+
+  private:
+
+    struct Slot {
+	T v;
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+    Slot *_slots;
+    unsigned _n;
+
+    PerThread(const PerThread<T> &);
+    PerThread<T> &operator=(const PerThread<T> &);
+
+};
+
+CLICK_ENDDECLS
+#endif
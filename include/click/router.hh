@@ -6,6 +6,7 @@
 #include <click/sync.hh>
 #include <click/task.hh>
 #include <click/standard/threadsched.hh>
+#include <click/hashtable.hh>
 #if CLICK_NS
 # include <click/simclick.h>
 #endif
@@ -16,9 +17,11 @@ class RouterVisitor;
 class RouterThread;
 class HashMap_ArenaFactory;
 class NotifierSignal;
+class Notifier;
 class ThreadSched;
 class Handler;
 class NameInfo;
+struct RouterImage;
 
 class Router { public:
 
@@ -129,7 +132,7 @@ class Router { public:
 #endif
 
     inline Router* hotswap_router() const;
-    void set_hotswap_router(Router* router);
+    void set_hotswap_router(Router* router, bool incremental = false);
 
     int initialize(ErrorHandler* errh);
     void activate(bool foreground, ErrorHandler* errh);
@@ -138,6 +141,9 @@ class Router { public:
 
     int new_notifier_signal(const char *name, NotifierSignal &signal);
     String notifier_signal_name(const atomic_uint32_t *signal) const;
+    void add_notifier_link(Element *listener, Element *owner, Notifier *notifier,
+                           void (*f)(void *, Notifier *), void *user_data);
+    void add_handler_user(const Element *e);
     //@}
 
     /** @cond never */
@@ -251,7 +257,7 @@ class Router { public:
     Vector<element_landmark_t> _element_landmarks;
     uint32_t _last_landmarkid;
 
-    mutable Vector<int> _element_name_sorter;
+    mutable HashTable<String, int> _element_name_map;
     Vector<int> _element_gport_offset[2];
     Vector<int> _element_configure_order;
 
@@ -289,8 +295,22 @@ class Router { public:
         }
     };
     notifier_signals_t *_notifier_signals;
+
+    struct notifier_link_t {
+        Element *listener;
+        Element *owner;
+        Notifier *notifier;
+        void (*f)(void *, Notifier *);
+        void *user_data;
+    };
+    Vector<notifier_link_t> _notifier_links;
+    Vector<int> _element_handler_users;
+
     HashMap_ArenaFactory* _arena_factory;
     Router* _hotswap_router;
+    bool _hotswap_incremental;
+    Vector<int> _hotswap_adopted;
+    Vector<Element*> _hotswap_fresh;
     ThreadSched* _thread_sched;
     mutable NameInfo* _name_info;
     Vector<int> _flow_code_override_eindex;
@@ -328,6 +348,11 @@ class Router { public:
 
     int hard_home_thread_id(const Element *e) const;
 
+    void connection_signatures(Vector<String> &sigs) const;
+    void hotswap_adopt();
+    void hotswap_unadopt(Vector<int> &element_stage);
+    void hotswap_finish_adoption();
+
     int element_lerror(ErrorHandler*, Element*, const char*, ...) const;
 
     // private handler methods
@@ -346,6 +371,7 @@ class Router { public:
     /** @cond never */
     friend class Master;
     friend class Task;
+    friend struct RouterImage;
     friend int Element::set_nports(int, int);
     /** @endcond never */
 
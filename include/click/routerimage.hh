@@ -0,0 +1,66 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/routerimage.cc" -*-
+#ifndef CLICK_ROUTERIMAGE_HH
+#define CLICK_ROUTERIMAGE_HH
+#include <click/string.hh>
+CLICK_DECLS
+class ErrorHandler;
+class Router;
+class Lexer;
+class LexerExtra;
+class Master;
+
+/** @file <click/routerimage.hh>
+ * @brief Binary images of flattened routers. */
+
+/** @class RouterImage
+ * @brief Binary image of a flattened router.
+ *
+ * A router image holds everything the lexer produces for a configuration:
+ * each element's class, name, configuration string, and landmark, the
+ * connections, and the requirements.  Compound elements are already
+ * expanded and names already resolved.  Instantiating a router from an
+ * image skips lexing entirely; it only creates the elements and adds the
+ * connections, so large configurations start much faster.  Elements still
+ * parse their configuration strings in configure().
+ *
+ * Images are written by "click --image" after the router initializes
+ * successfully, and click_read_router() recognizes them by their first
+ * bytes.  An image is tied to the Click version, word size, and byte order
+ * that wrote it.  At user level, image files are mapped into memory rather
+ * than read, and the router's strings point straight into the mapping. */
+struct RouterImage {
+
+    /** @brief Return true iff @a data starts like a router image. */
+    static bool is_image(const String &data);
+
+    /** @brief Return the image of @a router.
+     *
+     * @a router need not be initialized. */
+    static String unparse(const Router *router);
+
+    /** @brief Create a router from an image.
+     * @param image image data
+     * @param filename image file name, for error messages
+     * @param lexer lexer that supplies element classes
+     * @param lextra handles requirements, may be null
+     * @param master master for the new router
+     * @param errh error message receiver
+     * @return new, uninitialized router, or null on error */
+    static Router *parse(const String &image, const String &filename,
+			 Lexer *lexer, LexerExtra *lextra, Master *master,
+			 ErrorHandler *errh);
+
+#if CLICK_USERLEVEL
+    /** @brief Map image file @a filename into memory.
+     * @return the mapped image, or a null string if @a filename is not a
+     * router image or cannot be mapped
+     *
+     * The mapping is never removed, so strings pointing into it stay
+     * valid for the life of the program. */
+    static String map_file(const String &filename);
+#endif
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,167 @@
+// -*- c-basic-offset: 4; related-file-name: "../../../elements/standard/pacingwheel.cc" -*-
+#ifndef CLICK_PACINGWHEEL_HH
+#define CLICK_PACINGWHEEL_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+
+/*
+=c
+
+PacingWheel([I<keywords> SLOT, SLOTS])
+
+=s shaping
+
+shared departure-time scheduler for shaping elements
+
+=io
+
+None
+
+=d
+
+Provides a timing wheel that shaping elements use to wait for their next
+departure time, instead of each running its own Task and Timer.  When a
+PacingWheel is present in the configuration, RatedUnqueue,
+BandwidthRatedUnqueue, LinkUnqueue, and DelayShaper register with it
+automatically.  Without one, they behave as before.
+
+Time is divided into slots of length SLOT.  The wheel keeps one wheel of
+SLOTS slots per thread, and a single Task per thread fires all clients whose
+departure slot has arrived, so a configuration with thousands of shaped links
+needs only one Task per thread.  Inserting and removing a client take
+constant time.  Departure times are rounded up to the next slot boundary.
+
+At most one PacingWheel may appear in a configuration.
+
+Keyword arguments are:
+
+=over 8
+
+=item SLOT
+
+Time.  Slot length, with microsecond precision.  Default is 10 microseconds.
+
+=item SLOTS
+
+Unsigned integer.  Number of slots per thread, rounded up to a power of two.
+Departure times more than SLOT*SLOTS in the future are still honored, but are
+visited once per rotation.  Default is 4096.
+
+=back
+
+=h scheduled read-only
+
+Returns the number of clients currently waiting on the wheel.
+
+=h fires read-only
+
+Returns the number of times a client was fired.
+
+=e
+
+  PacingWheel(SLOT 10us);
+  q1 :: Queue -> BandwidthRatedUnqueue(10Mbps) -> ...;
+  q2 :: Queue -> BandwidthRatedUnqueue(2Mbps) -> ...;
+
+=a RatedUnqueue, BandwidthRatedUnqueue, LinkUnqueue, DelayShaper */
+
+class PacingWheel : public Element { public:
+
+    /** @brief An object that waits on a PacingWheel.
+     *
+     * Shaping elements inherit from Client and implement run_pacing(), which
+     * is called on the scheduling thread once the requested departure time
+     * has arrived. */
+    class Client { public:
+
+	Client()
+	    : _pw_next(0), _pw_prev(0), _pw_slot(0), _pw_wheel(-1) {
+	}
+	virtual ~Client() {
+	}
+
+	/** @brief Called once the departure time has arrived.
+	 * @param now current time
+	 *
+	 * The client is no longer scheduled when this is called, and may
+	 * call PacingWheel::schedule() again. */
+	virtual void run_pacing(const Timestamp &now) = 0;
+
+	/** @brief Return true iff this client is waiting on a wheel. */
+	bool pacing_scheduled() const {
+	    return _pw_wheel >= 0;
+	}
+
+      private:
+
+	Client *_pw_next;
+	Client *_pw_prev;
+	uint64_t _pw_slot;
+	int _pw_wheel;
+
+	friend class PacingWheel;
+
+    };
+
+    PacingWheel() CLICK_COLD;
+    ~PacingWheel() CLICK_COLD;
+
+    const char *class_name() const	{ return "PacingWheel"; }
+    int configure_phase() const		{ return CONFIGURE_PHASE_INFO; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    /** @brief Return the PacingWheel in @a e's router, or null if there is
+     * none. */
+    static PacingWheel *find(Element *e);
+
+    /** @brief Schedule @a c to fire at @a when on the current thread.
+     *
+     * If @a c is already scheduled, it is first unscheduled. */
+    void schedule(Client *c, const Timestamp &when);
+
+    /** @brief Unschedule @a c, if it is scheduled. */
+    void unschedule(Client *c);
+
+  private:
+
+    enum { pw_firing = -2 };
+
+    struct Wheel {
+	Client **slot;
+	uint64_t *nonempty;		// bit b: slot[b] != 0
+	uint64_t cursor;		// first slot not yet fired
+	uint64_t wake;			// slot the Task or Timer is armed for
+	uint32_t count;
+	uint32_t fires;
+	Vector<Client *> due;
+	Spinlock lock;
+	Task *task;
+	Timer *timer;
+	PacingWheel *owner;
+    };
+
+    Wheel *_wheels;
+    int _nwheels;
+    uint32_t _slot_usec;
+    uint32_t _nslots;			// power of two
+
+    inline uint64_t slot_of(const Timestamp &t) const;
+    inline Timestamp time_of(uint64_t slot) const;
+    inline void unlink(Wheel &w, Client *c);
+    bool next_slot(const Wheel &w, uint64_t &slot) const;
+    void arm(Wheel &w, uint64_t slot);
+    bool run_wheel(Wheel &w);
+    static bool task_hook(Task *, void *);
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
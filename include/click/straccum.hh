@@ -178,7 +178,7 @@ inline StringAccum::StringAccum(int capacity) {
     assert(capacity >= 0);
     unsigned char *s;
     if (capacity
-	&& (s = (unsigned char *) CLICK_LALLOC(capacity + MEMO_SPACE))) {
+	&& (s = (unsigned char *) String::alloc_memory(capacity + MEMO_SPACE))) {
 	r_.s = s + MEMO_SPACE;
 	r_.cap = capacity;
     }
@@ -205,7 +205,7 @@ inline StringAccum::StringAccum(StringAccum &&x)
 /** @brief Destroy a StringAccum, freeing its memory. */
 inline StringAccum::~StringAccum() {
     if (r_.cap > 0)
-	CLICK_LFREE(r_.s - MEMO_SPACE, r_.cap + MEMO_SPACE);
+	String::free_memory(r_.s - MEMO_SPACE, r_.cap + MEMO_SPACE);
 }
 
 /** @brief Return the contents of the StringAccum.
@@ -12,6 +12,9 @@
 # include <string.h>
 #endif
 #define CLICK_CONSTANT_CSTR(cstr) ((cstr) && __builtin_constant_p(strlen((cstr))))
+#if (CLICK_USERLEVEL || CLICK_NS || CLICK_MINIOS) && (!HAVE_MULTITHREAD || HAVE___THREAD_STORAGE_CLASS) && !CLICK_DMALLOC
+# define HAVE_STRING_POOL 1
+#endif
 CLICK_DECLS
 class StringAccum;
 
@@ -176,6 +179,8 @@ class String { public:
     static void profile_report(StringAccum &sa, int examples = 0);
 #endif
 
+    static void static_cleanup();
+
     static inline const char *skip_utf8_char(const char *first, const char *last);
     static const unsigned char *skip_utf8_char(const unsigned char *first,
 					       const unsigned char *last);
@@ -285,6 +290,8 @@ class String { public:
     }
     static memo_t *create_memo(char *space, int dirty, int capacity);
     static void delete_memo(memo_t *memo);
+    static void *alloc_memory(int size);
+    static void free_memory(void *p, int size);
     const char *hard_c_str() const;
     bool hard_equals(const char *s, int len) const;
 
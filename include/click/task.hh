@@ -573,8 +573,8 @@ inline bool
 Task::fire()
 {
 #if CLICK_STATS >= 2
-    click_cycles_t start_cycles = click_get_cycles(),
-        start_child_cycles = _owner->_child_cycles;
+    Element::ThreadStats &es = _owner->thread_stats(Element::stats_thread());
+    ProfileSample start = ProfileSample::now(), start_child = es.child;
 #endif
 #if HAVE_MULTITHREAD
     _cycle_runs++;
@@ -589,10 +589,9 @@ Task::fire()
     _work_done += work_done;
 #endif
 #if CLICK_STATS >= 2
-    click_cycles_t all_delta = click_get_cycles() - start_cycles,
-        own_delta = all_delta - (_owner->_child_cycles - start_child_cycles);
-    _owner->_task_calls += 1;
-    _owner->_task_own_cycles += own_delta;
+    ProfileSample all_delta = ProfileSample::now() - start;
+    es.task_calls += 1;
+    es.task_own += all_delta - (es.child - start_child);
 #endif
     return work_done;
 }
@@ -180,6 +180,16 @@ class Timer { public:
      * elements. */
     void initialize(Router *router);
 
+    /** @brief Move the timer to thread @a thread_id.
+     * @pre initialized()
+     *
+     * A timer normally runs on its owner element's home thread.  This
+     * function moves it to another thread; the timer's callback will run
+     * there from now on.  A scheduled timer remains scheduled for the same
+     * expiration time.  Call move_thread() after initialize(), since
+     * initialize() resets the thread. */
+    void move_thread(int thread_id);
+
 
     /** @brief Schedule the timer to fire at @a when_steady.
      * @param when_steady expiration time according to the steady clock
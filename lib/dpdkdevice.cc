@@ -20,6 +20,7 @@
 
 #include <click/config.h>
 #include <click/dpdkdevice.hh>
+#include <click/confparse.hh>
 #include <rte_errno.h>
 
 CLICK_DECLS
@@ -121,7 +122,10 @@ int DPDKDevice::initialize_device(ErrorHandler *errh)
 #endif
     dev_conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
     dev_conf.rx_adv_conf.rss_conf.rss_key = NULL;
-    dev_conf.rx_adv_conf.rss_conf.rss_hf = ETH_RSS_IP | ETH_RSS_UDP | ETH_RSS_TCP;
+    dev_conf.rx_adv_conf.rss_conf.rss_hf = info.rss_hf ? info.rss_hf
+        : ETH_RSS_IP | ETH_RSS_UDP | ETH_RSS_TCP;
+    // Devices reject hash fields they do not support
+    dev_conf.rx_adv_conf.rss_conf.rss_hf &= dev_info.flow_type_rss_offloads;
 
     //We must open at least one queue per direction
     if (info.rx_queues.size() == 0) {
@@ -259,6 +263,9 @@ int DPDKDevice::initialize_device(ErrorHandler *errh)
     if (info.promisc)
         rte_eth_promiscuous_enable(port_id);
 
+    if (info.rx_queues.size() > 1)
+        spread_reta();
+
     if (info.init_mac != EtherAddress()) {
         struct ether_addr addr;
         memcpy(&addr,info.init_mac.data(),sizeof(struct ether_addr));
@@ -270,6 +277,54 @@ int DPDKDevice::initialize_device(ErrorHandler *errh)
     return 0;
 }
 
+/* Spread the RSS redirection table round-robin over every RX queue, so that
+ * flows are balanced evenly between queues whatever the driver's default.
+ * Devices that cannot update their table keep the default. */
+void DPDKDevice::spread_reta()
+{
+    struct rte_eth_dev_info dev_info;
+    rte_eth_dev_info_get(port_id, &dev_info);
+    unsigned reta_size = dev_info.reta_size;
+    if (reta_size == 0)
+        return;
+
+    unsigned ngroups = (reta_size + RTE_RETA_GROUP_SIZE - 1) / RTE_RETA_GROUP_SIZE;
+    struct rte_eth_rss_reta_entry64 *reta =
+        new struct rte_eth_rss_reta_entry64[ngroups];
+    memset(reta, 0, sizeof(*reta) * ngroups);
+    for (unsigned i = 0; i < reta_size; ++i) {
+        struct rte_eth_rss_reta_entry64 &g = reta[i / RTE_RETA_GROUP_SIZE];
+        g.mask |= 1ULL << (i % RTE_RETA_GROUP_SIZE);
+        g.reta[i % RTE_RETA_GROUP_SIZE] = i % info.rx_queues.size();
+    }
+    if (rte_eth_dev_rss_reta_update(port_id, reta, reta_size) != 0)
+        click_chatter("DPDK port %u: cannot update RSS redirection table, "
+                      "using the driver's default", port_id);
+    delete[] reta;
+}
+
+int DPDKDevice::set_rx_rss(uint64_t rss_hf, ErrorHandler *errh)
+{
+    assert(!_is_initialized);
+    if (info.rss_hf && info.rss_hf != rss_hf)
+        return errh->error(
+            "Some elements disagree on the RSS hash fields for device %u",
+            port_id);
+    info.rss_hf = rss_hf;
+    return 0;
+}
+
+int DPDKDevice::set_rx_mark_anno(int anno, ErrorHandler *errh)
+{
+    assert(!_is_initialized);
+    if (info.mark_anno >= 0 && info.mark_anno != anno)
+        return errh->error(
+            "Some elements disagree on the flow mark annotation for device %u",
+            port_id);
+    info.mark_anno = anno;
+    return 0;
+}
+
 void DPDKDevice::set_init_mac(EtherAddress mac) {
     assert(!_is_initialized);
     info.init_mac = mac;
@@ -478,6 +533,44 @@ DPDKDeviceArg::parse(
     return true;
 }
 
+bool
+DPDKRSSArg::parse(const String &str, uint64_t &result, const ArgContext &ctx)
+{
+    static const struct {
+        const char *name;
+        uint64_t hf;
+    } fields[] = {
+        { "ip", ETH_RSS_IP },
+        { "ipv4", ETH_RSS_IPV4 },
+        { "ipv6", ETH_RSS_IPV6 },
+        { "udp", ETH_RSS_UDP },
+        { "tcp", ETH_RSS_TCP },
+        { "sctp", ETH_RSS_SCTP },
+        { "l2", ETH_RSS_L2_PAYLOAD }
+    };
+
+    Vector<String> words;
+    cp_spacevec(str, words);
+    uint64_t hf = 0;
+    for (String *it = words.begin(); it != words.end(); ++it) {
+        size_t i;
+        for (i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+            if (*it == fields[i].name)
+                break;
+        if (i == sizeof(fields) / sizeof(fields[0])) {
+            ctx.error("unknown RSS field %<%s%>", it->c_str());
+            return false;
+        }
+        hf |= fields[i].hf;
+    }
+    if (!hf) {
+        ctx.error("no RSS fields");
+        return false;
+    }
+    result = hf;
+    return true;
+}
+
 int DPDKDevice::NB_MBUF = 65536;
 #ifdef RTE_MBUF_DEFAULT_BUF_SIZE
 int DPDKDevice::MBUF_DATA_SIZE = RTE_MBUF_DEFAULT_BUF_SIZE;
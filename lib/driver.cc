@@ -54,6 +54,7 @@
 # include <click/straccum.hh>
 # include <click/nameinfo.hh>
 # include <click/bighashmap_arena.hh>
+# include <click/routerimage.hh>
 #endif
 
 #if HAVE_DYNAMIC_LINKING && !CLICK_LINUXMODULE && !CLICK_BSDMODULE
@@ -472,6 +473,7 @@ click_static_cleanup()
     cp_va_static_cleanup();
     NameInfo::static_cleanup();
     HashMap_ArenaFactory::static_cleanup();
+    String::static_cleanup();
 
 # ifdef HAVE_DYNAMIC_LINKING
     delete tmpdir;
@@ -497,7 +499,11 @@ click_read_router(String filename, bool is_expr, ErrorHandler *errh, bool initia
         errh->error("MiniOS doesn't support loading configurations from files!");
 #else
     } else {
-        config_str = file_string(filename, errh);
+# if CLICK_USERLEVEL
+        config_str = RouterImage::map_file(filename);
+        if (!config_str)
+# endif
+            config_str = file_string(filename, errh);
         if (!filename || filename == "-")
             filename = "<stdin>";
 #endif
@@ -517,14 +523,22 @@ click_read_router(String filename, bool is_expr, ErrorHandler *errh, bool initia
         }
     }
 
-    // lex
+    // lex, or instantiate a precompiled router image directly
     Lexer *l = click_lexer();
     RequireLexerExtra lextra(&archive);
-    int cookie = l->begin_parse(config_str, filename, &lextra, errh);
-    while (!l->ydone())
-        l->ystep();
-    Router *router = l->create_router(master ? master : new Master(1));
-    l->end_parse(cookie);
+    Router *router;
+    if (RouterImage::is_image(config_str)) {
+        router = RouterImage::parse(config_str, filename, l, &lextra,
+                                    master ? master : new Master(1), errh);
+        if (!router)
+            return 0;
+    } else {
+        int cookie = l->begin_parse(config_str, filename, &lextra, errh);
+        while (!l->ydone())
+            l->ystep();
+        router = l->create_router(master ? master : new Master(1));
+        l->end_parse(cookie);
+    }
 
     // initialize if requested
     if (initialize)
@@ -424,6 +424,10 @@ Element::Element()
     _nports[0] = _nports[1] = 0;
 
 #if CLICK_STATS >= 2
+    _nstats = click_max_cpu_ids();
+    if (_nstats == 0)
+        _nstats = 1;
+    _stats = new ThreadStats[_nstats];
     reset_cycles();
 #endif
 }
@@ -431,6 +435,9 @@ Element::Element()
 Element::~Element()
 {
     nelements_allocated--;
+#if CLICK_STATS >= 2
+    delete[] _stats;
+#endif
     if (_ports[0] < _inline_ports || _ports[0] > _inline_ports + INLINE_PORTS)
 	delete[] _ports[0];
     if (_ports[1] < _inline_ports || _ports[1] > _inline_ports + INLINE_PORTS)
@@ -2032,6 +2039,10 @@ Element::read_handlers_handler(Element *e, void *)
 		sa << 'b';
 	    if (h->flags() & Handler::f_checkbox)
 		sa << 'c';
+	    if (h->flags() & Handler::f_counter)
+		sa << 'C';
+	    if (h->flags() & Handler::f_gauge)
+		sa << 'G';
 	    sa << '\n';
 	}
     }
@@ -2068,16 +2079,53 @@ read_ocounts_handler(Element *f, void *)
 #endif /* CLICK_STATS >= 1 */
 
 #if CLICK_STATS >= 2
+Element::ThreadStats
+Element::total_stats() const
+{
+    ThreadStats ts;
+    ts.clear();
+    for (unsigned t = 0; t < _nstats; ++t)
+        ts.add(_stats[t]);
+    return ts;
+}
+
 String
 Element::read_cycles_handler(Element *e, void *)
 {
     StringAccum sa;
-    if (e->_task_calls)
-	sa << "tasks " << e->_task_calls << ' ' << e->_task_own_cycles << '\n';
-    if (e->_timer_calls)
-	sa << "timers " << e->_timer_calls << ' ' << e->_timer_own_cycles << '\n';
-    if (e->_xfer_calls)
-	sa << "xfer " << e->_xfer_calls << ' ' << e->_xfer_own_cycles << '\n';
+    ThreadStats ts = e->total_stats();
+    if (ts.task_calls)
+	sa << "tasks " << ts.task_calls << ' ' << ts.task_own.cycles << '\n';
+    if (ts.timer_calls)
+	sa << "timers " << ts.timer_calls << ' ' << ts.timer_own.cycles << '\n';
+    if (ts.xfer_calls)
+	sa << "xfer " << ts.xfer_calls << ' ' << ts.xfer_own.cycles << '\n';
+    return sa.take_string();
+}
+
+static void
+profile_line(StringAccum &sa, unsigned thread, const char *kind,
+             unsigned calls, const ProfileSample &own)
+{
+    sa << thread << ' ' << kind << ' ' << calls << ' ' << own.cycles;
+    for (int i = 0; i < PerfEvents::nconfigured(); ++i)
+        sa << ' ' << own.events[i];
+    sa << '\n';
+}
+
+String
+Element::read_profile_handler(Element *e, void *)
+{
+    StringAccum sa;
+    for (unsigned t = 0; t < e->_nstats; ++t) {
+        const ThreadStats &ts = e->_stats[t];
+        if (ts.task_calls)
+            profile_line(sa, t, "tasks", ts.task_calls, ts.task_own);
+        if (ts.timer_calls)
+            profile_line(sa, t, "timers", ts.timer_calls, ts.timer_own);
+        if (ts.xfer_calls)
+            profile_line(sa, t, "xfer", ts.xfer_calls, ts.xfer_own);
+    }
     return sa.take_string();
 }
 
@@ -2105,6 +2153,7 @@ Element::add_default_handlers(bool allow_write_config)
 # if CLICK_STATS >= 2
   add_read_handler("cycles", read_cycles_handler, 0);
   add_write_handler("cycles", write_cycles_handler, 0);
+  add_read_handler("profile", read_profile_handler, 0);
 # endif
 #endif
 }
@@ -704,6 +704,25 @@ click_jiffies()
     return Timestamp::now().msecval();
 }
 
+click_cycles_t
+click_cycles_per_second()
+{
+    // Calibrate once against the steady clock.  Concurrent first calls
+    // calibrate redundantly but agree closely enough.
+    static click_cycles_t hz;
+    if (!hz && click_get_cycles()) {
+	Timestamp t0 = Timestamp::now_steady();
+	click_cycles_t c0 = click_get_cycles();
+	Timestamp t1;
+	do {
+	    t1 = Timestamp::now_steady();
+	} while ((t1 - t0).msecval() < 20);
+	click_cycles_t c1 = click_get_cycles();
+	hz = (click_cycles_t) ((double) (c1 - c0) * 1e9 / (t1 - t0).nsecval());
+    }
+    return hz;
+}
+
 CLICK_ENDDECLS
 #endif
 
@@ -59,7 +59,10 @@ HandlerCall::initialize(int flags, const Element* context, ErrorHandler* errh)
     }
 
     // finish up in assign()
-    return assign(e, hname, value, flags, errh);
+    int r = assign(e, hname, value, flags, errh);
+    if (r >= 0 && context)
+	context->router()->add_handler_user(context);
+    return r;
 }
 
 static int
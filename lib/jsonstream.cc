@@ -0,0 +1,453 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/jsonstream.hh" -*-
+/*
+ * jsonstream.{cc,hh} -- streaming JSON output and event-driven parsing
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/jsonstream.hh>
+#include <click/string.hh>
+#if HAVE_FLOAT_TYPES
+# include <stdlib.h>
+#endif
+CLICK_DECLS
+
+// Returns the escaped form of the character at s (which may be U+2028 or
+// U+2029, encoded in three bytes), or 0 if it needs no escaping.
+static inline int
+json_escape(const char *s, const char *end)
+{
+    int c = (unsigned char) *s;
+    // U+2028 and U+2029 can't appear in Javascript strings!
+    if (unlikely(c == 0xE2)
+        && s + 2 < end && (unsigned char) s[1] == 0x80
+        && (unsigned char) (s[2] | 1) == 0xA9)
+        return 0x2028 + (s[2] & 1);
+    else if (likely(c >= 32 && c != '\\' && c != '\"' && c != '/'))
+        return 0;
+    else
+        return c;
+}
+
+void
+JsonWriter::append_escaped(StringAccum &sa, const char *s, int len)
+{
+    const char *last = s, *end = s + len;
+    for (; s != end; ++s) {
+        int c = json_escape(s, end);
+        if (likely(!c))
+            continue;
+        sa.append(last, s);
+        sa << '\\';
+        switch (c) {
+        case '\b':
+            sa << 'b';
+            break;
+        case '\f':
+            sa << 'f';
+            break;
+        case '\n':
+            sa << 'n';
+            break;
+        case '\r':
+            sa << 'r';
+            break;
+        case '\t':
+            sa << 't';
+            break;
+        case '\\':
+        case '\"':
+        case '/':
+            sa.append((char) c);
+            break;
+        default: // c is a control character, 0x2028, or 0x2029
+            sa.snprintf(5, "u%04X", c);
+            if (c > 255)        // skip rest of encoding of U+202[89]
+                s += 2;
+            break;
+        }
+        last = s + 1;
+    }
+    sa.append(last, end);
+}
+
+void
+JsonWriter::escape_from(int pos)
+{
+    const char *s = _sa.begin() + pos, *end = _sa.end();
+    for (; s != end; ++s)
+        if (json_escape(s, end)) {
+            // rare: move the unescaped text aside and escape it
+            String text(_sa.begin() + pos, end);
+            _sa.set_length(pos);
+            append_escaped(_sa, text.data(), text.length());
+            return;
+        }
+}
+
+#if HAVE_FLOAT_TYPES
+/** @brief Append the number @a x.
+ *
+ * JSON cannot represent infinities or NaNs; they are written as null. */
+JsonWriter &
+JsonWriter::value(double x)
+{
+    separate();
+    if (x != x || x - x != 0)
+        _sa.append("null", 4);
+    else
+        _sa << x;
+    _comma = true;
+    return *this;
+}
+#endif
+
+
+JsonParser::JsonParser()
+    : _error_offset(-1)
+{
+}
+
+JsonParser::~JsonParser()
+{
+}
+
+bool
+JsonParser::on_begin_object()
+{
+    return true;
+}
+
+/** @brief Report an object key.  The key's value is reported next. */
+bool
+JsonParser::on_key(const char *, int)
+{
+    return true;
+}
+
+bool
+JsonParser::on_end_object()
+{
+    return true;
+}
+
+bool
+JsonParser::on_begin_array()
+{
+    return true;
+}
+
+bool
+JsonParser::on_end_array()
+{
+    return true;
+}
+
+bool
+JsonParser::on_null()
+{
+    return true;
+}
+
+bool
+JsonParser::on_bool(bool)
+{
+    return true;
+}
+
+bool
+JsonParser::on_string(const char *, int)
+{
+    return true;
+}
+
+bool
+JsonParser::on_number(const char *s, int len, bool integer)
+{
+    if (integer) {
+        const char *end = s + len;
+        bool negative = (*s == '-');
+        click_uintmax_t limit = (click_uintmax_t) integer_traits<click_intmax_t>::const_max + negative;
+        click_uintmax_t x = 0;
+        const char *t;
+        for (t = s + negative; t != end; ++t) {
+            unsigned d = *t - '0';
+            if (x > (limit - d) / 10)
+                break;
+            x = 10 * x + d;
+        }
+        if (t == end)
+            return on_integer(negative ? (click_intmax_t) (0 - x) : (click_intmax_t) x);
+    }
+#if HAVE_FLOAT_TYPES
+    _buf.clear();
+    _buf.append(s, len);
+    return on_double(strtod(_buf.c_str(), 0));
+#else
+    return false;
+#endif
+}
+
+bool
+JsonParser::on_integer(click_intmax_t)
+{
+    return true;
+}
+
+#if HAVE_FLOAT_TYPES
+bool
+JsonParser::on_double(double)
+{
+    return true;
+}
+#endif
+
+static inline const char *
+skip_space(const char *s, const char *end)
+{
+    while (s != end && (unsigned char) *s <= 32
+           && (*s == ' ' || *s == '\n' || *s == '\r' || *s == '\t'))
+        ++s;
+    return s;
+}
+
+static inline int
+parse_hex4(const char *s)
+{
+    int ch = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = s[i];
+        if (c >= '0' && c <= '9')
+            ch = 16 * ch + c - '0';
+        else if (c >= 'A' && c <= 'F')
+            ch = 16 * ch + c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            ch = 16 * ch + c - 'a' + 10;
+        else
+            return -1;
+    }
+    return ch;
+}
+
+/* Parse a string starting just after its opening quote, and report it.
+   Returns a pointer just past the closing quote, or null on error. */
+const char *
+JsonParser::parse_string(const char *s, const char *end, bool is_key)
+{
+    bool escaped = false;
+    const char *last = s;
+    for (; s != end; ++s) {
+        if (*s == '\\') {
+            if (s + 1 == end)
+                return 0;
+            if (!escaped) {
+                _buf.clear();
+                escaped = true;
+            }
+            _buf.append(last, s);
+            char c = s[1];
+            if (c == '\"' || c == '\\' || c == '/')
+                ++s, last = s;
+            else if (c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't') {
+                _buf.append(c == 'b' ? '\b' : c == 'f' ? '\f' : c == 'n' ? '\n'
+                            : c == 'r' ? '\r' : '\t');
+                ++s, last = s + 1;
+            } else if (c == 'u' && s + 5 < end) {
+                int ch = parse_hex4(s + 2);
+                if (ch < 0)
+                    return 0;
+                // special handling required for surrogate pairs
+                if (unlikely(ch >= 0xD800 && ch <= 0xDFFF)) {
+                    if (ch >= 0xDC00 || s + 11 >= end || s[6] != '\\' || s[7] != 'u')
+                        return 0;
+                    int ch2 = parse_hex4(s + 8);
+                    if (ch2 < 0xDC00 || ch2 > 0xDFFF
+                        || !_buf.append_utf8(0x10000 + (ch - 0xD800) * 0x400 + (ch2 - 0xDC00)))
+                        return 0;
+                    s += 11, last = s + 1;
+                } else {
+                    if (!_buf.append_utf8(ch))
+                        return 0;
+                    s += 5, last = s + 1;
+                }
+            } else
+                return 0;
+        } else if (*s == '\"')
+            break;
+        else if (likely((unsigned char) *s >= 32 && (unsigned char) *s < 128))
+            /* OK as is */;
+        else if ((unsigned char) *s < 32)
+            return 0;
+        else {
+            const char *t = String::skip_utf8_char(s, end);
+            if (t == s)
+                return 0;
+            s = t - 1;
+        }
+    }
+    if (s == end)
+        return 0;
+
+    const char *data = last;
+    int len = s - last;
+    if (escaped) {
+        _buf.append(last, s);
+        data = _buf.begin();
+        len = _buf.length();
+    }
+    if (!(is_key ? on_key(data, len) : on_string(data, len)))
+        return 0;
+    return s + 1;
+}
+
+/* Parse a number, true, false, or null, and report it.  Returns a pointer
+   just past the value, or null on error. */
+const char *
+JsonParser::parse_primitive(const char *begin, const char *end)
+{
+    const char *s = begin;
+    switch (*s) {
+    case '-':
+        if (s + 1 == end || s[1] < '0' || s[1] > '9')
+            return 0;
+        ++s;
+        /* fallthru */
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9': {
+        bool integer = true;
+        if (*s == '0')
+            ++s;
+        else
+            for (++s; s != end && isdigit((unsigned char) *s); )
+                ++s;
+        if (s != end && *s == '.') {
+            integer = false;
+            if (s + 1 == end || s[1] < '0' || s[1] > '9')
+                return 0;
+            for (s += 2; s != end && isdigit((unsigned char) *s); )
+                ++s;
+        }
+        if (s != end && (*s == 'e' || *s == 'E')) {
+            integer = false;
+            ++s;
+            if (s != end && (*s == '+' || *s == '-'))
+                ++s;
+            if (s == end || s[0] < '0' || s[0] > '9')
+                return 0;
+            for (++s; s != end && isdigit((unsigned char) *s); )
+                ++s;
+        }
+        return on_number(begin, s - begin, integer) ? s : 0;
+    }
+    case 't':
+        if (s + 4 <= end && s[1] == 'r' && s[2] == 'u' && s[3] == 'e')
+            return on_bool(true) ? s + 4 : 0;
+        return 0;
+    case 'f':
+        if (s + 5 <= end && s[1] == 'a' && s[2] == 'l' && s[3] == 's' && s[4] == 'e')
+            return on_bool(false) ? s + 5 : 0;
+        return 0;
+    case 'n':
+        if (s + 4 <= end && s[1] == 'u' && s[2] == 'l' && s[3] == 'l')
+            return on_null() ? s + 4 : 0;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+bool
+JsonParser::parse(const String &str)
+{
+    return parse(str.begin(), str.end());
+}
+
+bool
+JsonParser::parse(const char *begin, const char *end)
+{
+    _stack.clear();
+    _error_offset = -1;
+    const char *s = skip_space(begin, end), *t;
+
+  value:
+    if (s == end)
+        goto error;
+    if (*s == '{' || *s == '[') {
+        char open = *s;
+        if (_stack.size() >= max_depth
+            || !(open == '{' ? on_begin_object() : on_begin_array()))
+            goto error;
+        _stack.push_back(open);
+        s = skip_space(s + 1, end);
+        if (s != end && *s == open + 2) // '}' or ']'
+            goto close;
+        else if (open == '{')
+            goto key;
+        else
+            goto value;
+    } else if (*s == '\"')
+        t = parse_string(s + 1, end, false);
+    else
+        t = parse_primitive(s, end);
+    if (!t)
+        goto error;
+    s = t;
+
+  next:
+    s = skip_space(s, end);
+    if (!_stack.size()) {
+        if (s != end)
+            goto error;
+        return true;
+    } else if (s == end)
+        goto error;
+    else if (*s == ',') {
+        s = skip_space(s + 1, end);
+        if (_stack.back() == '[')
+            goto value;
+    } else if (*s == _stack.back() + 2)
+        goto close;
+    else
+        goto error;
+
+  key:
+    if (s == end || *s != '\"' || !(t = parse_string(s + 1, end, true)))
+        goto error;
+    s = skip_space(t, end);
+    if (s == end || *s != ':')
+        goto error;
+    s = skip_space(s + 1, end);
+    goto value;
+
+  close: {
+        char open = _stack.back();
+        _stack.pop_back();
+        if (!(open == '{' ? on_end_object() : on_end_array()))
+            goto error;
+        ++s;
+        goto next;
+    }
+
+  error:
+    _error_offset = s - begin;
+    return false;
+}
+
+CLICK_ENDDECLS
@@ -1041,6 +1041,15 @@ Lexer::remove_element_type(int removed, int *prev_hint)
   return 0;
 }
 
+Element *
+Lexer::create_element(int t) const
+{
+  if (t < 0 || t >= _element_types.size() || t == TUNNEL_TYPE
+      || _element_types[t].factory == compound_element_factory)
+    return 0;
+  return (*_element_types[t].factory)(_element_types[t].thunk);
+}
+
 void
 Lexer::element_type_names(Vector<String> &v) const
 {
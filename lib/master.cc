@@ -120,6 +120,8 @@ Master::pause()
     for (int i = 1; i < _nthreads; ++i) {
         _threads[i]->timer_set().fence();
 #if CLICK_USERLEVEL
+        // a thread waiting in select() holds the select lock until it wakes
+        _threads[i]->wake();
         _threads[i]->select_set().fence();
 #endif
     }
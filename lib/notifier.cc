@@ -464,6 +464,7 @@ class NotifierRouterVisitor : public RouterVisitor { public:
     bool visit(Element *e, bool isoutput, int port,
 	       Element *from_e, int from_port, int distance);
     Vector<Notifier*> _notifiers;
+    Vector<Element*> _owners;
     NotifierSignal _signal;
     bool _pass2;
     bool _need_pass2;
@@ -481,8 +482,10 @@ NotifierRouterVisitor::visit(Element* e, bool isoutput, int port,
 			     Element *, int, int)
 {
     if (Notifier* n = (Notifier*) (e->port_cast(isoutput, port, _name))) {
-	if (find(_notifiers.begin(), _notifiers.end(), n) == _notifiers.end())
+	if (find(_notifiers.begin(), _notifiers.end(), n) == _notifiers.end()) {
 	    _notifiers.push_back(n);
+	    _owners.push_back(e);
+	}
 	if (!n->signal().initialized())
 	    n->initialize(_name, e->router());
 	_signal += n->signal();
@@ -539,9 +542,11 @@ Notifier::upstream_empty_signal(Element* e, int port, callback_type f, void *use
     if (ok < 0 || signal == NotifierSignal())
 	return NotifierSignal();
 
-    if (f || user_data)
-	for (int i = 0; i < filter._notifiers.size(); i++)
+    for (int i = 0; i < filter._notifiers.size(); i++) {
+	if (f || user_data)
 	    filter._notifiers[i]->add_activate_callback(f, user_data);
+	e->router()->add_notifier_link(e, filter._owners[i], filter._notifiers[i], f, user_data);
+    }
 
     return signal;
 }
@@ -572,9 +577,11 @@ Notifier::downstream_full_signal(Element* e, int port, callback_type f, void *us
     if (ok < 0 || signal == NotifierSignal())
 	return NotifierSignal();
 
-    if (f || user_data)
-	for (int i = 0; i < filter._notifiers.size(); i++)
+    for (int i = 0; i < filter._notifiers.size(); i++) {
+	if (f || user_data)
 	    filter._notifiers[i]->add_activate_callback(f, user_data);
+	e->router()->add_notifier_link(e, filter._owners[i], filter._notifiers[i], f, user_data);
+    }
 
     return signal;
 }
@@ -0,0 +1,212 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/perfevent.hh" -*-
+/*
+ * perfevent.{cc,hh} -- hardware performance counters for profiling
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/perfevent.hh>
+#include <click/string.hh>
+#include <click/error.hh>
+#include <click/confparse.hh>
+#include <click/machine.hh>
+#include <click/vector.hh>
+#if CLICK_USERLEVEL && defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/syscall.h>
+# include <sys/mman.h>
+# include <unistd.h>
+# include <errno.h>
+#endif
+CLICK_DECLS
+
+int PerfEvents::_nconfigured;
+
+#if CLICK_USERLEVEL && defined(__linux__)
+
+namespace {
+
+struct EventType {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventType event_types[] = {
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-references", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "llc-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+    { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { "bus-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES },
+    { "ref-cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES },
+    { "stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND },
+    { "stalled-cycles-backend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+};
+
+const EventType *configured[PerfEvents::nevents];
+
+// Per-thread counter state, created on the thread's first read.
+struct PerfThread {
+    int fd[PerfEvents::nevents];
+    volatile perf_event_mmap_page *page[PerfEvents::nevents];
+};
+
+# if HAVE___THREAD_STORAGE_CLASS
+__thread PerfThread *perf_thread;
+# endif
+
+PerfThread *
+open_thread()
+{
+    static bool warned;
+    PerfThread *pt = new PerfThread;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < PerfEvents::nevents; ++i) {
+	pt->fd[i] = -1;
+	pt->page[i] = 0;
+	if (i >= PerfEvents::nconfigured())
+	    continue;
+
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = configured[i]->type;
+	attr.config = configured[i]->config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	pt->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (pt->fd[i] < 0) {
+	    if (!warned) {
+		click_chatter("perf_event_open %s: %s", configured[i]->name, strerror(errno));
+		warned = true;
+	    }
+	    continue;
+	}
+	void *m = mmap(0, pagesize, PROT_READ, MAP_SHARED, pt->fd[i], 0);
+	if (m != MAP_FAILED)
+	    pt->page[i] = (volatile perf_event_mmap_page *) m;
+    }
+    return pt;
+}
+
+inline uint64_t
+read_counter(int fd, volatile perf_event_mmap_page *pc)
+{
+# if __i386__ || __x86_64__
+    // Self-monitoring read, as described in perf_event_open(2).
+    if (pc) {
+	uint32_t seq, idx;
+	uint64_t count;
+	do {
+	    seq = pc->lock;
+	    click_compiler_fence();
+	    idx = pc->index;
+	    count = pc->offset;
+	    if (pc->cap_user_rdpmc && idx) {
+		uint32_t lo, hi;
+		__asm__ __volatile__ ("rdpmc" : "=a" (lo), "=d" (hi) : "c" (idx - 1));
+		int width = pc->pmc_width;
+		int64_t pmc = (int64_t) ((((uint64_t) hi << 32) | lo) << (64 - width)) >> (64 - width);
+		count += pmc;
+	    } else
+		goto slow;
+	    click_compiler_fence();
+	} while (pc->lock != seq);
+	return count;
+    }
+  slow:
+# else
+    (void) pc;
+# endif
+    uint64_t v = 0;
+    if (fd < 0 || ::read(fd, &v, sizeof(v)) != (ssize_t) sizeof(v))
+	return 0;
+    return v;
+}
+
+}
+
+int
+PerfEvents::configure(const String &spec, ErrorHandler *errh)
+{
+    Vector<String> names;
+    cp_argvec(spec, names);
+    if (names.size() > nevents)
+	return errh->error("at most %d performance counters allowed", (int) nevents);
+    int n = 0;
+    for (String *it = names.begin(); it != names.end(); ++it) {
+	const EventType *et = 0;
+	for (size_t i = 0; i < sizeof(event_types) / sizeof(event_types[0]); ++i)
+	    if (*it == event_types[i].name)
+		et = &event_types[i];
+	if (!et)
+	    return errh->error("unknown performance counter %<%s%>", it->c_str());
+	configured[n++] = et;
+    }
+    _nconfigured = n;
+    return 0;
+}
+
+const char *
+PerfEvents::name(int i)
+{
+    return i < _nconfigured ? configured[i]->name : "";
+}
+
+void
+PerfEvents::read_slow(uint64_t *v)
+{
+# if HAVE___THREAD_STORAGE_CLASS
+    PerfThread *pt = perf_thread;
+    if (!pt)
+	pt = perf_thread = open_thread();
+    int i;
+    for (i = 0; i < _nconfigured; ++i)
+	v[i] = read_counter(pt->fd[i], pt->page[i]);
+    for (; i < nevents; ++i)
+	v[i] = 0;
+# else
+    for (int i = 0; i < nevents; ++i)
+	v[i] = 0;
+# endif
+}
+
+#else /* !CLICK_USERLEVEL || !__linux__ */
+
+int
+PerfEvents::configure(const String &spec, ErrorHandler *errh)
+{
+    if (spec)
+	return errh->error("performance counters are not supported on this platform");
+    return 0;
+}
+
+const char *
+PerfEvents::name(int)
+{
+    return "";
+}
+
+void
+PerfEvents::read_slow(uint64_t *v)
+{
+    for (int i = 0; i < nevents; ++i)
+	v[i] = 0;
+}
+
+#endif
+
+CLICK_ENDDECLS
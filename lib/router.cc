@@ -34,6 +34,7 @@
 #include <click/notifier.hh>
 #include <click/nameinfo.hh>
 #include <click/bighashmap_arena.hh>
+#include <click/hashtable.hh>
 #if CLICK_STATS >= 2
 # include <click/hashtable.hh>
 #endif
@@ -83,7 +84,7 @@ Router::Router(const String &configuration, Master *master)
       _configuration(configuration),
       _notifier_signals(0),
       _arena_factory(new HashMap_ArenaFactory),
-      _hotswap_router(0), _thread_sched(0), _name_info(0), _next_router(0)
+      _hotswap_router(0), _hotswap_incremental(false), _thread_sched(0), _name_info(0), _next_router(0)
 {
     _refcount = 0;
     _runcount = 0;
@@ -169,15 +170,6 @@ Router::unuse()
 
 // ACCESS
 
-static int
-element_name_sorter_compar(const void *ap, const void *bp, void *user_data)
-{
-    int a = *reinterpret_cast<const int *>(ap);
-    int b = *reinterpret_cast<const int *>(bp);
-    const Vector<String> &element_names = *reinterpret_cast<Vector<String> *>(user_data);
-    return String::compare(element_names[a], element_names[b]);
-}
-
 /** @brief  Finds an element named @a name.
  *  @param  name     element name
  *  @param  context  compound element context
@@ -197,28 +189,15 @@ element_name_sorter_compar(const void *ap, const void *bp, void *user_data)
 Element *
 Router::find(const String &name, String context, ErrorHandler *errh) const
 {
-    if (_element_name_sorter.size() != _element_names.size()) {
-        while (_element_name_sorter.size() != _element_names.size())
-            _element_name_sorter.push_back(_element_name_sorter.size());
-        click_qsort(_element_name_sorter.begin(), _element_name_sorter.size(),
-                    sizeof(_element_name_sorter[0]),
-                    element_name_sorter_compar, (void *) &_element_names);
+    if (_element_name_map.size() != (size_t) _element_names.size()) {
+        _element_name_map.clear();
+        for (int i = _element_names.size() - 1; i >= 0; --i)
+            _element_name_map.set(_element_names[i], i);
     }
 
     while (1) {
-        String n = context + name;
-        int *l = _element_name_sorter.begin();
-        int *r = _element_name_sorter.end();
-        while (l < r) {
-            int *m = l + (r - l) / 2;
-            int cmp = String::compare(n, _element_names[*m]);
-            if (cmp < 0)
-                r = m;
-            else if (cmp > 0)
-                l = m + 1;
-            else
-                return _elements[*m];
-        }
+        if (int *eip = _element_name_map.get_pointer(context + name))
+            return _elements[*eip];
 
         if (!context)
             break;
@@ -720,44 +699,66 @@ Router::check_push_and_pull(ErrorHandler *errh)
     int before = errh->nerrors();
     Connection *first_agnostic = conn.begin() + _conn.size();
 
-    // spread personalities
-    while (true) {
-
-        bool changed = false;
-        for (Connection *cp = conn.begin(); cp != conn.end(); ++cp) {
-            if ((*cp)[1].idx < 0)
-                continue;
-
-            int gf = gport(true, (*cp)[1]);
-            int gt = gport(false, (*cp)[0]);
-            int pf = output_pers[gf];
-            int pt = input_pers[gt];
-
-            switch (pt) {
-
-              case Element::VAGNOSTIC:
-                if (pf != Element::VAGNOSTIC) {
-                    input_pers[gt] = pf;
-                    changed = true;
-                }
-                break;
+    // Spread personalities.  A port's personality changes at most once,
+    // from agnostic, and only the connections touching that port need
+    // another look, so keep a queue of connections to check: this takes
+    // linear time however the connections are ordered.
+    int nc = conn.size();
+    Vector<int> first_conn_in(ngports(false), -1), first_conn_out(ngports(true), -1);
+    Vector<int> next_conn_in(nc, -1), next_conn_out(nc, -1);
+    for (int c = nc - 1; c >= 0; --c) {
+        int gt = gport(false, conn[c][0]), gf = gport(true, conn[c][1]);
+        next_conn_in[c] = first_conn_in[gt];
+        first_conn_in[gt] = c;
+        next_conn_out[c] = first_conn_out[gf];
+        first_conn_out[gf] = c;
+    }
 
-              case Element::VPUSH:
-              case Element::VPULL:
-                if (pf == Element::VAGNOSTIC) {
-                    output_pers[gf] = pt;
-                    changed = true;
-                } else if (pf != pt) {
-                    processing_error(*cp, cp >= first_agnostic, pf, errh);
-                    (*cp)[1].idx = -1;
-                }
-                break;
+    Vector<int> work(nc, 0);
+    Bitvector queued(nc, true);
+    for (int c = 0; c < nc; ++c)
+        work[c] = c;
+    for (int wi = 0; wi < work.size(); ++wi) {
+        int c = work[wi];
+        queued[c] = false;
+        Connection *cp = &conn[c];
+        if ((*cp)[1].idx < 0)
+            continue;
+
+        int gf = gport(true, (*cp)[1]);
+        int gt = gport(false, (*cp)[0]);
+        int pf = output_pers[gf];
+        int pt = input_pers[gt];
+        int changed = -1;
+
+        switch (pt) {
+
+          case Element::VAGNOSTIC:
+            if (pf != Element::VAGNOSTIC) {
+                input_pers[gt] = pf;
+                changed = first_conn_in[gt];
+            }
+            break;
 
+          case Element::VPUSH:
+          case Element::VPULL:
+            if (pf == Element::VAGNOSTIC) {
+                output_pers[gf] = pt;
+                changed = first_conn_out[gf];
+            } else if (pf != pt) {
+                processing_error(*cp, cp >= first_agnostic, pf, errh);
+                (*cp)[1].idx = -1;
             }
+            break;
+
         }
 
-        if (!changed)
-            break;
+        bool in = (pt == Element::VAGNOSTIC);
+        for (; changed >= 0; changed = (in ? next_conn_in : next_conn_out)[changed])
+            if (!queued[changed]) {
+                queued[changed] = true;
+                work.push_back(changed);
+            }
     }
 
     if (errh->nerrors() != before)
@@ -1101,8 +1102,14 @@ Router::initialize(ErrorHandler *errh)
     if (check_hookup_elements(errh) < 0)
         return -1;
 
+    // take over unchanged elements from the router being replaced
+    if (_hotswap_router && _hotswap_incremental
+        && _hotswap_router->_state == ROUTER_LIVE)
+        hotswap_adopt();
+
     // prepare thread IDs
     _element_home_thread_ids.assign(nelements() + 1, ThreadSched::THREAD_UNKNOWN);
+    _element_handler_users.assign(nelements(), 0);
 
     // set up configuration order
     _element_configure_order.assign(nelements(), 0);
@@ -1143,6 +1150,10 @@ Router::initialize(ErrorHandler *errh)
         click_random_srandom();
         for (int ord = 0; ord < _elements.size(); ord++) {
             int i = _element_configure_order[ord], r;
+            if (_hotswap_adopted.size() && _hotswap_adopted[i] >= 0) {
+                element_stage[i] = Element::CLEANUP_CONFIGURED;
+                continue;
+            }
 #if CLICK_DMALLOC
             sprintf(dmalloc_buf, "c%d  ", i);
             CLICK_DMALLOC_REG(dmalloc_buf);
@@ -1176,6 +1187,10 @@ Router::initialize(ErrorHandler *errh)
         for (int ord = 0; all_ok && ord < _elements.size(); ord++) {
             int i = _element_configure_order[ord];
             assert(element_stage[i] == Element::CLEANUP_CONFIGURED);
+            if (_hotswap_adopted.size() && _hotswap_adopted[i] >= 0) {
+                element_stage[i] = Element::CLEANUP_INITIALIZED;
+                continue;
+            }
 #if CLICK_DMALLOC
             sprintf(dmalloc_buf, "i%d  ", i);
             CLICK_DMALLOC_REG(dmalloc_buf);
@@ -1219,6 +1234,10 @@ Router::initialize(ErrorHandler *errh)
         _state = ROUTER_DEAD;
         errh->error("Router could not be initialized!");
 
+        // Give adopted elements back to the old router
+        if (_hotswap_adopted.size())
+            hotswap_unadopt(element_stage);
+
         // Unschedule tasks and timers
         master()->kill_router(this);
 
@@ -1248,12 +1267,18 @@ Router::activate(bool foreground, ErrorHandler *errh)
         master()->kill_router(_hotswap_router);
 
         for (int i = 0; i < _elements.size(); i++) {
-            Element *e = _elements[_element_configure_order[i]];
+            int ei = _element_configure_order[i];
+            if (_hotswap_adopted.size() && _hotswap_adopted[ei] >= 0)
+                continue;
+            Element *e = _elements[ei];
             if (Element *other = e->hotswap_element()) {
                 RouterContextErrh cerrh(errh, "While hot-swapping state into", element(i));
                 e->take_state(other, &cerrh);
             }
         }
+
+        if (_hotswap_adopted.size())
+            hotswap_finish_adoption();
     }
     if (_hotswap_router) {
         _hotswap_router->unuse();
@@ -1268,15 +1293,238 @@ Router::activate(bool foreground, ErrorHandler *errh)
 
 // steal state
 
+/** @brief Set the router this router will replace.
+ * @param r the router being replaced, or null
+ * @param incremental if true, take over r's unchanged elements
+ *
+ * When this router is activated, it takes over from @a r: @a r's tasks and
+ * timers are killed and each element may take state from its counterpart via
+ * Element::take_state().
+ *
+ * If @a incremental is true, initialize() instead adopts every element of @a
+ * r that has not changed: same name, class, configuration string, and
+ * connections, and no dependence on an element that has changed.  Elements
+ * that hold handler pointers (see add_handler_user()) are never adopted,
+ * since @a r's handlers die with it.  Adopted elements move into this router as they are, without being configured or
+ * initialized again, so their tasks, timers, queues, and statistics carry on
+ * untouched.  Since this rewires @a r's elements, @a r must not run between
+ * initialize() and activate(); callers block all threads across both. */
 void
-Router::set_hotswap_router(Router *r)
+Router::set_hotswap_router(Router *r, bool incremental)
 {
     assert(_state == ROUTER_NEW && !_hotswap_router && (!r || r->initialized()));
     _hotswap_router = r;
+    _hotswap_incremental = r && incremental;
     if (_hotswap_router)
         _hotswap_router->use();
 }
 
+static int
+string_compar(const void *ap, const void *bp, void *)
+{
+    return String::compare(*reinterpret_cast<const String *>(ap),
+                           *reinterpret_cast<const String *>(bp));
+}
+
+void
+Router::connection_signatures(Vector<String> &sigs) const
+{
+    Vector<Vector<String> > pieces(nelements(), Vector<String>());
+    for (const Connection *it = _conn.begin(); it != _conn.end(); ++it) {
+        int f = (*it)[1].idx, t = (*it)[0].idx;
+        StringAccum sa;
+        sa << (*it)[1].port << '>' << _element_names[t] << ' '
+           << _elements[t]->class_name() << ' ' << (*it)[0].port;
+        pieces[f].push_back(sa.take_string());
+        sa << (*it)[0].port << '<' << _element_names[f] << ' '
+           << _elements[f]->class_name() << ' ' << (*it)[1].port;
+        pieces[t].push_back(sa.take_string());
+    }
+    sigs.assign(nelements(), String());
+    for (int i = 0; i < nelements(); ++i) {
+        Vector<String> &p = pieces[i];
+        if (p.size())
+            click_qsort(p.begin(), p.size(), sizeof(String), string_compar);
+        StringAccum sa;
+        for (String *it = p.begin(); it != p.end(); ++it)
+            sa << *it << '\n';
+        sigs[i] = sa.take_string();
+    }
+}
+
+static void
+add_name_tokens(const String &text, HashTable<String, int> &tokens)
+{
+    const char *s = text.begin(), *end = text.end();
+    while (s != end) {
+        const char *first = s;
+        while (s != end && (isalnum((unsigned char) *s) || *s == '_'
+                            || *s == '/' || *s == '@'))
+            ++s;
+        if (s != first)
+            tokens.set(text.substring(first, s), 1);
+        else
+            ++s;
+    }
+}
+
+static String
+name_basename(const String &name)
+{
+    int slash = name.find_right('/');
+    return slash >= 0 ? name.substring(slash + 1) : name;
+}
+
+void
+Router::hotswap_adopt()
+{
+    Router *old = _hotswap_router;
+    int n = nelements();
+    Vector<int> match(n, -1);
+
+    // candidates: same name, class, configuration, and connections
+    Vector<String> sigs, old_sigs;
+    connection_signatures(sigs);
+    old->connection_signatures(old_sigs);
+    for (int i = 0; i < n; ++i) {
+        Element *e = _elements[i];
+        Element *oe = old->find(_element_names[i], String());
+        if (oe && old->_element_names[oe->eindex()] == _element_names[i]
+            && strcmp(oe->class_name(), e->class_name()) == 0
+            && old->_element_configurations[oe->eindex()] == _element_configurations[i]
+            && old_sigs[oe->eindex()] == sigs[i]
+            && e->configure_phase() >= Element::CONFIGURE_PHASE_DEFAULT
+            && !old->_element_handler_users[oe->eindex()])
+            match[i] = oe->eindex();
+    }
+
+    // Drop candidates that depend on replaced elements, or that replaced
+    // elements refer to, until nothing changes.  Dependencies are names in
+    // configuration strings and notifier signals.
+    Vector<int> old_match;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        old_match.assign(old->nelements(), -1);
+        for (int i = 0; i < n; ++i)
+            if (match[i] >= 0)
+                old_match[match[i]] = i;
+
+        HashTable<String, int> gone, mentioned;
+        for (int i = 0; i < n; ++i)
+            if (match[i] < 0) {
+                gone.set(_element_names[i], 1);
+                gone.set(name_basename(_element_names[i]), 1);
+                add_name_tokens(_element_configurations[i], mentioned);
+            }
+        for (int oi = 0; oi < old->nelements(); ++oi)
+            if (old_match[oi] < 0) {
+                gone.set(old->_element_names[oi], 1);
+                gone.set(name_basename(old->_element_names[oi]), 1);
+                add_name_tokens(old->_element_configurations[oi], mentioned);
+            }
+
+        for (int i = 0; i < n; ++i) {
+            if (match[i] < 0)
+                continue;
+            bool keep = !mentioned.get(_element_names[i])
+                && !mentioned.get(name_basename(_element_names[i]));
+            if (keep) {
+                HashTable<String, int> tokens;
+                add_name_tokens(_element_configurations[i], tokens);
+                for (HashTable<String, int>::iterator it = tokens.begin();
+                     keep && it.live(); ++it)
+                    keep = !gone.get(it.key());
+            }
+            if (!keep) {
+                match[i] = -1;
+                changed = true;
+            }
+        }
+
+        for (const notifier_link_t *l = old->_notifier_links.begin();
+             l != old->_notifier_links.end(); ++l) {
+            int li = l->listener->eindex(old), oi = l->owner->eindex(old);
+            if (li >= 0 && old_match[li] >= 0 && (oi < 0 || old_match[oi] < 0)
+                && match[old_match[li]] >= 0) {
+                match[old_match[li]] = -1;
+                changed = true;
+            }
+        }
+    }
+
+    // Swap adopted elements in, leaving placeholders in the old router
+    _hotswap_adopted.assign(n, -1);
+    _hotswap_fresh.assign(n, 0);
+    for (int i = 0; i < n; ++i)
+        if (match[i] >= 0) {
+            int oi = match[i];
+            Element *oe = old->_elements[oi];
+            Element *placeholder = new ErrorElement;
+            placeholder->attach_router(old, oi);
+            old->_elements[oi] = placeholder;
+            oe->_router = this;
+            oe->_eindex = i;
+            _hotswap_fresh[i] = _elements[i];
+            _elements[i] = oe;
+            _hotswap_adopted[i] = oi;
+        }
+}
+
+void
+Router::hotswap_unadopt(Vector<int> &element_stage)
+{
+    Router *old = _hotswap_router;
+    for (int i = 0; i < nelements(); ++i)
+        if (_hotswap_adopted[i] >= 0) {
+            int oi = _hotswap_adopted[i];
+            Element *oe = _elements[i];
+            delete old->_elements[oi];
+            old->_elements[oi] = oe;
+            oe->_router = old;
+            oe->_eindex = oi;
+            _elements[i] = _hotswap_fresh[i];
+            element_stage[i] = Element::CLEANUP_BEFORE_CONFIGURE;
+        }
+    _hotswap_adopted.clear();
+    _hotswap_fresh.clear();
+
+    // The new router's hookup changed the adopted elements' ports
+    old->check_push_and_pull(ErrorHandler::silent_handler());
+    old->set_connections();
+}
+
+void
+Router::hotswap_finish_adoption()
+{
+    Router *old = _hotswap_router;
+    for (const notifier_link_t *l = old->_notifier_links.begin();
+         l != old->_notifier_links.end(); ++l)
+        if (l->owner->router() == this && l->listener->router() == this)
+            _notifier_links.push_back(*l);
+        else if (l->owner->router() == this && (l->f || l->user_data))
+            // the listener is about to be deleted
+            l->notifier->remove_activate_callback(l->f, l->user_data);
+
+    // Adopted notifiers keep their signals, which the old router allocated.
+    // Move its signal blocks here so they outlive it.
+    if (notifier_signals_t *ns = old->_notifier_signals) {
+        while (ns->next)
+            ns = ns->next;
+        ns->next = _notifier_signals;
+        _notifier_signals = old->_notifier_signals;
+        old->_notifier_signals = 0;
+    }
+
+    for (int i = 0; i < nelements(); ++i)
+        if (Element *fresh = _hotswap_fresh[i]) {
+            fresh->cleanup(Element::CLEANUP_NO_ROUTER);
+            delete fresh;
+        }
+    _hotswap_adopted.clear();
+    _hotswap_fresh.clear();
+}
+
 
 // HANDLERS
 
@@ -1940,6 +2188,38 @@ Router::notifier_signal_name(const atomic_uint32_t *signal) const
     return sa.take_string();
 }
 
+/** @brief Record that @a listener uses the signal of @a owner's @a notifier.
+ *
+ * Notifier::upstream_empty_signal() and Notifier::downstream_full_signal()
+ * call this for every notifier they find.  Incremental hot-swapping uses
+ * these links to keep listeners and notifiers together. */
+void
+Router::add_notifier_link(Element *listener, Element *owner, Notifier *notifier,
+                          void (*f)(void *, Notifier *), void *user_data)
+{
+    notifier_link_t l;
+    l.listener = listener;
+    l.owner = owner;
+    l.notifier = notifier;
+    l.f = f;
+    l.user_data = user_data;
+    _notifier_links.push_back(l);
+}
+
+/** @brief Record that element @a e holds pointers to this router's handlers.
+ *
+ * HandlerCall::initialize() calls this for its context element; elements
+ * that look up and keep Handler pointers themselves should call it too.
+ * Handlers belong to their router, so incremental hot-swapping never adopts
+ * such an element: it is rebuilt and looks its handlers up again. */
+void
+Router::add_handler_user(const Element *e)
+{
+    int i = e->eindex(this);
+    if (i >= 0 && i < _element_handler_users.size())
+        _element_handler_users[i] = 1;
+}
+
 int
 ThreadSched::initial_home_thread_id(const Element *)
 {
@@ -2188,13 +2468,29 @@ Router::configuration_string() const
 enum { GH_VERSION, GH_CONFIG, GH_FLATCONFIG, GH_LIST, GH_REQUIREMENTS,
        GH_DRIVER, GH_ACTIVE_PORTS, GH_ACTIVE_PORT_STATS, GH_STRING_PROFILE,
        GH_STRING_PROFILE_LONG, GH_SCHEDULING_PROFILE, GH_STOP,
-       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES };
+       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES, GH_PROFILE };
 
 #if CLICK_STATS >= 2
 struct stats_info {
     click_cycles_t task_own_cycles, timer_own_cycles, xfer_own_cycles;
     uint32_t task_calls, timer_calls, xfer_calls, nelements;
 };
+
+struct profile_info {
+    int eindex;
+    uint32_t calls;
+    ProfileSample own;
+};
+
+static int
+profile_info_compar(const void *av, const void *bv, void *)
+{
+    const profile_info *a = (const profile_info *) av,
+        *b = (const profile_info *) bv;
+    if (a->own.cycles != b->own.cycles)
+        return a->own.cycles > b->own.cycles ? -1 : 1;
+    return a->eindex - b->eindex;
+}
 #endif
 
 String
@@ -2297,22 +2593,22 @@ Router::router_read_handler(Element *e, void *thunk)
             break;
         sa << "name,class,task_calls,task_cycles,cycles_per_task,timer_calls,timer_cycles,cycles_per_timer,xfer_calls,xfer_cycles,cycles_per_xfer,any_cycles,cycles_per_any\n";
         for (int ei = 0; ei < r->nelements(); ++ei) {
-            Element *e = r->element(ei);
-            if (!(e->_task_own_cycles || e->_timer_own_cycles || e->_xfer_own_cycles))
+            Element::ThreadStats ts = r->element(ei)->total_stats();
+            if (!ts.any())
                 continue;
             sa << r->_element_names[ei] << ','
-               << e->class_name() << ','
-               << e->_task_calls << ','
-               << e->_task_own_cycles << ','
-               << int_divide(e->_task_own_cycles, e->_task_calls ? e->_task_calls : 1) << ','
-               << e->_timer_calls << ','
-               << e->_timer_own_cycles << ','
-               << int_divide(e->_timer_own_cycles, e->_timer_calls ? e->_timer_calls : 1) << ','
-               << e->_xfer_calls << ','
-               << e->_xfer_own_cycles << ','
-               << int_divide(e->_xfer_own_cycles, e->_xfer_calls ? e->_xfer_calls : 1) << ',';
-            click_cycles_t any_cycles = e->_task_own_cycles + e->_timer_own_cycles + e->_xfer_own_cycles;
-            uint32_t any_calls = e->_task_calls + e->_timer_calls + e->_xfer_calls;
+               << r->element(ei)->class_name() << ','
+               << ts.task_calls << ','
+               << ts.task_own.cycles << ','
+               << int_divide(ts.task_own.cycles, ts.task_calls ? ts.task_calls : 1) << ','
+               << ts.timer_calls << ','
+               << ts.timer_own.cycles << ','
+               << int_divide(ts.timer_own.cycles, ts.timer_calls ? ts.timer_calls : 1) << ','
+               << ts.xfer_calls << ','
+               << ts.xfer_own.cycles << ','
+               << int_divide(ts.xfer_own.cycles, ts.xfer_calls ? ts.xfer_calls : 1) << ',';
+            click_cycles_t any_cycles = ts.task_own.cycles + ts.timer_own.cycles + ts.xfer_own.cycles;
+            uint32_t any_calls = ts.task_calls + ts.timer_calls + ts.xfer_calls;
             sa << any_cycles << ','
                << int_divide(any_cycles, any_calls ? any_calls : 1) << '\n';
         }
@@ -2325,7 +2621,7 @@ Router::router_read_handler(Element *e, void *thunk)
         int nclasses = 0;
         for (int ei = 0; ei < r->nelements(); ++ei) {
             Element *e = r->element(ei);
-            if (!(e->_task_own_cycles || e->_timer_own_cycles || e->_xfer_own_cycles))
+            if (!e->total_stats().any())
                 continue;
             int &x = class_map[e->class_name()];
             if (x < 0)
@@ -2337,15 +2633,16 @@ Router::router_read_handler(Element *e, void *thunk)
         for (int ei = 0; ei < r->nelements(); ++ei) {
             Element *e = r->element(ei);
             int x = class_map.get(e->class_name());
-            if (!(e->_task_own_cycles || e->_timer_own_cycles || e->_xfer_own_cycles) || x < 0)
+            Element::ThreadStats ts = e->total_stats();
+            if (!ts.any() || x < 0)
                 continue;
             stats_info &sii = si[x];
-            sii.task_own_cycles += e->_task_own_cycles;
-            sii.task_calls += e->_task_calls;
-            sii.timer_own_cycles += e->_timer_own_cycles;
-            sii.timer_calls += e->_timer_calls;
-            sii.xfer_own_cycles += e->_xfer_own_cycles;
-            sii.xfer_calls += e->_xfer_calls;
+            sii.task_own_cycles += ts.task_own.cycles;
+            sii.task_calls += ts.task_calls;
+            sii.timer_own_cycles += ts.timer_own.cycles;
+            sii.timer_calls += ts.timer_calls;
+            sii.xfer_own_cycles += ts.xfer_own.cycles;
+            sii.xfer_calls += ts.xfer_calls;
             sii.nelements += 1;
         }
 
@@ -2373,6 +2670,46 @@ Router::router_read_handler(Element *e, void *thunk)
         delete[] si;
         break;
     }
+
+    case GH_PROFILE: {
+        if (!r)
+            break;
+        Vector<profile_info> pi;
+        click_cycles_t total = 0;
+        for (int ei = 0; ei < r->nelements(); ++ei) {
+            Element::ThreadStats ts = r->element(ei)->total_stats();
+            if (!ts.any())
+                continue;
+            profile_info x;
+            x.eindex = ei;
+            x.calls = ts.task_calls + ts.timer_calls + ts.xfer_calls;
+            x.own = ts.task_own + ts.timer_own + ts.xfer_own;
+            total += x.own.cycles;
+            pi.push_back(x);
+        }
+        if (pi.size())
+            click_qsort(pi.begin(), pi.size(), sizeof(profile_info), profile_info_compar);
+
+        sa << "# element class calls cycles %cycles cycles/call";
+        for (int i = 0; i < PerfEvents::nconfigured(); ++i)
+            sa << ' ' << PerfEvents::name(i) << "/call";
+        sa << '\n';
+        for (profile_info *it = pi.begin(); it != pi.end(); ++it) {
+            uint32_t calls = it->calls ? it->calls : 1;
+            sa << r->_element_names[it->eindex] << ' '
+               << r->element(it->eindex)->class_name() << ' '
+               << it->calls << ' '
+               << it->own.cycles << ' ';
+            sa.snprintf(20, "%.2f", total ? it->own.cycles * 100. / total : 0.);
+            sa << ' ' << int_divide(it->own.cycles, calls);
+            for (int i = 0; i < PerfEvents::nconfigured(); ++i) {
+                sa << ' ';
+                sa.snprintf(24, "%.2f", (double) it->own.events[i] / calls);
+            }
+            sa << '\n';
+        }
+        break;
+    }
 #endif
 
     }
@@ -2436,6 +2773,7 @@ Router::static_initialize()
 #if CLICK_STATS >= 2
         add_read_handler(0, "element_cycles.csv", router_read_handler, (void *)GH_ELEMENT_CYCLES);
         add_read_handler(0, "class_cycles.csv", router_read_handler, (void *)GH_CLASS_CYCLES);
+        add_read_handler(0, "profile", router_read_handler, (void *)GH_PROFILE);
         add_write_handler(0, "reset_cycles", router_write_handler, (void *)GH_RESET_CYCLES);
 #endif
     }
@@ -0,0 +1,283 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/routerimage.hh" -*-
+/*
+ * routerimage.{cc,hh} -- binary images of flattened routers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/routerimage.hh>
+#include <click/router.hh>
+#include <click/lexer.hh>
+#include <click/error.hh>
+#include <click/straccum.hh>
+#include <click/hashtable.hh>
+#include <click/standard/errorelement.hh>
+#if CLICK_USERLEVEL
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+CLICK_DECLS
+
+/* Layout, in host byte order:
+
+   header
+   element records	nelements * { class, name, configuration, filename, lineno }
+   connections		nconnections * { from_idx, from_port, to_idx, to_port }
+   requirements		nrequirements * { type, value }
+   string table		nstrings * { offset, length }
+   string data
+
+   Every field is a uint32_t.  Strings are indexes into the string table;
+   offsets are from the start of the image.  Identical strings are stored
+   once. */
+
+namespace {
+
+const char image_magic[8] = { '\177', 'C', 'l', 'i', 'c', 'k', 'R', 'I' };
+enum { image_version = 1, image_byte_order = 0x01020304 };
+
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t pointer_size;
+    uint32_t click_version;
+    uint32_t length;
+    uint32_t nelements;
+    uint32_t nconnections;
+    uint32_t nrequirements;
+    uint32_t nstrings;
+    uint32_t configuration;
+};
+
+class ImageWriter { public:
+
+    ImageWriter()
+	: _string_map(-1) {
+    }
+
+    uint32_t string_index(const String &s) {
+	int &x = _string_map[s];
+	if (x < 0) {
+	    x = _strings.size();
+	    _strings.push_back(s);
+	}
+	return x;
+    }
+
+    void add(uint32_t x) {
+	_body.append(reinterpret_cast<const char *>(&x), sizeof(x));
+    }
+
+    String finish(ImageHeader &h);
+
+  private:
+
+    HashTable<String, int> _string_map;
+    Vector<String> _strings;
+    StringAccum _body;
+
+};
+
+String
+ImageWriter::finish(ImageHeader &h)
+{
+    h.nstrings = _strings.size();
+    uint32_t table = sizeof(h) + _body.length();
+    uint32_t offset = table + _strings.size() * 2 * sizeof(uint32_t);
+    for (String *it = _strings.begin(); it != _strings.end(); ++it) {
+	add(offset);
+	add(it->length());
+	offset += it->length();
+    }
+    h.length = offset;
+
+    StringAccum sa(h.length);
+    sa.append(reinterpret_cast<const char *>(&h), sizeof(h));
+    sa << _body;
+    for (String *it = _strings.begin(); it != _strings.end(); ++it)
+	sa << *it;
+    return sa.take_string();
+}
+
+}
+
+bool
+RouterImage::is_image(const String &data)
+{
+    return data.length() >= (int) sizeof(image_magic)
+	&& memcmp(data.data(), image_magic, sizeof(image_magic)) == 0;
+}
+
+String
+RouterImage::unparse(const Router *router)
+{
+    ImageWriter w;
+    ImageHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, image_magic, sizeof(image_magic));
+    h.version = image_version;
+    h.byte_order = image_byte_order;
+    h.pointer_size = sizeof(void *);
+    h.click_version = CLICK_VERSION_CODE;
+    h.configuration = w.string_index(router->_configuration);
+
+    h.nelements = router->nelements();
+    for (int i = 0; i < router->nelements(); ++i) {
+	// split the landmark as in Router::elandmark
+	uint32_t x = router->_element_landmarkids[i];
+	uint32_t l = 0, r = router->_element_landmarks.size();
+	while (l < r) {
+	    uint32_t m = l + ((r - l) >> 1);
+	    if (x < router->_element_landmarks[m].first_landmarkid)
+		r = m;
+	    else
+		l = m + 1;
+	}
+	const Router::element_landmark_t &lm = router->_element_landmarks[r - 1];
+
+	w.add(w.string_index(router->element(i)->class_name()));
+	w.add(w.string_index(router->ename(i)));
+	w.add(w.string_index(router->econfiguration(i)));
+	w.add(w.string_index(lm.filename));
+	w.add(x - lm.first_landmarkid);
+    }
+
+    router->sort_connections();
+    h.nconnections = router->_conn.size();
+    for (const Router::Connection *it = router->_conn.begin();
+	 it != router->_conn.end(); ++it) {
+	w.add((*it)[1].idx);
+	w.add((*it)[1].port);
+	w.add((*it)[0].idx);
+	w.add((*it)[0].port);
+    }
+
+    h.nrequirements = router->_requirements.size() / 2;
+    for (const String *it = router->_requirements.begin();
+	 it != router->_requirements.end(); ++it)
+	w.add(w.string_index(*it));
+
+    return w.finish(h);
+}
+
+Router *
+RouterImage::parse(const String &image, const String &filename,
+		   Lexer *lexer, LexerExtra *lextra, Master *master,
+		   ErrorHandler *errh)
+{
+    ImageHeader h;
+    if (!is_image(image)) {
+	errh->error("%s: not a router image", filename.c_str());
+	return 0;
+    } else if (image.length() < (int) sizeof(h)) {
+	errh->error("%s: truncated router image", filename.c_str());
+	return 0;
+    }
+    memcpy(&h, image.data(), sizeof(h));
+    if (h.version != image_version || h.byte_order != image_byte_order
+	|| h.pointer_size != sizeof(void *)
+	|| h.click_version != CLICK_VERSION_CODE) {
+	errh->error("%s: router image was written by another Click build", filename.c_str());
+	return 0;
+    }
+
+    // check that every table fits
+    const uint32_t *body = reinterpret_cast<const uint32_t *>(image.data() + sizeof(h));
+    uint64_t nwords = (uint64_t) h.nelements * 5 + (uint64_t) h.nconnections * 4
+	+ (uint64_t) h.nrequirements * 2 + (uint64_t) h.nstrings * 2;
+    if (h.length != (uint32_t) image.length()
+	|| sizeof(h) + nwords * sizeof(uint32_t) > h.length) {
+	errh->error("%s: truncated router image", filename.c_str());
+	return 0;
+    }
+    const uint32_t *strtab = body + h.nelements * 5 + h.nconnections * 4
+	+ h.nrequirements * 2;
+    Vector<String> strings(h.nstrings, String());
+    for (uint32_t i = 0; i < h.nstrings; ++i) {
+	uint32_t offset = strtab[2 * i], len = strtab[2 * i + 1];
+	if (offset > h.length || len > h.length - offset) {
+	    errh->error("%s: corrupt router image", filename.c_str());
+	    return 0;
+	}
+	strings[i] = image.substring(offset, len);
+    }
+#define IMAGE_STRING(x) ((x) < h.nstrings ? strings[(x)] : String())
+
+    Router *router = new Router(IMAGE_STRING(h.configuration), master);
+    int before = errh->nerrors();
+
+    // requirements first, since they may load packages
+    const uint32_t *req = body + h.nelements * 5 + h.nconnections * 4;
+    for (uint32_t i = 0; i < h.nrequirements; ++i, req += 2) {
+	String type = IMAGE_STRING(req[0]), value = IMAGE_STRING(req[1]);
+	if (lextra)
+	    lextra->require(type, value, errh);
+	router->add_requirement(type, value);
+    }
+
+    const uint32_t *er = body;
+    for (uint32_t i = 0; i < h.nelements; ++i, er += 5) {
+	const String &class_name = IMAGE_STRING(er[0]);
+	Element *e = lexer->create_element(lexer->element_type(class_name));
+	if (!e) {
+	    errh->error("%s: unknown element class %<%s%>", filename.c_str(), class_name.c_str());
+	    e = new ErrorElement;
+	}
+	router->add_element(e, IMAGE_STRING(er[1]), IMAGE_STRING(er[2]),
+			    IMAGE_STRING(er[3]), er[4]);
+    }
+
+    const uint32_t *cr = body + h.nelements * 5;
+    for (uint32_t i = 0; i < h.nconnections; ++i, cr += 4)
+	if (cr[0] >= h.nelements || cr[2] >= h.nelements
+	    || router->add_connection(cr[0], cr[1], cr[2], cr[3]) < 0) {
+	    errh->error("%s: corrupt router image", filename.c_str());
+	    break;
+	}
+#undef IMAGE_STRING
+
+    if (errh->nerrors() != before) {
+	delete router;
+	return 0;
+    }
+    return router;
+}
+
+#if CLICK_USERLEVEL
+String
+RouterImage::map_file(const String &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+	return String();
+    String result;
+    struct stat st;
+    char magic[sizeof(image_magic)];
+    if (fstat(fd, &st) >= 0 && S_ISREG(st.st_mode)
+	&& st.st_size >= (off_t) sizeof(ImageHeader)
+	&& st.st_size < 0x7FFFFFFF
+	&& read(fd, magic, sizeof(magic)) == (ssize_t) sizeof(magic)
+	&& memcmp(magic, image_magic, sizeof(magic)) == 0) {
+	void *m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m != MAP_FAILED)
+	    result = String::make_stable(reinterpret_cast<const char *>(m), st.st_size);
+    }
+    close(fd);
+    return result;
+}
+#endif
+
+CLICK_ENDDECLS
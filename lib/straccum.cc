@@ -63,7 +63,7 @@ void
 StringAccum::assign_out_of_memory()
 {
     if (r_.cap > 0)
-	CLICK_LFREE(r_.s - MEMO_SPACE, r_.cap + MEMO_SPACE);
+	String::free_memory(r_.s - MEMO_SPACE, r_.cap + MEMO_SPACE);
     r_.s = reinterpret_cast<unsigned char *>(const_cast<char *>(String::empty_data()));
     r_.cap = -1;
     r_.len = 0;
@@ -80,7 +80,7 @@ StringAccum::grow(int want)
     while (ncap <= want)
 	ncap = (ncap + MEMO_SPACE) * 2 - MEMO_SPACE;
 
-    unsigned char *n = (unsigned char *) CLICK_LALLOC(ncap + MEMO_SPACE);
+    unsigned char *n = (unsigned char *) String::alloc_memory(ncap + MEMO_SPACE);
     if (!n) {
 	assign_out_of_memory();
 	return 0;
@@ -89,7 +89,7 @@ StringAccum::grow(int want)
 
     if (r_.cap > 0) {
 	memcpy(n, r_.s, r_.len);
-	CLICK_LFREE(r_.s - MEMO_SPACE, r_.cap + MEMO_SPACE);
+	String::free_memory(r_.s - MEMO_SPACE, r_.cap + MEMO_SPACE);
     }
     r_.s = n;
     r_.cap = ncap;
@@ -167,7 +167,7 @@ StringAccum::hard_append(const char *s, int len)
 	    memcpy(new_s, old_r.s, old_r.len);
 	    memcpy(new_s + old_r.len, s, len);
 	}
-	CLICK_LFREE(old_r.s - MEMO_SPACE, old_r.cap + MEMO_SPACE);
+	String::free_memory(old_r.s - MEMO_SPACE, old_r.cap + MEMO_SPACE);
     }
 }
 
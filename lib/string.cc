@@ -24,6 +24,7 @@
 #include <click/straccum.hh>
 #include <click/glue.hh>
 #include <click/vector.hh>
+#include <click/machine.hh>
 CLICK_DECLS
 
 /** @file string.hh
@@ -104,7 +105,7 @@ String::create_memo(char *space, int dirty, int capacity)
     if (space)
         memo = reinterpret_cast<memo_t *>(space);
     else
-        memo = (memo_t *) CLICK_LALLOC(MEMO_SPACE + capacity);
+        memo = (memo_t *) alloc_memory(MEMO_SPACE + capacity);
     if (memo) {
         memo->capacity = capacity;
         memo->dirty = dirty;
@@ -142,7 +143,148 @@ String::delete_memo(memo_t *memo)
         memo->next->pprev = memo->pprev;
 # endif
 #endif
-    CLICK_LFREE(memo, MEMO_SPACE + memo->capacity);
+    free_memory(memo, MEMO_SPACE + memo->capacity);
+}
+
+
+#if HAVE_STRING_POOL
+// ** String memory pool **
+
+// Short Strings and StringAccum buffers are created and destroyed
+// constantly by handlers, configuration parsing, and error reporting.
+// Freed blocks of up to STRING_POOL_MAXSIZE bytes go onto per-thread free
+// lists, one per 16-byte size class, for reuse.  Each list holds at most
+// STRING_POOL_COUNT blocks.  Blocks freed on one thread may be reused on
+// another.
+
+# define STRING_POOL_MAXSIZE		256
+# define STRING_POOL_COUNT		64
+# define STRING_POOL_NCLASSES		(STRING_POOL_MAXSIZE / 16)
+
+namespace {
+struct StringPoolBlock {
+    StringPoolBlock *next;
+};
+
+struct StringPool {
+    StringPoolBlock *free[STRING_POOL_NCLASSES];
+    unsigned count[STRING_POOL_NCLASSES];
+# if HAVE_MULTITHREAD
+    StringPool *thread_pool_next;
+# endif
+};
+}
+
+// Cleared by static_cleanup(), after which memory goes straight to the
+// allocator.
+static bool string_pool_active = true;
+
+# if HAVE_MULTITHREAD
+static __thread StringPool *thread_string_pool;
+static StringPool *string_pools;
+static volatile uint32_t string_pools_lock;
+# else
+static StringPool global_string_pool;
+# endif
+
+static inline StringPool *
+local_string_pool()
+{
+# if HAVE_MULTITHREAD
+    StringPool *sp = thread_string_pool;
+    if (unlikely(!sp) && (sp = new StringPool)) {
+        memset(sp, 0, sizeof(StringPool));
+        while (atomic_uint32_t::swap(string_pools_lock, 1) == 1)
+            /* do nothing */;
+        sp->thread_pool_next = string_pools;
+        string_pools = sp;
+        thread_string_pool = sp;
+        click_compiler_fence();
+        string_pools_lock = 0;
+    }
+    return sp;
+# else
+    return &global_string_pool;
+# endif
+}
+
+static void
+drain_string_pool(StringPool *sp)
+{
+    for (int c = 0; c < STRING_POOL_NCLASSES; ++c) {
+        while (StringPoolBlock *b = sp->free[c]) {
+            sp->free[c] = b->next;
+            CLICK_LFREE(b, (c + 1) * 16);
+        }
+        sp->count[c] = 0;
+    }
+}
+#endif
+
+/* Allocate @a size bytes for a memo or a StringAccum buffer.  The memory
+   must be freed with free_memory(), passing the same size. */
+void *
+String::alloc_memory(int size)
+{
+#if HAVE_STRING_POOL
+    if (size <= STRING_POOL_MAXSIZE) {
+        int c = (size - 1) >> 4;
+        if (likely(string_pool_active))
+            if (StringPool *sp = local_string_pool())
+                if (StringPoolBlock *b = sp->free[c]) {
+                    sp->free[c] = b->next;
+                    --sp->count[c];
+                    return b;
+                }
+        size = (c + 1) * 16;
+    }
+#endif
+    return CLICK_LALLOC(size);
+}
+
+void
+String::free_memory(void *p, int size)
+{
+#if HAVE_STRING_POOL
+    if (size <= STRING_POOL_MAXSIZE) {
+        int c = (size - 1) >> 4;
+        if (likely(string_pool_active))
+            if (StringPool *sp = local_string_pool())
+                if (sp->count[c] < STRING_POOL_COUNT) {
+                    StringPoolBlock *b = reinterpret_cast<StringPoolBlock *>(p);
+                    b->next = sp->free[c];
+                    sp->free[c] = b;
+                    ++sp->count[c];
+                    return;
+                }
+        size = (c + 1) * 16;
+    }
+#endif
+    CLICK_LFREE(p, size);
+}
+
+/** @brief Release memory cached for future Strings.
+ *
+ * Called when Click shuts down.  Strings may still be created and destroyed
+ * afterwards; they use the memory allocator directly. */
+void
+String::static_cleanup()
+{
+#if HAVE_STRING_POOL
+    string_pool_active = false;
+# if HAVE_MULTITHREAD
+    while (atomic_uint32_t::swap(string_pools_lock, 1) == 1)
+        /* do nothing */;
+    while (StringPool *sp = string_pools) {
+        string_pools = sp->thread_pool_next;
+        drain_string_pool(sp);
+        delete sp;
+    }
+    string_pools_lock = 0;
+# else
+    drain_string_pool(&global_string_pool);
+# endif
+#endif
 }
 
 
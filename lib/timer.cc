@@ -246,6 +246,22 @@ Timer::initialize(Element *owner, bool quiet)
     _thread = owner->master()->thread(tid);
 }
 
+void
+Timer::move_thread(int thread_id)
+{
+    assert(initialized());
+    RouterThread *thread = _owner->master()->thread(thread_id);
+    if (thread == _thread)
+	return;
+    if (scheduled()) {
+	Timestamp expiry_s = _expiry_s;
+	unschedule();
+	_thread = thread;
+	schedule_at_steady(expiry_s);
+    } else
+	_thread = thread;
+}
+
 int
 Timer::home_thread_id() const
 {
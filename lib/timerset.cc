@@ -95,18 +95,16 @@ inline void
 TimerSet::run_one_timer(Timer *t)
 {
 #if CLICK_STATS >= 2
-    Element *owner = t->_owner;
-    click_cycles_t start_cycles = click_get_cycles(),
-	start_child_cycles = owner->_child_cycles;
+    Element::ThreadStats &es = t->_owner->thread_stats(Element::stats_thread());
+    ProfileSample start = ProfileSample::now(), start_child = es.child;
 #endif
 
     t->_hook.callback(t, t->_thunk);
 
 #if CLICK_STATS >= 2
-    click_cycles_t all_delta = click_get_cycles() - start_cycles,
-	own_delta = all_delta - (owner->_child_cycles - start_child_cycles);
-    owner->_timer_calls += 1;
-    owner->_timer_own_cycles += own_delta;
+    ProfileSample all_delta = ProfileSample::now() - start;
+    es.timer_calls += 1;
+    es.timer_own += all_delta - (es.child - start_child);
 #endif
 }
 
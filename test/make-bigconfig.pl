@@ -0,0 +1,66 @@
+#! /usr/bin/perl -w
+#
+# make-bigconfig.pl -- make a very large configuration for benchmarking
+# configuration parsing and router initialization
+#
+# ./make-bigconfig.pl [-c] N
+#    Prints a configuration with N subscribers to standard output.  Each
+#    subscriber gets its own classifier, shaper, and counter, 6 elements
+#    in all, so N = 8333 yields about 50,000 elements.  With -c, each
+#    subscriber is an instance of a compound element class.
+#
+# Time the result with, for example:
+#    ./make-bigconfig.pl 8333 > big.click
+#    time click -q big.click
+
+use strict;
+
+my $compound = 0;
+if (@ARGV && $ARGV[0] eq '-c') {
+    $compound = 1;
+    shift @ARGV;
+}
+if (@ARGV != 1 || $ARGV[0] !~ /^\d+$/) {
+    print STDERR "usage: make-bigconfig.pl [-c] N\n";
+    exit 1;
+}
+my $n = $ARGV[0];
+
+print "// $n subscribers, generated by make-bigconfig.pl\n\n";
+
+print <<'END';
+src :: InfiniteSource(LIMIT 0, STOP false)
+    -> Strip(14)
+    -> CheckIPHeader
+    -> sub :: HashSwitch(16, 4);
+out :: Queue(1000) -> Unqueue -> Discard;
+
+END
+
+if ($compound) {
+    print <<'END';
+elementclass Subscriber { $rate |
+    input -> cl :: IPClassifier(tcp, udp, -);
+    cl[0] -> SetIPDSCP(10) -> shaper :: BandwidthRatedSplitter($rate);
+    cl[1] -> shaper;
+    cl[2] -> Paint(1) -> shaper;
+    shaper[0] -> c :: Counter -> output;
+    shaper[1] -> Discard;
+}
+
+END
+    for (my $i = 0; $i < $n; ++$i) {
+	my $rate = 1000 + $i;
+	print "sub[$i] -> s$i :: Subscriber(${rate}Bps) -> out;\n";
+    }
+} else {
+    for (my $i = 0; $i < $n; ++$i) {
+	my $rate = 1000 + $i;
+	print "sub[$i] -> s$i/cl :: IPClassifier(tcp, udp, -);\n";
+	print "s$i/cl[0] -> SetIPDSCP(10) -> s$i/shaper :: BandwidthRatedSplitter(${rate}Bps);\n";
+	print "s$i/cl[1] -> s$i/shaper;\n";
+	print "s$i/cl[2] -> Paint(1) -> s$i/shaper;\n";
+	print "s$i/shaper[0] -> s$i/c :: Counter -> out;\n";
+	print "s$i/shaper[1] -> Discard;\n";
+    }
+}
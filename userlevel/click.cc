@@ -58,6 +58,10 @@
 #include <click/userutils.hh>
 #include <click/args.hh>
 #include <click/handlercall.hh>
+#include <click/routerimage.hh>
+#if CLICK_STATS >= 2
+# include <click/perfevent.hh>
+#endif
 #include "elements/standard/quitwatcher.hh"
 #include "elements/userlevel/controlsocket.hh"
 CLICK_USING_DECLS
@@ -82,6 +86,9 @@ CLICK_USING_DECLS
 #define SOCKET_OPT              318
 #define THREADS_AFF_OPT         319
 #define DPDK_OPT                320
+#define PROFILE_OPT             321
+#define PROFILE_EVENTS_OPT      322
+#define IMAGE_OPT               323
 
 static const Clp_Option options[] = {
     { "allow-reconfigure", 'R', ALLOW_RECONFIG_OPT, 0, Clp_Negate },
@@ -91,9 +98,12 @@ static const Clp_Option options[] = {
     { "file", 'f', ROUTER_OPT, Clp_ValString, 0 },
     { "handler", 'h', HANDLER_OPT, Clp_ValString, 0 },
     { "help", 0, HELP_OPT, 0, 0 },
+    { "image", 0, IMAGE_OPT, Clp_ValString, 0 },
     { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
     { "socket", 0, SOCKET_OPT, Clp_ValInt, 0 },
     { "port", 'p', PORT_OPT, Clp_ValString, 0 },
+    { "profile", 0, PROFILE_OPT, Clp_ValString, Clp_Optional },
+    { "profile-events", 0, PROFILE_EVENTS_OPT, Clp_ValString, 0 },
     { "quit", 'q', QUIT_OPT, 0, 0 },
     { "simtime", 0, SIMTIME_OPT, Clp_ValDouble, Clp_Optional },
     { "simulation-time", 0, SIMTIME_OPT, Clp_ValDouble, Clp_Optional },
@@ -149,8 +159,13 @@ Options:\n\
                                 driver and print result to standard output.\n\
   -x, --exit-handler ELEMENT.H  Use handler ELEMENT.H value for exit status.\n\
   -o, --output FILE             Write flat configuration to FILE.\n\
+      --image FILE              Write binary router image to FILE.\n\
   -q, --quit                    Do not run driver.\n\
   -t, --time                    Print information on how long driver took.\n\
+      --profile[=FILE]          Print per-element cycle counts after running\n\
+                                driver (requires --enable-stats=2).\n\
+      --profile-events LIST     Also count hardware events in LIST, such as\n\
+                                instructions,llc-misses.\n\
   -w, --no-warnings             Do not print warnings.\n\
       --simtime                 Run in simulation time.\n\
   -C, --clickpath PATH          Use PATH for CLICKPATH.\n\
@@ -298,6 +313,7 @@ call_read_handlers(Vector<String> &handlers, ErrorHandler *errh)
 
 static Router* hotswap_router;
 static Router* hotswap_thunk_router;
+static bool hotswap_incremental;
 static bool hotswap_hook(Task *, void *);
 static Task hotswap_task(hotswap_hook, 0);
 
@@ -305,6 +321,16 @@ static bool
 hotswap_hook(Task*, void*)
 {
     hotswap_thunk_router->set_foreground(false);
+    if (hotswap_incremental) {
+        // Adopting unchanged elements rewires the running router, so
+        // initialize here, where no other task runs
+        hotswap_router->set_hotswap_router(click_router, true);
+        if (hotswap_router->initialize(ErrorHandler::default_handler()) < 0) {
+            delete hotswap_router;
+            hotswap_router = 0;
+            return true;
+        }
+    }
     hotswap_router->activate(ErrorHandler::default_handler());
     click_router->unuse();
     click_router = hotswap_router;
@@ -320,13 +346,14 @@ extern "C" {
 static void* hotswap_threadfunc(void*)
 {
     pthread_detach(pthread_self());
+    // Block first: hotconfig_handler takes hotswap_lock from a router
+    // thread, which block_all() waits for
+    click_master->block_all();
     pthread_mutex_lock(&hotswap_lock);
-    if (hotswap_router) {
-        click_master->block_all();
+    if (hotswap_router)
         hotswap_hook(0, 0);
-        click_master->unblock_all();
-    }
     pthread_mutex_unlock(&hotswap_lock);
+    click_master->unblock_all();
     return 0;
 }
 }
@@ -352,7 +379,8 @@ click_driver_control_socket_name(int number)
 
 static Router *
 parse_configuration(const String &text, bool text_is_expr, bool hotswap,
-                    ErrorHandler *errh)
+                    ErrorHandler *errh, bool incremental = false,
+                    String *image = 0)
 {
     int before_errors = errh->nerrors();
     Router *router = click_read_router(text, text_is_expr, errh, false,
@@ -360,6 +388,10 @@ parse_configuration(const String &text, bool text_is_expr, bool hotswap,
     if (!router)
         return 0;
 
+    // take the image before adding driver elements
+    if (image)
+        *image = RouterImage::unparse(router);
+
     // add new ControlSockets
     String retries = (hotswap ? ", RETRIES 1, RETRY_WARNINGS false" : "");
     int ncs = 0;
@@ -392,12 +424,13 @@ parse_configuration(const String &text, bool text_is_expr, bool hotswap,
 #endif
   }
 
-  // register hotswap router on new router
-  if (hotswap && click_router && click_router->initialized())
+  // register hotswap router on new router; hotswap_hook does this for
+  // incremental hotswaps
+  if (hotswap && !incremental && click_router && click_router->initialized())
       router->set_hotswap_router(click_router);
 
   if (errh->nerrors() == before_errors
-      && router->initialize(errh) >= 0)
+      && (incremental || router->initialize(errh) >= 0))
     return router;
   else {
     delete router;
@@ -406,15 +439,17 @@ parse_configuration(const String &text, bool text_is_expr, bool hotswap,
 }
 
 static int
-hotconfig_handler(const String &text, Element *, void *, ErrorHandler *errh)
+hotconfig_handler(const String &text, Element *, void *user_data, ErrorHandler *errh)
 {
-  if (Router *new_router = parse_configuration(text, true, true, errh)) {
+  bool incremental = (user_data != 0);
+  if (Router *new_router = parse_configuration(text, true, true, errh, incremental)) {
 #if HAVE_MULTITHREAD
       pthread_mutex_lock(&hotswap_lock);
 #endif
-      if (hotswap_router)
-          hotswap_router->unuse();
+      // a pending router was never used; hotswap_hook takes the reference
+      delete hotswap_router;
       hotswap_router = new_router;
+      hotswap_incremental = incremental;
       hotswap_thunk_router->set_foreground(true);
 #if HAVE_MULTITHREAD
       pthread_t thread_ignored;
@@ -527,11 +562,13 @@ main(int argc, char **argv)
   const char *router_file = 0;
   bool file_is_expr = false;
   const char *output_file = 0;
+  const char *image_file = 0;
   bool quit_immediately = false;
   bool report_time = false;
   bool allow_reconfigure = false;
   Vector<String> handlers;
   String exit_handler;
+  String profile_file;
   Vector<char*> dpdk_arg;
 
   while (1) {
@@ -567,6 +604,14 @@ main(int argc, char **argv)
       output_file = clp->vstr;
       break;
 
+     case IMAGE_OPT:
+      if (image_file) {
+        errh->error("image file specified twice");
+        goto bad_option;
+      }
+      image_file = clp->vstr;
+      break;
+
      case HANDLER_OPT:
       handlers.push_back(clp->vstr);
       break;
@@ -616,6 +661,23 @@ main(int argc, char **argv)
       report_time = true;
       break;
 
+     case PROFILE_OPT:
+#if CLICK_STATS >= 2
+      profile_file = clp->have_val ? clp->vstr : "-";
+#else
+      errh->warning("Click was built without --enable-stats=2, ignoring %<--profile%>");
+#endif
+      break;
+
+     case PROFILE_EVENTS_OPT:
+#if CLICK_STATS >= 2
+      if (PerfEvents::configure(clp->vstr, errh) < 0)
+          goto bad_option;
+#else
+      errh->warning("Click was built without --enable-stats=2, ignoring %<--profile-events%>");
+#endif
+      break;
+
      case WARNINGS_OPT:
       warnings = !clp->negated;
       break;
@@ -719,15 +781,19 @@ particular purpose.\n");
 #endif
 
   // provide hotconfig handler if asked
-  if (allow_reconfigure)
+  if (allow_reconfigure) {
       Router::add_write_handler(0, "hotconfig", hotconfig_handler, 0, Handler::f_raw | Handler::f_nonexclusive);
+      Router::add_write_handler(0, "hotconfig_incremental", hotconfig_handler, (void *) 1, Handler::f_raw | Handler::f_nonexclusive);
+  }
   Router::add_read_handler(0, "timewarp", timewarp_read_handler, 0);
   if (Timestamp::warp_class() != Timestamp::warp_simulation)
       Router::add_write_handler(0, "timewarp", timewarp_write_handler, 0);
 
   // parse configuration
   click_master = new Master(click_nthreads);
-  click_router = parse_configuration(router_file, file_is_expr, false, errh);
+  String image;
+  click_router = parse_configuration(router_file, file_is_expr, false, errh,
+                                     false, image_file ? &image : 0);
   if (!click_router)
     return cleanup(clp, 1);
   click_router->use();
@@ -759,6 +825,18 @@ particular purpose.\n");
     }
   }
 
+  // output router image
+  if (image_file) {
+    FILE *f = fopen(image_file, "wb");
+    bool ok = f && fwrite(image.data(), 1, image.length(), f) == (size_t) image.length();
+    if (f && fclose(f) != 0)
+      ok = false;
+    if (!ok) {
+      errh->error("%s: %s", image_file, strerror(errno));
+      exit_value = 1;
+    }
+  }
+
   struct rusage before, after;
   getrusage(RUSAGE_SELF, &before);
   Timestamp before_time = Timestamp::now_unwarped();
@@ -830,6 +908,22 @@ particular purpose.\n");
     if (call_read_handlers(handlers, errh) < 0)
       exit_value = 1;
 
+#if CLICK_STATS >= 2
+  // report profile
+  if (profile_file && click_router) {
+    String profile = HandlerCall::call_read("profile", click_router->root_element(), errh);
+    FILE *f = stdout;
+    if (profile_file != "-" && !(f = fopen(profile_file.c_str(), "w"))) {
+      errh->error("%s: %s", profile_file.c_str(), strerror(errno));
+      exit_value = 1;
+    } else {
+      fwrite(profile.data(), 1, profile.length(), f);
+      if (f != stdout)
+        fclose(f);
+    }
+  }
+#endif
+
   // call exit handler
   if (exit_handler) {
     int before = errh->nerrors();